@@ -24,21 +24,44 @@
 #endif
 
 #include <stdlib.h>
+#include <unistd.h>
 #include <string.h>
 #include <poll.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <sys/time.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 
 #include "../weechat.h"
 #include "../wee-hook.h"
 #include "../wee-infolist.h"
 #include "../wee-log.h"
+#include "../wee-util.h"
 #include "../../gui/gui-chat.h"
 
 
 struct pollfd *hook_fd_pollfd = NULL;  /* file descriptors for poll()       */
 int hook_fd_pollfd_count = 0;          /* number of file descriptors        */
 
+struct t_hook **hook_fd_index = NULL;  /* fd hooks indexed by fd number     */
+int hook_fd_index_size = 0;            /* size of index                     */
+
+#ifdef HAVE_SYS_EPOLL_H
+int hook_fd_epoll = -1;                /* epoll fd (-1 if not created)      */
+int hook_fd_epoll_disabled = 0;        /* 1 if epoll failed: use poll()     */
+struct epoll_event *hook_fd_epoll_events = NULL; /* events for epoll_wait() */
+int hook_fd_epoll_events_count = 0;    /* size of events array              */
+unsigned int hook_fd_epoll_generation = 0; /* incremented for each fd added */
+int hook_fd_epoll_remove_failed = 0;   /* 1 if a fd could not be removed    */
+                                       /* from epoll (stale registration)   */
+#endif
+
+long long hook_fd_stats_wakeups = 0;   /* number of poll/epoll wakeups      */
+long long hook_fd_stats_callbacks = 0; /* number of fd callbacks called     */
+long long hook_fd_stats_time = 0;      /* time spent in callbacks (in µs)   */
+
 
 /*
  * Returns description of hook.
@@ -62,6 +85,21 @@ hook_fd_get_description (struct t_hook *hook)
     return strdup (str_desc);
 }
 
+/*
+ * Returns the name of backend used to wait for activity on file descriptors:
+ * "epoll" or "poll".
+ */
+
+const char *
+hook_fd_get_backend ()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (!hook_fd_epoll_disabled)
+        return "epoll";
+#endif
+    return "poll";
+}
+
 /*
  * Searches for a fd hook in list.
  *
@@ -71,27 +109,67 @@ hook_fd_get_description (struct t_hook *hook)
 struct t_hook *
 hook_fd_search (int fd)
 {
-    struct t_hook *ptr_hook;
+    if ((fd < 0) || (fd >= hook_fd_index_size))
+        return NULL;
 
-    for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
-         ptr_hook = ptr_hook->next_hook)
+    return hook_fd_index[fd];
+}
+
+/*
+ * Sets the hook for a fd in the index (hook can be NULL to remove the fd
+ * from index).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (memory allocation failed)
+ */
+
+int
+hook_fd_index_set (int fd, struct t_hook *hook)
+{
+    struct t_hook **new_index;
+    int i, new_size;
+
+    if (fd < 0)
+        return 0;
+
+    if (fd >= hook_fd_index_size)
     {
-        if (!ptr_hook->deleted && (HOOK_FD(ptr_hook, fd) == fd))
-            return ptr_hook;
+        if (!hook)
+            return 1;
+        new_size = (hook_fd_index_size > 0) ? hook_fd_index_size : 64;
+        while (new_size <= fd)
+        {
+            new_size *= 2;
+        }
+        new_index = realloc (hook_fd_index, new_size * sizeof (*new_index));
+        if (!new_index)
+            return 0;
+        for (i = hook_fd_index_size; i < new_size; i++)
+        {
+            new_index[i] = NULL;
+        }
+        hook_fd_index = new_index;
+        hook_fd_index_size = new_size;
     }
 
-    /* fd hook not found */
-    return NULL;
+    hook_fd_index[fd] = hook;
+
+    return 1;
 }
 
 /*
- * Reallocates the "struct pollfd" array for poll().
+ * Reallocates the "struct pollfd" array for poll() (and the events array for
+ * epoll_wait()).
  */
 
 void
 hook_fd_realloc_pollfd ()
 {
     struct pollfd *ptr_pollfd;
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event *ptr_events;
+#endif
     int count;
 
     if (hooks_count[HOOK_TYPE_FD] == hook_fd_pollfd_count)
@@ -106,9 +184,27 @@ hook_fd_realloc_pollfd ()
             free (hook_fd_pollfd);
             hook_fd_pollfd = NULL;
         }
+#ifdef HAVE_SYS_EPOLL_H
+        if (hook_fd_epoll_events)
+        {
+            free (hook_fd_epoll_events);
+            hook_fd_epoll_events = NULL;
+        }
+        hook_fd_epoll_events_count = 0;
+#endif
     }
     else
     {
+#ifdef HAVE_SYS_EPOLL_H
+        /* on error, the old array (with its size) is kept */
+        ptr_events = realloc (hook_fd_epoll_events,
+                              count * sizeof (struct epoll_event));
+        if (ptr_events)
+        {
+            hook_fd_epoll_events = ptr_events;
+            hook_fd_epoll_events_count = count;
+        }
+#endif
         ptr_pollfd = realloc (hook_fd_pollfd,
                               count * sizeof (struct pollfd));
         if (!ptr_pollfd)
@@ -119,6 +215,143 @@ hook_fd_realloc_pollfd ()
     hook_fd_pollfd_count = count;
 }
 
+/*
+ * Sets error on a fd hook and displays an error if the file descriptor is
+ * invalid (only the first time the error occurs).
+ */
+
+void
+hook_fd_set_error (struct t_hook *hook, int error)
+{
+    if (HOOK_FD(hook, error) != 0)
+        return;
+
+    HOOK_FD(hook, error) = error;
+    if (error == EBADF)
+    {
+        gui_chat_printf (NULL,
+                         _("%sBad file descriptor (%d) used in "
+                           "hook_fd"),
+                         gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                         HOOK_FD(hook, fd));
+    }
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * Stops using epoll: poll() is used instead for all file descriptors.
+ */
+
+void
+hook_fd_epoll_disable ()
+{
+    if (hook_fd_epoll >= 0)
+    {
+        close (hook_fd_epoll);
+        hook_fd_epoll = -1;
+    }
+    hook_fd_epoll_disabled = 1;
+}
+
+/*
+ * Adds or modifies a fd hook in the epoll interest set.
+ *
+ * The data associated to the fd is the fd number + a generation number: this
+ * is used to detect events coming from a stale registration (file descriptor
+ * closed without removing it from epoll, while it is still open in a child
+ * process).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (epoll is disabled if the error is not related to the fd itself)
+ */
+
+int
+hook_fd_epoll_ctl (struct t_hook *hook, int operation)
+{
+    struct epoll_event event;
+
+    if (hook_fd_epoll < 0)
+        return 0;
+
+    if (operation == EPOLL_CTL_ADD)
+        HOOK_FD(hook, generation) = ++hook_fd_epoll_generation;
+
+    memset (&event, 0, sizeof (event));
+    if (HOOK_FD(hook, flags) & HOOK_FD_FLAG_READ)
+        event.events |= EPOLLIN;
+    if (HOOK_FD(hook, flags) & HOOK_FD_FLAG_WRITE)
+        event.events |= EPOLLOUT;
+    event.data.u64 = ((uint64_t)HOOK_FD(hook, generation) << 32)
+        | (uint32_t)HOOK_FD(hook, fd);
+
+    if (epoll_ctl (hook_fd_epoll, operation, HOOK_FD(hook, fd), &event) == 0)
+        return 1;
+
+    /* fd already in interest set (or not in it): retry the other way */
+    if (((operation == EPOLL_CTL_ADD) && (errno == EEXIST))
+        || ((operation == EPOLL_CTL_MOD) && (errno == ENOENT)))
+    {
+        operation = (operation == EPOLL_CTL_ADD) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (epoll_ctl (hook_fd_epoll, operation, HOOK_FD(hook, fd), &event) == 0)
+            return 1;
+    }
+
+    if (errno == EBADF)
+    {
+        hook_fd_set_error (hook, errno);
+        return 0;
+    }
+
+    /*
+     * any other error (fd not supported by epoll like a regular file, no
+     * memory, too many watches): fallback to poll() for all fds
+     */
+    hook_fd_epoll_disable ();
+    return 0;
+}
+
+/*
+ * Creates a new epoll instance and adds all fd hooks in it.
+ *
+ * This is called when the epoll instance is created and when an event is
+ * received for a stale registration which could not be removed from the
+ * current epoll instance.
+ */
+
+void
+hook_fd_epoll_rebuild ()
+{
+    struct t_hook *ptr_hook;
+
+    if (hook_fd_epoll_disabled)
+        return;
+
+    if (hook_fd_epoll >= 0)
+        close (hook_fd_epoll);
+
+    hook_fd_epoll_remove_failed = 0;
+
+    hook_fd_epoll = epoll_create1 (EPOLL_CLOEXEC);
+    if (hook_fd_epoll < 0)
+    {
+        hook_fd_epoll_disable ();
+        return;
+    }
+
+    for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (!ptr_hook->deleted && (HOOK_FD(ptr_hook, error) == 0))
+        {
+            hook_fd_epoll_ctl (ptr_hook, EPOLL_CTL_ADD);
+            if (hook_fd_epoll_disabled)
+                return;
+        }
+    }
+}
+#endif
+
 /*
  * Callback called when a fd hook is added in the list of hooks.
  */
@@ -126,10 +359,19 @@ hook_fd_realloc_pollfd ()
 void
 hook_fd_add_cb (struct t_hook *hook)
 {
-    /* make C compiler happy */
-    (void) hook;
+    hook_fd_index_set (HOOK_FD(hook, fd), hook);
 
     hook_fd_realloc_pollfd ();
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (!hook_fd_epoll_disabled)
+    {
+        if (hook_fd_epoll < 0)
+            hook_fd_epoll_rebuild ();
+        else
+            hook_fd_epoll_ctl (hook, EPOLL_CTL_ADD);
+    }
+#endif
 }
 
 /*
@@ -143,6 +385,23 @@ hook_fd_remove_cb (struct t_hook *hook)
     (void) hook;
 
     hook_fd_realloc_pollfd ();
+
+    if (hooks_count[HOOK_TYPE_FD] == 0)
+    {
+        if (hook_fd_index)
+        {
+            free (hook_fd_index);
+            hook_fd_index = NULL;
+        }
+        hook_fd_index_size = 0;
+#ifdef HAVE_SYS_EPOLL_H
+        if (hook_fd_epoll >= 0)
+        {
+            close (hook_fd_epoll);
+            hook_fd_epoll = -1;
+        }
+#endif
+    }
 }
 
 /*
@@ -182,6 +441,7 @@ hook_fd (struct t_weechat_plugin *plugin, int fd, int flag_read,
     new_hook_fd->fd = fd;
     new_hook_fd->flags = 0;
     new_hook_fd->error = 0;
+    new_hook_fd->generation = 0;
     if (flag_read)
         new_hook_fd->flags |= HOOK_FD_FLAG_READ;
     if (flag_write)
@@ -195,20 +455,58 @@ hook_fd (struct t_weechat_plugin *plugin, int fd, int flag_read,
 }
 
 /*
- * Executes fd hooks:
- * - poll() on fie descriptors
- * - call of hook fd callbacks if needed.
+ * Changes flags of a fd hook (and updates the epoll interest set if needed).
  */
 
 void
-hook_fd_exec ()
+hook_fd_set_flags (struct t_hook *hook, int flags)
 {
-    int i, num_fd, timeout, ready, found;
-    struct t_hook *ptr_hook, *next_hook;
+    if (!hook || hook->deleted || (hook->type != HOOK_TYPE_FD)
+        || (HOOK_FD(hook, flags) == flags))
+    {
+        return;
+    }
 
-    if (!weechat_hooks[HOOK_TYPE_FD])
+    HOOK_FD(hook, flags) = flags;
+
+#ifdef HAVE_SYS_EPOLL_H
+    if ((hook_fd_epoll >= 0) && (HOOK_FD(hook, error) == 0))
+        hook_fd_epoll_ctl (hook, EPOLL_CTL_MOD);
+#endif
+}
+
+/*
+ * Runs the callback of a fd hook.
+ */
+
+void
+hook_fd_run_callback (struct t_hook *hook)
+{
+    if (!hook || hook->deleted || hook->running)
         return;
 
+    hook->running = 1;
+    (void) (HOOK_FD(hook, callback)) (
+        hook->callback_pointer,
+        hook->callback_data,
+        HOOK_FD(hook, fd));
+    hook->running = 0;
+
+    hook_fd_stats_callbacks++;
+}
+
+/*
+ * Waits for activity on file descriptors with poll() and calls callbacks of
+ * fd hooks with activity.
+ */
+
+void
+hook_fd_exec_poll (int timeout)
+{
+    int i, num_fd, ready;
+    struct t_hook *ptr_hook;
+    struct timeval tv_start, tv_end;
+
     /* build an array of "struct pollfd" for poll() */
     num_fd = 0;
     for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
@@ -220,19 +518,11 @@ hook_fd_exec ()
             if ((fcntl (HOOK_FD(ptr_hook,fd), F_GETFD) == -1)
                 && (errno == EBADF))
             {
-                if (HOOK_FD(ptr_hook, error) == 0)
-                {
-                    HOOK_FD(ptr_hook, error) = errno;
-                    gui_chat_printf (NULL,
-                                     _("%sBad file descriptor (%d) used in "
-                                       "hook_fd"),
-                                     gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
-                                     HOOK_FD(ptr_hook, fd));
-                }
+                hook_fd_set_error (ptr_hook, errno);
             }
             else
             {
-                if (num_fd > hook_fd_pollfd_count)
+                if (num_fd >= hook_fd_pollfd_count)
                     break;
 
                 hook_fd_pollfd[num_fd].fd = HOOK_FD(ptr_hook, fd);
@@ -249,49 +539,119 @@ hook_fd_exec ()
     }
 
     /* perform the poll() */
-    timeout = hook_timer_get_time_to_next ();
-    if (hook_process_pending)
-        timeout = 0;
     ready = poll (hook_fd_pollfd, num_fd, timeout);
     if (ready <= 0)
         return;
 
+    hook_fd_stats_wakeups++;
+
     /* execute callbacks for file descriptors with activity */
     hook_exec_start ();
+    gettimeofday (&tv_start, NULL);
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_FD];
-    while (ptr_hook)
+    for (i = 0; i < num_fd; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        if (hook_fd_pollfd[i].revents)
+            hook_fd_run_callback (hook_fd_search (hook_fd_pollfd[i].fd));
+    }
+
+    gettimeofday (&tv_end, NULL);
+    hook_fd_stats_time += util_timeval_diff (&tv_start, &tv_end);
+    hook_exec_end ();
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * Waits for activity on file descriptors with epoll_wait() and calls
+ * callbacks of fd hooks with activity.
+ */
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running)
+void
+hook_fd_exec_epoll (int timeout)
+{
+    int i, fd, ready, stale;
+    unsigned int generation;
+    struct t_hook *ptr_hook;
+    struct timeval tv_start, tv_end;
+
+    /* no memory for events: use poll() for this time */
+    if (hook_fd_epoll_events_count <= 0)
+    {
+        hook_fd_exec_poll (timeout);
+        return;
+    }
+
+    ready = epoll_wait (hook_fd_epoll, hook_fd_epoll_events,
+                        hook_fd_epoll_events_count, timeout);
+    if (ready <= 0)
+        return;
+
+    hook_fd_stats_wakeups++;
+
+    /* execute callbacks for file descriptors with activity */
+    hook_exec_start ();
+    gettimeofday (&tv_start, NULL);
+
+    stale = 0;
+    for (i = 0; i < ready; i++)
+    {
+        fd = (int)(hook_fd_epoll_events[i].data.u64 & 0xFFFFFFFF);
+        generation = (unsigned int)(hook_fd_epoll_events[i].data.u64 >> 32);
+        ptr_hook = hook_fd_search (fd);
+        if (!ptr_hook || (HOOK_FD(ptr_hook, generation) != generation))
         {
-            found = 0;
-            for (i = 0; i < num_fd; i++)
-            {
-                if (hook_fd_pollfd[i].fd == HOOK_FD(ptr_hook, fd)
-                    && hook_fd_pollfd[i].revents)
-                {
-                    found = 1;
-                    break;
-                }
-            }
-            if (found)
-            {
-                ptr_hook->running = 1;
-                (void) (HOOK_FD(ptr_hook, callback)) (
-                    ptr_hook->callback_pointer,
-                    ptr_hook->callback_data,
-                    HOOK_FD(ptr_hook, fd));
-                ptr_hook->running = 0;
-            }
+            /*
+             * event for a fd unhooked (or hooked again) after epoll_wait()
+             * returned, or for a stale registration: ignore it
+             */
+            stale = 1;
+            continue;
         }
-
-        ptr_hook = next_hook;
+        hook_fd_run_callback (ptr_hook);
     }
 
+    gettimeofday (&tv_end, NULL);
+    hook_fd_stats_time += util_timeval_diff (&tv_start, &tv_end);
     hook_exec_end ();
+
+    /*
+     * event received for a fd that is not hooked any more, and a fd could
+     * not be removed from epoll (closed before unhook, but still open in a
+     * child process): the registration can not be removed any more, so the
+     * whole epoll instance is rebuilt
+     */
+    if (stale && hook_fd_epoll_remove_failed && (hook_fd_epoll >= 0))
+        hook_fd_epoll_rebuild ();
+}
+#endif
+
+/*
+ * Executes fd hooks:
+ * - wait for activity on file descriptors (with epoll_wait() or poll())
+ * - call of hook fd callbacks if needed.
+ */
+
+void
+hook_fd_exec ()
+{
+    int timeout;
+
+    if (!weechat_hooks[HOOK_TYPE_FD])
+        return;
+
+    timeout = hook_timer_get_time_to_next ();
+    if (hook_process_pending)
+        timeout = 0;
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (hook_fd_epoll >= 0)
+    {
+        hook_fd_exec_epoll (timeout);
+        return;
+    }
+#endif
+
+    hook_fd_exec_poll (timeout);
 }
 
 /*
@@ -304,6 +664,24 @@ hook_fd_free_data (struct t_hook *hook)
     if (!hook || !hook->hook_data)
         return;
 
+    /*
+     * remove the fd from index and epoll now (and not when the hook is
+     * removed from list), because the fd is usually closed by the caller
+     * immediately after unhook
+     */
+    if (hook_fd_search (HOOK_FD(hook, fd)) == hook)
+        hook_fd_index_set (HOOK_FD(hook, fd), NULL);
+#ifdef HAVE_SYS_EPOLL_H
+    if ((hook_fd_epoll >= 0) && (HOOK_FD(hook, error) == 0))
+    {
+        if (epoll_ctl (hook_fd_epoll, EPOLL_CTL_DEL, HOOK_FD(hook, fd),
+                       NULL) != 0)
+        {
+            hook_fd_epoll_remove_failed = 1;
+        }
+    }
+#endif
+
     free (hook->hook_data);
     hook->hook_data = NULL;
 }
@@ -350,4 +728,5 @@ hook_fd_print_log (struct t_hook *hook)
     log_printf ("    fd. . . . . . . . . . : %d", HOOK_FD(hook, fd));
     log_printf ("    flags . . . . . . . . : %d", HOOK_FD(hook, flags));
     log_printf ("    error . . . . . . . . : %d", HOOK_FD(hook, error));
+    log_printf ("    generation. . . . . . : %u", HOOK_FD(hook, generation));
 }
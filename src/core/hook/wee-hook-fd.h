@@ -39,9 +39,15 @@ struct t_hook_fd
     int flags;                         /* fd flags (read,write,..)          */
     int error;                         /* contains errno if error occurred  */
                                        /* with fd                           */
+    unsigned int generation;           /* generation of epoll registration  */
 };
 
+extern long long hook_fd_stats_wakeups;
+extern long long hook_fd_stats_callbacks;
+extern long long hook_fd_stats_time;
+
 extern char *hook_fd_get_description (struct t_hook *hook);
+extern const char *hook_fd_get_backend ();
 extern void hook_fd_add_cb (struct t_hook *hook);
 extern void hook_fd_remove_cb (struct t_hook *hook);
 extern struct t_hook *hook_fd (struct t_weechat_plugin *plugin, int fd,
@@ -50,6 +56,7 @@ extern struct t_hook *hook_fd (struct t_weechat_plugin *plugin, int fd,
                                t_hook_callback_fd *callback,
                                const void *callback_pointer,
                                void *callback_data);
+extern void hook_fd_set_flags (struct t_hook *hook, int flags);
 extern void hook_fd_exec ();
 extern void hook_fd_free_data (struct t_hook *hook);
 extern int hook_fd_add_to_infolist (struct t_infolist_item *item,
@@ -25,12 +25,14 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "../weechat.h"
 #include "../wee-hook.h"
 #include "../wee-infolist.h"
 #include "../wee-log.h"
 #include "../wee-string.h"
+#include "../wee-util.h"
 #include "../../plugins/plugin.h"
 
 
@@ -128,21 +130,40 @@ hook_hsignal_match (const char *signal, struct t_hook *hook)
 int
 hook_hsignal_send (const char *signal, struct t_hashtable *hashtable)
 {
-    struct t_hook *ptr_hook, *next_hook;
-    int rc;
+    struct t_hook_match *ptr_match;
+    struct t_hook *ptr_hook, *hooks_static[HOOK_MATCH_STATIC_SIZE], **hooks;
+    struct timeval tv_start, tv_end;
+    int i, num_hooks, rc;
 
     rc = WEECHAT_RC_OK;
 
+    ptr_match = hook_match_get (HOOK_TYPE_HSIGNAL, signal, &hook_hsignal_match);
+    if (!ptr_match)
+        return rc;
+
+    ptr_match->count++;
+
+    if (ptr_match->num_hooks == 0)
+        return rc;
+
+    /* copy hooks matching: the cache may be updated by callbacks */
+    num_hooks = ptr_match->num_hooks;
+    hooks = (num_hooks <= HOOK_MATCH_STATIC_SIZE) ?
+        hooks_static : malloc (num_hooks * sizeof (*hooks));
+    if (!hooks)
+        return rc;
+    memcpy (hooks, ptr_match->hooks, num_hooks * sizeof (*hooks));
+
+    ptr_match->running++;
     hook_exec_start ();
+    gettimeofday (&tv_start, NULL);
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_HSIGNAL];
-    while (ptr_hook)
+    for (i = 0; i < num_hooks; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks[i];
 
         if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (hook_hsignal_match (signal, ptr_hook)))
+            && !ptr_hook->running)
         {
             ptr_hook->running = 1;
             rc = (HOOK_HSIGNAL(ptr_hook, callback))
@@ -155,12 +176,17 @@ hook_hsignal_send (const char *signal, struct t_hashtable *hashtable)
             if (rc == WEECHAT_RC_OK_EAT)
                 break;
         }
-
-        ptr_hook = next_hook;
     }
 
+    gettimeofday (&tv_end, NULL);
+    ptr_match->time += util_timeval_diff (&tv_start, &tv_end);
+    ptr_match->running--;
+
     hook_exec_end ();
 
+    if (hooks != hooks_static)
+        free (hooks);
+
     return rc;
 }
 
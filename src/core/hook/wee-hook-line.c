@@ -111,100 +111,210 @@ hook_line (struct t_weechat_plugin *plugin, const char *buffer_type,
         &new_hook_line->num_buffers);
     new_hook_line->tags_array = string_split_tags (tags,
                                                    &new_hook_line->tags_count);
+    new_hook_line->tags_mask = gui_line_tags_mask_compile (
+        new_hook_line->tags_count, new_hook_line->tags_array);
 
     hook_add_to_list (new_hook);
 
     return new_hook;
 }
 
+/*
+ * Checks if a line hook matches a buffer (name is the buffer pointer as
+ * string): it matches if the buffer type and full name are matching.
+ *
+ * Returns:
+ *   1: hook matches buffer
+ *   0: hook does not match buffer
+ */
+
+int
+hook_line_match (const char *name, struct t_hook *hook)
+{
+    struct t_gui_buffer *buffer;
+    unsigned long value;
+
+    if (sscanf (name, "%lx", &value) != 1)
+        return 0;
+
+    buffer = (struct t_gui_buffer *)value;
+
+    return (((HOOK_LINE(hook, buffer_type) == -1)
+             || ((int)(buffer->type) == (HOOK_LINE(hook, buffer_type))))
+            && string_match_list (buffer->full_name,
+                                  (const char **)HOOK_LINE(hook, buffers),
+                                  0)) ? 1 : 0;
+}
+
+/*
+ * Runs callback of a line hook and updates the line data.
+ */
+
+void
+hook_line_run_callback (struct t_hook *hook, struct t_gui_line *line,
+                        struct t_hashtable *hashtable)
+{
+    struct t_hashtable *hashtable2;
+    char str_value[128], *str_tags;
+
+    HASHTABLE_SET_POINTER("buffer", line->data->buffer);
+    HASHTABLE_SET_STR("buffer_name", line->data->buffer->full_name);
+    HASHTABLE_SET_STR("buffer_type",
+                      gui_buffer_type_string[line->data->buffer->type]);
+    HASHTABLE_SET_INT("y", line->data->y);
+    HASHTABLE_SET_TIME("date", line->data->date);
+    HASHTABLE_SET_TIME("date_printed", line->data->date_printed);
+    HASHTABLE_SET_STR_NOT_NULL("str_time", line->data->str_time);
+    HASHTABLE_SET_INT("tags_count", line->data->tags_count);
+    str_tags = string_rebuild_split_string (
+        (const char **)line->data->tags_array, ",", 0, -1);
+    HASHTABLE_SET_STR_NOT_NULL("tags", str_tags);
+    if (str_tags)
+        free (str_tags);
+    HASHTABLE_SET_INT("displayed", line->data->displayed);
+    HASHTABLE_SET_INT("notify_level", line->data->notify_level);
+    HASHTABLE_SET_INT("highlight", line->data->highlight);
+    HASHTABLE_SET_STR_NOT_NULL("prefix", line->data->prefix);
+    HASHTABLE_SET_STR_NOT_NULL("message", line->data->message);
+
+    /* run callback */
+    hook->running = 1;
+    hashtable2 = (HOOK_LINE(hook, callback))
+        (hook->callback_pointer,
+         hook->callback_data,
+         hashtable);
+    hook->running = 0;
+
+    if (hashtable2)
+    {
+        gui_line_hook_update (line, hashtable, hashtable2);
+        hashtable_free (hashtable2);
+    }
+}
+
 /*
  * Executes a line hook and updates the line data.
+ *
+ * The line hooks matching the buffer (type and name) are taken from cache
+ * (see function hook_match_get), so that only the tags are checked for
+ * each line. If a callback moves the line to another buffer, the next hooks
+ * are checked with the new buffer.
  */
 
 void
 hook_line_exec (struct t_gui_line *line)
 {
-    struct t_hook *ptr_hook, *next_hook;
-    struct t_hashtable *hashtable, *hashtable2;
-    char str_value[128], *str_tags;
+    struct t_hook_match *ptr_match;
+    struct t_hook *ptr_hook, *hooks_static[HOOK_MATCH_STATIC_SIZE], **hooks;
+    struct t_hashtable *hashtable;
+    struct t_gui_buffer *ptr_buffer;
+    char str_buffer[64];
+    int i, num_hooks;
 
     if (!weechat_hooks[HOOK_TYPE_LINE])
         return;
 
+    ptr_buffer = line->data->buffer;
+
+    snprintf (str_buffer, sizeof (str_buffer),
+              "0x%lx", (unsigned long)ptr_buffer);
+    ptr_match = hook_match_get (HOOK_TYPE_LINE, str_buffer, &hook_line_match);
+    if (!ptr_match)
+        return;
+
+    ptr_match->count++;
+
+    if (ptr_match->num_hooks == 0)
+        return;
+
+    /* copy hooks matching: the cache may be updated by callbacks */
+    num_hooks = ptr_match->num_hooks;
+    hooks = (num_hooks <= HOOK_MATCH_STATIC_SIZE) ?
+        hooks_static : malloc (num_hooks * sizeof (*hooks));
+    if (!hooks)
+        return;
+    memcpy (hooks, ptr_match->hooks, num_hooks * sizeof (*hooks));
+
     hashtable = NULL;
+    ptr_hook = NULL;
 
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_LINE];
-    while (ptr_hook)
+    for (i = 0; i < num_hooks; i++)
     {
-        next_hook = ptr_hook->next_hook;
-
-        if (!ptr_hook->deleted && !ptr_hook->running
-            && ((HOOK_LINE(ptr_hook, buffer_type) == -1)
-                || ((int)(line->data->buffer->type) == (HOOK_LINE(ptr_hook, buffer_type))))
-            && string_match_list (line->data->buffer->full_name,
-                                  (const char **)HOOK_LINE(ptr_hook, buffers),
-                                  0)
-            && (!HOOK_LINE(ptr_hook, tags_array)
-                || gui_line_match_tags (line->data,
-                                        HOOK_LINE(ptr_hook, tags_count),
-                                        HOOK_LINE(ptr_hook, tags_array))))
+        ptr_hook = hooks[i];
+
+        if (ptr_hook->deleted || ptr_hook->running
+            || (HOOK_LINE(ptr_hook, tags_array)
+                && !gui_line_match_tags_mask (line->data,
+                                              HOOK_LINE(ptr_hook, tags_mask))))
+        {
+            continue;
+        }
+
+        /* create the hashtable that will be sent to callback */
+        if (!hashtable)
         {
-            /* create the hashtable that will be sent to callback */
+            hashtable = hashtable_new (32,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       NULL, NULL);
             if (!hashtable)
+                break;
+        }
+
+        hook_line_run_callback (ptr_hook, line, hashtable);
+
+        if (line->data->buffer != ptr_buffer)
+            break;
+    }
+
+    /*
+     * line moved to another buffer by a callback: check next hooks with the
+     * new buffer (slow path, hooks are not taken from cache)
+     */
+    if (hashtable && (i < num_hooks) && line->data->buffer
+        && (line->data->buffer != ptr_buffer))
+    {
+        for (ptr_hook = ptr_hook->next_hook; ptr_hook;
+             ptr_hook = ptr_hook->next_hook)
+        {
+            snprintf (str_buffer, sizeof (str_buffer),
+                      "0x%lx", (unsigned long)line->data->buffer);
+            if (!ptr_hook->deleted && !ptr_hook->running
+                && hook_line_match (str_buffer, ptr_hook)
+                && (!HOOK_LINE(ptr_hook, tags_array)
+                    || gui_line_match_tags_mask (line->data,
+                                                 HOOK_LINE(ptr_hook, tags_mask))))
             {
-                hashtable = hashtable_new (32,
-                                           WEECHAT_HASHTABLE_STRING,
-                                           WEECHAT_HASHTABLE_STRING,
-                                           NULL, NULL);
-                if (!hashtable)
-                    break;
-            }
-            HASHTABLE_SET_POINTER("buffer", line->data->buffer);
-            HASHTABLE_SET_STR("buffer_name", line->data->buffer->full_name);
-            HASHTABLE_SET_STR("buffer_type",
-                              gui_buffer_type_string[line->data->buffer->type]);
-            HASHTABLE_SET_INT("y", line->data->y);
-            HASHTABLE_SET_TIME("date", line->data->date);
-            HASHTABLE_SET_TIME("date_printed", line->data->date_printed);
-            HASHTABLE_SET_STR_NOT_NULL("str_time", line->data->str_time);
-            HASHTABLE_SET_INT("tags_count", line->data->tags_count);
-            str_tags = string_rebuild_split_string (
-                (const char **)line->data->tags_array, ",", 0, -1);
-            HASHTABLE_SET_STR_NOT_NULL("tags", str_tags);
-            if (str_tags)
-                free (str_tags);
-            HASHTABLE_SET_INT("displayed", line->data->displayed);
-            HASHTABLE_SET_INT("notify_level", line->data->notify_level);
-            HASHTABLE_SET_INT("highlight", line->data->highlight);
-            HASHTABLE_SET_STR_NOT_NULL("prefix", line->data->prefix);
-            HASHTABLE_SET_STR_NOT_NULL("message", line->data->message);
-
-            /* run callback */
-            ptr_hook->running = 1;
-            hashtable2 = (HOOK_LINE(ptr_hook, callback))
-                (ptr_hook->callback_pointer,
-                 ptr_hook->callback_data,
-                 hashtable);
-            ptr_hook->running = 0;
-
-            if (hashtable2)
-            {
-                gui_line_hook_update (line, hashtable, hashtable2);
-                hashtable_free (hashtable2);
+                hook_line_run_callback (ptr_hook, line, hashtable);
                 if (!line->data->buffer)
                     break;
             }
         }
-
-        ptr_hook = next_hook;
     }
 
     hook_exec_end ();
 
     if (hashtable)
         hashtable_free (hashtable);
+    if (hooks != hooks_static)
+        free (hooks);
+}
+
+/*
+ * Removes line hooks matching a buffer from cache (called when the buffer is
+ * renamed, when its type is changed or when it is closed).
+ */
+
+void
+hook_line_buffer_changed (struct t_gui_buffer *buffer)
+{
+    char str_buffer[64];
+
+    snprintf (str_buffer, sizeof (str_buffer),
+              "0x%lx", (unsigned long)buffer);
+    hook_match_remove (HOOK_TYPE_LINE, str_buffer);
 }
 
 /*
@@ -227,6 +337,11 @@ hook_line_free_data (struct t_hook *hook)
         string_free_split_tags (HOOK_LINE(hook, tags_array));
         HOOK_LINE(hook, tags_array) = NULL;
     }
+    if (HOOK_LINE(hook, tags_mask))
+    {
+        gui_line_tags_mask_free (HOOK_LINE(hook, tags_mask));
+        HOOK_LINE(hook, tags_mask) = NULL;
+    }
 
     free (hook->hook_data);
     hook->hook_data = NULL;
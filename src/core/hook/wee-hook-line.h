@@ -23,7 +23,9 @@
 struct t_weechat_plugin;
 struct t_infolist_item;
 struct t_hashtable;
+struct t_gui_buffer;
 struct t_gui_line;
+struct t_gui_line_tag_mask;
 
 #define HOOK_LINE(hook, var) (((struct t_hook_line *)hook->hook_data)->var)
 
@@ -41,6 +43,7 @@ struct t_hook_line
     int num_buffers;                   /* number of buffers in list         */
     int tags_count;                    /* number of tags selected           */
     char ***tags_array;                /* tags selected (NULL = any)        */
+    struct t_gui_line_tag_mask *tags_mask; /* compiled tags (fast match)    */
 };
 
 extern char *hook_line_get_description (struct t_hook *hook);
@@ -52,6 +55,7 @@ extern struct t_hook *hook_line (struct t_weechat_plugin *plugin,
                                  const void *callback_pointer,
                                  void *callback_data);
 extern void hook_line_exec (struct t_gui_line *line);
+extern void hook_line_buffer_changed (struct t_gui_buffer *buffer);
 extern void hook_line_free_data (struct t_hook *hook);
 extern int hook_line_add_to_infolist (struct t_infolist_item *item,
                                       struct t_hook *hook);
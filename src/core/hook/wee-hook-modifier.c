@@ -25,12 +25,14 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include "../weechat.h"
 #include "../wee-hook.h"
 #include "../wee-infolist.h"
 #include "../wee-log.h"
 #include "../wee-string.h"
+#include "../wee-util.h"
 
 
 /*
@@ -89,6 +91,48 @@ hook_modifier (struct t_weechat_plugin *plugin, const char *modifier,
     return new_hook;
 }
 
+/*
+ * Checks if a hooked modifier matches a modifier executed.
+ *
+ * Returns:
+ *   1: hook matches modifier
+ *   0: hook does not match modifier
+ */
+
+int
+hook_modifier_match (const char *modifier, struct t_hook *hook)
+{
+    return (string_strcasecmp (HOOK_MODIFIER(hook, modifier), modifier) == 0) ?
+        1 : 0;
+}
+
+/*
+ * Checks if there is at least one hook for a modifier.
+ *
+ * This can be used to skip the call to hook_modifier_exec (and the build of
+ * string and modifier data), which always returns a copy of the string, even
+ * if there is no hook for the modifier.
+ *
+ * Returns:
+ *   1: modifier has at least one hook
+ *   0: modifier has no hook
+ */
+
+int
+hook_modifier_has_hooks (const char *modifier)
+{
+    struct t_hook_match *ptr_match;
+
+    if (!modifier || !modifier[0] || !weechat_hooks[HOOK_TYPE_MODIFIER])
+        return 0;
+
+    ptr_match = hook_match_get (HOOK_TYPE_MODIFIER, modifier,
+                                &hook_modifier_match);
+
+    /* in case of error, assume there are hooks */
+    return (!ptr_match || (ptr_match->num_hooks > 0)) ? 1 : 0;
+}
+
 /*
  * Executes a modifier hook.
  *
@@ -99,8 +143,11 @@ char *
 hook_modifier_exec (struct t_weechat_plugin *plugin, const char *modifier,
                     const char *modifier_data, const char *string)
 {
-    struct t_hook *ptr_hook, *next_hook;
+    struct t_hook_match *ptr_match;
+    struct t_hook *ptr_hook, *hooks_static[HOOK_MATCH_STATIC_SIZE], **hooks;
+    struct timeval tv_start, tv_end;
     char *new_msg, *message_modified;
+    int i, num_hooks;
 
     /* make C compiler happy */
     (void) plugin;
@@ -108,22 +155,39 @@ hook_modifier_exec (struct t_weechat_plugin *plugin, const char *modifier,
     if (!modifier || !modifier[0] || !string)
         return NULL;
 
+    ptr_match = hook_match_get (HOOK_TYPE_MODIFIER, modifier,
+                                &hook_modifier_match);
+    if (!ptr_match)
+        return NULL;
+
+    ptr_match->count++;
+
     new_msg = NULL;
     message_modified = strdup (string);
     if (!message_modified)
         return NULL;
 
+    if (ptr_match->num_hooks == 0)
+        return message_modified;
+
+    /* copy hooks matching: the cache may be updated by callbacks */
+    num_hooks = ptr_match->num_hooks;
+    hooks = (num_hooks <= HOOK_MATCH_STATIC_SIZE) ?
+        hooks_static : malloc (num_hooks * sizeof (*hooks));
+    if (!hooks)
+        return message_modified;
+    memcpy (hooks, ptr_match->hooks, num_hooks * sizeof (*hooks));
+
+    ptr_match->running++;
     hook_exec_start ();
+    gettimeofday (&tv_start, NULL);
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_MODIFIER];
-    while (ptr_hook)
+    for (i = 0; i < num_hooks; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = hooks[i];
 
         if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (string_strcasecmp (HOOK_MODIFIER(ptr_hook, modifier),
-                                   modifier) == 0))
+            && !ptr_hook->running)
         {
             ptr_hook->running = 1;
             new_msg = (HOOK_MODIFIER(ptr_hook, callback))
@@ -138,8 +202,8 @@ hook_modifier_exec (struct t_weechat_plugin *plugin, const char *modifier,
             if (new_msg && !new_msg[0])
             {
                 free (message_modified);
-                hook_exec_end ();
-                return new_msg;
+                message_modified = new_msg;
+                break;
             }
 
             /* new message => keep it as base for next modifier */
@@ -149,12 +213,17 @@ hook_modifier_exec (struct t_weechat_plugin *plugin, const char *modifier,
                 message_modified = new_msg;
             }
         }
-
-        ptr_hook = next_hook;
     }
 
+    gettimeofday (&tv_end, NULL);
+    ptr_match->time += util_timeval_diff (&tv_start, &tv_end);
+    ptr_match->running--;
+
     hook_exec_end ();
 
+    if (hooks != hooks_static)
+        free (hooks);
+
     return message_modified;
 }
 
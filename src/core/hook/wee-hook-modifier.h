@@ -42,6 +42,7 @@ extern struct t_hook *hook_modifier (struct t_weechat_plugin *plugin,
                                      t_hook_callback_modifier *callback,
                                      const void *callback_pointer,
                                      void *callback_data);
+extern int hook_modifier_has_hooks (const char *modifier);
 extern char *hook_modifier_exec (struct t_weechat_plugin *plugin,
                                  const char *modifier,
                                  const char *modifier_data,
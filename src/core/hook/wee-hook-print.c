@@ -105,6 +105,8 @@ hook_print (struct t_weechat_plugin *plugin, struct t_gui_buffer *buffer,
     new_hook_print->buffer = buffer;
     new_hook_print->tags_array = string_split_tags (tags,
                                                     &new_hook_print->tags_count);
+    new_hook_print->tags_mask = gui_line_tags_mask_compile (
+        new_hook_print->tags_count, new_hook_print->tags_array);
     new_hook_print->message = (message) ? strdup (message) : NULL;
     new_hook_print->strip_colors = strip_colors;
 
@@ -113,15 +115,45 @@ hook_print (struct t_weechat_plugin *plugin, struct t_gui_buffer *buffer,
     return new_hook;
 }
 
+/*
+ * Checks if a print hook matches a buffer (name is the buffer pointer as
+ * string): it matches if the hook has no buffer or the same buffer.
+ *
+ * Returns:
+ *   1: hook matches buffer
+ *   0: hook does not match buffer
+ */
+
+int
+hook_print_match (const char *name, struct t_hook *hook)
+{
+    char str_buffer[64];
+
+    if (!HOOK_PRINT(hook, buffer))
+        return 1;
+
+    snprintf (str_buffer, sizeof (str_buffer),
+              "0x%lx", (unsigned long)HOOK_PRINT(hook, buffer));
+
+    return (strcmp (name, str_buffer) == 0) ? 1 : 0;
+}
+
 /*
  * Executes a print hook.
+ *
+ * The print hooks matching the buffer are taken from cache (see function
+ * hook_match_get), so that only the message and tags are checked for each
+ * line printed. The colors are removed from prefix and message only if a
+ * hook needs them (to check its message or if it strips colors).
  */
 
 void
 hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
 {
-    struct t_hook *ptr_hook, *next_hook;
-    char *prefix_no_color, *message_no_color;
+    struct t_hook_match *ptr_match;
+    struct t_hook *ptr_hook, *hooks_static[HOOK_MATCH_STATIC_SIZE], **hooks;
+    char str_buffer[64], *prefix_no_color, *message_no_color;
+    int i, num_hooks, has_message;
 
     if (!weechat_hooks[HOOK_TYPE_PRINT])
         return;
@@ -129,36 +161,58 @@ hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
     if (!line->data->message)
         return;
 
-    prefix_no_color = (line->data->prefix) ?
-        gui_color_decode (line->data->prefix, NULL) : NULL;
+    snprintf (str_buffer, sizeof (str_buffer),
+              "0x%lx", (unsigned long)buffer);
+    ptr_match = hook_match_get (HOOK_TYPE_PRINT, str_buffer,
+                                &hook_print_match);
+    if (!ptr_match)
+        return;
 
-    message_no_color = gui_color_decode (line->data->message, NULL);
-    if (!message_no_color)
-    {
-        if (prefix_no_color)
-            free (prefix_no_color);
+    ptr_match->count++;
+
+    if (ptr_match->num_hooks == 0)
         return;
-    }
+
+    /* copy hooks matching: the cache may be updated by callbacks */
+    num_hooks = ptr_match->num_hooks;
+    hooks = (num_hooks <= HOOK_MATCH_STATIC_SIZE) ?
+        hooks_static : malloc (num_hooks * sizeof (*hooks));
+    if (!hooks)
+        return;
+    memcpy (hooks, ptr_match->hooks, num_hooks * sizeof (*hooks));
+
+    prefix_no_color = NULL;
+    message_no_color = NULL;
 
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_PRINT];
-    while (ptr_hook)
+    for (i = 0; i < num_hooks; i++)
     {
-        next_hook = ptr_hook->next_hook;
-
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (!HOOK_PRINT(ptr_hook, buffer)
-                || (buffer == HOOK_PRINT(ptr_hook, buffer)))
-            && (!HOOK_PRINT(ptr_hook, message)
-                || !HOOK_PRINT(ptr_hook, message)[0]
-                || string_strcasestr (prefix_no_color, HOOK_PRINT(ptr_hook, message))
-                || string_strcasestr (message_no_color, HOOK_PRINT(ptr_hook, message)))
+        ptr_hook = hooks[i];
+
+        if (ptr_hook->deleted || ptr_hook->running)
+            continue;
+
+        has_message = (HOOK_PRINT(ptr_hook, message)
+                       && HOOK_PRINT(ptr_hook, message)[0]);
+
+        /* remove colors in prefix and message (only once) */
+        if ((has_message || HOOK_PRINT(ptr_hook, strip_colors))
+            && !message_no_color)
+        {
+            message_no_color = gui_color_decode (line->data->message, NULL);
+            if (!message_no_color)
+                break;
+            prefix_no_color = (line->data->prefix) ?
+                gui_color_decode (line->data->prefix, NULL) : NULL;
+        }
+
+        if ((!has_message
+             || string_strcasestr (prefix_no_color, HOOK_PRINT(ptr_hook, message))
+             || string_strcasestr (message_no_color, HOOK_PRINT(ptr_hook, message)))
             && (!HOOK_PRINT(ptr_hook, tags_array)
-                || gui_line_match_tags (line->data,
-                                        HOOK_PRINT(ptr_hook, tags_count),
-                                        HOOK_PRINT(ptr_hook, tags_array))))
+                || gui_line_match_tags_mask (line->data,
+                                             HOOK_PRINT(ptr_hook, tags_mask))))
         {
             /* run callback */
             ptr_hook->running = 1;
@@ -174,8 +228,6 @@ hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
                  (HOOK_PRINT(ptr_hook, strip_colors)) ? message_no_color : line->data->message);
             ptr_hook->running = 0;
         }
-
-        ptr_hook = next_hook;
     }
 
     if (prefix_no_color)
@@ -184,6 +236,24 @@ hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
         free (message_no_color);
 
     hook_exec_end ();
+
+    if (hooks != hooks_static)
+        free (hooks);
+}
+
+/*
+ * Removes print hooks matching a buffer from cache (called when a buffer is
+ * closed).
+ */
+
+void
+hook_print_buffer_closed (struct t_gui_buffer *buffer)
+{
+    char str_buffer[64];
+
+    snprintf (str_buffer, sizeof (str_buffer),
+              "0x%lx", (unsigned long)buffer);
+    hook_match_remove (HOOK_TYPE_PRINT, str_buffer);
 }
 
 /*
@@ -201,6 +271,11 @@ hook_print_free_data (struct t_hook *hook)
         string_free_split_tags (HOOK_PRINT(hook, tags_array));
         HOOK_PRINT(hook, tags_array) = NULL;
     }
+    if (HOOK_PRINT(hook, tags_mask))
+    {
+        gui_line_tags_mask_free (HOOK_PRINT(hook, tags_mask));
+        HOOK_PRINT(hook, tags_mask) = NULL;
+    }
     if (HOOK_PRINT(hook, message))
     {
         free (HOOK_PRINT(hook, message));
@@ -26,6 +26,7 @@ struct t_weechat_plugin;
 struct t_infolist_item;
 struct t_gui_buffer;
 struct t_gui_line;
+struct t_gui_line_tag_mask;
 
 #define HOOK_PRINT(hook, var) (((struct t_hook_print *)hook->hook_data)->var)
 
@@ -42,6 +43,7 @@ struct t_hook_print
     struct t_gui_buffer *buffer;       /* buffer selected (NULL = all)      */
     int tags_count;                    /* number of tags selected           */
     char ***tags_array;                /* tags selected (NULL = any)        */
+    struct t_gui_line_tag_mask *tags_mask; /* compiled tags (fast match)    */
     char *message;                     /* part of message (NULL/empty = all)*/
     int strip_colors;                  /* strip colors in msg for callback? */
 };
@@ -56,6 +58,7 @@ extern struct t_hook *hook_print (struct t_weechat_plugin *plugin,
                                   void *callback_data);
 extern void hook_print_exec (struct t_gui_buffer *buffer,
                              struct t_gui_line *line);
+extern void hook_print_buffer_closed (struct t_gui_buffer *buffer);
 extern void hook_print_free_data (struct t_hook *hook);
 extern int hook_print_add_to_infolist (struct t_infolist_item *item,
                                        struct t_hook *hook);
@@ -37,6 +37,12 @@
 
 time_t hook_last_system_time = 0;      /* used to detect system clock skew  */
 
+struct t_hook **hook_timer_heap = NULL; /* timers sorted by next execution  */
+                                       /* (binary min-heap)                 */
+int hook_timer_heap_size = 0;          /* number of timers in heap          */
+int hook_timer_heap_alloc = 0;         /* allocated size for heap           */
+unsigned long long hook_timer_sequence = 0; /* order of creation of timers  */
+
 
 /*
  * Returns description of hook.
@@ -131,6 +137,211 @@ hook_timer_init (struct t_hook *hook)
                       ((long long)HOOK_TIMER(hook, interval)) * 1000);
 }
 
+/*
+ * Compares two timers in heap: by date of next execution, then by order of
+ * creation (so that timers with same date are executed in order of creation).
+ *
+ * Returns:
+ *   < 0: timer1 must be executed before timer2
+ *     0: timer1 == timer2
+ *   > 0: timer1 must be executed after timer2
+ */
+
+int
+hook_timer_heap_cmp (struct t_hook *timer1, struct t_hook *timer2)
+{
+    int rc;
+
+    rc = util_timeval_cmp (&HOOK_TIMER(timer1, next_exec),
+                           &HOOK_TIMER(timer2, next_exec));
+    if (rc != 0)
+        return rc;
+
+    if (HOOK_TIMER(timer1, sequence) < HOOK_TIMER(timer2, sequence))
+        return -1;
+    if (HOOK_TIMER(timer1, sequence) > HOOK_TIMER(timer2, sequence))
+        return 1;
+    return 0;
+}
+
+/*
+ * Sets a timer at a position in heap.
+ */
+
+void
+hook_timer_heap_set (int index, struct t_hook *hook)
+{
+    hook_timer_heap[index] = hook;
+    HOOK_TIMER(hook, heap_index) = index;
+}
+
+/*
+ * Moves a timer up in heap (to restore heap order after insertion or when
+ * next execution is sooner).
+ */
+
+void
+hook_timer_heap_up (int index)
+{
+    struct t_hook *ptr_hook;
+    int parent;
+
+    ptr_hook = hook_timer_heap[index];
+    while (index > 0)
+    {
+        parent = (index - 1) / 2;
+        if (hook_timer_heap_cmp (ptr_hook, hook_timer_heap[parent]) >= 0)
+            break;
+        hook_timer_heap_set (index, hook_timer_heap[parent]);
+        index = parent;
+    }
+    hook_timer_heap_set (index, ptr_hook);
+}
+
+/*
+ * Moves a timer down in heap (to restore heap order after removal or when
+ * next execution is later).
+ */
+
+void
+hook_timer_heap_down (int index)
+{
+    struct t_hook *ptr_hook;
+    int child;
+
+    ptr_hook = hook_timer_heap[index];
+    while (1)
+    {
+        child = (2 * index) + 1;
+        if (child >= hook_timer_heap_size)
+            break;
+        if ((child + 1 < hook_timer_heap_size)
+            && (hook_timer_heap_cmp (hook_timer_heap[child + 1],
+                                     hook_timer_heap[child]) < 0))
+        {
+            child++;
+        }
+        if (hook_timer_heap_cmp (ptr_hook, hook_timer_heap[child]) <= 0)
+            break;
+        hook_timer_heap_set (index, hook_timer_heap[child]);
+        index = child;
+    }
+    hook_timer_heap_set (index, ptr_hook);
+}
+
+/*
+ * Adds a timer in heap.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (memory allocation failed)
+ */
+
+int
+hook_timer_heap_add (struct t_hook *hook)
+{
+    struct t_hook **new_heap;
+    int new_alloc;
+
+    if (HOOK_TIMER(hook, heap_index) >= 0)
+        return 1;
+
+    if (hook_timer_heap_size >= hook_timer_heap_alloc)
+    {
+        new_alloc = (hook_timer_heap_alloc > 0) ?
+            hook_timer_heap_alloc * 2 : 32;
+        new_heap = realloc (hook_timer_heap, new_alloc * sizeof (*new_heap));
+        if (!new_heap)
+            return 0;
+        hook_timer_heap = new_heap;
+        hook_timer_heap_alloc = new_alloc;
+    }
+
+    hook_timer_heap_set (hook_timer_heap_size, hook);
+    hook_timer_heap_size++;
+    hook_timer_heap_up (hook_timer_heap_size - 1);
+
+    return 1;
+}
+
+/*
+ * Removes a timer from heap.
+ */
+
+void
+hook_timer_heap_remove (struct t_hook *hook)
+{
+    struct t_hook *ptr_last;
+    int index;
+
+    index = HOOK_TIMER(hook, heap_index);
+    if ((index < 0) || (index >= hook_timer_heap_size)
+        || (hook_timer_heap[index] != hook))
+    {
+        return;
+    }
+
+    HOOK_TIMER(hook, heap_index) = -1;
+    hook_timer_heap_size--;
+
+    if (index < hook_timer_heap_size)
+    {
+        /* move last timer to the free slot and restore heap order */
+        ptr_last = hook_timer_heap[hook_timer_heap_size];
+        hook_timer_heap_set (index, ptr_last);
+        hook_timer_heap_up (index);
+        hook_timer_heap_down (HOOK_TIMER(ptr_last, heap_index));
+    }
+}
+
+/*
+ * Rebuilds the heap (used when date of next execution has changed for all
+ * timers).
+ */
+
+void
+hook_timer_heap_rebuild ()
+{
+    int i;
+
+    for (i = (hook_timer_heap_size / 2) - 1; i >= 0; i--)
+    {
+        hook_timer_heap_down (i);
+    }
+}
+
+/*
+ * Callback called when a timer hook is added in the list of hooks.
+ */
+
+void
+hook_timer_add_cb (struct t_hook *hook)
+{
+    hook_timer_heap_add (hook);
+}
+
+/*
+ * Callback called when a timer hook is removed from the list of hooks.
+ */
+
+void
+hook_timer_remove_cb (struct t_hook *hook)
+{
+    /* make C compiler happy */
+    (void) hook;
+
+    if (hooks_count[HOOK_TYPE_TIMER] == 0)
+    {
+        if (hook_timer_heap)
+        {
+            free (hook_timer_heap);
+            hook_timer_heap = NULL;
+        }
+        hook_timer_heap_size = 0;
+        hook_timer_heap_alloc = 0;
+    }
+}
+
 /*
  * Hooks a timer.
  *
@@ -167,6 +378,8 @@ hook_timer (struct t_weechat_plugin *plugin, long interval, int align_second,
     new_hook_timer->interval = interval;
     new_hook_timer->align_second = align_second;
     new_hook_timer->remaining_calls = max_calls;
+    new_hook_timer->sequence = ++hook_timer_sequence;
+    new_hook_timer->heap_index = -1;
 
     hook_timer_init (new_hook);
 
@@ -212,6 +425,7 @@ hook_timer_check_system_clock ()
             if (!ptr_hook->deleted)
                 hook_timer_init (ptr_hook);
         }
+        hook_timer_heap_rebuild ();
     }
 
     hook_last_system_time = now;
@@ -224,7 +438,6 @@ hook_timer_check_system_clock ()
 int
 hook_timer_get_time_to_next ()
 {
-    struct t_hook *ptr_hook;
     int found, timeout;
     struct timeval tv_now, tv_timeout;
     long diff_usec;
@@ -235,18 +448,12 @@ hook_timer_get_time_to_next ()
     tv_timeout.tv_sec = 0;
     tv_timeout.tv_usec = 0;
 
-    for (ptr_hook = weechat_hooks[HOOK_TYPE_TIMER]; ptr_hook;
-         ptr_hook = ptr_hook->next_hook)
+    /* first timer in heap is the next one to execute */
+    if (hook_timer_heap_size > 0)
     {
-        if (!ptr_hook->deleted
-            && (!found
-                || (util_timeval_cmp (&HOOK_TIMER(ptr_hook, next_exec),
-                                      &tv_timeout) < 0)))
-        {
-            found = 1;
-            tv_timeout.tv_sec = HOOK_TIMER(ptr_hook, next_exec).tv_sec;
-            tv_timeout.tv_usec = HOOK_TIMER(ptr_hook, next_exec).tv_usec;
-        }
+        found = 1;
+        tv_timeout.tv_sec = HOOK_TIMER(hook_timer_heap[0], next_exec).tv_sec;
+        tv_timeout.tv_usec = HOOK_TIMER(hook_timer_heap[0], next_exec).tv_usec;
     }
 
     /* no timeout found, return 2 seconds by default */
@@ -303,26 +510,52 @@ void
 hook_timer_exec ()
 {
     struct timeval tv_time;
-    struct t_hook *ptr_hook, *next_hook;
+    struct t_hook *ptr_hook, **timers_to_run;
+    int i, num_timers;
 
-    if (!weechat_hooks[HOOK_TYPE_TIMER])
+    if (hook_timer_heap_size == 0)
         return;
 
     hook_timer_check_system_clock ();
 
     gettimeofday (&tv_time, NULL);
 
+    /*
+     * extract from heap all timers to execute now: they are executed only
+     * once in this call, even if next execution is still in the past after
+     * the call
+     */
+    timers_to_run = NULL;
+    num_timers = 0;
+    while ((hook_timer_heap_size > 0)
+           && (util_timeval_cmp (&HOOK_TIMER(hook_timer_heap[0], next_exec),
+                                 &tv_time) <= 0))
+    {
+        if (!timers_to_run)
+        {
+            timers_to_run = malloc (hook_timer_heap_size
+                                    * sizeof (*timers_to_run));
+            if (!timers_to_run)
+                return;
+        }
+        ptr_hook = hook_timer_heap[0];
+        hook_timer_heap_remove (ptr_hook);
+        timers_to_run[num_timers++] = ptr_hook;
+    }
+
+    if (num_timers == 0)
+        return;
+
     hook_exec_start ();
 
-    ptr_hook = weechat_hooks[HOOK_TYPE_TIMER];
-    while (ptr_hook)
+    for (i = 0; i < num_timers; i++)
     {
-        next_hook = ptr_hook->next_hook;
+        ptr_hook = timers_to_run[i];
 
-        if (!ptr_hook->deleted
-            && !ptr_hook->running
-            && (util_timeval_cmp (&HOOK_TIMER(ptr_hook, next_exec),
-                                  &tv_time) <= 0))
+        if (ptr_hook->deleted)
+            continue;
+
+        if (!ptr_hook->running)
         {
             ptr_hook->running = 1;
             (void) (HOOK_TIMER(ptr_hook, callback))
@@ -349,9 +582,13 @@ hook_timer_exec ()
             }
         }
 
-        ptr_hook = next_hook;
+        /* put timer back in heap with its new date of next execution */
+        if (!ptr_hook->deleted)
+            hook_timer_heap_add (ptr_hook);
     }
 
+    free (timers_to_run);
+
     hook_exec_end ();
 }
 
@@ -365,6 +602,8 @@ hook_timer_free_data (struct t_hook *hook)
     if (!hook || !hook->hook_data)
         return;
 
+    hook_timer_heap_remove (hook);
+
     free (hook->hook_data);
     hook->hook_data = NULL;
 }
@@ -426,6 +665,8 @@ hook_timer_print_log (struct t_hook *hook)
     log_printf ("    interval. . . . . . . : %ld", HOOK_TIMER(hook, interval));
     log_printf ("    align_second. . . . . : %d", HOOK_TIMER(hook, align_second));
     log_printf ("    remaining_calls . . . : %d", HOOK_TIMER(hook, remaining_calls));
+    log_printf ("    sequence. . . . . . . : %llu", HOOK_TIMER(hook, sequence));
+    log_printf ("    heap_index. . . . . . : %d", HOOK_TIMER(hook, heap_index));
     text_time[0] = '\0';
     seconds = HOOK_TIMER(hook, last_exec).tv_sec;
     local_time = localtime (&seconds);
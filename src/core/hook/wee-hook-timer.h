@@ -40,11 +40,15 @@ struct t_hook_timer
     int remaining_calls;               /* calls remaining (0 = unlimited)   */
     struct timeval last_exec;          /* last time hook was executed       */
     struct timeval next_exec;          /* next scheduled execution          */
+    unsigned long long sequence;       /* order of creation (for heap)      */
+    int heap_index;                    /* index in heap (-1 if not in heap) */
 };
 
 extern time_t hook_last_system_time;
 
 extern char *hook_timer_get_description (struct t_hook *hook);
+extern void hook_timer_add_cb (struct t_hook *hook);
+extern void hook_timer_remove_cb (struct t_hook *hook);
 extern struct t_hook *hook_timer (struct t_weechat_plugin *plugin,
                                   long interval, int align_second,
                                   int max_calls,
@@ -731,10 +731,8 @@ config_compute_prefix_max_length_all_buffers ()
     for (ptr_buffer = gui_buffers; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
     {
-        if (ptr_buffer->own_lines)
-            ptr_buffer->own_lines->prefix_max_length_refresh = 1;
-        if (ptr_buffer->mixed_lines)
-            ptr_buffer->mixed_lines->prefix_max_length_refresh = 1;
+        gui_line_ask_prefix_max_length_refresh (ptr_buffer->own_lines);
+        gui_line_ask_prefix_max_length_refresh (ptr_buffer->mixed_lines);
     }
 }
 
@@ -936,6 +934,22 @@ config_change_emphasized_attributes (const void *pointer, void *data,
     gui_window_ask_refresh (1);
 }
 
+/*
+ * Callback for changes on option "weechat.look.highlight".
+ */
+
+void
+config_change_highlight (const void *pointer, void *data,
+                         struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) option;
+
+    gui_buffer_reset_highlight_words_compiled_all ();
+}
+
 /*
  * Callback for changes on option "weechat.look.highlight_disable_regex".
  */
@@ -3195,7 +3209,9 @@ config_weechat_init_options ()
                "case sensitive), words may begin or end with \"*\" for partial "
                "match; example: \"test,(?-i)*toto*,flash*\""),
             NULL, 0, 0, "", NULL, 0,
-            NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+            NULL, NULL, NULL,
+            &config_change_highlight, NULL, NULL,
+            NULL, NULL, NULL);
         config_look_highlight_disable_regex = config_file_new_option (
             weechat_config_file, weechat_config_section_look,
             "highlight_disable_regex", "string",
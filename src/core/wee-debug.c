@@ -38,6 +38,7 @@
 #include <gnutls/gnutls.h>
 
 #include "weechat.h"
+#include "wee-arraylist.h"
 #include "wee-backtrace.h"
 #include "wee-config-file.h"
 #include "wee-hashtable.h"
@@ -60,6 +61,7 @@
 #include "../gui/gui-hotlist.h"
 #include "../gui/gui-key.h"
 #include "../gui/gui-layout.h"
+#include "../gui/gui-line.h"
 #include "../gui/gui-main.h"
 #include "../gui/gui-window.h"
 #include "../plugins/plugin.h"
@@ -249,6 +251,10 @@ debug_windows_tree ()
     gui_chat_printf (NULL, "");
     gui_chat_printf (NULL, _("Windows tree:"));
     debug_windows_tree_display (gui_windows_tree, 1);
+    gui_chat_printf (NULL,
+                     _("Chat draws: %ld full, %ld partial (only new lines)"),
+                     gui_chat_draw_full_count,
+                     gui_chat_draw_partial_count);
 }
 
 /*
@@ -299,6 +305,16 @@ debug_memory ()
                        "found)"));
 #endif /* HAVE_MALLINFO */
 #endif /* HAVE_MALLINFO2 */
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL,
+                     _("Lines in arena: %d lines, %d chunks, %ld bytes "
+                       "(%ld bytes per line)"),
+                     gui_line_arena_lines,
+                     gui_line_arena_count,
+                     gui_line_arena_size,
+                     (gui_line_arena_lines > 0) ?
+                     gui_line_arena_size / gui_line_arena_lines : 0);
 }
 
 /*
@@ -414,6 +430,82 @@ debug_hdata ()
         hashtable_map (weechat_hdata, &debug_hdata_map_cb, NULL);
 }
 
+/*
+ * Compares two names sent in cache of matching hooks: by time spent in
+ * callbacks, then by number of times the name was sent (descending).
+ */
+
+int
+debug_hooks_match_cmp_cb (void *data, struct t_arraylist *arraylist,
+                          void *pointer1, void *pointer2)
+{
+    struct t_hook_match *ptr_match1, *ptr_match2;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) arraylist;
+
+    ptr_match1 = (struct t_hook_match *)(((struct t_hashtable_item *)pointer1)->value);
+    ptr_match2 = (struct t_hook_match *)(((struct t_hashtable_item *)pointer2)->value);
+
+    if (ptr_match1->time != ptr_match2->time)
+        return (ptr_match1->time > ptr_match2->time) ? -1 : 1;
+    if (ptr_match1->count != ptr_match2->count)
+        return (ptr_match1->count > ptr_match2->count) ? -1 : 1;
+    return 0;
+}
+
+/*
+ * Displays statistics about names sent for a hook type (signals, hsignals):
+ * number of times sent and time spent in callbacks (top 20 by time).
+ */
+
+void
+debug_hooks_match (int type)
+{
+    struct t_arraylist *list;
+    struct t_hashtable_item *ptr_item;
+    struct t_hook_match *ptr_match;
+    int i, size;
+
+    if (!hook_match_cache[type] || (hook_match_cache[type]->items_count == 0))
+        return;
+
+    list = arraylist_new (hook_match_cache[type]->items_count, 1, 1,
+                          &debug_hooks_match_cmp_cb, NULL, NULL, NULL);
+    if (!list)
+        return;
+
+    for (ptr_item = hook_match_cache[type]->oldest_item; ptr_item;
+         ptr_item = ptr_item->next_created_item)
+    {
+        arraylist_add (list, ptr_item);
+    }
+
+    size = arraylist_size (list);
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL,
+                     "%s: %d names (top %d by time in callbacks):",
+                     hook_type_string[type],
+                     size,
+                     (size < 20) ? size : 20);
+    gui_chat_printf (NULL, "  %10s %12s %5s  %s",
+                     "count", "time (ms)", "hooks", "name");
+    for (i = 0; (i < size) && (i < 20); i++)
+    {
+        ptr_item = (struct t_hashtable_item *)arraylist_get (list, i);
+        ptr_match = (struct t_hook_match *)ptr_item->value;
+        gui_chat_printf (NULL, "  %10lld %12.3f %5d  %s",
+                         ptr_match->count,
+                         ((double)ptr_match->time) / 1000,
+                         ptr_match->num_hooks,
+                         (const char *)ptr_item->key);
+    }
+
+    arraylist_free (list);
+}
+
 /*
  * Displays info about hooks.
  */
@@ -433,6 +525,21 @@ debug_hooks ()
     }
     gui_chat_printf (NULL, "%17s------", "---------");
     gui_chat_printf (NULL, "%17s:%5d", "total", hooks_count_total);
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL,
+                     "fd hooks (%s): %lld wakeups, %lld callbacks, "
+                     "%.3f ms in callbacks (%.3f ms per wakeup)",
+                     hook_fd_get_backend (),
+                     hook_fd_stats_wakeups,
+                     hook_fd_stats_callbacks,
+                     ((double)hook_fd_stats_time) / 1000,
+                     (hook_fd_stats_wakeups > 0) ?
+                     ((double)hook_fd_stats_time) / 1000 / hook_fd_stats_wakeups : 0);
+
+    debug_hooks_match (HOOK_TYPE_SIGNAL);
+    debug_hooks_match (HOOK_TYPE_HSIGNAL);
+    debug_hooks_match (HOOK_TYPE_MODIFIER);
 }
 
 /*
@@ -63,6 +63,11 @@
     }
 
 
+struct t_hashtable *eval_hashtable_compiled = NULL; /* compiled exprs     */
+struct t_eval_compiled *eval_compiled = NULL;       /* LRU (recent first) */
+struct t_eval_compiled *last_eval_compiled = NULL;  /* last (oldest) one  */
+int eval_compiled_count = 0;                        /* number of exprs    */
+
 char *eval_logical_ops[EVAL_NUM_LOGICAL_OPS] =
 { "||", "&&" };
 
@@ -85,10 +90,16 @@ char *eval_range_chars[][2] =
     { NULL,     NULL },
 };
 
+const char *eval_no_replace_prefix_list[] = { "if:", "raw:", NULL };
+
 char *eval_replace_vars (const char *expr,
                          struct t_eval_context *eval_context);
 char *eval_expression_condition (const char *expr,
                                  struct t_eval_context *eval_context);
+char *eval_vars_exec (struct t_eval_vars *vars,
+                      struct t_eval_context *eval_context);
+char *eval_node_exec (struct t_eval_node *node,
+                      struct t_eval_context *eval_context);
 
 
 /*
@@ -1883,7 +1894,7 @@ end:
 char *
 eval_replace_vars (const char *expr, struct t_eval_context *eval_context)
 {
-    const char *no_replace_prefix_list[] = { "if:", "raw:", NULL };
+    struct t_eval_compiled *compiled;
     char *result;
     int debug_id;
 
@@ -1893,13 +1904,29 @@ eval_replace_vars (const char *expr, struct t_eval_context *eval_context)
 
     if (eval_context->recursion_count < EVAL_RECURSION_MAX)
     {
-        result = string_replace_with_callback (expr,
-                                               eval_context->prefix,
-                                               eval_context->suffix,
-                                               no_replace_prefix_list,
-                                               &eval_replace_vars_cb,
-                                               eval_context,
-                                               NULL);
+        /*
+         * expressions with variables are compiled once and kept in cache
+         * (not in debug mode, so that all steps are displayed)
+         */
+        compiled = (!eval_context->debug_level
+                    && expr && strstr (expr, eval_context->prefix)) ?
+            eval_compiled_get (EVAL_COMPILED_VARS, expr, eval_context) : NULL;
+        if (compiled)
+        {
+            result = eval_vars_exec (compiled->vars, eval_context);
+            eval_compiled_unref (compiled);
+        }
+        else
+        {
+            result = string_replace_with_callback (
+                expr,
+                eval_context->prefix,
+                eval_context->suffix,
+                eval_no_replace_prefix_list,
+                &eval_replace_vars_cb,
+                eval_context,
+                NULL);
+        }
     }
     else
     {
@@ -2057,6 +2084,92 @@ end:
     return value;
 }
 
+/*
+ * Evaluates sub-expressions between parentheses at beginning of a condition
+ * (without logical operator neither comparison) and replaces them with their
+ * values, then replaces variables in the string (this function must not be
+ * called directly).
+ *
+ * The argument "expr" is freed by this function.
+ *
+ * Note: result must be freed after use (if not NULL).
+ */
+
+char *
+eval_expression_condition_parentheses (char *expr,
+                                       struct t_eval_context *eval_context)
+{
+    int length, level;
+    const char *pos;
+    char *sub_expr, *value, *tmp_value, *tmp_value2;
+
+    value = NULL;
+
+    while (expr[0] == '(')
+    {
+        level = 0;
+        pos = expr + 1;
+        while (pos[0])
+        {
+            if (pos[0] == '(')
+                level++;
+            else if (pos[0] == ')')
+            {
+                if (level == 0)
+                    break;
+                level--;
+            }
+            pos++;
+        }
+        /* closing parenthesis not found */
+        if (pos[0] != ')')
+            goto end;
+        sub_expr = string_strndup (expr + 1, pos - expr - 1);
+        if (!sub_expr)
+            goto end;
+        tmp_value = eval_expression_condition (sub_expr, eval_context);
+        free (sub_expr);
+        if (!pos[1])
+        {
+            /*
+             * nothing around parentheses, then return value of
+             * sub-expression as-is
+             */
+            value = tmp_value;
+            goto end;
+        }
+        length = ((tmp_value) ? strlen (tmp_value) : 0) + 1 +
+            strlen (pos + 1) + 1;
+        tmp_value2 = malloc (length);
+        if (!tmp_value2)
+        {
+            if (tmp_value)
+                free (tmp_value);
+            goto end;
+        }
+        tmp_value2[0] = '\0';
+        if (tmp_value)
+            strcat (tmp_value2, tmp_value);
+        strcat (tmp_value2, " ");
+        strcat (tmp_value2, pos + 1);
+        free (expr);
+        expr = tmp_value2;
+        if (tmp_value)
+            free (tmp_value);
+    }
+
+    /*
+     * at this point, there is no more logical operator neither comparison,
+     * so we just replace variables in string and return the result
+     */
+    value = eval_replace_vars (expr, eval_context);
+
+end:
+    free (expr);
+
+    return value;
+}
+
 /*
  * Evaluates a condition (this function must not be called directly).
  *
@@ -2069,7 +2182,8 @@ char *
 eval_expression_condition (const char *expr,
                            struct t_eval_context *eval_context)
 {
-    int logic, comp, length, level, rc, debug_id;
+    struct t_eval_compiled *compiled;
+    int logic, comp, rc, debug_id;
     const char *pos, *pos_end;
     char *expr2, *sub_expr, *value, *tmp_value, *tmp_value2;
 
@@ -2081,6 +2195,22 @@ eval_expression_condition (const char *expr,
     if (!expr)
         goto end;
 
+    /*
+     * condition is compiled once and kept in cache
+     * (not in debug mode, so that all steps are displayed)
+     */
+    if (!eval_context->debug_level)
+    {
+        compiled = eval_compiled_get (EVAL_COMPILED_CONDITION, expr,
+                                      eval_context);
+        if (compiled)
+        {
+            value = eval_node_exec (compiled->node, eval_context);
+            eval_compiled_unref (compiled);
+            goto end;
+        }
+    }
+
     if (!expr[0])
     {
         value = strdup (expr);
@@ -2217,66 +2347,10 @@ eval_expression_condition (const char *expr,
 
     /*
      * evaluate sub-expressions between parentheses and replace them with their
-     * values
-     */
-    while (expr2[0] == '(')
-    {
-        level = 0;
-        pos = expr2 + 1;
-        while (pos[0])
-        {
-            if (pos[0] == '(')
-                level++;
-            else if (pos[0] == ')')
-            {
-                if (level == 0)
-                    break;
-                level--;
-            }
-            pos++;
-        }
-        /* closing parenthesis not found */
-        if (pos[0] != ')')
-            goto end;
-        sub_expr = string_strndup (expr2 + 1, pos - expr2 - 1);
-        if (!sub_expr)
-            goto end;
-        tmp_value = eval_expression_condition (sub_expr, eval_context);
-        free (sub_expr);
-        if (!pos[1])
-        {
-            /*
-             * nothing around parentheses, then return value of
-             * sub-expression as-is
-             */
-            value = tmp_value;
-            goto end;
-        }
-        length = ((tmp_value) ? strlen (tmp_value) : 0) + 1 +
-            strlen (pos + 1) + 1;
-        tmp_value2 = malloc (length);
-        if (!tmp_value2)
-        {
-            if (tmp_value)
-                free (tmp_value);
-            goto end;
-        }
-        tmp_value2[0] = '\0';
-        if (tmp_value)
-            strcat (tmp_value2, tmp_value);
-        strcat (tmp_value2, " ");
-        strcat (tmp_value2, pos + 1);
-        free (expr2);
-        expr2 = tmp_value2;
-        if (tmp_value)
-            free (tmp_value);
-    }
-
-    /*
-     * at this point, there is no more logical operator neither comparison,
-     * so we just replace variables in string and return the result
+     * values, then replace variables
      */
-    value = eval_replace_vars (expr2, eval_context);
+    value = eval_expression_condition_parentheses (expr2, eval_context);
+    expr2 = NULL;
 
 end:
     if (expr2)
@@ -2288,109 +2362,969 @@ end:
 }
 
 /*
- * Replaces text in a string using a regular expression and replacement text.
- *
- * The argument "regex" is a pointer to a regex compiled with WeeChat function
- * string_regcomp (or function regcomp).
- *
- * The argument "replace" is evaluated and can contain any valid expression,
- * and these ones:
- *   ${re:0} .. ${re:99}  match 0 to 99 (0 is whole match, 1 .. 99 are groups
- *                        captured)
- *   ${re:+}              the last match (with highest number)
- *
- * Examples:
- *
- *    string   | regex         | replace                    | result
- *   ----------+---------------+----------------------------+-------------
- *    test foo | test          | Z                          | Z foo
- *    test foo | ^(test +)(.*) | ${re:2}                    | foo
- *    test foo | ^(test +)(.*) | ${re:1}/ ${hide:*,${re:2}} | test / ***
- *    test foo | ^(test +)(.*) | ${hide:%,${re:+}}          | %%%
- *
- * Note: result must be freed after use.
+ * Frees a compiled string with variables.
  */
 
-char *
-eval_replace_regex (const char *string, regex_t *regex, const char *replace,
-                    struct t_eval_context *eval_context)
+void
+eval_vars_free (struct t_eval_vars *vars)
 {
-    char *result, *result2, *str_replace;
-    int length, length_replace, start_offset, i, rc, end, debug_id;
-    int empty_replace_allowed;
-    struct t_eval_regex eval_regex;
-
-    result = NULL;
+    int i;
 
-    EVAL_DEBUG_MSG(1, "eval_replace_regex(\"%s\", 0x%lx, \"%s\")",
-                   string, regex, replace);
+    if (!vars)
+        return;
 
-    if (!string || !regex || !replace)
-        goto end;
+    if (vars->expr)
+        free (vars->expr);
+    if (vars->segments)
+    {
+        for (i = 0; i < vars->num_segments; i++)
+        {
+            if (vars->segments[i].text)
+                free (vars->segments[i].text);
+            eval_vars_free (vars->segments[i].vars);
+        }
+        free (vars->segments);
+    }
+    if (vars->static_value)
+        free (vars->static_value);
 
-    length = strlen (string) + 1;
-    result = malloc (length);
-    if (!result)
-        goto end;
-    snprintf (result, length, "%s", string);
+    free (vars);
+}
 
-    eval_context->regex = &eval_regex;
-    eval_context->regex_replacement_index = 1;
+/*
+ * Adds a segment in a compiled string with variables.
+ *
+ * Returns pointer to new segment, NULL if error.
+ */
 
-    start_offset = 0;
+struct t_eval_segment *
+eval_vars_add_segment (struct t_eval_vars *vars,
+                       enum t_eval_segment_type type,
+                       const char *text, int length, int offset)
+{
+    struct t_eval_segment *new_segments, *ptr_segment;
 
-    /* we allow one empty replace if input string is empty */
-    empty_replace_allowed = (result[0]) ? 0 : 1;
+    new_segments = realloc (vars->segments,
+                            (vars->num_segments + 1) * sizeof (*new_segments));
+    if (!new_segments)
+        return NULL;
+    vars->segments = new_segments;
 
-    while (result)
+    ptr_segment = &(vars->segments[vars->num_segments]);
+    ptr_segment->type = type;
+    if (text)
     {
-        for (i = 0; i < 100; i++)
-        {
-            eval_regex.match[i].rm_so = -1;
-        }
-
-        rc = regexec (regex, result + start_offset, 100, eval_regex.match, 0);
+        ptr_segment->text = (length < 0) ?
+            strdup (text) : string_strndup (text, length);
+    }
+    else
+    {
+        ptr_segment->text = NULL;
+    }
+    ptr_segment->offset = offset;
+    ptr_segment->vars = NULL;
+    if (text && !ptr_segment->text)
+        return NULL;
 
-        /* no match found: exit the loop */
-        if ((rc != 0) || (eval_regex.match[0].rm_so < 0))
-            break;
+    vars->num_segments++;
 
-        /*
-         * if empty string is matching, continue only if empty replace is
-         * still allowed (to prevent infinite loop)
-         */
-        if (eval_regex.match[0].rm_eo <= 0)
-        {
-            if (!empty_replace_allowed)
-                break;
-            empty_replace_allowed = 0;
-        }
+    return ptr_segment;
+}
 
-        /* adjust the start/end offsets */
-        eval_regex.last_match = 0;
-        for (i = 0; i < 100; i++)
-        {
-            if (eval_regex.match[i].rm_so >= 0)
-            {
-                eval_regex.last_match = i;
-                eval_regex.match[i].rm_so += start_offset;
-                eval_regex.match[i].rm_eo += start_offset;
-            }
-        }
+/*
+ * Compiles a string with variables: the string is split into segments
+ * (text and variables), with the same rules as function
+ * string_replace_with_callback.
+ *
+ * Returns pointer to compiled string, NULL if error.
+ *
+ * Note: result must be freed after use with function eval_vars_free().
+ */
 
-        /* check if the regex matched the end of string */
-        end = !result[eval_regex.match[0].rm_eo];
+struct t_eval_vars *
+eval_vars_compile (const char *expr, const char *prefix, const char *suffix)
+{
+    struct t_eval_vars *vars;
+    struct t_eval_segment *ptr_segment;
+    const char *pos_end_name;
+    char **text;
+    int length_prefix, length_suffix, index_expr, index_text, sub_count;
+    int sub_level, has_vars, replace, i;
+
+    if (!expr || !prefix || !prefix[0] || !suffix || !suffix[0])
+        return NULL;
 
-        eval_regex.result = result;
+    vars = calloc (1, sizeof (*vars));
+    if (!vars)
+        return NULL;
 
-        str_replace = eval_replace_vars (replace, eval_context);
+    text = string_dyn_alloc (strlen (expr) + 1);
+    if (!text)
+        goto error;
 
-        length_replace = (str_replace) ? strlen (str_replace) : 0;
+    vars->expr = strdup (expr);
+    if (!vars->expr)
+        goto error;
 
-        length = eval_regex.match[0].rm_so + length_replace +
-            strlen (result + eval_regex.match[0].rm_eo) + 1;
-        result2 = malloc (length);
-        if (!result2)
+    length_prefix = strlen (prefix);
+    length_suffix = strlen (suffix);
+    has_vars = 0;
+    index_expr = 0;
+    index_text = 0;
+    while (expr[index_expr])
+    {
+        if ((expr[index_expr] == '\\') && (expr[index_expr + 1] == prefix[0]))
+        {
+            index_expr++;
+            string_dyn_concat (text, expr + index_expr, 1);
+            index_expr++;
+        }
+        else if (strncmp (expr + index_expr, prefix, length_prefix) == 0)
+        {
+            sub_count = 0;
+            sub_level = 0;
+            pos_end_name = expr + index_expr + length_prefix;
+            while (pos_end_name[0])
+            {
+                if (strncmp (pos_end_name, suffix, length_suffix) == 0)
+                {
+                    if (sub_level == 0)
+                        break;
+                    sub_level--;
+                }
+                if ((pos_end_name[0] == '\\')
+                    && (pos_end_name[1] == prefix[0]))
+                {
+                    pos_end_name++;
+                }
+                else if (strncmp (pos_end_name, prefix, length_prefix) == 0)
+                {
+                    sub_count++;
+                    sub_level++;
+                }
+                pos_end_name++;
+            }
+            if ((*text)[index_text]
+                && !eval_vars_add_segment (vars, EVAL_SEGMENT_TEXT,
+                                           *text + index_text, -1, -1))
+            {
+                goto error;
+            }
+            index_text = strlen (*text);
+            /* prefix without matching suffix: end of string */
+            if (!pos_end_name[0])
+            {
+                if (!eval_vars_add_segment (vars, EVAL_SEGMENT_ERROR,
+                                            NULL, 0, index_expr))
+                {
+                    goto error;
+                }
+                break;
+            }
+            ptr_segment = eval_vars_add_segment (
+                vars,
+                EVAL_SEGMENT_VAR,
+                expr + index_expr + length_prefix,
+                pos_end_name - (expr + index_expr + length_prefix),
+                index_expr);
+            if (!ptr_segment)
+                goto error;
+            if (sub_count > 0)
+            {
+                replace = 1;
+                for (i = 0; eval_no_replace_prefix_list[i]; i++)
+                {
+                    if (strncmp (ptr_segment->text,
+                                 eval_no_replace_prefix_list[i],
+                                 strlen (eval_no_replace_prefix_list[i])) == 0)
+                    {
+                        replace = 0;
+                        break;
+                    }
+                }
+                if (replace)
+                {
+                    ptr_segment->vars = eval_vars_compile (ptr_segment->text,
+                                                           prefix, suffix);
+                    if (!ptr_segment->vars)
+                        goto error;
+                }
+            }
+            has_vars = 1;
+            index_expr = pos_end_name - expr + length_suffix;
+        }
+        else
+        {
+            string_dyn_concat (text, expr + index_expr, 1);
+            index_expr++;
+        }
+    }
+    if ((*text)[index_text]
+        && !eval_vars_add_segment (vars, EVAL_SEGMENT_TEXT,
+                                   *text + index_text, -1, -1))
+    {
+        goto error;
+    }
+
+    if (!has_vars)
+    {
+        /* no variable at all: the value is always the same */
+        vars->static_value = strdup (*text);
+        if (!vars->static_value)
+            goto error;
+    }
+
+    string_dyn_free (text, 1);
+
+    return vars;
+
+error:
+    if (text)
+        string_dyn_free (text, 1);
+    eval_vars_free (vars);
+    return NULL;
+}
+
+/*
+ * Replaces variables in a compiled string (this function must not be called
+ * directly).
+ *
+ * The result is the same as function string_replace_with_callback called
+ * with the callback eval_replace_vars_cb.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+eval_vars_exec (struct t_eval_vars *vars, struct t_eval_context *eval_context)
+{
+    struct t_eval_segment *ptr_segment;
+    char **result, *key, *value;
+    int i;
+
+    if (vars->static_value)
+        return strdup (vars->static_value);
+
+    result = string_dyn_alloc (strlen (vars->expr) + 1);
+    if (!result)
+        return NULL;
+
+    for (i = 0; i < vars->num_segments; i++)
+    {
+        ptr_segment = &(vars->segments[i]);
+        switch (ptr_segment->type)
+        {
+            case EVAL_SEGMENT_TEXT:
+                string_dyn_concat (result, ptr_segment->text, -1);
+                break;
+            case EVAL_SEGMENT_VAR:
+                key = (ptr_segment->vars) ?
+                    eval_vars_exec (ptr_segment->vars, eval_context) : NULL;
+                value = eval_replace_vars_cb (
+                    eval_context,
+                    (ptr_segment->vars) ?
+                    ((key) ? key : "") : ptr_segment->text);
+                if (key)
+                    free (key);
+                if (!value)
+                {
+                    /*
+                     * variable not replaced: keep first char of prefix and
+                     * replace variables in the rest of string
+                     */
+                    string_dyn_concat (result,
+                                       vars->expr + ptr_segment->offset, 1);
+                    value = string_replace_with_callback (
+                        vars->expr + ptr_segment->offset + 1,
+                        eval_context->prefix,
+                        eval_context->suffix,
+                        eval_no_replace_prefix_list,
+                        &eval_replace_vars_cb,
+                        eval_context,
+                        NULL);
+                    if (value)
+                    {
+                        string_dyn_concat (result, value, -1);
+                        free (value);
+                    }
+                    goto end;
+                }
+                string_dyn_concat (result, value, -1);
+                free (value);
+                break;
+            case EVAL_SEGMENT_ERROR:
+            case EVAL_NUM_SEGMENT_TYPES:
+                goto end;
+        }
+    }
+
+end:
+    return string_dyn_free (result, 0);
+}
+
+/*
+ * Frees a compiled condition.
+ */
+
+void
+eval_node_free (struct t_eval_node *node)
+{
+    if (!node)
+        return;
+
+    eval_node_free (node->left);
+    eval_node_free (node->right);
+    eval_vars_free (node->vars_left);
+    eval_vars_free (node->vars_right);
+    if (node->regex)
+    {
+        regfree (node->regex);
+        free (node->regex);
+    }
+    if (node->text)
+        free (node->text);
+
+    free (node);
+}
+
+/*
+ * Compiles a condition: the condition is split into sub-expressions
+ * (logical operators, comparisons, parentheses), with the same rules as
+ * function eval_expression_condition.
+ *
+ * Returns pointer to compiled condition, NULL if error.
+ *
+ * Note: result must be freed after use with function eval_node_free().
+ */
+
+struct t_eval_node *
+eval_node_compile (const char *expr, struct t_eval_context *eval_context)
+{
+    struct t_eval_node *node;
+    int logic, comp, level;
+    const char *pos, *pos_end;
+    char *expr2, *sub_expr;
+
+    if (!expr)
+        return NULL;
+
+    node = calloc (1, sizeof (*node));
+    if (!node)
+        return NULL;
+
+    expr2 = NULL;
+    sub_expr = NULL;
+
+    /* skip spaces at beginning of string */
+    while (expr[0] == ' ')
+    {
+        expr++;
+    }
+    if (!expr[0])
+    {
+        node->type = EVAL_NODE_EMPTY;
+        return node;
+    }
+
+    /* skip spaces at end of string */
+    pos_end = expr + strlen (expr) - 1;
+    while ((pos_end > expr) && (pos_end[0] == ' '))
+    {
+        pos_end--;
+    }
+
+    expr2 = string_strndup (expr, pos_end + 1 - expr);
+    if (!expr2)
+        goto error;
+
+    /* search for a logical operator */
+    for (logic = 0; logic < EVAL_NUM_LOGICAL_OPS; logic++)
+    {
+        pos = eval_strstr_level (expr2, eval_logical_ops[logic], eval_context,
+                                 "(", ")", 0);
+        if (pos > expr2)
+        {
+            pos_end = pos - 1;
+            while ((pos_end > expr2) && (pos_end[0] == ' '))
+            {
+                pos_end--;
+            }
+            sub_expr = string_strndup (expr2, pos_end + 1 - expr2);
+            if (!sub_expr)
+                goto error;
+            pos += strlen (eval_logical_ops[logic]);
+            while (pos[0] == ' ')
+            {
+                pos++;
+            }
+            node->type = EVAL_NODE_LOGICAL;
+            node->op = logic;
+            node->left = eval_node_compile (sub_expr, eval_context);
+            node->right = eval_node_compile (pos, eval_context);
+            if (!node->left || !node->right)
+                goto error;
+            goto end;
+        }
+    }
+
+    /* search for a comparison */
+    for (comp = 0; comp < EVAL_NUM_COMPARISONS; comp++)
+    {
+        pos = eval_strstr_level (expr2, eval_comparisons[comp], eval_context,
+                                 "(", ")", 0);
+        if (pos >= expr2)
+        {
+            if (pos > expr2)
+            {
+                pos_end = pos - 1;
+                while ((pos_end > expr2) && (pos_end[0] == ' '))
+                {
+                    pos_end--;
+                }
+                sub_expr = string_strndup (expr2, pos_end + 1 - expr2);
+            }
+            else
+            {
+                sub_expr = strdup ("");
+            }
+            if (!sub_expr)
+                goto error;
+            pos += strlen (eval_comparisons[comp]);
+            while (pos[0] == ' ')
+            {
+                pos++;
+            }
+            node->type = EVAL_NODE_COMPARE;
+            node->op = comp;
+            if ((comp == EVAL_COMPARE_REGEX_MATCHING)
+                || (comp == EVAL_COMPARE_REGEX_NOT_MATCHING))
+            {
+                /* for regex: just replace vars in both expressions */
+                node->vars_left = eval_vars_compile (sub_expr,
+                                                     eval_context->prefix,
+                                                     eval_context->suffix);
+                node->vars_right = eval_vars_compile (pos,
+                                                      eval_context->prefix,
+                                                      eval_context->suffix);
+                if (!node->vars_left || !node->vars_right)
+                    goto error;
+                /* regex without variables: compile it now */
+                if (node->vars_right->static_value)
+                {
+                    node->regex = malloc (sizeof (*node->regex));
+                    if (!node->regex)
+                        goto error;
+                    if (string_regcomp (node->regex,
+                                        node->vars_right->static_value,
+                                        REG_EXTENDED | REG_ICASE | REG_NOSUB) != 0)
+                    {
+                        free (node->regex);
+                        node->regex = NULL;
+                        node->regex_error = 1;
+                    }
+                }
+            }
+            else
+            {
+                /* other comparison: fully evaluate both expressions */
+                node->left = eval_node_compile (sub_expr, eval_context);
+                node->right = eval_node_compile (pos, eval_context);
+                if (!node->left || !node->right)
+                    goto error;
+            }
+            goto end;
+        }
+    }
+
+    /* sub-expression between parentheses at beginning */
+    if (expr2[0] == '(')
+    {
+        level = 0;
+        pos = expr2 + 1;
+        while (pos[0])
+        {
+            if (pos[0] == '(')
+                level++;
+            else if (pos[0] == ')')
+            {
+                if (level == 0)
+                    break;
+                level--;
+            }
+            pos++;
+        }
+        /* closing parenthesis not found */
+        if (pos[0] != ')')
+        {
+            node->type = EVAL_NODE_ERROR;
+            goto end;
+        }
+        sub_expr = string_strndup (expr2 + 1, pos - expr2 - 1);
+        if (!sub_expr)
+            goto error;
+        node->type = EVAL_NODE_PARENTHESES;
+        node->left = eval_node_compile (sub_expr, eval_context);
+        node->text = strdup (pos + 1);
+        if (!node->left || !node->text)
+            goto error;
+        goto end;
+    }
+
+    /* no logical operator neither comparison: just replace variables */
+    node->type = EVAL_NODE_VARS;
+    node->vars_left = eval_vars_compile (expr2,
+                                         eval_context->prefix,
+                                         eval_context->suffix);
+    if (!node->vars_left)
+        goto error;
+
+end:
+    if (expr2)
+        free (expr2);
+    if (sub_expr)
+        free (sub_expr);
+    return node;
+
+error:
+    if (expr2)
+        free (expr2);
+    if (sub_expr)
+        free (sub_expr);
+    eval_node_free (node);
+    return NULL;
+}
+
+/*
+ * Replaces variables in a compiled string, with check of recursion
+ * (this function must not be called directly).
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+eval_vars_replace (struct t_eval_vars *vars,
+                   struct t_eval_context *eval_context)
+{
+    char *result;
+
+    eval_context->recursion_count++;
+
+    if (eval_context->recursion_count < EVAL_RECURSION_MAX)
+        result = eval_vars_exec (vars, eval_context);
+    else
+        result = strdup ("");
+
+    eval_context->recursion_count--;
+
+    return result;
+}
+
+/*
+ * Evaluates a compiled condition (this function must not be called directly).
+ *
+ * The result is the same as function eval_expression_condition called
+ * with the expression that was compiled.
+ *
+ * Note: result must be freed after use (if not NULL).
+ */
+
+char *
+eval_node_exec (struct t_eval_node *node, struct t_eval_context *eval_context)
+{
+    char *value, *tmp_value, *tmp_value2;
+    int rc, length;
+
+    value = NULL;
+
+    switch (node->type)
+    {
+        case EVAL_NODE_EMPTY:
+            value = strdup ("");
+            break;
+        case EVAL_NODE_LOGICAL:
+            tmp_value = eval_node_exec (node->left, eval_context);
+            rc = eval_is_true (tmp_value);
+            if (tmp_value)
+                free (tmp_value);
+            /*
+             * if rc == 0 with "&&" or rc == 1 with "||", no need to
+             * evaluate second sub-expression, just return the rc
+             */
+            if ((rc && (node->op == EVAL_LOGICAL_OP_AND))
+                || (!rc && (node->op == EVAL_LOGICAL_OP_OR)))
+            {
+                tmp_value = eval_node_exec (node->right, eval_context);
+                rc = eval_is_true (tmp_value);
+                if (tmp_value)
+                    free (tmp_value);
+            }
+            value = strdup ((rc) ? EVAL_STR_TRUE : EVAL_STR_FALSE);
+            break;
+        case EVAL_NODE_COMPARE:
+            if (node->vars_left)
+            {
+                tmp_value = eval_vars_replace (node->vars_left, eval_context);
+                if ((node->regex || node->regex_error)
+                    && (eval_context->recursion_count + 1 < EVAL_RECURSION_MAX))
+                {
+                    /* regex already compiled */
+                    rc = 0;
+                    if (tmp_value && node->regex)
+                    {
+                        rc = (regexec (node->regex, tmp_value,
+                                       0, NULL, 0) == 0) ? 1 : 0;
+                        if (node->op == EVAL_COMPARE_REGEX_NOT_MATCHING)
+                            rc ^= 1;
+                    }
+                    if (tmp_value)
+                        free (tmp_value);
+                    value = strdup ((rc) ? EVAL_STR_TRUE : EVAL_STR_FALSE);
+                    break;
+                }
+                tmp_value2 = eval_vars_replace (node->vars_right,
+                                                eval_context);
+            }
+            else
+            {
+                tmp_value = eval_node_exec (node->left, eval_context);
+                tmp_value2 = eval_node_exec (node->right, eval_context);
+            }
+            value = eval_compare (tmp_value, node->op, tmp_value2,
+                                  eval_context);
+            if (tmp_value)
+                free (tmp_value);
+            if (tmp_value2)
+                free (tmp_value2);
+            break;
+        case EVAL_NODE_PARENTHESES:
+            tmp_value = eval_node_exec (node->left, eval_context);
+            if (!node->text[0])
+            {
+                /*
+                 * nothing around parentheses, then return value of
+                 * sub-expression as-is
+                 */
+                value = tmp_value;
+                break;
+            }
+            length = ((tmp_value) ? strlen (tmp_value) : 0) + 1 +
+                strlen (node->text) + 1;
+            tmp_value2 = malloc (length);
+            if (tmp_value2)
+            {
+                snprintf (tmp_value2, length, "%s %s",
+                          (tmp_value) ? tmp_value : "", node->text);
+                value = eval_expression_condition_parentheses (tmp_value2,
+                                                               eval_context);
+            }
+            if (tmp_value)
+                free (tmp_value);
+            break;
+        case EVAL_NODE_VARS:
+            value = eval_vars_replace (node->vars_left, eval_context);
+            break;
+        case EVAL_NODE_ERROR:
+        case EVAL_NUM_NODE_TYPES:
+            break;
+    }
+
+    return value;
+}
+
+/*
+ * Frees a compiled expression.
+ */
+
+void
+eval_compiled_free (struct t_eval_compiled *compiled)
+{
+    if (!compiled)
+        return;
+
+    if (compiled->key)
+        free (compiled->key);
+    eval_vars_free (compiled->vars);
+    eval_node_free (compiled->node);
+
+    free (compiled);
+}
+
+/*
+ * Releases a compiled expression returned by function eval_compiled_get
+ * (it is freed if it has been removed from cache in the meantime).
+ */
+
+void
+eval_compiled_unref (struct t_eval_compiled *compiled)
+{
+    if (!compiled)
+        return;
+
+    compiled->refcount--;
+    if (compiled->refcount <= 0)
+        eval_compiled_free (compiled);
+}
+
+/*
+ * Removes a compiled expression from cache.
+ */
+
+void
+eval_compiled_remove (struct t_eval_compiled *compiled)
+{
+    hashtable_remove (eval_hashtable_compiled, compiled->key);
+
+    if (compiled->prev_compiled)
+        (compiled->prev_compiled)->next_compiled = compiled->next_compiled;
+    if (compiled->next_compiled)
+        (compiled->next_compiled)->prev_compiled = compiled->prev_compiled;
+    if (eval_compiled == compiled)
+        eval_compiled = compiled->next_compiled;
+    if (last_eval_compiled == compiled)
+        last_eval_compiled = compiled->prev_compiled;
+    compiled->prev_compiled = NULL;
+    compiled->next_compiled = NULL;
+
+    eval_compiled_count--;
+
+    eval_compiled_unref (compiled);
+}
+
+/*
+ * Gets a compiled expression from cache; the expression is compiled and
+ * added in cache if not found (the least recently used expression is removed
+ * if the cache is full).
+ *
+ * The compiled expression depends on the type, the expression and the
+ * prefix/suffix in context.
+ *
+ * Returns pointer to compiled expression, NULL if error.
+ *
+ * Note: the compiled expression must be released after use with function
+ * eval_compiled_unref().
+ */
+
+struct t_eval_compiled *
+eval_compiled_get (enum t_eval_compiled_type type, const char *expr,
+                   struct t_eval_context *eval_context)
+{
+    struct t_eval_compiled *compiled;
+    char str_key[1024], *key;
+    int length;
+
+    if (!expr)
+        return NULL;
+
+    if (!eval_hashtable_compiled)
+    {
+        eval_hashtable_compiled = hashtable_new (256,
+                                                 WEECHAT_HASHTABLE_STRING,
+                                                 WEECHAT_HASHTABLE_POINTER,
+                                                 NULL,
+                                                 NULL);
+        if (!eval_hashtable_compiled)
+            return NULL;
+    }
+
+    length = 64 + eval_context->length_prefix + eval_context->length_suffix +
+        strlen (expr);
+    key = (length <= (int)sizeof (str_key)) ? str_key : malloc (length);
+    if (!key)
+        return NULL;
+    snprintf (key, length, "%d:%d:%d:%s%s%s",
+              type,
+              eval_context->length_prefix,
+              eval_context->length_suffix,
+              eval_context->prefix,
+              eval_context->suffix,
+              expr);
+
+    compiled = (struct t_eval_compiled *)hashtable_get (
+        eval_hashtable_compiled, key);
+    if (compiled)
+    {
+        /* move expression at beginning of list (most recently used) */
+        if (compiled != eval_compiled)
+        {
+            (compiled->prev_compiled)->next_compiled = compiled->next_compiled;
+            if (compiled->next_compiled)
+                (compiled->next_compiled)->prev_compiled = compiled->prev_compiled;
+            else
+                last_eval_compiled = compiled->prev_compiled;
+            compiled->prev_compiled = NULL;
+            compiled->next_compiled = eval_compiled;
+            eval_compiled->prev_compiled = compiled;
+            eval_compiled = compiled;
+        }
+        goto end;
+    }
+
+    compiled = calloc (1, sizeof (*compiled));
+    if (!compiled)
+        goto end;
+    compiled->key = strdup (key);
+    compiled->type = type;
+    if (type == EVAL_COMPILED_CONDITION)
+    {
+        compiled->node = eval_node_compile (expr, eval_context);
+    }
+    else
+    {
+        compiled->vars = eval_vars_compile (expr,
+                                            eval_context->prefix,
+                                            eval_context->suffix);
+    }
+    if (!compiled->key || (!compiled->node && !compiled->vars)
+        || !hashtable_set (eval_hashtable_compiled, key, compiled))
+    {
+        eval_compiled_free (compiled);
+        compiled = NULL;
+        goto end;
+    }
+    compiled->refcount = 1;
+
+    /* add expression at beginning of list (most recently used) */
+    compiled->prev_compiled = NULL;
+    compiled->next_compiled = eval_compiled;
+    if (eval_compiled)
+        eval_compiled->prev_compiled = compiled;
+    else
+        last_eval_compiled = compiled;
+    eval_compiled = compiled;
+    eval_compiled_count++;
+
+    /* remove least recently used expressions if cache is full */
+    while ((eval_compiled_count > EVAL_COMPILED_MAX) && last_eval_compiled
+           && (last_eval_compiled != compiled))
+    {
+        eval_compiled_remove (last_eval_compiled);
+    }
+
+end:
+    if (key != str_key)
+        free (key);
+    if (compiled)
+        compiled->refcount++;
+    return compiled;
+}
+
+/*
+ * Removes all compiled expressions from cache.
+ */
+
+void
+eval_compiled_free_all ()
+{
+    while (eval_compiled)
+    {
+        eval_compiled_remove (eval_compiled);
+    }
+}
+
+/*
+ * Replaces text in a string using a regular expression and replacement text.
+ *
+ * The argument "regex" is a pointer to a regex compiled with WeeChat function
+ * string_regcomp (or function regcomp).
+ *
+ * The argument "replace" is evaluated and can contain any valid expression,
+ * and these ones:
+ *   ${re:0} .. ${re:99}  match 0 to 99 (0 is whole match, 1 .. 99 are groups
+ *                        captured)
+ *   ${re:+}              the last match (with highest number)
+ *
+ * Examples:
+ *
+ *    string   | regex         | replace                    | result
+ *   ----------+---------------+----------------------------+-------------
+ *    test foo | test          | Z                          | Z foo
+ *    test foo | ^(test +)(.*) | ${re:2}                    | foo
+ *    test foo | ^(test +)(.*) | ${re:1}/ ${hide:*,${re:2}} | test / ***
+ *    test foo | ^(test +)(.*) | ${hide:%,${re:+}}          | %%%
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+eval_replace_regex (const char *string, regex_t *regex, const char *replace,
+                    struct t_eval_context *eval_context)
+{
+    char *result, *result2, *str_replace;
+    int length, length_replace, start_offset, i, rc, end, debug_id;
+    int empty_replace_allowed;
+    struct t_eval_regex eval_regex;
+
+    result = NULL;
+
+    EVAL_DEBUG_MSG(1, "eval_replace_regex(\"%s\", 0x%lx, \"%s\")",
+                   string, regex, replace);
+
+    if (!string || !regex || !replace)
+        goto end;
+
+    length = strlen (string) + 1;
+    result = malloc (length);
+    if (!result)
+        goto end;
+    snprintf (result, length, "%s", string);
+
+    eval_context->regex = &eval_regex;
+    eval_context->regex_replacement_index = 1;
+
+    start_offset = 0;
+
+    /* we allow one empty replace if input string is empty */
+    empty_replace_allowed = (result[0]) ? 0 : 1;
+
+    while (result)
+    {
+        for (i = 0; i < 100; i++)
+        {
+            eval_regex.match[i].rm_so = -1;
+        }
+
+        rc = regexec (regex, result + start_offset, 100, eval_regex.match, 0);
+
+        /* no match found: exit the loop */
+        if ((rc != 0) || (eval_regex.match[0].rm_so < 0))
+            break;
+
+        /*
+         * if empty string is matching, continue only if empty replace is
+         * still allowed (to prevent infinite loop)
+         */
+        if (eval_regex.match[0].rm_eo <= 0)
+        {
+            if (!empty_replace_allowed)
+                break;
+            empty_replace_allowed = 0;
+        }
+
+        /* adjust the start/end offsets */
+        eval_regex.last_match = 0;
+        for (i = 0; i < 100; i++)
+        {
+            if (eval_regex.match[i].rm_so >= 0)
+            {
+                eval_regex.last_match = i;
+                eval_regex.match[i].rm_so += start_offset;
+                eval_regex.match[i].rm_eo += start_offset;
+            }
+        }
+
+        /* check if the regex matched the end of string */
+        end = !result[eval_regex.match[0].rm_eo];
+
+        eval_regex.result = result;
+
+        str_replace = eval_replace_vars (replace, eval_context);
+
+        length_replace = (str_replace) ? strlen (str_replace) : 0;
+
+        length = eval_regex.match[0].rm_so + length_replace +
+            strlen (result + eval_regex.match[0].rm_eo) + 1;
+        result2 = malloc (length);
+        if (!result2)
         {
             free (result);
             result = NULL;
@@ -2683,3 +3617,19 @@ eval_expression (const char *expr, struct t_hashtable *pointers,
 
     return value;
 }
+
+/*
+ * Frees all allocated data.
+ */
+
+void
+eval_end ()
+{
+    eval_compiled_free_all ();
+
+    if (eval_hashtable_compiled)
+    {
+        hashtable_free (eval_hashtable_compiled);
+        eval_hashtable_compiled = NULL;
+    }
+}
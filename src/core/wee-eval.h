@@ -30,6 +30,8 @@
 
 #define EVAL_RECURSION_MAX  32
 
+#define EVAL_COMPILED_MAX   1024
+
 #define EVAL_RANGE_DIGIT    "0123456789"
 #define EVAL_RANGE_XDIGIT   EVAL_RANGE_DIGIT "abcdefABCDEF"
 #define EVAL_RANGE_LOWER    "abcdefghijklmnopqrstuvwxyz"
@@ -38,6 +40,7 @@
 #define EVAL_RANGE_ALNUM    EVAL_RANGE_ALPHA EVAL_RANGE_DIGIT
 
 struct t_hashtable;
+struct t_eval_vars;
 
 enum t_eval_logical_op
 {
@@ -76,6 +79,75 @@ struct t_eval_regex
     int last_match;
 };
 
+enum t_eval_segment_type
+{
+    EVAL_SEGMENT_TEXT = 0,             /* text copied as-is                 */
+    EVAL_SEGMENT_VAR,                  /* variable: ${name}                 */
+    EVAL_SEGMENT_ERROR,                /* prefix without suffix (end)       */
+    /* number of segment types */
+    EVAL_NUM_SEGMENT_TYPES,
+};
+
+struct t_eval_segment
+{
+    enum t_eval_segment_type type;     /* type of segment                   */
+    char *text;                        /* text or name of variable          */
+    int offset;                        /* offset of segment in expression   */
+    struct t_eval_vars *vars;          /* name of var with vars (or NULL)   */
+};
+
+struct t_eval_vars
+{
+    char *expr;                        /* expression                        */
+    struct t_eval_segment *segments;   /* text and variables in expression  */
+    int num_segments;                  /* number of segments                */
+    char *static_value;                /* value if there's no variable      */
+};
+
+enum t_eval_node_type
+{
+    EVAL_NODE_EMPTY = 0,               /* empty expression (value: "")      */
+    EVAL_NODE_LOGICAL,                 /* logical operator: "||" or "&&"    */
+    EVAL_NODE_COMPARE,                 /* comparison                        */
+    EVAL_NODE_PARENTHESES,             /* sub-expression in parentheses     */
+    EVAL_NODE_VARS,                    /* replace variables in text         */
+    EVAL_NODE_ERROR,                   /* invalid expression (value: NULL)  */
+    /* number of node types */
+    EVAL_NUM_NODE_TYPES,
+};
+
+struct t_eval_node
+{
+    enum t_eval_node_type type;        /* type of node                      */
+    int op;                            /* logical operator or comparison    */
+    struct t_eval_node *left;          /* left sub-expression               */
+    struct t_eval_node *right;         /* right sub-expression              */
+    struct t_eval_vars *vars_left;     /* left text (regex or vars)         */
+    struct t_eval_vars *vars_right;    /* right text (regex)                */
+    regex_t *regex;                    /* regex (if static right text)      */
+    int regex_error;                   /* 1 if static regex is invalid      */
+    char *text;                        /* text after parentheses            */
+};
+
+enum t_eval_compiled_type
+{
+    EVAL_COMPILED_VARS = 0,            /* replace variables                 */
+    EVAL_COMPILED_CONDITION,           /* evaluate condition                */
+    /* number of compiled expression types */
+    EVAL_NUM_COMPILED_TYPES,
+};
+
+struct t_eval_compiled
+{
+    char *key;                         /* type, prefix, suffix, expression  */
+    enum t_eval_compiled_type type;    /* type of compiled expression       */
+    struct t_eval_vars *vars;          /* vars (EVAL_COMPILED_VARS)         */
+    struct t_eval_node *node;          /* node (EVAL_COMPILED_CONDITION)    */
+    int refcount;                      /* cache + evaluations in progress   */
+    struct t_eval_compiled *prev_compiled; /* link to prev (more recent)    */
+    struct t_eval_compiled *next_compiled; /* link to next (less recent)    */
+};
+
 struct t_eval_context
 {
     struct t_hashtable *pointers;      /* pointers used in eval             */
@@ -95,10 +167,28 @@ struct t_eval_context
     char **debug_output;               /* string with debug output          */
 };
 
+extern struct t_hashtable *eval_hashtable_compiled;
+extern struct t_eval_compiled *eval_compiled;
+extern struct t_eval_compiled *last_eval_compiled;
+extern int eval_compiled_count;
+
 extern int eval_is_true (const char *value);
+extern struct t_eval_vars *eval_vars_compile (const char *expr,
+                                              const char *prefix,
+                                              const char *suffix);
+extern void eval_vars_free (struct t_eval_vars *vars);
+extern struct t_eval_node *eval_node_compile (const char *expr,
+                                              struct t_eval_context *eval_context);
+extern void eval_node_free (struct t_eval_node *node);
+extern struct t_eval_compiled *eval_compiled_get (enum t_eval_compiled_type type,
+                                                  const char *expr,
+                                                  struct t_eval_context *eval_context);
+extern void eval_compiled_unref (struct t_eval_compiled *compiled);
+extern void eval_compiled_free_all ();
 extern char *eval_expression (const char *expr,
                               struct t_hashtable *pointers,
                               struct t_hashtable *extra_vars,
                               struct t_hashtable *options);
+extern void eval_end ();
 
 #endif /* WEECHAT_EVAL_H */
@@ -23,6 +23,7 @@
 #include "config.h"
 #endif
 
+#include <limits.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
@@ -180,10 +181,12 @@ hashtable_keycmp_default_cb (struct t_hashtable *hashtable,
 /*
  * Creates a new hashtable.
  *
- * The size is NOT a limit for number of items in hashtable. It is the size of
- * internal array to store hashed keys: a high value uses more memory, but has
- * better performance because this reduces the collisions of hashed keys and
- * then reduces length of linked lists.
+ * The size is NOT a limit for number of items in hashtable. It is the initial
+ * size of internal array to store hashed keys: a high value uses more memory,
+ * but has better performance because this reduces the collisions of hashed
+ * keys and then reduces length of linked lists.
+ * The internal array grows automatically when there are too many items in
+ * the hashtable (see HASHTABLE_MAX_LOAD_FACTOR).
  *
  * Returns pointer to new hashtable, NULL if error.
  */
@@ -228,6 +231,9 @@ hashtable_new (int size,
         {
             new_hashtable->htable[i] = NULL;
         }
+        new_hashtable->size_old = 0;
+        new_hashtable->htable_old = NULL;
+        new_hashtable->rehash_index = 0;
         new_hashtable->items_count = 0;
         new_hashtable->oldest_item = NULL;
         new_hashtable->newest_item = NULL;
@@ -243,6 +249,145 @@ hashtable_new (int size,
     return new_hashtable;
 }
 
+/*
+ * Returns the address of bucket (in htable or htable_old) where an item with
+ * this hash is stored.
+ */
+
+struct t_hashtable_item **
+hashtable_get_bucket (struct t_hashtable *hashtable, unsigned long long hash)
+{
+    int index;
+
+    if (hashtable->htable_old)
+    {
+        index = hash % hashtable->size_old;
+        if (index >= hashtable->rehash_index)
+            return &(hashtable->htable_old[index]);
+    }
+
+    return &(hashtable->htable[hash % hashtable->size]);
+}
+
+/*
+ * Moves some buckets from the old htable to the new one (during a rehash).
+ *
+ * The new htable has twice the size of the old one, so the items of a bucket
+ * "i" in old htable are moved to buckets "i" or "i + size_old" in new htable;
+ * these buckets are empty (new items with such hash are still added in old
+ * htable), so the items are just appended and remain sorted.
+ *
+ * When all buckets are moved, the old htable is freed.
+ */
+
+void
+hashtable_rehash_step (struct t_hashtable *hashtable, int num_buckets)
+{
+    struct t_hashtable_item *ptr_item, *ptr_next_item, *last_item[2];
+    int i, index, index_new;
+
+    while (hashtable->htable_old && (num_buckets > 0))
+    {
+        index = hashtable->rehash_index;
+        ptr_item = hashtable->htable_old[index];
+        hashtable->htable_old[index] = NULL;
+        hashtable->rehash_index++;
+
+        last_item[0] = NULL;
+        last_item[1] = NULL;
+        while (ptr_item)
+        {
+            ptr_next_item = ptr_item->next_item;
+            index_new = ptr_item->hash % hashtable->size;
+            i = (index_new == index) ? 0 : 1;
+            ptr_item->prev_item = last_item[i];
+            ptr_item->next_item = NULL;
+            if (last_item[i])
+                (last_item[i])->next_item = ptr_item;
+            else
+                hashtable->htable[index_new] = ptr_item;
+            last_item[i] = ptr_item;
+            ptr_item = ptr_next_item;
+        }
+
+        if (hashtable->rehash_index >= hashtable->size_old)
+        {
+            free (hashtable->htable_old);
+            hashtable->htable_old = NULL;
+            hashtable->size_old = 0;
+            hashtable->rehash_index = 0;
+        }
+
+        num_buckets--;
+    }
+}
+
+/*
+ * Grows the htable of hashtable: a new htable with twice the size is
+ * allocated and the items will be moved incrementally by function
+ * hashtable_rehash_step.
+ *
+ * If the allocation fails, the hashtable keeps its current htable (it is
+ * still working, but with longer linked lists).
+ */
+
+void
+hashtable_grow (struct t_hashtable *hashtable)
+{
+    struct t_hashtable_item **new_htable;
+    int new_size;
+
+    if (hashtable->size > INT_MAX / 2)
+        return;
+
+    /* finish the rehash in progress (if any) */
+    if (hashtable->htable_old)
+        hashtable_rehash_step (hashtable, hashtable->size_old);
+
+    new_size = hashtable->size * 2;
+    new_htable = calloc (new_size, sizeof (*new_htable));
+    if (!new_htable)
+        return;
+
+    hashtable->size_old = hashtable->size;
+    hashtable->htable_old = hashtable->htable;
+    hashtable->rehash_index = 0;
+    hashtable->size = new_size;
+    hashtable->htable = new_htable;
+}
+
+/*
+ * Returns size of key if it can be allocated in same memory block as the item
+ * (inline key), or 0 if the key must be allocated separately.
+ */
+
+int
+hashtable_inline_key_size (struct t_hashtable *hashtable,
+                           const void *key, int key_size)
+{
+    /* the key is freed by the caller, so it must be allocated separately */
+    if (hashtable->callback_free_key)
+        return 0;
+
+    switch (hashtable->type_keys)
+    {
+        case HASHTABLE_INTEGER:
+            return sizeof (int);
+        case HASHTABLE_STRING:
+            return strlen ((const char *)key) + 1;
+        case HASHTABLE_POINTER:
+            return 0;
+        case HASHTABLE_BUFFER:
+            return key_size;
+        case HASHTABLE_TIME:
+            return sizeof (time_t);
+        case HASHTABLE_NUM_TYPES:
+            break;
+    }
+
+    return 0;
+}
+
 /*
  * Allocates space for a key or value.
  */
@@ -308,6 +453,10 @@ void
 hashtable_free_key (struct t_hashtable *hashtable,
                     struct t_hashtable_item *item)
 {
+    /* inline key is freed with the item */
+    if (item->key_inline)
+        return;
+
     if (hashtable->callback_free_key)
     {
         (void) (hashtable->callback_free_key) (hashtable,
@@ -379,7 +528,8 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
                          const void *value, int value_size)
 {
     unsigned long long hash;
-    struct t_hashtable_item *ptr_item, *pos_item, *new_item;
+    struct t_hashtable_item **ptr_bucket, *ptr_item, *pos_item, *new_item;
+    int inline_key_size;
 
     if (!hashtable || !key
         || ((hashtable->type_keys == HASHTABLE_BUFFER) && (key_size <= 0))
@@ -388,10 +538,14 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
         return NULL;
     }
 
+    if (hashtable->htable_old)
+        hashtable_rehash_step (hashtable, HASHTABLE_REHASH_STEP);
+
     /* search position for item in hashtable */
-    hash = hashtable->callback_hash_key (hashtable, key) % hashtable->size;
+    hash = hashtable->callback_hash_key (hashtable, key);
+    ptr_bucket = hashtable_get_bucket (hashtable, hash);
     pos_item = NULL;
-    for (ptr_item = hashtable->htable[hash];
+    for (ptr_item = *ptr_bucket;
          ptr_item
              && ((int)(hashtable->callback_keycmp) (hashtable, key, ptr_item->key) > 0);
          ptr_item = ptr_item->next_item)
@@ -409,15 +563,28 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
         return ptr_item;
     }
 
-    /* create new item */
-    new_item = malloc (sizeof (*new_item));
+    /* create new item (with the key in same memory block if possible) */
+    inline_key_size = hashtable_inline_key_size (hashtable, key, key_size);
+    new_item = malloc (sizeof (*new_item) + inline_key_size);
     if (!new_item)
         return NULL;
 
     /* set key and value */
-    hashtable_alloc_type (hashtable->type_keys,
-                          key, key_size,
-                          &new_item->key, &new_item->key_size);
+    if (inline_key_size > 0)
+    {
+        new_item->key = new_item + 1;
+        memcpy (new_item->key, key, inline_key_size);
+        new_item->key_size = inline_key_size;
+        new_item->key_inline = 1;
+    }
+    else
+    {
+        hashtable_alloc_type (hashtable->type_keys,
+                              key, key_size,
+                              &new_item->key, &new_item->key_size);
+        new_item->key_inline = 0;
+    }
+    new_item->hash = hash;
     hashtable_alloc_type (hashtable->type_values,
                           value, value_size,
                           &new_item->value, &new_item->value_size);
@@ -436,10 +603,10 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
     {
         /* insert item at beginning of list */
         new_item->prev_item = NULL;
-        new_item->next_item = hashtable->htable[hash];
-        if (hashtable->htable[hash])
-            (hashtable->htable[hash])->prev_item = new_item;
-        hashtable->htable[hash] = new_item;
+        new_item->next_item = *ptr_bucket;
+        if (*ptr_bucket)
+            (*ptr_bucket)->prev_item = new_item;
+        *ptr_bucket = new_item;
     }
 
     /* keep items ordered by date of creation */
@@ -453,6 +620,12 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
 
     hashtable->items_count++;
 
+    if (!hashtable->htable_old
+        && (hashtable->items_count > hashtable->size * HASHTABLE_MAX_LOAD_FACTOR))
+    {
+        hashtable_grow (hashtable);
+    }
+
     return new_item;
 }
 
@@ -475,8 +648,8 @@ hashtable_set (struct t_hashtable *hashtable,
 /*
  * Searches for an item in hashtable.
  *
- * If hash is non NULL, then it is set with hash value of key (even if key is
- * not found).
+ * If hash is non NULL, then it is set with hash value of key, reduced to the
+ * size of htable (even if key is not found).
  */
 
 struct t_hashtable_item *
@@ -489,10 +662,13 @@ hashtable_get_item (struct t_hashtable *hashtable, const void *key,
     if (!hashtable || !key)
         return NULL;
 
-    key_hash = hashtable->callback_hash_key (hashtable, key) % hashtable->size;
+    if (hashtable->htable_old)
+        hashtable_rehash_step (hashtable, HASHTABLE_REHASH_STEP);
+
+    key_hash = hashtable->callback_hash_key (hashtable, key);
     if (hash)
-        *hash = key_hash;
-    for (ptr_item = hashtable->htable[key_hash];
+        *hash = key_hash % hashtable->size;
+    for (ptr_item = *(hashtable_get_bucket (hashtable, key_hash));
          ptr_item && hashtable->callback_keycmp (hashtable, key, ptr_item->key) > 0;
          ptr_item = ptr_item->next_item)
     {
@@ -1202,9 +1378,10 @@ hashtable_add_from_infolist (struct t_hashtable *hashtable,
 
 void
 hashtable_remove_item (struct t_hashtable *hashtable,
-                       struct t_hashtable_item *item,
-                       unsigned long long hash)
+                       struct t_hashtable_item *item)
 {
+    struct t_hashtable_item **ptr_bucket;
+
     if (!hashtable || !item)
         return;
 
@@ -1227,8 +1404,9 @@ hashtable_remove_item (struct t_hashtable *hashtable,
         (item->prev_item)->next_item = item->next_item;
     if (item->next_item)
         (item->next_item)->prev_item = item->prev_item;
-    if (hashtable->htable[hash] == item)
-        hashtable->htable[hash] = item->next_item;
+    ptr_bucket = hashtable_get_bucket (hashtable, item->hash);
+    if (*ptr_bucket == item)
+        *ptr_bucket = item->next_item;
 
     free (item);
 
@@ -1243,14 +1421,13 @@ void
 hashtable_remove (struct t_hashtable *hashtable, const void *key)
 {
     struct t_hashtable_item *ptr_item;
-    unsigned long long hash;
 
     if (!hashtable || !key)
         return;
 
-    ptr_item = hashtable_get_item (hashtable, key, &hash);
+    ptr_item = hashtable_get_item (hashtable, key, NULL);
     if (ptr_item)
-        hashtable_remove_item (hashtable, ptr_item, hash);
+        hashtable_remove_item (hashtable, ptr_item);
 }
 
 /*
@@ -1260,17 +1437,21 @@ hashtable_remove (struct t_hashtable *hashtable, const void *key)
 void
 hashtable_remove_all (struct t_hashtable *hashtable)
 {
-    int i;
-
     if (!hashtable)
         return;
 
-    for (i = 0; i < hashtable->size; i++)
+    while (hashtable->oldest_item)
     {
-        while (hashtable->htable[i])
-        {
-            hashtable_remove_item (hashtable, hashtable->htable[i], i);
-        }
+        hashtable_remove_item (hashtable, hashtable->oldest_item);
+    }
+
+    /* all buckets are empty, so the rehash in progress (if any) is done */
+    if (hashtable->htable_old)
+    {
+        free (hashtable->htable_old);
+        hashtable->htable_old = NULL;
+        hashtable->size_old = 0;
+        hashtable->rehash_index = 0;
     }
 }
 
@@ -1286,6 +1467,8 @@ hashtable_free (struct t_hashtable *hashtable)
 
     hashtable_remove_all (hashtable);
     free (hashtable->htable);
+    if (hashtable->htable_old)
+        free (hashtable->htable_old);
     if (hashtable->keys_values)
         free (hashtable->keys_values);
     free (hashtable);
@@ -1298,13 +1481,16 @@ hashtable_free (struct t_hashtable *hashtable)
 void
 hashtable_print_log (struct t_hashtable *hashtable, const char *name)
 {
-    struct t_hashtable_item *ptr_item;
+    struct t_hashtable_item **ptr_bucket, *ptr_item;
     int i;
 
     log_printf ("");
     log_printf ("[hashtable %s (addr:0x%lx)]", name, hashtable);
     log_printf ("  size . . . . . . . . . : %d",    hashtable->size);
     log_printf ("  htable . . . . . . . . : 0x%lx", hashtable->htable);
+    log_printf ("  size_old . . . . . . . : %d",    hashtable->size_old);
+    log_printf ("  htable_old . . . . . . : 0x%lx", hashtable->htable_old);
+    log_printf ("  rehash_index . . . . . : %d",    hashtable->rehash_index);
     log_printf ("  items_count. . . . . . : %d",    hashtable->items_count);
     log_printf ("  oldest_item. . . . . . : 0x%lx", hashtable->oldest_item);
     log_printf ("  newest_item. . . . . . : 0x%lx", hashtable->newest_item);
@@ -1320,13 +1506,23 @@ hashtable_print_log (struct t_hashtable *hashtable, const char *name)
     log_printf ("  callback_free_value. . : 0x%lx", hashtable->callback_free_value);
     log_printf ("  keys_values. . . . . . : '%s'",  hashtable->keys_values);
 
-    for (i = 0; i < hashtable->size; i++)
+    for (i = 0; i < hashtable->size + hashtable->size_old; i++)
     {
-        log_printf ("  htable[%06d] . . . . : 0x%lx", i, hashtable->htable[i]);
-        for (ptr_item = hashtable->htable[i]; ptr_item;
+        if (i < hashtable->size)
+        {
+            ptr_bucket = &(hashtable->htable[i]);
+            log_printf ("  htable[%06d] . . . . : 0x%lx", i, *ptr_bucket);
+        }
+        else
+        {
+            ptr_bucket = &(hashtable->htable_old[i - hashtable->size]);
+            log_printf ("  htable_old[%06d] . . : 0x%lx",
+                        i - hashtable->size, *ptr_bucket);
+        }
+        for (ptr_item = *ptr_bucket; ptr_item;
              ptr_item = ptr_item->next_item)
         {
-            log_printf ("    [item 0x%lx]", hashtable->htable);
+            log_printf ("    [item 0x%lx]", ptr_item);
             switch (hashtable->type_keys)
             {
                 case HASHTABLE_INTEGER:
@@ -1348,6 +1544,7 @@ hashtable_print_log (struct t_hashtable *hashtable, const char *name)
                     break;
             }
             log_printf ("      key_size . . . . . : %d", ptr_item->key_size);
+            log_printf ("      key_inline . . . . : %d", ptr_item->key_inline);
             switch (hashtable->type_values)
             {
                 case HASHTABLE_INTEGER:
@@ -1369,6 +1566,7 @@ hashtable_print_log (struct t_hashtable *hashtable, const char *name)
                     break;
             }
             log_printf ("      value_size . . . . : %d",    ptr_item->value_size);
+            log_printf ("      hash . . . . . . . : %llu",  ptr_item->hash);
             log_printf ("      prev_item. . . . . : 0x%lx", ptr_item->prev_item);
             log_printf ("      next_item. . . . . : 0x%lx", ptr_item->next_item);
             log_printf ("      prev_created_item. : 0x%lx", ptr_item->prev_created_item);
@@ -96,8 +96,24 @@ typedef void (t_hashtable_map_string)(void *data,
  * +-----+
  * |   7 | --> "weechat"
  * +-----+
+ *
+ * The htable grows automatically: when the number of items exceeds
+ * HASHTABLE_MAX_LOAD_FACTOR * size, a new htable with twice the size is
+ * allocated and the items are moved incrementally from the old htable to the
+ * new one: a few buckets are moved on each set/get/remove, so that there is
+ * never a long pause to rehash a big hashtable. During this time, the key is
+ * searched in the old htable if its bucket was not yet moved, otherwise in the
+ * new one.
+ *
+ * The key of an item is allocated in the same memory block as the item
+ * (except for keys of type "pointer" and if a callback to free keys is set),
+ * so that a single allocation is made per item and the key is close to the
+ * item in memory.
  */
 
+#define HASHTABLE_MAX_LOAD_FACTOR 1
+#define HASHTABLE_REHASH_STEP     4
+
 enum t_hashtable_type
 {
     HASHTABLE_INTEGER = 0,
@@ -113,8 +129,10 @@ struct t_hashtable_item
 {
     void *key;                          /* item key                         */
     int key_size;                       /* size of key (in bytes)           */
+    int key_inline;                     /* 1 if key is allocated with item  */
     void *value;                        /* pointer to value                 */
     int value_size;                     /* size of value (in bytes)         */
+    unsigned long long hash;            /* hash of key (not reduced to size)*/
     struct t_hashtable_item *prev_item; /* link to previous item            */
     struct t_hashtable_item *next_item; /* link to next item                */
     /* previous/next item by order of creation in the hashtable */
@@ -128,6 +146,11 @@ struct t_hashtable
     int size;                          /* hashtable size                    */
     struct t_hashtable_item **htable;  /* table to map hashes with linked   */
                                        /* lists                             */
+    int size_old;                      /* size of old htable (during rehash)*/
+    struct t_hashtable_item **htable_old; /* old htable, items not yet      */
+                                       /* moved to htable (NULL if no       */
+                                       /* rehash in progress)               */
+    int rehash_index;                  /* next bucket to move in htable_old */
     int items_count;                   /* number of items in hashtable      */
     struct t_hashtable_item *oldest_item; /* oldest item in hashtable       */
     struct t_hashtable_item *newest_item; /* newest item in hashtable       */
@@ -120,6 +120,7 @@ hdata_new (struct t_weechat_plugin *plugin, const char *hdata_name,
                                               NULL,
                                               NULL);
         new_hdata->hash_list->callback_free_value = &hdata_free_list_cb;
+        new_hdata->lists_pointers = NULL;
         hashtable_set (weechat_hdata, hdata_name, new_hdata);
         new_hdata->create_allowed = create_allowed;
         new_hdata->delete_allowed = delete_allowed;
@@ -178,20 +179,115 @@ void
 hdata_new_list (struct t_hdata *hdata, const char *name, void *pointer,
                 int flags)
 {
-    struct t_hdata_list *list;
+    hdata_new_list_pointers (hdata, name, pointer, flags, NULL);
+}
+
+/*
+ * Creates a new list pointer in hdata, with a hashtable containing all
+ * pointers in the list (this hashtable is maintained by the owner of the
+ * list with functions hdata_pointers_add and hdata_pointers_remove).
+ *
+ * The hashtable is used to check pointers of this list without reading the
+ * whole list.
+ */
+
+void
+hdata_new_list_pointers (struct t_hdata *hdata, const char *name,
+                         void *pointer, int flags,
+                         struct t_hashtable **pointers)
+{
+    struct t_hdata_list *list, *ptr_list, **ptr_next;
 
     if (!hdata || !name)
         return;
 
+    /* remove list with same name from lists with pointers */
+    ptr_list = hashtable_get (hdata->hash_list, name);
+    if (ptr_list)
+    {
+        for (ptr_next = &hdata->lists_pointers; *ptr_next;
+             ptr_next = &((*ptr_next)->next_list_pointers))
+        {
+            if (*ptr_next == ptr_list)
+            {
+                *ptr_next = ptr_list->next_list_pointers;
+                break;
+            }
+        }
+    }
+
     list = malloc (sizeof (*list));
     if (list)
     {
         list->pointer = pointer;
         list->flags = flags;
+        list->pointers = pointers;
+        list->next_list_pointers = NULL;
+        if (pointers)
+        {
+            list->next_list_pointers = hdata->lists_pointers;
+            hdata->lists_pointers = list;
+        }
         hashtable_set (hdata->hash_list, name, list);
     }
 }
 
+/*
+ * Adds a pointer in a hashtable with pointers of a list (this function must
+ * be called for each element added in the list, "list" is the list before
+ * the element is added).
+ *
+ * The hashtable is created when the list is empty; if an error occurs, the
+ * hashtable is freed and not used any more until the list becomes empty
+ * again.
+ */
+
+void
+hdata_pointers_add (struct t_hashtable **pointers, void *list, void *pointer)
+{
+    if (!pointers || !pointer)
+        return;
+
+    if (!*pointers)
+    {
+        if (list)
+            return;
+        *pointers = hashtable_new (32,
+                                   WEECHAT_HASHTABLE_POINTER,
+                                   WEECHAT_HASHTABLE_POINTER,
+                                   NULL, NULL);
+        if (!*pointers)
+            return;
+    }
+
+    if (!hashtable_set (*pointers, pointer, NULL))
+    {
+        hashtable_free (*pointers);
+        *pointers = NULL;
+    }
+}
+
+/*
+ * Removes a pointer from a hashtable with pointers of a list (this function
+ * must be called for each element removed from the list).
+ *
+ * The hashtable is freed when it becomes empty.
+ */
+
+void
+hdata_pointers_remove (struct t_hashtable **pointers, void *pointer)
+{
+    if (!pointers || !*pointers || !pointer)
+        return;
+
+    hashtable_remove (*pointers, pointer);
+    if ((*pointers)->items_count == 0)
+    {
+        hashtable_free (*pointers);
+        *pointers = NULL;
+    }
+}
+
 /*
  * Gets offset of variable in hdata.
  */
@@ -472,6 +568,27 @@ hdata_check_pointer_in_list (struct t_hdata *hdata, void *list, void *pointer)
     return 0;
 }
 
+/*
+ * Checks if a pointer is in a list, using the hashtable with pointers of the
+ * list if there is one.
+ *
+ * Returns:
+ *   1: pointer exists in list
+ *   0: pointer does not exist
+ */
+
+int
+hdata_check_pointer_in_hdata_list (struct t_hdata *hdata,
+                                   struct t_hdata_list *list, void *pointer)
+{
+    if (list->pointers && *(list->pointers))
+        return (hashtable_has_key (*(list->pointers), pointer)) ? 1 : 0;
+
+    return hdata_check_pointer_in_list (hdata,
+                                        *((void **)(list->pointer)),
+                                        pointer);
+}
+
 /*
  * Checks if a pointer is in a list with flag "check_pointers".
  */
@@ -502,10 +619,8 @@ hdata_check_pointer_map_cb (void *data, struct t_hashtable *hashtable,
     if (!ptr_list || !(ptr_list->flags & WEECHAT_HDATA_LIST_CHECK_POINTERS))
         return;
 
-    *found = (void *)((unsigned long)hdata_check_pointer_in_list (
-                          ptr_hdata,
-                          *((void **)(ptr_list->pointer)),
-                          pointer));
+    *found = (void *)((unsigned long)hdata_check_pointer_in_hdata_list (
+                          ptr_hdata, ptr_list, pointer));
     (*num_lists)++;
 }
 
@@ -517,6 +632,9 @@ hdata_check_pointer_map_cb (void *data, struct t_hashtable *hashtable,
  * the pointer is considered valid (so this function returns 1); if the
  * pointer is not found in any list, this function returns 0.
  *
+ * For lists that have a hashtable with pointers (for example buffers and
+ * windows), the check is made with this hashtable, without reading the list.
+ *
  * Returns:
  *   1: pointer exists in the given list (or a list with check_pointers flag)
  *   0: pointer does not exist
@@ -525,6 +643,7 @@ hdata_check_pointer_map_cb (void *data, struct t_hashtable *hashtable,
 int
 hdata_check_pointer (struct t_hdata *hdata, void *list, void *pointer)
 {
+    struct t_hdata_list *ptr_list;
     void *pointers[4];
 
     if (!hdata || !pointer)
@@ -532,6 +651,17 @@ hdata_check_pointer (struct t_hdata *hdata, void *list, void *pointer)
 
     if (list)
     {
+        /* search a list in hdata with this start and pointers */
+        for (ptr_list = hdata->lists_pointers; ptr_list;
+             ptr_list = ptr_list->next_list_pointers)
+        {
+            if (*((void **)(ptr_list->pointer)) == list)
+            {
+                return hdata_check_pointer_in_hdata_list (hdata, ptr_list,
+                                                          pointer);
+            }
+        }
+
         /* search pointer in the given list */
         return hdata_check_pointer_in_list (hdata, list, pointer);
     }
@@ -1342,6 +1472,7 @@ hdata_print_log_map_cb (void *data, struct t_hashtable *hashtable,
     log_printf ("  hash_list. . . . . . . : 0x%lx (hashtable: '%s')",
                 ptr_hdata->hash_list,
                 hashtable_get_string (ptr_hdata->hash_list, "keys_values"));
+    log_printf ("  lists_pointers . . . . : 0x%lx", ptr_hdata->lists_pointers);
     log_printf ("  create_allowed . . . . : %d",    (int)ptr_hdata->create_allowed);
     log_printf ("  delete_allowed . . . . : %d",    (int)ptr_hdata->delete_allowed);
     log_printf ("  callback_update. . . . : 0x%lx", ptr_hdata->callback_update);
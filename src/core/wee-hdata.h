@@ -29,6 +29,9 @@
                    __array_size, __hdata_name)
 #define HDATA_LIST(__name, __flags)                                     \
     hdata_new_list (hdata, #__name, &(__name), __flags);
+#define HDATA_LIST_POINTERS(__name, __flags, __pointers)                \
+    hdata_new_list_pointers (hdata, #__name, &(__name), __flags,        \
+                             &(__pointers));
 
 struct t_hdata_var
 {
@@ -45,6 +48,10 @@ struct t_hdata_list
 {
     void *pointer;                     /* list pointer                      */
     int flags;                         /* flags for list                    */
+    struct t_hashtable **pointers;     /* hashtable with all pointers in    */
+                                       /* list (to check pointers quickly), */
+                                       /* NULL if not used                  */
+    struct t_hdata_list *next_list_pointers; /* next list with pointers     */
 };
 
 struct t_hdata
@@ -59,6 +66,7 @@ struct t_hdata
     struct t_hashtable *hash_var;      /* hash with type & offset of vars   */
     struct t_hashtable *hash_list;     /* hashtable with pointers on lists  */
                                        /* (used to search objects)          */
+    struct t_hdata_list *lists_pointers; /* lists with hashtable of pointers*/
 
     char create_allowed;               /* create allowed?                   */
     char delete_allowed;               /* delete allowed?                   */
@@ -91,6 +99,13 @@ extern void hdata_new_var (struct t_hdata *hdata, const char *name, int offset,
                            const char *hdata_name);
 extern void hdata_new_list (struct t_hdata *hdata, const char *name,
                             void *pointer, int flags);
+extern void hdata_new_list_pointers (struct t_hdata *hdata, const char *name,
+                                     void *pointer, int flags,
+                                     struct t_hashtable **pointers);
+extern void hdata_pointers_add (struct t_hashtable **pointers, void *list,
+                                void *pointer);
+extern void hdata_pointers_remove (struct t_hashtable **pointers,
+                                   void *pointer);
 extern int hdata_get_var_offset (struct t_hdata *hdata, const char *name);
 extern int hdata_get_var_type (struct t_hdata *hdata, const char *name);
 extern const char *hdata_get_var_type_string (struct t_hdata *hdata,
@@ -54,13 +54,22 @@ int real_delete_pending = 0;           /* 1 if some hooks must be deleted   */
 
 int hook_socketpair_ok = 0;            /* 1 if socketpair() is OK           */
 
+/* hooks matching names sent (signals, hsignals, ...), by hook type */
+struct t_hashtable *hook_match_cache[HOOK_NUM_TYPES];
+/* entries in cache, sorted from most recently to least recently used */
+struct t_hook_match *hook_match_first[HOOK_NUM_TYPES];
+struct t_hook_match *hook_match_last[HOOK_NUM_TYPES];
+unsigned int hook_generation[HOOK_NUM_TYPES]; /* incremented when hooks of  */
+                                              /* this type are added or     */
+                                              /* removed                    */
+
 /* hook callbacks */
 t_callback_hook *hook_callback_add[HOOK_NUM_TYPES] =
-{ NULL, NULL, NULL, &hook_fd_add_cb, NULL, NULL, NULL, NULL, NULL, NULL,
-  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+{ NULL, NULL, &hook_timer_add_cb, &hook_fd_add_cb, NULL, NULL, NULL, NULL,
+  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
 t_callback_hook *hook_callback_remove[HOOK_NUM_TYPES] =
-{ NULL, NULL, NULL, &hook_fd_remove_cb, NULL, NULL, NULL, NULL, NULL, NULL,
-  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+{ NULL, NULL, &hook_timer_remove_cb, &hook_fd_remove_cb, NULL, NULL, NULL,
+  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
 t_callback_hook *hook_callback_free_data[HOOK_NUM_TYPES] =
 { &hook_command_free_data, &hook_command_run_free_data,
   &hook_timer_free_data, &hook_fd_free_data,
@@ -118,6 +127,10 @@ hook_init ()
         weechat_hooks[type] = NULL;
         last_weechat_hook[type] = NULL;
         hooks_count[type] = 0;
+        hook_match_cache[type] = NULL;
+        hook_match_first[type] = NULL;
+        hook_match_last[type] = NULL;
+        hook_generation[type] = 0;
     }
     hooks_count_total = 0;
     hook_last_system_time = time (NULL);
@@ -215,6 +228,17 @@ hook_find_pos (struct t_hook *hook)
     }
     else
     {
+        /*
+         * fast path: priority is lower or equal to the last hook (for example
+         * all timers and fd hooks have the default priority), add at the end
+         */
+        if (last_weechat_hook[hook->type]
+            && !last_weechat_hook[hook->type]->deleted
+            && (hook->priority <= last_weechat_hook[hook->type]->priority))
+        {
+            return NULL;
+        }
+
         /* for other types, sort on priority */
         for (ptr_hook = weechat_hooks[hook->type]; ptr_hook;
              ptr_hook = ptr_hook->next_hook)
@@ -270,6 +294,7 @@ hook_add_to_list (struct t_hook *new_hook)
 
     hooks_count[new_hook->type]++;
     hooks_count_total++;
+    hook_generation[new_hook->type]++;
 
     if (hook_callback_add[new_hook->type])
         (hook_callback_add[new_hook->type]) (new_hook);
@@ -304,6 +329,7 @@ hook_remove_from_list (struct t_hook *hook)
 
     hooks_count[type]--;
     hooks_count_total--;
+    hook_generation[type]++;
 
     if (hook_callback_remove[hook->type])
         (hook_callback_remove[hook->type]) (hook);
@@ -402,6 +428,228 @@ hook_valid (struct t_hook *hook)
     return 0;
 }
 
+/*
+ * Removes an entry from the list of entries in cache of matching hooks
+ * (sorted from most recently to least recently used).
+ */
+
+void
+hook_match_unlink (struct t_hook_match *match)
+{
+    if (match->prev_match)
+        (match->prev_match)->next_match = match->next_match;
+    else
+        hook_match_first[match->type] = match->next_match;
+    if (match->next_match)
+        (match->next_match)->prev_match = match->prev_match;
+    else
+        hook_match_last[match->type] = match->prev_match;
+    match->prev_match = NULL;
+    match->next_match = NULL;
+}
+
+/*
+ * Adds an entry at the beginning of the list of entries in cache of matching
+ * hooks (most recently used).
+ */
+
+void
+hook_match_link_first (struct t_hook_match *match)
+{
+    match->prev_match = NULL;
+    match->next_match = hook_match_first[match->type];
+    if (hook_match_first[match->type])
+        (hook_match_first[match->type])->prev_match = match;
+    else
+        hook_match_last[match->type] = match;
+    hook_match_first[match->type] = match;
+}
+
+/*
+ * Frees an entry in cache of matching hooks.
+ */
+
+void
+hook_match_free_value_cb (struct t_hashtable *hashtable,
+                          const void *key, void *value)
+{
+    struct t_hook_match *ptr_match;
+
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    ptr_match = (struct t_hook_match *)value;
+    if (!ptr_match)
+        return;
+
+    hook_match_unlink (ptr_match);
+    if (ptr_match->name)
+        free (ptr_match->name);
+    if (ptr_match->hooks)
+        free (ptr_match->hooks);
+    free (ptr_match);
+}
+
+/*
+ * Removes the least recently used entries from cache of matching hooks, so
+ * that a new entry can be added without exceeding the max size of cache.
+ *
+ * Entries with callbacks running are not removed.
+ */
+
+void
+hook_match_evict (int type)
+{
+    struct t_hook_match *ptr_match, *prev_match;
+
+    ptr_match = hook_match_last[type];
+    while (ptr_match
+           && (hook_match_cache[type]->items_count >= HOOK_MATCH_CACHE_MAX_SIZE))
+    {
+        prev_match = ptr_match->prev_match;
+        if (ptr_match->running == 0)
+            hashtable_remove (hook_match_cache[type], ptr_match->name);
+        ptr_match = prev_match;
+    }
+}
+
+/*
+ * Returns the hooks of a type matching a name (for example the signal
+ * hooks matching a signal name), sorted like the list of hooks (by priority).
+ *
+ * The result is kept in a cache (hashtable indexed by name), it is computed
+ * again only if hooks of this type have been added or removed since the last
+ * call, so that sending a name without any matching hook is O(1).
+ *
+ * The cache has at most HOOK_MATCH_CACHE_MAX_SIZE entries by type (names
+ * may come from remote input, like IRC commands received): the least
+ * recently used entries are removed when a new name is added.
+ *
+ * Note: the array of hooks is updated on next call to this function with same
+ * type and name, so the caller must copy it if callbacks are called (they may
+ * send the same name); if the entry is used after callbacks, the caller must
+ * increment "running" before calling them, so that the entry is not removed.
+ *
+ * Returns NULL if error.
+ */
+
+struct t_hook_match *
+hook_match_get (int type, const char *name,
+                t_callback_hook_match *callback_match)
+{
+    struct t_hook_match *ptr_match;
+    struct t_hook *ptr_hook, **new_hooks;
+    int size;
+
+    if ((type < 0) || (type >= HOOK_NUM_TYPES) || !name || !callback_match)
+        return NULL;
+
+    if (!hook_match_cache[type])
+    {
+        hook_match_cache[type] = hashtable_new (32,
+                                                WEECHAT_HASHTABLE_STRING,
+                                                WEECHAT_HASHTABLE_POINTER,
+                                                NULL, NULL);
+        if (!hook_match_cache[type])
+            return NULL;
+        hook_match_cache[type]->callback_free_value = &hook_match_free_value_cb;
+    }
+
+    ptr_match = hashtable_get (hook_match_cache[type], name);
+    if (ptr_match)
+    {
+        if (ptr_match != hook_match_first[type])
+        {
+            hook_match_unlink (ptr_match);
+            hook_match_link_first (ptr_match);
+        }
+    }
+    else
+    {
+        hook_match_evict (type);
+        ptr_match = malloc (sizeof (*ptr_match));
+        if (!ptr_match)
+            return NULL;
+        ptr_match->type = type;
+        ptr_match->name = strdup (name);
+        ptr_match->generation = hook_generation[type] - 1;
+        ptr_match->hooks = NULL;
+        ptr_match->num_hooks = 0;
+        ptr_match->count = 0;
+        ptr_match->time = 0;
+        ptr_match->running = 0;
+        if (!ptr_match->name)
+        {
+            free (ptr_match);
+            return NULL;
+        }
+        hook_match_link_first (ptr_match);
+        if (!hashtable_set (hook_match_cache[type], name, ptr_match))
+        {
+            hook_match_unlink (ptr_match);
+            free (ptr_match->name);
+            free (ptr_match);
+            return NULL;
+        }
+    }
+
+    if (ptr_match->generation == hook_generation[type])
+        return ptr_match;
+
+    /* hooks have changed since last call: search matching hooks again */
+    ptr_match->num_hooks = 0;
+    size = 0;
+    for (ptr_hook = weechat_hooks[type]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (ptr_hook->deleted || !(callback_match) (name, ptr_hook))
+            continue;
+        if (ptr_match->num_hooks >= size)
+        {
+            size = (size > 0) ? size * 2 : 4;
+            new_hooks = realloc (ptr_match->hooks,
+                                 size * sizeof (*new_hooks));
+            if (!new_hooks)
+                break;
+            ptr_match->hooks = new_hooks;
+        }
+        ptr_match->hooks[ptr_match->num_hooks++] = ptr_hook;
+    }
+    if ((ptr_match->num_hooks == 0) && ptr_match->hooks)
+    {
+        free (ptr_match->hooks);
+        ptr_match->hooks = NULL;
+    }
+    ptr_match->generation = hook_generation[type];
+
+    return ptr_match;
+}
+
+/*
+ * Removes a name from the cache of matching hooks (for example when the
+ * object identified by this name is destroyed).
+ *
+ * The entry is not removed if callbacks are running (it will be removed
+ * later, when the cache is full).
+ */
+
+void
+hook_match_remove (int type, const char *name)
+{
+    struct t_hook_match *ptr_match;
+
+    if ((type < 0) || (type >= HOOK_NUM_TYPES) || !name
+        || !hook_match_cache[type])
+    {
+        return;
+    }
+
+    ptr_match = hashtable_get (hook_match_cache[type], name);
+    if (ptr_match && (ptr_match->running == 0))
+        hashtable_remove (hook_match_cache[type], name);
+}
+
 /*
  * Starts a hook exec.
  */
@@ -448,7 +696,7 @@ hook_set (struct t_hook *hook, const char *property, const char *value)
     ssize_t num_written;
     char *error;
     long number;
-    int rc;
+    int rc, flag;
 
     /* invalid hook? */
     if (!hook_valid (hook))
@@ -514,6 +762,25 @@ hook_set (struct t_hook *hook, const char *property, const char *value)
             }
         }
     }
+    else if ((strcmp (property, "flag_read") == 0)
+             || (strcmp (property, "flag_write") == 0)
+             || (strcmp (property, "flag_exception") == 0))
+    {
+        if (!hook->deleted && (hook->type == HOOK_TYPE_FD))
+        {
+            if (strcmp (property, "flag_read") == 0)
+                flag = HOOK_FD_FLAG_READ;
+            else if (strcmp (property, "flag_write") == 0)
+                flag = HOOK_FD_FLAG_WRITE;
+            else
+                flag = HOOK_FD_FLAG_EXCEPTION;
+            /* add or remove the flag (the fd is watched with new flags) */
+            hook_fd_set_flags (
+                hook,
+                (value && (strcmp (value, "1") == 0)) ?
+                HOOK_FD(hook, flags) | flag : HOOK_FD(hook, flags) & ~flag);
+        }
+    }
 }
 
 /*
@@ -540,6 +807,9 @@ unhook (struct t_hook *hook)
                          plugin_get_name (hook->plugin));
     }
 
+    /* hook must not be used any more by the cache of matching hooks */
+    hook_generation[hook->type]++;
+
     /* free data specific to the hook */
     (hook_callback_free_data[hook->type]) (hook);
 
@@ -617,6 +887,13 @@ unhook_all ()
             unhook (ptr_hook);
             ptr_hook = next_hook;
         }
+        if (hook_match_cache[type])
+        {
+            hashtable_free (hook_match_cache[type]);
+            hook_match_cache[type] = NULL;
+            hook_match_first[type] = NULL;
+            hook_match_last[type] = NULL;
+        }
     }
 }
 
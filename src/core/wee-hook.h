@@ -110,6 +110,32 @@ struct t_hook
     struct t_hook *next_hook;          /* link to next hook                 */
 };
 
+/* hooks matching a name sent (cache used to send signals, hsignals, ...) */
+
+#define HOOK_MATCH_STATIC_SIZE 32
+#define HOOK_MATCH_CACHE_MAX_SIZE 4096
+
+struct t_hook_match
+{
+    int type;                          /* hook type                         */
+    char *name;                        /* name sent (key in cache)          */
+    unsigned int generation;           /* generation of hooks used to build */
+                                       /* the array of hooks                */
+    struct t_hook **hooks;             /* hooks matching (sorted by         */
+                                       /* priority)                         */
+    int num_hooks;                     /* number of hooks matching          */
+    long long count;                   /* number of times name was sent     */
+    long long time;                    /* time spent in callbacks (in µs)   */
+    int running;                       /* >0 if callbacks are running       */
+                                       /* (entry can not be removed)        */
+    struct t_hook_match *prev_match;   /* link to previous match (more      */
+                                       /* recently used)                    */
+    struct t_hook_match *next_match;   /* link to next match (less          */
+                                       /* recently used)                    */
+};
+
+typedef int (t_callback_hook_match)(const char *name, struct t_hook *hook);
+
 /* hook variables */
 
 extern char *hook_type_string[];
@@ -118,6 +144,9 @@ extern struct t_hook *last_weechat_hook[];
 extern int hooks_count[];
 extern int hooks_count_total;
 extern int hook_socketpair_ok;
+extern struct t_hashtable *hook_match_cache[];
+extern struct t_hook_match *hook_match_first[];
+extern struct t_hook_match *hook_match_last[];
 
 /* hook functions */
 
@@ -128,6 +157,9 @@ extern void hook_init_data (struct t_hook *hook,
                             int type, int priority,
                             const void *callback_pointer, void *callback_data);
 extern int hook_valid (struct t_hook *hook);
+extern struct t_hook_match *hook_match_get (int type, const char *name,
+                                            t_callback_hook_match *callback_match);
+extern void hook_match_remove (int type, const char *name);
 extern void hook_exec_start ();
 extern void hook_exec_end ();
 extern char *hook_get_description (struct t_hook *hook);
@@ -1483,8 +1483,9 @@ network_connect_gnutls_handshake_fd_cb (const void *pointer, void *data,
             || (((flags & HOOK_FD_FLAG_WRITE) == HOOK_FD_FLAG_WRITE)
                 && (direction != 1)))
         {
-            HOOK_FD(HOOK_CONNECT(hook_connect, handshake_hook_fd), flags) =
-                (direction) ? HOOK_FD_FLAG_WRITE: HOOK_FD_FLAG_READ;
+            hook_fd_set_flags (
+                HOOK_CONNECT(hook_connect, handshake_hook_fd),
+                (direction) ? HOOK_FD_FLAG_WRITE: HOOK_FD_FLAG_READ);
         }
     }
     else if (rc != GNUTLS_E_SUCCESS)
@@ -1568,9 +1568,466 @@ string_regcomp (void *preg, const char *regex, int default_flags)
                     flags);
 }
 
+/*
+ * Converts a char to lower case for highlight comparison (same conversion as
+ * function string_charcasecmp).
+ */
+
+int
+string_highlight_char_lower (int c)
+{
+    if (c < 0x80)
+        return ((c >= 'A') && (c <= 'Z')) ? c + ('a' - 'A') : c;
+
+    return (int)towlower ((wint_t)c);
+}
+
+/*
+ * Searches the next state for a char in an automaton state (without following
+ * the fail links).
+ *
+ * Returns the next state, -1 if not found.
+ */
+
+int
+string_highlight_goto (struct t_string_highlight_state *state, int c)
+{
+    int min, max, middle;
+
+    min = 0;
+    max = state->num_edges - 1;
+    while (min <= max)
+    {
+        middle = (min + max) / 2;
+        if (c == state->edges[middle].c)
+            return state->edges[middle].state;
+        if (c < state->edges[middle].c)
+            max = middle - 1;
+        else
+            min = middle + 1;
+    }
+
+    return -1;
+}
+
+/*
+ * Adds a new state in an automaton.
+ *
+ * Returns index of new state, -1 if error.
+ */
+
+int
+string_highlight_add_state (struct t_string_highlight_automaton *automaton)
+{
+    struct t_string_highlight_state *new_states;
+    int new_size;
+
+    if (automaton->num_states >= automaton->size_states)
+    {
+        new_size = (automaton->size_states > 0) ?
+            automaton->size_states * 2 : 16;
+        new_states = realloc (automaton->states,
+                              new_size * sizeof (automaton->states[0]));
+        if (!new_states)
+            return -1;
+        automaton->states = new_states;
+        automaton->size_states = new_size;
+    }
+
+    automaton->states[automaton->num_states].edges = NULL;
+    automaton->states[automaton->num_states].num_edges = 0;
+    automaton->states[automaton->num_states].fail = 0;
+    automaton->states[automaton->num_states].output = -1;
+    automaton->states[automaton->num_states].word = -1;
+
+    return automaton->num_states++;
+}
+
+/*
+ * Adds a word in an automaton (in the trie, fail links are computed later by
+ * function string_highlight_build_fail).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+string_highlight_add_word (struct t_string_highlight *highlight,
+                           struct t_string_highlight_automaton *automaton,
+                           int index_word, const char *word, int length,
+                           int case_sensitive)
+{
+    struct t_string_highlight_state *ptr_state;
+    struct t_string_highlight_edge *new_edges;
+    int i, c, state, next_state, pos;
+
+    state = 0;
+    for (i = 0; i < length; i++)
+    {
+        c = utf8_char_int (word);
+        if (!case_sensitive)
+            c = string_highlight_char_lower (c);
+        word = utf8_next_char (word);
+
+        next_state = string_highlight_goto (&automaton->states[state], c);
+        if (next_state < 0)
+        {
+            next_state = string_highlight_add_state (automaton);
+            if (next_state < 0)
+                return 0;
+            /* insert edge, keeping edges sorted by char */
+            ptr_state = &automaton->states[state];
+            new_edges = realloc (
+                ptr_state->edges,
+                (ptr_state->num_edges + 1) * sizeof (ptr_state->edges[0]));
+            if (!new_edges)
+                return 0;
+            ptr_state->edges = new_edges;
+            pos = ptr_state->num_edges;
+            while ((pos > 0) && (ptr_state->edges[pos - 1].c > c))
+            {
+                ptr_state->edges[pos] = ptr_state->edges[pos - 1];
+                pos--;
+            }
+            ptr_state->edges[pos].c = c;
+            ptr_state->edges[pos].state = next_state;
+            ptr_state->num_edges++;
+        }
+        state = next_state;
+    }
+
+    highlight->words[index_word].next_word = automaton->states[state].word;
+    automaton->states[state].word = index_word;
+
+    return 1;
+}
+
+/*
+ * Computes fail links and output links of states in an automaton (breadth
+ * first traversal of the trie).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+string_highlight_build_fail (struct t_string_highlight_automaton *automaton)
+{
+    struct t_string_highlight_state *states;
+    int *queue, queue_start, queue_end, i, state, next_state, fail;
+
+    queue = malloc (automaton->num_states * sizeof (*queue));
+    if (!queue)
+        return 0;
+
+    states = automaton->states;
+    queue_start = 0;
+    queue_end = 0;
+    for (i = 0; i < states[0].num_edges; i++)
+    {
+        next_state = states[0].edges[i].state;
+        states[next_state].fail = 0;
+        queue[queue_end++] = next_state;
+    }
+
+    while (queue_start < queue_end)
+    {
+        state = queue[queue_start++];
+        for (i = 0; i < states[state].num_edges; i++)
+        {
+            next_state = states[state].edges[i].state;
+            fail = states[state].fail;
+            while ((fail > 0)
+                   && (string_highlight_goto (&states[fail],
+                                              states[state].edges[i].c) < 0))
+            {
+                fail = states[fail].fail;
+            }
+            fail = string_highlight_goto (&states[fail],
+                                          states[state].edges[i].c);
+            states[next_state].fail = (fail >= 0) ? fail : 0;
+            fail = states[next_state].fail;
+            states[next_state].output = (states[fail].word >= 0) ?
+                fail : states[fail].output;
+            queue[queue_end++] = next_state;
+        }
+    }
+
+    free (queue);
+
+    return 1;
+}
+
+/*
+ * Compiles a list of words to highlight (comma separated list, same format as
+ * in function string_has_highlight).
+ *
+ * Note: result must be freed after use with function string_highlight_free.
+ *
+ * Returns pointer to compiled highlight words, NULL if error.
+ */
+
+struct t_string_highlight *
+string_highlight_compile (const char *highlight_words)
+{
+    struct t_string_highlight *new_highlight;
+    const char *pos, *pos_end;
+    int i, num_words, length, flags, wildcard_start, wildcard_end;
+
+    new_highlight = malloc (sizeof (*new_highlight));
+    if (!new_highlight)
+        return NULL;
+
+    new_highlight->num_words = 0;
+    new_highlight->words = NULL;
+    for (i = 0; i < 2; i++)
+    {
+        new_highlight->automaton[i].states = NULL;
+        new_highlight->automaton[i].num_states = 0;
+        new_highlight->automaton[i].size_states = 0;
+        if (string_highlight_add_state (&new_highlight->automaton[i]) < 0)
+            goto error;
+    }
+    new_highlight->max_length = 0;
+    new_highlight->last_end = NULL;
+    new_highlight->pos_chars = NULL;
+
+    if (!highlight_words || !highlight_words[0])
+        return new_highlight;
+
+    num_words = 1;
+    for (pos = highlight_words; pos[0]; pos++)
+    {
+        if (pos[0] == ',')
+            num_words++;
+    }
+    new_highlight->words = malloc (num_words * sizeof (new_highlight->words[0]));
+    if (!new_highlight->words)
+        goto error;
+
+    pos = highlight_words;
+    while (pos)
+    {
+        flags = 0;
+        pos = string_regex_flags (pos, REG_ICASE, &flags);
+        pos_end = strchr (pos, ',');
+        length = (pos_end) ? pos_end - pos : (int)strlen (pos);
+        wildcard_start = 0;
+        wildcard_end = 0;
+        if (length > 0)
+        {
+            wildcard_start = (pos[0] == '*');
+            wildcard_end = (pos[length - 1] == '*');
+            length -= wildcard_start + wildcard_end;
+        }
+        if (length > 0)
+        {
+            length = utf8_strnlen (pos + wildcard_start, length);
+            i = new_highlight->num_words;
+            new_highlight->words[i].length = length;
+            new_highlight->words[i].wildcard_start = wildcard_start;
+            new_highlight->words[i].wildcard_end = wildcard_end;
+            if (!string_highlight_add_word (
+                    new_highlight,
+                    &new_highlight->automaton[(flags & REG_ICASE) ? 0 : 1],
+                    i, pos + wildcard_start, length,
+                    (flags & REG_ICASE) ? 0 : 1))
+            {
+                goto error;
+            }
+            new_highlight->num_words++;
+            if (length > new_highlight->max_length)
+                new_highlight->max_length = length;
+        }
+        pos = (pos_end) ? pos_end + 1 : NULL;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        if (!string_highlight_build_fail (&new_highlight->automaton[i]))
+            goto error;
+    }
+
+    if (new_highlight->num_words > 0)
+    {
+        new_highlight->last_end = malloc (
+            new_highlight->num_words * sizeof (new_highlight->last_end[0]));
+        new_highlight->pos_chars = malloc (
+            new_highlight->max_length * sizeof (new_highlight->pos_chars[0]));
+        if (!new_highlight->last_end || !new_highlight->pos_chars)
+            goto error;
+    }
+
+    return new_highlight;
+
+error:
+    string_highlight_free (new_highlight);
+    return NULL;
+}
+
+/*
+ * Checks words ending on a state of automaton, at position "end" in string
+ * (the last char of words is the char with index "index_char").
+ *
+ * Returns:
+ *   1: one word is a highlight
+ *   0: no highlight
+ */
+
+int
+string_highlight_match_state (struct t_string_highlight *highlight,
+                              struct t_string_highlight_automaton *automaton,
+                              int state, const char *string, int index_char,
+                              int end)
+{
+    struct t_string_highlight_word *ptr_word;
+    int word, start, startswith, endswith;
+
+    if (automaton->states[state].word < 0)
+        state = automaton->states[state].output;
+
+    while (state >= 0)
+    {
+        for (word = automaton->states[state].word; word >= 0;
+             word = ptr_word->next_word)
+        {
+            ptr_word = &highlight->words[word];
+            start = highlight->pos_chars[(index_char - ptr_word->length + 1)
+                                         % highlight->max_length];
+            /*
+             * ignore occurrences overlapping the last one checked for this
+             * word (like a search of word starting after the last one)
+             */
+            if (start < highlight->last_end[word])
+                continue;
+            highlight->last_end[word] = end;
+            startswith = ((start == 0)
+                          || !string_is_word_char_highlight (
+                              utf8_prev_char (string, string + start)));
+            endswith = (!string[end]
+                        || !string_is_word_char_highlight (string + end));
+            if ((ptr_word->wildcard_start && ptr_word->wildcard_end)
+                || (!ptr_word->wildcard_start && !ptr_word->wildcard_end
+                    && startswith && endswith)
+                || (ptr_word->wildcard_start && endswith)
+                || (ptr_word->wildcard_end && startswith))
+            {
+                return 1;
+            }
+        }
+        state = automaton->states[state].output;
+    }
+
+    return 0;
+}
+
+/*
+ * Checks if a string has a highlight using compiled highlight words (see
+ * function string_highlight_compile): the string is read only once, whatever
+ * the number of words.
+ *
+ * Returns:
+ *   1: string has a highlight
+ *   0: string has no highlight
+ */
+
+int
+string_highlight_match (struct t_string_highlight *highlight,
+                        const char *string)
+{
+    struct t_string_highlight_automaton *ptr_automaton;
+    const char *ptr_string;
+    int i, c, c_state, state[2], next_state, index_char;
+
+    if (!highlight || (highlight->num_words == 0) || !string || !string[0])
+        return 0;
+
+    memset (highlight->last_end, 0,
+            highlight->num_words * sizeof (highlight->last_end[0]));
+
+    state[0] = 0;
+    state[1] = 0;
+    index_char = 0;
+    ptr_string = string;
+    while (ptr_string[0])
+    {
+        highlight->pos_chars[index_char % highlight->max_length] =
+            ptr_string - string;
+        c = utf8_char_int (ptr_string);
+        ptr_string = utf8_next_char (ptr_string);
+        for (i = 0; i < 2; i++)
+        {
+            ptr_automaton = &highlight->automaton[i];
+            if (ptr_automaton->num_states <= 1)
+                continue;
+            if (i == 0)
+                c_state = string_highlight_char_lower (c);
+            else
+                c_state = c;
+            while (1)
+            {
+                next_state = string_highlight_goto (
+                    &ptr_automaton->states[state[i]], c_state);
+                if ((next_state >= 0) || (state[i] == 0))
+                    break;
+                state[i] = ptr_automaton->states[state[i]].fail;
+            }
+            state[i] = (next_state >= 0) ? next_state : 0;
+            if (string_highlight_match_state (highlight, ptr_automaton,
+                                              state[i], string, index_char,
+                                              ptr_string - string))
+            {
+                return 1;
+            }
+        }
+        index_char++;
+    }
+
+    /* no highlight found */
+    return 0;
+}
+
+/*
+ * Frees compiled highlight words.
+ */
+
+void
+string_highlight_free (struct t_string_highlight *highlight)
+{
+    int i, j;
+
+    if (!highlight)
+        return;
+
+    for (i = 0; i < 2; i++)
+    {
+        for (j = 0; j < highlight->automaton[i].num_states; j++)
+        {
+            if (highlight->automaton[i].states[j].edges)
+                free (highlight->automaton[i].states[j].edges);
+        }
+        if (highlight->automaton[i].states)
+            free (highlight->automaton[i].states);
+    }
+    if (highlight->words)
+        free (highlight->words);
+    if (highlight->last_end)
+        free (highlight->last_end);
+    if (highlight->pos_chars)
+        free (highlight->pos_chars);
+
+    free (highlight);
+}
+
 /*
  * Checks if a string has a highlight (using list of words to highlight).
  *
+ * The words are searched one by one in string (they are not compiled, which
+ * is faster for a single check); to check many strings with the same words,
+ * functions string_highlight_compile and string_highlight_match are used.
+ *
  * Returns:
  *   1: string has a highlight
  *   0: string has no highlight
@@ -34,6 +34,56 @@ struct t_string_dyn
     string_dyn_size_t size;            /* size of string (including '\0')   */
 };
 
+/*
+ * compiled list of highlight words: an Aho-Corasick automaton is built for
+ * case insensitive words (chars converted to lower case) and another one for
+ * case sensitive words, so that a string is checked in a single pass
+ */
+
+struct t_string_highlight_word
+{
+    int length;                        /* length of word (number of chars)  */
+    int wildcard_start;                /* 1 if word starts with "*"         */
+    int wildcard_end;                  /* 1 if word ends with "*"           */
+    int next_word;                     /* next word ending on same state    */
+};
+
+struct t_string_highlight_edge
+{
+    int c;                             /* char (UTF-8 code point)           */
+    int state;                         /* next state for this char          */
+};
+
+struct t_string_highlight_state
+{
+    struct t_string_highlight_edge *edges; /* edges (sorted by char)        */
+    int num_edges;                     /* number of edges                   */
+    int fail;                          /* state for longest proper suffix   */
+    int output;                        /* next state in fail chain with a   */
+                                       /* word ending on it (-1 if none)    */
+    int word;                          /* first word ending on this state   */
+};
+
+struct t_string_highlight_automaton
+{
+    struct t_string_highlight_state *states; /* states (0 = root state)     */
+    int num_states;                    /* number of states                  */
+    int size_states;                   /* number of allocated states        */
+};
+
+struct t_string_highlight
+{
+    int num_words;                     /* number of words                   */
+    struct t_string_highlight_word *words; /* words                         */
+    struct t_string_highlight_automaton automaton[2]; /* 0 = case           */
+                                       /* insensitive, 1 = case sensitive   */
+    int max_length;                    /* max length of words (in chars)    */
+    int *last_end;                     /* end of last occurrence checked    */
+                                       /* for each word (used in match)     */
+    int *pos_chars;                    /* positions of last chars (circular */
+                                       /* buffer, used in match)            */
+};
+
 struct t_hashtable;
 
 extern char *string_strndup (const char *string, int bytes);
@@ -84,6 +134,10 @@ extern char *string_mask_to_regex (const char *mask);
 extern const char *string_regex_flags (const char *regex, int default_flags,
                                        int *flags);
 extern int string_regcomp (void *preg, const char *regex, int default_flags);
+extern struct t_string_highlight *string_highlight_compile (const char *highlight_words);
+extern int string_highlight_match (struct t_string_highlight *highlight,
+                                   const char *string);
+extern void string_highlight_free (struct t_string_highlight *highlight);
 extern int string_has_highlight (const char *string,
                                  const char *highlight_words);
 extern int string_has_highlight_regex_compiled (const char *string,
@@ -30,6 +30,7 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <zstd.h>
 
 #include "weechat.h"
 #include "wee-upgrade-file.h"
@@ -215,6 +216,11 @@ upgrade_file_new (const char *filename,
         new_upgrade_file->callback_read = callback_read;
         new_upgrade_file->callback_read_pointer = callback_read_pointer;
         new_upgrade_file->callback_read_data = callback_read_data;
+        new_upgrade_file->callback_read_block = NULL;
+        new_upgrade_file->block = NULL;
+        new_upgrade_file->block_size = 0;
+        new_upgrade_file->block_length = 0;
+        new_upgrade_file->block_compression = 0;
 
         /* open file in read or write mode */
         if (callback_read)
@@ -415,6 +421,211 @@ upgrade_file_write_object (struct t_upgrade_file *upgrade_file, int object_id,
     return 1;
 }
 
+/*
+ * Starts a binary block in upgrade file.
+ *
+ * A binary block is a sequence of records in a format defined by the caller,
+ * written with functions upgrade_file_write_block_data (data of a record),
+ * upgrade_file_write_block_end_record (end of a record) and
+ * upgrade_file_write_block_end (end of block).
+ *
+ * The block is written by chunks of about UPGRADE_BLOCK_CHUNK_SIZE bytes,
+ * a record is never split between two chunks; if compression is > 0, each
+ * chunk is compressed with zstd (with this compression level) if this makes
+ * it smaller.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_write_block_start (struct t_upgrade_file *upgrade_file,
+                                int object_id, int version, int compression)
+{
+    if (!upgrade_file_write_integer (upgrade_file, UPGRADE_TYPE_BLOCK_START))
+    {
+        UPGRADE_ERROR(_("write - object type"), "block start");
+        return 0;
+    }
+    if (!upgrade_file_write_integer (upgrade_file, object_id))
+    {
+        UPGRADE_ERROR(_("write - object id"), "");
+        return 0;
+    }
+    if (!upgrade_file_write_integer (upgrade_file, version))
+    {
+        UPGRADE_ERROR(_("write - block version"), "");
+        return 0;
+    }
+
+    upgrade_file->block_length = 0;
+    upgrade_file->block_compression = compression;
+
+    return 1;
+}
+
+/*
+ * Adds data to the current record of binary block.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_write_block_data (struct t_upgrade_file *upgrade_file,
+                               const void *data, int size)
+{
+    char *new_block;
+    int new_size;
+
+    if (size <= 0)
+        return 1;
+
+    if (upgrade_file->block_length + size > upgrade_file->block_size)
+    {
+        new_size = (upgrade_file->block_size > 0) ?
+            upgrade_file->block_size : UPGRADE_BLOCK_CHUNK_SIZE;
+        while (upgrade_file->block_length + size > new_size)
+        {
+            new_size *= 2;
+        }
+        new_block = realloc (upgrade_file->block, new_size);
+        if (!new_block)
+            return 0;
+        upgrade_file->block = new_block;
+        upgrade_file->block_size = new_size;
+    }
+
+    memcpy (upgrade_file->block + upgrade_file->block_length, data, size);
+    upgrade_file->block_length += size;
+
+    return 1;
+}
+
+/*
+ * Writes data of binary block as a chunk in upgrade file.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_write_block_chunk (struct t_upgrade_file *upgrade_file)
+{
+    void *compressed;
+    size_t compressed_size;
+    int rc;
+
+    if (upgrade_file->block_length <= 0)
+        return 1;
+
+    compressed = NULL;
+    compressed_size = 0;
+    if (upgrade_file->block_compression > 0)
+    {
+        compressed_size = ZSTD_compressBound (upgrade_file->block_length);
+        compressed = malloc (compressed_size);
+        if (compressed)
+        {
+            compressed_size = ZSTD_compress (
+                compressed, compressed_size,
+                upgrade_file->block, upgrade_file->block_length,
+                upgrade_file->block_compression);
+            if (ZSTD_isError (compressed_size)
+                || (compressed_size >= (size_t)upgrade_file->block_length))
+            {
+                free (compressed);
+                compressed = NULL;
+            }
+        }
+    }
+
+    if (compressed)
+    {
+        rc = (upgrade_file_write_integer (upgrade_file,
+                                          UPGRADE_BLOCK_CHUNK_ZSTD)
+              && upgrade_file_write_integer (upgrade_file,
+                                             upgrade_file->block_length)
+              && upgrade_file_write_buffer (upgrade_file, compressed,
+                                            (int)compressed_size));
+        free (compressed);
+    }
+    else
+    {
+        rc = (upgrade_file_write_integer (upgrade_file,
+                                          UPGRADE_BLOCK_CHUNK_RAW)
+              && upgrade_file_write_integer (upgrade_file,
+                                             upgrade_file->block_length)
+              && upgrade_file_write_buffer (upgrade_file,
+                                            upgrade_file->block,
+                                            upgrade_file->block_length));
+    }
+
+    upgrade_file->block_length = 0;
+
+    return rc;
+}
+
+/*
+ * Ends a record in binary block: the chunk is written in upgrade file if its
+ * size is at least UPGRADE_BLOCK_CHUNK_SIZE.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_write_block_end_record (struct t_upgrade_file *upgrade_file)
+{
+    if (upgrade_file->block_length < UPGRADE_BLOCK_CHUNK_SIZE)
+        return 1;
+
+    if (!upgrade_file_write_block_chunk (upgrade_file))
+    {
+        UPGRADE_ERROR(_("write - block chunk"), "");
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Ends a binary block: writes the last chunk and the end of block.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_write_block_end (struct t_upgrade_file *upgrade_file)
+{
+    if (!upgrade_file_write_block_chunk (upgrade_file))
+    {
+        UPGRADE_ERROR(_("write - block chunk"), "");
+        return 0;
+    }
+    if (!upgrade_file_write_integer (upgrade_file, UPGRADE_BLOCK_CHUNK_END))
+    {
+        UPGRADE_ERROR(_("write - block end"), "");
+        return 0;
+    }
+
+    /* free memory if the block was big */
+    if (upgrade_file->block_size > UPGRADE_BLOCK_CHUNK_SIZE)
+    {
+        free (upgrade_file->block);
+        upgrade_file->block = NULL;
+        upgrade_file->block_size = 0;
+    }
+
+    return 1;
+}
+
 /*
  * Reads an integer in upgrade file.
  *
@@ -566,6 +777,153 @@ upgrade_file_read_time (struct t_upgrade_file *upgrade_file, time_t *time)
     return 1;
 }
 
+/*
+ * Reads a binary block in upgrade file (after the block start) and calls the
+ * block callback for each chunk, then with a NULL chunk at end of block.
+ *
+ * If there is no block callback, the block is skipped.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_file_read_block (struct t_upgrade_file *upgrade_file)
+{
+    int rc, object_id, version, type, size, stored_size;
+    void *stored;
+    char *chunk;
+    size_t chunk_size;
+
+    rc = 0;
+
+    stored = NULL;
+    chunk = NULL;
+
+    if (!upgrade_file_read_integer (upgrade_file, &object_id))
+    {
+        UPGRADE_ERROR(_("read - object id"), "");
+        goto end;
+    }
+    if (!upgrade_file_read_integer (upgrade_file, &version))
+    {
+        UPGRADE_ERROR(_("read - block version"), "");
+        goto end;
+    }
+
+    while (1)
+    {
+        if (!upgrade_file_read_integer (upgrade_file, &type))
+        {
+            UPGRADE_ERROR(_("read - block chunk type"), "");
+            goto end;
+        }
+
+        if (type == UPGRADE_BLOCK_CHUNK_END)
+            break;
+
+        if ((type != UPGRADE_BLOCK_CHUNK_RAW)
+            && (type != UPGRADE_BLOCK_CHUNK_ZSTD))
+        {
+            UPGRADE_ERROR(_("read - bad block chunk type"), "");
+            goto end;
+        }
+
+        if (!upgrade_file_read_integer (upgrade_file, &size) || (size <= 0))
+        {
+            UPGRADE_ERROR(_("read - block chunk size"), "");
+            goto end;
+        }
+
+        if (!upgrade_file->callback_read_block)
+        {
+            /* skip chunk */
+            if (!upgrade_file_read_integer (upgrade_file, &stored_size)
+                || (stored_size <= 0)
+                || (fseek (upgrade_file->file, stored_size, SEEK_CUR) < 0))
+            {
+                UPGRADE_ERROR(_("read - block chunk"), "");
+                goto end;
+            }
+            continue;
+        }
+
+        if (!upgrade_file_read_buffer (upgrade_file, &stored, &stored_size)
+            || !stored)
+        {
+            UPGRADE_ERROR(_("read - block chunk"), "");
+            goto end;
+        }
+
+        if (type == UPGRADE_BLOCK_CHUNK_ZSTD)
+        {
+            chunk = malloc (size);
+            if (!chunk)
+            {
+                UPGRADE_ERROR(_("read - block chunk"), "");
+                goto end;
+            }
+            chunk_size = ZSTD_decompress (chunk, size, stored, stored_size);
+            if (ZSTD_isError (chunk_size) || (chunk_size != (size_t)size))
+            {
+                UPGRADE_ERROR(_("read - block chunk decompression"), "");
+                goto end;
+            }
+        }
+        else
+        {
+            if (stored_size != size)
+            {
+                UPGRADE_ERROR(_("read - block chunk size"), "");
+                goto end;
+            }
+            chunk = stored;
+            stored = NULL;
+        }
+
+        if ((int)(upgrade_file->callback_read_block) (
+                upgrade_file->callback_read_pointer,
+                upgrade_file->callback_read_data,
+                upgrade_file,
+                object_id,
+                version,
+                chunk,
+                size) == WEECHAT_RC_ERROR)
+        {
+            goto end;
+        }
+
+        free (chunk);
+        chunk = NULL;
+    }
+
+    rc = 1;
+
+    if (upgrade_file->callback_read_block)
+    {
+        if ((int)(upgrade_file->callback_read_block) (
+                upgrade_file->callback_read_pointer,
+                upgrade_file->callback_read_data,
+                upgrade_file,
+                object_id,
+                version,
+                NULL,
+                0) == WEECHAT_RC_ERROR)
+        {
+            rc = 0;
+        }
+    }
+
+end:
+    if (stored)
+        free (stored);
+    if (chunk)
+        free (chunk);
+
+    return rc;
+}
+
 /*
  * Reads an object in upgrade file and calls read callback.
  *
@@ -600,6 +958,9 @@ upgrade_file_read_object (struct t_upgrade_file *upgrade_file)
         goto end;
     }
 
+    if (type == UPGRADE_TYPE_BLOCK_START)
+        return upgrade_file_read_block (upgrade_file);
+
     if (type != UPGRADE_TYPE_OBJECT_START)
     {
         UPGRADE_ERROR(_("read - bad object type ('object start' expected)"), "");
@@ -745,7 +1106,9 @@ upgrade_file_read (struct t_upgrade_file *upgrade_file)
         return 0;
     }
 
-    if (!signature || (strcmp (signature, UPGRADE_SIGNATURE) != 0))
+    if (!signature
+        || ((strcmp (signature, UPGRADE_SIGNATURE) != 0)
+            && (strcmp (signature, UPGRADE_SIGNATURE_V2_2) != 0)))
     {
         UPGRADE_ERROR(_("read - bad signature (upgrade file format may have "
                         "changed since last version)"), "");
@@ -781,6 +1144,8 @@ upgrade_file_close (struct t_upgrade_file *upgrade_file)
         fclose (upgrade_file->file);
     if (upgrade_file->callback_read_data)
         free (upgrade_file->callback_read_data);
+    if (upgrade_file->block)
+        free (upgrade_file->block);
 
     /* remove upgrade file list */
     if (upgrade_file->prev_upgrade)
@@ -22,7 +22,12 @@
 
 #include <stdio.h>
 
-#define UPGRADE_SIGNATURE "===== WeeChat Upgrade file v2.2 - binary, do not edit! ====="
+#define UPGRADE_SIGNATURE "===== WeeChat Upgrade file v2.3 - binary, do not edit! ====="
+/* signature of files without binary blocks (still accepted on read) */
+#define UPGRADE_SIGNATURE_V2_2 "===== WeeChat Upgrade file v2.2 - binary, do not edit! ====="
+
+/* size of a chunk in a binary block (a chunk may be bigger for one record) */
+#define UPGRADE_BLOCK_CHUNK_SIZE (64 * 1024)
 
 #define UPGRADE_ERROR(msg1, msg2)                                       \
     upgrade_file_error(upgrade_file, msg1, msg2, __FILE__, __LINE__)
@@ -34,6 +39,14 @@ enum t_upgrade_type
     UPGRADE_TYPE_OBJECT_START = 0,
     UPGRADE_TYPE_OBJECT_END,
     UPGRADE_TYPE_OBJECT_VAR,
+    UPGRADE_TYPE_BLOCK_START,
+};
+
+enum t_upgrade_block_chunk
+{
+    UPGRADE_BLOCK_CHUNK_END = 0,           /* end of block                  */
+    UPGRADE_BLOCK_CHUNK_RAW,               /* chunk data is not compressed  */
+    UPGRADE_BLOCK_CHUNK_ZSTD,              /* chunk data compressed (zstd)  */
 };
 
 struct t_upgrade_file
@@ -50,10 +63,25 @@ struct t_upgrade_file
      struct t_infolist *infolist);
     const void *callback_read_pointer;     /* pointer sent to callback      */
     void *callback_read_data;              /* data sent to callback         */
+    int (*callback_read_block)             /* callback called for each      */
+    (const void *pointer,                  /* chunk of a binary block       */
+     void *data,                           /* (chunk is NULL at end of      */
+     struct t_upgrade_file *upgrade_file,  /* block)                        */
+     int object_id,
+     int version,
+     const char *chunk,
+     int size);
+    char *block;                           /* binary block being written    */
+    int block_size;                        /* allocated size for block      */
+    int block_length;                      /* length of data in block       */
+    int block_compression;                 /* zstd level (0 = no compress.) */
     struct t_upgrade_file *prev_upgrade;   /* link to previous upgrade file */
     struct t_upgrade_file *next_upgrade;   /* link to next upgrade file     */
 };
 
+extern void upgrade_file_error (struct t_upgrade_file *upgrade_file,
+                                char *message1, char *message2,
+                                char *file, int line);
 extern struct t_upgrade_file *upgrade_file_new (const char *filename,
                                                 int (*callback_read)(const void *pointer,
                                                                      void *data,
@@ -65,6 +93,13 @@ extern struct t_upgrade_file *upgrade_file_new (const char *filename,
 extern int upgrade_file_write_object (struct t_upgrade_file *upgrade_file,
                                       int object_id,
                                       struct t_infolist *infolist);
+extern int upgrade_file_write_block_start (struct t_upgrade_file *upgrade_file,
+                                           int object_id, int version,
+                                           int compression);
+extern int upgrade_file_write_block_data (struct t_upgrade_file *upgrade_file,
+                                          const void *data, int size);
+extern int upgrade_file_write_block_end_record (struct t_upgrade_file *upgrade_file);
+extern int upgrade_file_write_block_end (struct t_upgrade_file *upgrade_file);
 extern int upgrade_file_read (struct t_upgrade_file *upgrade_file);
 extern void upgrade_file_close (struct t_upgrade_file *upgrade_file);
 
@@ -31,6 +31,7 @@
 #include "weechat.h"
 #include "wee-upgrade.h"
 #include "wee-dir.h"
+#include "wee-hashtable.h"
 #include "wee-hook.h"
 #include "wee-infolist.h"
 #include "wee-secure-buffer.h"
@@ -53,6 +54,9 @@ struct t_gui_buffer *upgrade_set_current_buffer = NULL;
 int upgrade_set_current_window = 0;
 int hotlist_reset = 0;
 struct t_gui_layout *upgrade_layout = NULL;
+char **upgrade_lines_strings = NULL;   /* strings read in block of lines    */
+int upgrade_lines_strings_count = 0;
+int upgrade_lines_strings_size = 0;
 
 
 /*
@@ -109,6 +113,165 @@ upgrade_weechat_save_history (struct t_upgrade_file *upgrade_file,
     return 1;
 }
 
+/*
+ * Adds a string in block of lines, if not already in block.
+ *
+ * Index of string is returned in "index" (-1 if string is NULL).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_weechat_save_lines_string (struct t_upgrade_file *upgrade_file,
+                                   struct t_hashtable *strings,
+                                   const char *string, int *index)
+{
+    int *ptr_index, length;
+    char type;
+
+    if (!string)
+    {
+        *index = -1;
+        return 1;
+    }
+
+    ptr_index = hashtable_get (strings, string);
+    if (ptr_index)
+    {
+        *index = *ptr_index;
+        return 1;
+    }
+
+    *index = strings->items_count;
+    if (!hashtable_set (strings, string, index))
+        return 0;
+
+    type = UPGRADE_WEECHAT_LINES_RECORD_STRING;
+    length = strlen (string) + 1;
+    if (!upgrade_file_write_block_data (upgrade_file, &type, sizeof (type))
+        || !upgrade_file_write_block_data (upgrade_file, &length, sizeof (length))
+        || !upgrade_file_write_block_data (upgrade_file, string, length)
+        || !upgrade_file_write_block_end_record (upgrade_file))
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Saves lines of a buffer in WeeChat upgrade file, as a binary block.
+ *
+ * Tags and prefixes are written once in the block (records "string") and
+ * lines (records "line") refer to them by index.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_weechat_save_buffer_lines (struct t_upgrade_file *upgrade_file,
+                                   struct t_gui_buffer *buffer)
+{
+    struct t_hashtable *strings;
+    struct t_gui_line *ptr_line;
+    struct t_upgrade_weechat_line_record record;
+    int i, index, *ptr_index, rc;
+    char type;
+
+    if (!buffer->own_lines->first_line)
+        return 1;
+
+    strings = hashtable_new (256,
+                             WEECHAT_HASHTABLE_STRING,
+                             WEECHAT_HASHTABLE_INTEGER,
+                             NULL, NULL);
+    if (!strings)
+        return 0;
+
+    rc = 0;
+
+    if (!upgrade_file_write_block_start (upgrade_file,
+                                         UPGRADE_WEECHAT_TYPE_BUFFER_LINES,
+                                         UPGRADE_WEECHAT_LINES_VERSION,
+                                         UPGRADE_WEECHAT_LINES_COMPRESSION))
+    {
+        goto end;
+    }
+
+    type = UPGRADE_WEECHAT_LINES_RECORD_LINE;
+
+    for (ptr_line = buffer->own_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        /* write strings used by line (if not yet written) */
+        for (i = 0; i < ptr_line->data->tags_count; i++)
+        {
+            if (!upgrade_weechat_save_lines_string (
+                    upgrade_file, strings,
+                    ptr_line->data->tags_array[i], &index))
+            {
+                goto end;
+            }
+        }
+        if (!upgrade_weechat_save_lines_string (upgrade_file, strings,
+                                                ptr_line->data->prefix,
+                                                &index))
+        {
+            goto end;
+        }
+
+        /* write line */
+        memset (&record, 0, sizeof (record));
+        record.id = ptr_line->data->id;
+        record.y = ptr_line->data->y;
+        record.date = ptr_line->data->date;
+        record.date_printed = ptr_line->data->date_printed;
+        record.prefix = index;
+        record.tags_count = ptr_line->data->tags_count;
+        record.message_length = (ptr_line->data->message) ?
+            (int)strlen (ptr_line->data->message) + 1 : 0;
+        record.highlight = ptr_line->data->highlight;
+        record.last_read_line =
+            (buffer->own_lines->last_read_line == ptr_line) ? 1 : 0;
+        if (!upgrade_file_write_block_data (upgrade_file, &type, sizeof (type))
+            || !upgrade_file_write_block_data (upgrade_file, &record,
+                                               sizeof (record)))
+        {
+            goto end;
+        }
+        for (i = 0; i < ptr_line->data->tags_count; i++)
+        {
+            ptr_index = hashtable_get (strings, ptr_line->data->tags_array[i]);
+            if (!ptr_index
+                || !upgrade_file_write_block_data (upgrade_file, ptr_index,
+                                                   sizeof (*ptr_index)))
+            {
+                goto end;
+            }
+        }
+        if (!upgrade_file_write_block_data (upgrade_file,
+                                            ptr_line->data->message,
+                                            record.message_length)
+            || !upgrade_file_write_block_end_record (upgrade_file))
+        {
+            goto end;
+        }
+    }
+
+    if (!upgrade_file_write_block_end (upgrade_file))
+        goto end;
+
+    rc = 1;
+
+end:
+    hashtable_free (strings);
+    return rc;
+}
+
 /*
  * Saves buffers in WeeChat upgrade file.
  *
@@ -122,7 +285,6 @@ upgrade_weechat_save_buffers (struct t_upgrade_file *upgrade_file)
 {
     struct t_infolist *ptr_infolist;
     struct t_gui_buffer *ptr_buffer;
-    struct t_gui_line *ptr_line;
     int rc;
 
     for (ptr_buffer = gui_buffers; ptr_buffer;
@@ -164,26 +326,8 @@ upgrade_weechat_save_buffers (struct t_upgrade_file *upgrade_file)
         }
 
         /* save buffer lines */
-        for (ptr_line = ptr_buffer->own_lines->first_line; ptr_line;
-             ptr_line = ptr_line->next_line)
-        {
-            ptr_infolist = infolist_new (NULL);
-            if (!ptr_infolist)
-                return 0;
-            if (!gui_line_add_to_infolist (ptr_infolist,
-                                           ptr_buffer->own_lines,
-                                           ptr_line))
-            {
-                infolist_free (ptr_infolist);
-                return 0;
-            }
-            rc = upgrade_file_write_object (upgrade_file,
-                                            UPGRADE_WEECHAT_TYPE_BUFFER_LINE,
-                                            ptr_infolist);
-            infolist_free (ptr_infolist);
-            if (!rc)
-                return 0;
-        }
+        if (!upgrade_weechat_save_buffer_lines (upgrade_file, ptr_buffer))
+            return 0;
 
         /* save command/text history of buffer */
         if (ptr_buffer->history)
@@ -631,11 +775,14 @@ upgrade_weechat_read_buffer (struct t_infolist *infolist)
 }
 
 /*
- * Reads a buffer line from infolist.
+ * Adds a line read in upgrade file to current buffer.
  */
 
 void
-upgrade_weechat_read_buffer_line (struct t_infolist *infolist)
+upgrade_weechat_add_buffer_line (int id, int y, time_t date,
+                                 time_t date_printed, const char *tags,
+                                 const char *prefix, const char *message,
+                                 int highlight, int last_read_line)
 {
     struct t_gui_line *new_line;
 
@@ -647,32 +794,31 @@ upgrade_weechat_read_buffer_line (struct t_infolist *infolist)
         case GUI_BUFFER_TYPE_FORMATTED:
             new_line = gui_line_new (upgrade_current_buffer,
                                      -1,
-                                     infolist_time (infolist, "date"),
-                                     infolist_time (infolist, "date_printed"),
-                                     infolist_string (infolist, "tags"),
-                                     infolist_string (infolist, "prefix"),
-                                     infolist_string (infolist, "message"));
+                                     date,
+                                     date_printed,
+                                     tags,
+                                     prefix,
+                                     message);
             if (new_line)
             {
-                new_line->data->id = infolist_integer (infolist, "id");
+                new_line->data->id = id;
                 gui_line_add (new_line);
-                new_line->data->highlight = infolist_integer (infolist,
-                                                              "highlight");
-                if (infolist_integer (infolist, "last_read_line"))
+                new_line->data->highlight = highlight;
+                if (last_read_line)
                     upgrade_current_buffer->lines->last_read_line = new_line;
             }
             break;
         case GUI_BUFFER_TYPE_FREE:
             new_line = gui_line_new (upgrade_current_buffer,
-                                     infolist_integer (infolist, "y"),
-                                     infolist_time (infolist, "date"),
-                                     infolist_time (infolist, "date_printed"),
-                                     infolist_string (infolist, "tags"),
+                                     y,
+                                     date,
+                                     date_printed,
+                                     tags,
                                      NULL,
-                                     infolist_string (infolist, "message"));
+                                     message);
             if (new_line)
             {
-                new_line->data->id = infolist_integer (infolist, "id");
+                new_line->data->id = id;
                 gui_line_add_y (new_line);
             }
             break;
@@ -681,6 +827,177 @@ upgrade_weechat_read_buffer_line (struct t_infolist *infolist)
     }
 }
 
+/*
+ * Reads a buffer line from infolist.
+ */
+
+void
+upgrade_weechat_read_buffer_line (struct t_infolist *infolist)
+{
+    upgrade_weechat_add_buffer_line (
+        infolist_integer (infolist, "id"),
+        infolist_integer (infolist, "y"),
+        infolist_time (infolist, "date"),
+        infolist_time (infolist, "date_printed"),
+        infolist_string (infolist, "tags"),
+        infolist_string (infolist, "prefix"),
+        infolist_string (infolist, "message"),
+        infolist_integer (infolist, "highlight"),
+        infolist_integer (infolist, "last_read_line"));
+}
+
+/*
+ * Frees strings read in block of lines.
+ */
+
+void
+upgrade_weechat_lines_strings_free ()
+{
+    int i;
+
+    for (i = 0; i < upgrade_lines_strings_count; i++)
+    {
+        free (upgrade_lines_strings[i]);
+    }
+    if (upgrade_lines_strings)
+        free (upgrade_lines_strings);
+    upgrade_lines_strings = NULL;
+    upgrade_lines_strings_count = 0;
+    upgrade_lines_strings_size = 0;
+}
+
+/*
+ * Adds a string read in block of lines.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+upgrade_weechat_lines_strings_add (const char *string)
+{
+    char **new_strings;
+    int new_size;
+
+    if (upgrade_lines_strings_count >= upgrade_lines_strings_size)
+    {
+        new_size = (upgrade_lines_strings_size > 0) ?
+            upgrade_lines_strings_size * 2 : 256;
+        new_strings = realloc (upgrade_lines_strings,
+                               new_size * sizeof (*new_strings));
+        if (!new_strings)
+            return 0;
+        upgrade_lines_strings = new_strings;
+        upgrade_lines_strings_size = new_size;
+    }
+
+    upgrade_lines_strings[upgrade_lines_strings_count] = strdup (string);
+    if (!upgrade_lines_strings[upgrade_lines_strings_count])
+        return 0;
+    upgrade_lines_strings_count++;
+
+    return 1;
+}
+
+/*
+ * Reads a chunk of buffer lines (binary block): strings are added in the list
+ * of strings and lines are added to current buffer.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (invalid data)
+ */
+
+int
+upgrade_weechat_read_buffer_lines (const char *chunk, int size)
+{
+    struct t_upgrade_weechat_line_record record;
+    const char *ptr_message;
+    char **tags;
+    int rc, pos, length, i, index;
+
+    tags = string_dyn_alloc (256);
+    if (!tags)
+        return 0;
+
+    rc = 0;
+
+    pos = 0;
+    while (pos < size)
+    {
+        switch (chunk[pos++])
+        {
+            case UPGRADE_WEECHAT_LINES_RECORD_STRING:
+                if (size - pos < (int)sizeof (length))
+                    goto end;
+                memcpy (&length, chunk + pos, sizeof (length));
+                pos += sizeof (length);
+                if ((length <= 0) || (length > size - pos)
+                    || (chunk[pos + length - 1] != '\0'))
+                {
+                    goto end;
+                }
+                if (!upgrade_weechat_lines_strings_add (chunk + pos))
+                    goto end;
+                pos += length;
+                break;
+            case UPGRADE_WEECHAT_LINES_RECORD_LINE:
+                if (size - pos < (int)sizeof (record))
+                    goto end;
+                memcpy (&record, chunk + pos, sizeof (record));
+                pos += sizeof (record);
+                if ((record.prefix < -1)
+                    || (record.prefix >= upgrade_lines_strings_count)
+                    || (record.tags_count < 0)
+                    || (record.tags_count > (size - pos) / (int)sizeof (index)))
+                {
+                    goto end;
+                }
+                string_dyn_copy (tags, NULL);
+                for (i = 0; i < record.tags_count; i++)
+                {
+                    memcpy (&index, chunk + pos, sizeof (index));
+                    pos += sizeof (index);
+                    if ((index < 0) || (index >= upgrade_lines_strings_count))
+                        goto end;
+                    if (i > 0)
+                        string_dyn_concat (tags, ",", -1);
+                    string_dyn_concat (tags, upgrade_lines_strings[index], -1);
+                }
+                if ((record.message_length < 0)
+                    || (record.message_length > size - pos)
+                    || ((record.message_length > 0)
+                        && (chunk[pos + record.message_length - 1] != '\0')))
+                {
+                    goto end;
+                }
+                ptr_message = (record.message_length > 0) ? chunk + pos : NULL;
+                pos += record.message_length;
+                upgrade_weechat_add_buffer_line (
+                    record.id,
+                    record.y,
+                    record.date,
+                    record.date_printed,
+                    *tags,
+                    (record.prefix >= 0) ?
+                    upgrade_lines_strings[record.prefix] : NULL,
+                    ptr_message,
+                    record.highlight,
+                    record.last_read_line);
+                break;
+            default:
+                goto end;
+        }
+    }
+
+    rc = 1;
+
+end:
+    string_dyn_free (tags, 1);
+    return rc;
+}
+
 /*
  * Reads a nicklist from infolist.
  */
@@ -851,6 +1168,47 @@ upgrade_weechat_read_cb (const void *pointer, void *data,
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Reads a chunk of a binary block in WeeChat upgrade file (chunk is NULL at
+ * end of block).
+ */
+
+int
+upgrade_weechat_read_block_cb (const void *pointer, void *data,
+                               struct t_upgrade_file *upgrade_file,
+                               int object_id, int version,
+                               const char *chunk, int size)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+
+    switch (object_id)
+    {
+        case UPGRADE_WEECHAT_TYPE_BUFFER_LINES:
+            if (!chunk)
+            {
+                upgrade_weechat_lines_strings_free ();
+                break;
+            }
+            if (version != UPGRADE_WEECHAT_LINES_VERSION)
+            {
+                UPGRADE_ERROR(_("read - unsupported version of block"),
+                              "buffer lines");
+                return WEECHAT_RC_ERROR;
+            }
+            if (!upgrade_weechat_read_buffer_lines (chunk, size))
+            {
+                UPGRADE_ERROR(_("read - invalid block"), "buffer lines");
+                upgrade_weechat_lines_strings_free ();
+                return WEECHAT_RC_ERROR;
+            }
+            break;
+    }
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Loads WeeChat upgrade file.
  *
@@ -871,11 +1229,14 @@ upgrade_weechat_load ()
                                      &upgrade_weechat_read_cb, NULL, NULL);
     if (!upgrade_file)
         return 0;
+    upgrade_file->callback_read_block = &upgrade_weechat_read_block_cb;
 
     rc = upgrade_file_read (upgrade_file);
 
     upgrade_file_close (upgrade_file);
 
+    upgrade_weechat_lines_strings_free ();
+
     if (!hotlist_reset)
         gui_hotlist_clear (GUI_HOTLIST_MASK_MAX);
 
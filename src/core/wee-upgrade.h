@@ -20,10 +20,19 @@
 #ifndef WEECHAT_UPGRADE_H
 #define WEECHAT_UPGRADE_H
 
+#include <time.h>
+
 #include "wee-upgrade-file.h"
 
 #define WEECHAT_UPGRADE_FILENAME "weechat"
 
+/* binary format of buffer lines (block UPGRADE_WEECHAT_TYPE_BUFFER_LINES) */
+#define UPGRADE_WEECHAT_LINES_VERSION 1
+#define UPGRADE_WEECHAT_LINES_COMPRESSION 1
+
+#define UPGRADE_WEECHAT_LINES_RECORD_STRING 'S'
+#define UPGRADE_WEECHAT_LINES_RECORD_LINE   'L'
+
 /* For developers: please add new values ONLY AT THE END of enums */
 
 enum t_upgrade_weechat_type
@@ -35,6 +44,28 @@ enum t_upgrade_weechat_type
     UPGRADE_WEECHAT_TYPE_MISC,
     UPGRADE_WEECHAT_TYPE_HOTLIST,
     UPGRADE_WEECHAT_TYPE_LAYOUT_WINDOW,
+    UPGRADE_WEECHAT_TYPE_BUFFER_LINES,
+};
+
+/*
+ * fixed part of a line record in binary block of lines, followed by:
+ *   - tags_count integers: indexes of tags in strings
+ *   - message_length bytes: message, including final '\0'
+ */
+
+struct t_upgrade_weechat_line_record
+{
+    int id;                            /* line id                           */
+    int y;                             /* line position (free buffer)       */
+    time_t date;                       /* date/time of line                 */
+    time_t date_printed;               /* date/time when weechat print it   */
+    int prefix;                        /* index of prefix in strings        */
+                                       /* (-1 if no prefix)                 */
+    int tags_count;                    /* number of tags                    */
+    int message_length;                /* length of message with '\0'       */
+                                       /* (0 if no message)                 */
+    char highlight;                    /* 1 if line has highlight           */
+    char last_read_line;               /* 1 if line is the last read line   */
 };
 
 int upgrade_weechat_save ();
@@ -717,6 +717,7 @@ weechat_end (void (*gui_end_cb)(int clean_exit))
     gui_key_end ();                     /* remove all keys                  */
     unhook_all ();                      /* remove all hooks                 */
     hdata_end ();                       /* end hdata                        */
+    eval_end ();                        /* end eval                         */
     secure_end ();                      /* end secured data                 */
     string_end ();                      /* end string                       */
     weechat_shutdown (-1, 0);           /* end other things                 */
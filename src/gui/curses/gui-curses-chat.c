@@ -26,6 +26,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 #include <time.h>
 
 #include "../../core/weechat.h"
@@ -44,10 +45,16 @@
 #include "../gui-main.h"
 #include "../gui-window.h"
 #include "gui-curses.h"
+#include "gui-curses-chat.h"
 #include "gui-curses-main.h"
 #include "gui-curses-window.h"
 
 
+int gui_chat_layout_generation = 0;    /* incremented on each screen        */
+                                       /* refresh (options/size changed)    */
+int gui_chat_layout_last_id = 0;       /* last layout id given to a window  */
+
+
 /*
  * Gets real width for chat.
  *
@@ -1334,6 +1341,103 @@ gui_chat_display_time_to_prefix (struct t_gui_window *window,
         free (ptr_prefix);
 }
 
+/*
+ * Checks if a message "day changed" must be displayed before a line: only
+ * before the first line with a date, if this date is not today.
+ *
+ * Returns:
+ *   1: message must be displayed (date is set with date of line)
+ *   0: message must not be displayed
+ */
+
+int
+gui_chat_day_changed_before (struct t_gui_window *window,
+                             struct t_gui_line *line, struct tm *date)
+{
+    struct t_gui_line *ptr_prev_line;
+    struct tm local_time;
+    struct timeval tv_time;
+    time_t seconds;
+
+    if ((line->data->date == 0)
+        || !CONFIG_BOOLEAN(config_look_day_change)
+        || !window->buffer->day_change)
+    {
+        return 0;
+    }
+
+    ptr_prev_line = gui_line_get_prev_displayed (line);
+    while (ptr_prev_line && (ptr_prev_line->data->date == 0))
+    {
+        ptr_prev_line = gui_line_get_prev_displayed (ptr_prev_line);
+    }
+    if (ptr_prev_line)
+        return 0;
+
+    gettimeofday (&tv_time, NULL);
+    seconds = tv_time.tv_sec;
+    localtime_r (&seconds, &local_time);
+    localtime_r (&line->data->date, date);
+
+    return ((local_time.tm_mday != date->tm_mday)
+            || (local_time.tm_mon != date->tm_mon)
+            || (local_time.tm_year != date->tm_year)) ? 1 : 0;
+}
+
+/*
+ * Checks if a message "day changed" must be displayed after a line: if the
+ * day of next line with a date (or current day for the last line) is
+ * different.
+ *
+ * Returns:
+ *   1: message must be displayed (date1 and date2 are set)
+ *   0: message must not be displayed
+ */
+
+int
+gui_chat_day_changed_after (struct t_gui_window *window,
+                            struct t_gui_line *line,
+                            struct tm *date1, struct tm *date2)
+{
+    struct t_gui_line *ptr_next_line;
+    struct timeval tv_time;
+    time_t seconds, *ptr_time;
+
+    if ((line->data->date == 0)
+        || !CONFIG_BOOLEAN(config_look_day_change)
+        || !window->buffer->day_change)
+    {
+        return 0;
+    }
+
+    ptr_next_line = gui_line_get_next_displayed (line);
+    while (ptr_next_line && (ptr_next_line->data->date == 0))
+    {
+        ptr_next_line = gui_line_get_next_displayed (ptr_next_line);
+    }
+    if (ptr_next_line)
+    {
+        /* get time of next line */
+        ptr_time = &ptr_next_line->data->date;
+    }
+    else
+    {
+        /* it was the last line => compare with current system time */
+        gettimeofday (&tv_time, NULL);
+        seconds = tv_time.tv_sec;
+        ptr_time = &seconds;
+    }
+    if (*ptr_time == 0)
+        return 0;
+
+    localtime_r (&line->data->date, date1);
+    localtime_r (ptr_time, date2);
+
+    return ((date1->tm_mday != date2->tm_mday)
+            || (date1->tm_mon != date2->tm_mon)
+            || (date1->tm_year != date2->tm_year)) ? 1 : 0;
+}
+
 /*
  * Displays a line in the chat window.
  *
@@ -1355,10 +1459,7 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
     int word_length_with_spaces, word_length;
     char *message_with_tags, *message_with_search;
     const char *ptr_data, *ptr_end_offset, *ptr_style, *next_char;
-    struct t_gui_line *ptr_prev_line, *ptr_next_line;
     struct tm local_time, local_time2;
-    struct timeval tv_time;
-    time_t seconds, *ptr_time;
 
     if (!line)
         return 0;
@@ -1377,7 +1478,7 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
             return 0;
         x = window->win_chat_cursor_x;
         y = window->win_chat_cursor_y;
-        num_lines = gui_chat_display_line (window, line, 0, 1);
+        num_lines = gui_chat_get_line_height (window, line);
         window->win_chat_cursor_x = x;
         window->win_chat_cursor_y = y;
         gui_window_current_emphasis = 0;
@@ -1387,36 +1488,12 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
     lines_displayed = 0;
 
     /* display message before first line of buffer if date is not today */
-    if ((line->data->date != 0)
-        && CONFIG_BOOLEAN(config_look_day_change)
-        && window->buffer->day_change)
+    if (gui_chat_day_changed_before (window, line, &local_time2))
     {
-        ptr_time = NULL;
-        ptr_prev_line = gui_line_get_prev_displayed (line);
-        if (ptr_prev_line)
-        {
-            while (ptr_prev_line && (ptr_prev_line->data->date == 0))
-            {
-                ptr_prev_line = gui_line_get_prev_displayed (ptr_prev_line);
-            }
-        }
-        if (!ptr_prev_line)
-        {
-            gettimeofday (&tv_time, NULL);
-            seconds = tv_time.tv_sec;
-            localtime_r (&seconds, &local_time);
-            localtime_r (&line->data->date, &local_time2);
-            if ((local_time.tm_mday != local_time2.tm_mday)
-                || (local_time.tm_mon != local_time2.tm_mon)
-                || (local_time.tm_year != local_time2.tm_year))
-            {
-                gui_chat_display_day_changed (window, NULL, &local_time2,
-                                              simulate);
-                gui_chat_display_new_line (window, num_lines, count,
-                                           &lines_displayed, simulate);
-                pre_lines_displayed++;
-            }
-        }
+        gui_chat_display_day_changed (window, NULL, &local_time2, simulate);
+        gui_chat_display_new_line (window, num_lines, count,
+                                   &lines_displayed, simulate);
+        pre_lines_displayed++;
     }
 
     /* calculate marker position (maybe not used for this line!) */
@@ -1589,45 +1666,12 @@ gui_chat_display_line (struct t_gui_window *window, struct t_gui_line *line,
         free (message_with_search);
 
     /* display message if day has changed after this line */
-    if ((line->data->date != 0)
-        && CONFIG_BOOLEAN(config_look_day_change)
-        && window->buffer->day_change)
+    if (gui_chat_day_changed_after (window, line, &local_time, &local_time2))
     {
-        ptr_time = NULL;
-        ptr_next_line = gui_line_get_next_displayed (line);
-        if (ptr_next_line)
-        {
-            while (ptr_next_line && (ptr_next_line->data->date == 0))
-            {
-                ptr_next_line = gui_line_get_next_displayed (ptr_next_line);
-            }
-        }
-        if (ptr_next_line)
-        {
-            /* get time of next line */
-            ptr_time = &ptr_next_line->data->date;
-        }
-        else
-        {
-            /* it was the last line => compare with current system time */
-            gettimeofday (&tv_time, NULL);
-            seconds = tv_time.tv_sec;
-            ptr_time = &seconds;
-        }
-        if (ptr_time && (*ptr_time != 0))
-        {
-            localtime_r (&line->data->date, &local_time);
-            localtime_r (ptr_time, &local_time2);
-            if ((local_time.tm_mday != local_time2.tm_mday)
-                || (local_time.tm_mon != local_time2.tm_mon)
-                || (local_time.tm_year != local_time2.tm_year))
-            {
-                gui_chat_display_day_changed (window, &local_time, &local_time2,
-                                              simulate);
-                gui_chat_display_new_line (window, num_lines, count,
-                                           &lines_displayed, simulate);
-            }
-        }
+        gui_chat_display_day_changed (window, &local_time, &local_time2,
+                                      simulate);
+        gui_chat_display_new_line (window, num_lines, count,
+                                   &lines_displayed, simulate);
     }
 
     /* display read marker (after line) */
@@ -1744,6 +1788,140 @@ gui_chat_display_line_y (struct t_gui_window *window, struct t_gui_line *line,
         free (message_with_search);
 }
 
+/*
+ * Searches the height of a line cached for a layout id.
+ *
+ * Returns index of height in line, -1 if not found.
+ */
+
+int
+gui_chat_line_height_search (struct t_gui_line_data *line_data, int layout_id)
+{
+    int i;
+
+    for (i = 0; i < GUI_LINE_HEIGHT_CACHE_SIZE; i++)
+    {
+        if (line_data->height_layout_id[i] == layout_id)
+            return i;
+    }
+
+    return -1;
+}
+
+/*
+ * Gets context of a line when its height was computed for the current layout
+ * of window.
+ *
+ * Returns the context, -1 if height of line is not cached for this layout.
+ */
+
+int
+gui_chat_line_height_context (struct t_gui_window *window,
+                              struct t_gui_line *line)
+{
+    int index;
+
+    index = gui_chat_line_height_search (line->data,
+                                         GUI_WINDOW_OBJECTS(window)->layout_id);
+
+    return (index >= 0) ? line->data->height_context[index] : -1;
+}
+
+/*
+ * Gets height of a line (number of rows on screen).
+ *
+ * The height is cached in the line, with the layout id of window (chat
+ * width, alignment of prefix and buffer name, options) and the context of
+ * line (time/nick same as previous line, day change, read marker): it is
+ * computed again (simulated display of line) only if one of them changes.
+ *
+ * Up to GUI_LINE_HEIGHT_CACHE_SIZE heights are cached in each line (one per
+ * layout): when a line is displayed in windows with different layouts, the
+ * height computed for the oldest layout is replaced.
+ */
+
+int
+gui_chat_get_line_height (struct t_gui_window *window,
+                          struct t_gui_line *line)
+{
+    struct t_gui_window_curses_objects *ptr_objects;
+    struct tm date1, date2;
+    int width, flags, context, height, index, i;
+
+    if (!line)
+        return 0;
+
+    ptr_objects = GUI_WINDOW_OBJECTS(window);
+
+    /* give a new layout id to the window if its layout has changed */
+    width = gui_chat_get_real_width (window);
+    flags = ((window->buffer->time_for_each_line) ? 1 : 0)
+        | ((gui_chat_display_tags) ? 2 : 0);
+    if ((ptr_objects->layout_id == 0)
+        || (ptr_objects->layout_generation != gui_chat_layout_generation)
+        || (ptr_objects->layout_width != width)
+        || (ptr_objects->layout_lines != window->buffer->lines)
+        || (ptr_objects->layout_prefix_max_length != window->buffer->lines->prefix_max_length)
+        || (ptr_objects->layout_buffer_max_length != window->buffer->lines->buffer_max_length)
+        || (ptr_objects->layout_flags != flags))
+    {
+        gui_chat_layout_last_id = (gui_chat_layout_last_id == INT_MAX) ?
+            1 : gui_chat_layout_last_id + 1;
+        ptr_objects->layout_id = gui_chat_layout_last_id;
+        ptr_objects->layout_generation = gui_chat_layout_generation;
+        ptr_objects->layout_width = width;
+        ptr_objects->layout_lines = window->buffer->lines;
+        ptr_objects->layout_prefix_max_length = window->buffer->lines->prefix_max_length;
+        ptr_objects->layout_buffer_max_length = window->buffer->lines->buffer_max_length;
+        ptr_objects->layout_flags = flags;
+    }
+
+    /* context of line (depending on other lines) */
+    context = 0;
+    if (CONFIG_STRING(config_look_buffer_time_same)
+        && CONFIG_STRING(config_look_buffer_time_same)[0]
+        && gui_chat_line_time_is_same_as_previous (line))
+    {
+        context |= 1;
+    }
+    if (CONFIG_STRING(config_look_prefix_same_nick)
+        && CONFIG_STRING(config_look_prefix_same_nick)[0])
+    {
+        if (gui_line_prefix_is_same_nick (line, -1))
+            context |= 2;
+        if (gui_line_prefix_is_same_nick (line, 1))
+            context |= 4;
+    }
+    if (gui_chat_day_changed_before (window, line, &date1))
+        context |= 8;
+    if (gui_chat_day_changed_after (window, line, &date1, &date2))
+        context |= 16;
+    if (gui_chat_marker_for_line (window->buffer, line))
+        context |= 32;
+
+    index = gui_chat_line_height_search (line->data, ptr_objects->layout_id);
+    if ((index >= 0) && (line->data->height_context[index] == context))
+        return line->data->height[index];
+
+    height = gui_chat_display_line (window, line, 0, 1);
+
+    if (index < 0)
+    {
+        /* replace the oldest layout (layout ids are increasing, 0 = none) */
+        index = 0;
+        for (i = 1; i < GUI_LINE_HEIGHT_CACHE_SIZE; i++)
+        {
+            if (line->data->height_layout_id[i] < line->data->height_layout_id[index])
+                index = i;
+        }
+    }
+    line->data->height_layout_id[index] = ptr_objects->layout_id;
+    line->data->height_context[index] = context;
+    line->data->height[index] = height;
+
+    return height;
+}
+
 /*
  * Returns pointer to line & offset for a difference with given line.
  */
@@ -1774,7 +1952,7 @@ gui_chat_calculate_line_diff (struct t_gui_window *window,
             *line = gui_line_get_last_displayed (window->buffer);
             if (!(*line))
                 return;
-            current_size = gui_chat_display_line (window, *line, 0, 1);
+            current_size = gui_chat_get_line_height (window, *line);
             if (current_size == 0)
                 current_size = 1;
             *line_pos = current_size - 1;
@@ -1786,11 +1964,11 @@ gui_chat_calculate_line_diff (struct t_gui_window *window,
             if (!(*line))
                 return;
             *line_pos = 0;
-            current_size = gui_chat_display_line (window, *line, 0, 1);
+            current_size = gui_chat_get_line_height (window, *line);
         }
     }
     else
-        current_size = gui_chat_display_line (window, *line, 0, 1);
+        current_size = gui_chat_get_line_height (window, *line);
 
     while ((*line) && (difference != 0))
     {
@@ -1804,7 +1982,7 @@ gui_chat_calculate_line_diff (struct t_gui_window *window,
                 *line = gui_line_get_prev_displayed (*line);
                 if (*line)
                 {
-                    current_size = gui_chat_display_line (window, *line, 0, 1);
+                    current_size = gui_chat_get_line_height (window, *line);
                     if (current_size == 0)
                         current_size = 1;
                     *line_pos = current_size - 1;
@@ -1822,7 +2000,7 @@ gui_chat_calculate_line_diff (struct t_gui_window *window,
                 *line = gui_line_get_next_displayed (*line);
                 if (*line)
                 {
-                    current_size = gui_chat_display_line (window, *line, 0, 1);
+                    current_size = gui_chat_get_line_height (window, *line);
                     if (current_size == 0)
                         current_size = 1;
                     *line_pos = 0;
@@ -1856,6 +2034,157 @@ gui_chat_calculate_line_diff (struct t_gui_window *window,
     }
 }
 
+/*
+ * Saves the last line displayed in chat window (after lines have been drawn),
+ * so that lines added later in buffer can be displayed without drawing again
+ * all lines (see function gui_chat_draw_formatted_buffer_lines_added).
+ *
+ * If line is NULL (last line of buffer not displayed at bottom of window),
+ * the next draw of chat will draw all lines.
+ */
+
+void
+gui_chat_draw_save_last_line (struct t_gui_window *window,
+                              struct t_gui_line *line)
+{
+    struct t_gui_window_curses_objects *ptr_objects;
+    int rows, y;
+
+    ptr_objects = GUI_WINDOW_OBJECTS(window);
+
+    ptr_objects->chat_last_line = NULL;
+
+    if (!line || !window->coords)
+        return;
+
+    rows = (window->win_chat_cursor_y < window->win_chat_height) ?
+        window->win_chat_cursor_y : window->win_chat_height;
+    if (rows > window->coords_size)
+        return;
+
+    /* search the last row of line in chat */
+    for (y = rows - 1; y >= 0; y--)
+    {
+        if (window->coords[y].line == line)
+            break;
+    }
+    if (y < 0)
+        return;
+
+    ptr_objects->chat_last_line = line;
+    ptr_objects->chat_last_line_y = y;
+    ptr_objects->chat_last_line_height = gui_chat_get_line_height (window,
+                                                                   line);
+    ptr_objects->chat_last_line_context = gui_chat_line_height_context (window,
+                                                                       line);
+    ptr_objects->chat_layout_id = ptr_objects->layout_id;
+    ptr_objects->chat_rows = rows;
+}
+
+/*
+ * Displays lines added at the end of a formatted buffer, without drawing
+ * again the other lines: the chat area is scrolled up if needed and only the
+ * new lines are displayed at bottom.
+ *
+ * This is possible only if the last line of buffer was displayed at bottom
+ * of window by the last draw (window not scrolled) and if the layout of
+ * window and the display of this line did not change.
+ *
+ * Returns:
+ *   1: new lines displayed (or no line to display)
+ *   0: all lines must be drawn
+ */
+
+int
+gui_chat_draw_formatted_buffer_lines_added (struct t_gui_window *window)
+{
+    struct t_gui_window_curses_objects *ptr_objects;
+    struct t_gui_line *ptr_line, *ptr_first_line, *ptr_last_line;
+    int height, rows, shift, i;
+
+    ptr_objects = GUI_WINDOW_OBJECTS(window);
+
+    if (!ptr_objects->chat_last_line
+        || (window->buffer->type != GUI_BUFFER_TYPE_FORMATTED)
+        || (window->win_chat_height < 2)
+        || window->scroll->start_line
+        || window->scroll->scrolling
+        || !window->coords
+        || (window->coords_size != window->win_chat_height)
+        || (ptr_objects->chat_rows > window->win_chat_height)
+        || (ptr_objects->chat_last_line_y >= window->coords_size)
+        || (window->coords[ptr_objects->chat_last_line_y].line != ptr_objects->chat_last_line))
+    {
+        return 0;
+    }
+
+    /* the last line displayed must be displayed the same way */
+    height = gui_chat_get_line_height (window, ptr_objects->chat_last_line);
+    if ((ptr_objects->layout_id != ptr_objects->chat_layout_id)
+        || (height != ptr_objects->chat_last_line_height)
+        || (gui_chat_line_height_context (window, ptr_objects->chat_last_line) != ptr_objects->chat_last_line_context))
+    {
+        return 0;
+    }
+
+    ptr_first_line = gui_line_get_next_displayed (ptr_objects->chat_last_line);
+    if (!ptr_first_line)
+        return 1;
+
+    /* count rows of new lines (if they fill the window, draw all lines) */
+    rows = 0;
+    ptr_last_line = NULL;
+    for (ptr_line = ptr_first_line; ptr_line;
+         ptr_line = gui_line_get_next_displayed (ptr_line))
+    {
+        rows += gui_chat_get_line_height (window, ptr_line);
+        if (rows >= window->win_chat_height)
+            return 0;
+        ptr_last_line = ptr_line;
+    }
+
+    /* scroll chat area (and coordinates) to make room for new lines */
+    shift = ptr_objects->chat_rows + rows - window->win_chat_height;
+    if (shift > 0)
+    {
+        scrollok (GUI_WINDOW_OBJECTS(window)->win_chat, TRUE);
+        wscrl (GUI_WINDOW_OBJECTS(window)->win_chat, shift);
+        scrollok (GUI_WINDOW_OBJECTS(window)->win_chat, FALSE);
+        memmove (window->coords, window->coords + shift,
+                 (window->coords_size - shift) * sizeof (window->coords[0]));
+        for (i = window->coords_size - shift; i < window->coords_size; i++)
+        {
+            gui_window_coords_init_line (window, i);
+        }
+        ptr_objects->chat_rows -= shift;
+        window->scroll->first_line_displayed = 0;
+    }
+
+    gui_chat_reset_style (window, NULL, 0, 1,
+                          GUI_COLOR_CHAT_INACTIVE_WINDOW,
+                          GUI_COLOR_CHAT_INACTIVE_BUFFER,
+                          GUI_COLOR_CHAT);
+
+    window->win_chat_cursor_x = 0;
+    window->win_chat_cursor_y = ptr_objects->chat_rows;
+
+    for (ptr_line = ptr_first_line; ptr_line;
+         ptr_line = gui_line_get_next_displayed (ptr_line))
+    {
+        gui_chat_display_line (window, ptr_line, 0, 0);
+    }
+
+    gui_chat_draw_save_last_line (window, ptr_last_line);
+
+    if (window->win_chat_cursor_y > window->win_chat_height - 1)
+    {
+        window->win_chat_cursor_x = 0;
+        window->win_chat_cursor_y = window->win_chat_height - 1;
+    }
+
+    return 1;
+}
+
 /*
  * Draws chat window for a formatted buffer.
  */
@@ -1863,7 +2192,7 @@ gui_chat_calculate_line_diff (struct t_gui_window *window,
 void
 gui_chat_draw_formatted_buffer (struct t_gui_window *window)
 {
-    struct t_gui_line *ptr_line, *ptr_line2;
+    struct t_gui_line *ptr_line, *ptr_line2, *ptr_last_line;
     int auto_search_first_line, line_pos, line_pos2, count;
     int old_scrolling, old_lines_after;
 
@@ -1911,19 +2240,22 @@ gui_chat_draw_formatted_buffer (struct t_gui_window *window)
                                       (-1) * (window->win_chat_height - 1));
     }
 
+    GUI_WINDOW_OBJECTS(window)->chat_last_line = NULL;
+
     if (!ptr_line)
         return;
 
     count = 0;
+    ptr_last_line = NULL;
 
     if (line_pos > 0)
     {
         /* display end of first line at top of screen */
         count = gui_chat_display_line (window, ptr_line,
-                                       gui_chat_display_line (window,
-                                                              ptr_line,
-                                                              0, 1) -
+                                       gui_chat_get_line_height (window,
+                                                                 ptr_line) -
                                        line_pos, 0);
+        ptr_last_line = ptr_line;
         ptr_line = gui_line_get_next_displayed (ptr_line);
         window->scroll->first_line_displayed = 0;
     }
@@ -1935,6 +2267,7 @@ gui_chat_draw_formatted_buffer (struct t_gui_window *window)
     while (ptr_line && (window->win_chat_cursor_y <= window->win_chat_height - 1))
     {
         count = gui_chat_display_line (window, ptr_line, 0, 0);
+        ptr_last_line = ptr_line;
         ptr_line = gui_line_get_next_displayed (ptr_line);
     }
 
@@ -1947,7 +2280,7 @@ gui_chat_draw_formatted_buffer (struct t_gui_window *window)
     /* if so, disable scroll indicator */
     if (!ptr_line && window->scroll->scrolling)
     {
-        if ((count == gui_chat_display_line (window, gui_line_get_last_displayed (window->buffer), 0, 1))
+        if ((count == gui_chat_get_line_height (window, gui_line_get_last_displayed (window->buffer)))
             || (count == window->win_chat_height))
             window->scroll->scrolling = 0;
     }
@@ -1959,6 +2292,10 @@ gui_chat_draw_formatted_buffer (struct t_gui_window *window)
         window->scroll->start_line_pos = 0;
     }
 
+    /* last line of buffer displayed at bottom: next lines can be added */
+    if (!ptr_line && !window->scroll->scrolling && !window->scroll->start_line)
+        gui_chat_draw_save_last_line (window, ptr_last_line);
+
     window->scroll->lines_after = 0;
     if (window->scroll->scrolling && ptr_line)
     {
@@ -2215,6 +2552,15 @@ gui_chat_draw (struct t_gui_buffer *buffer, int clear_chat)
             && (ptr_win->win_chat_x >= 0) && (ptr_win->win_chat_y >= 0)
             && (GUI_WINDOW_OBJECTS(ptr_win)->win_chat))
         {
+            if (!clear_chat
+                && buffer->chat_refresh_lines_added
+                && gui_chat_draw_formatted_buffer_lines_added (ptr_win))
+            {
+                gui_chat_draw_partial_count++;
+                wnoutrefresh (GUI_WINDOW_OBJECTS(ptr_win)->win_chat);
+                continue;
+            }
+
             gui_window_coords_alloc (ptr_win);
 
             gui_chat_reset_style (ptr_win, NULL, 0, 1,
@@ -2241,16 +2587,21 @@ gui_chat_draw (struct t_gui_buffer *buffer, int clear_chat)
                 case GUI_BUFFER_TYPE_FORMATTED:
                     /* min 2 lines for chat area */
                     if (ptr_win->win_chat_height < 2)
+                    {
                         mvwaddstr (GUI_WINDOW_OBJECTS(ptr_win)->win_chat, 0, 0, "...");
+                        GUI_WINDOW_OBJECTS(ptr_win)->chat_last_line = NULL;
+                    }
                     else
                         gui_chat_draw_formatted_buffer (ptr_win);
                     break;
                 case GUI_BUFFER_TYPE_FREE:
                     gui_chat_draw_free_buffer (ptr_win, clear_chat);
+                    GUI_WINDOW_OBJECTS(ptr_win)->chat_last_line = NULL;
                     break;
                 case GUI_BUFFER_NUM_TYPES:
                     break;
             }
+            gui_chat_draw_full_count++;
             wnoutrefresh (GUI_WINDOW_OBJECTS(ptr_win)->win_chat);
         }
     }
@@ -2268,4 +2619,5 @@ gui_chat_draw (struct t_gui_buffer *buffer, int clear_chat)
 
 end:
     buffer->chat_refresh_needed = 0;
+    buffer->chat_refresh_lines_added = 0;
 }
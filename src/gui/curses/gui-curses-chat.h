@@ -20,6 +20,12 @@
 #ifndef WEECHAT_GUI_CURSES_CHAT_H
 #define WEECHAT_GUI_CURSES_CHAT_H
 
+extern int gui_chat_layout_generation;
+
+extern int gui_chat_line_height_search (struct t_gui_line_data *line_data,
+                                        int layout_id);
+extern int gui_chat_get_line_height (struct t_gui_window *window,
+                                     struct t_gui_line *line);
 extern void gui_chat_calculate_line_diff (struct t_gui_window *window,
                                           struct t_gui_line **line,
                                           int *line_pos, int difference);
@@ -310,32 +310,36 @@ gui_main_refreshes ()
     }
 
     /* compute max length for prefix/buffer if needed */
-    for (ptr_buffer = gui_buffers; ptr_buffer;
-         ptr_buffer = ptr_buffer->next_buffer)
+    if (gui_line_max_length_refresh_needed)
     {
-        /* compute buffer/prefix max length for own_lines */
-        if (ptr_buffer->own_lines)
+        for (ptr_buffer = gui_buffers; ptr_buffer;
+             ptr_buffer = ptr_buffer->next_buffer)
         {
-            if (ptr_buffer->own_lines->buffer_max_length_refresh)
+            /* compute buffer/prefix max length for own_lines */
+            if (ptr_buffer->own_lines)
             {
-                gui_line_compute_buffer_max_length (ptr_buffer,
-                                                    ptr_buffer->own_lines);
+                if (ptr_buffer->own_lines->buffer_max_length_refresh)
+                {
+                    gui_line_compute_buffer_max_length (ptr_buffer,
+                                                        ptr_buffer->own_lines);
+                }
+                if (ptr_buffer->own_lines->prefix_max_length_refresh)
+                    gui_line_compute_prefix_max_length (ptr_buffer->own_lines);
             }
-            if (ptr_buffer->own_lines->prefix_max_length_refresh)
-                gui_line_compute_prefix_max_length (ptr_buffer->own_lines);
-        }
 
-        /* compute buffer/prefix max length for mixed_lines */
-        if (ptr_buffer->mixed_lines)
-        {
-            if (ptr_buffer->mixed_lines->buffer_max_length_refresh)
+            /* compute buffer/prefix max length for mixed_lines */
+            if (ptr_buffer->mixed_lines)
             {
-                gui_line_compute_buffer_max_length (ptr_buffer,
-                                                    ptr_buffer->mixed_lines);
+                if (ptr_buffer->mixed_lines->buffer_max_length_refresh)
+                {
+                    gui_line_compute_buffer_max_length (ptr_buffer,
+                                                        ptr_buffer->mixed_lines);
+                }
+                if (ptr_buffer->mixed_lines->prefix_max_length_refresh)
+                    gui_line_compute_prefix_max_length (ptr_buffer->mixed_lines);
             }
-            if (ptr_buffer->mixed_lines->prefix_max_length_refresh)
-                gui_line_compute_prefix_max_length (ptr_buffer->mixed_lines);
         }
+        gui_line_max_length_refresh_needed = 0;
     }
 
     /* refresh window if needed */
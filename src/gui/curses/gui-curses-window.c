@@ -137,6 +137,19 @@ gui_window_objects_init (struct t_gui_window *window)
         GUI_WINDOW_OBJECTS(window)->win_chat = NULL;
         GUI_WINDOW_OBJECTS(window)->win_separator_horiz = NULL;
         GUI_WINDOW_OBJECTS(window)->win_separator_vertic = NULL;
+        GUI_WINDOW_OBJECTS(window)->layout_id = 0;
+        GUI_WINDOW_OBJECTS(window)->layout_generation = 0;
+        GUI_WINDOW_OBJECTS(window)->layout_width = 0;
+        GUI_WINDOW_OBJECTS(window)->layout_lines = NULL;
+        GUI_WINDOW_OBJECTS(window)->layout_prefix_max_length = 0;
+        GUI_WINDOW_OBJECTS(window)->layout_buffer_max_length = 0;
+        GUI_WINDOW_OBJECTS(window)->layout_flags = 0;
+        GUI_WINDOW_OBJECTS(window)->chat_last_line = NULL;
+        GUI_WINDOW_OBJECTS(window)->chat_last_line_y = 0;
+        GUI_WINDOW_OBJECTS(window)->chat_last_line_height = 0;
+        GUI_WINDOW_OBJECTS(window)->chat_last_line_context = 0;
+        GUI_WINDOW_OBJECTS(window)->chat_layout_id = 0;
+        GUI_WINDOW_OBJECTS(window)->chat_rows = 0;
         return 1;
     }
     return 0;
@@ -2472,6 +2485,9 @@ gui_window_swap (struct t_gui_window *window, int direction)
 void
 gui_window_refresh_screen (int full_refresh)
 {
+    /* options or size may have changed: heights of lines must be computed */
+    gui_chat_layout_generation++;
+
     if (full_refresh)
     {
         endwin ();
@@ -2724,4 +2740,10 @@ gui_window_objects_print_log (struct t_gui_window *window)
     log_printf ("    win_chat. . . . . . . : 0x%lx", GUI_WINDOW_OBJECTS(window)->win_chat);
     log_printf ("    win_separator_horiz . : 0x%lx", GUI_WINDOW_OBJECTS(window)->win_separator_horiz);
     log_printf ("    win_separator_vertic. : 0x%lx", GUI_WINDOW_OBJECTS(window)->win_separator_vertic);
+    log_printf ("    layout_id . . . . . . : %d",    GUI_WINDOW_OBJECTS(window)->layout_id);
+    log_printf ("    chat_last_line. . . . : 0x%lx", GUI_WINDOW_OBJECTS(window)->chat_last_line);
+    log_printf ("    chat_last_line_y. . . : %d",    GUI_WINDOW_OBJECTS(window)->chat_last_line_y);
+    log_printf ("    chat_last_line_height : %d",    GUI_WINDOW_OBJECTS(window)->chat_last_line_height);
+    log_printf ("    chat_layout_id. . . . : %d",    GUI_WINDOW_OBJECTS(window)->chat_layout_id);
+    log_printf ("    chat_rows . . . . . . : %d",    GUI_WINDOW_OBJECTS(window)->chat_rows);
 }
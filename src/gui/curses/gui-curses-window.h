@@ -38,6 +38,20 @@ struct t_gui_window_curses_objects
     WINDOW *win_chat;               /* chat window (example: channel)       */
     WINDOW *win_separator_horiz;    /* horizontal separator (optional)      */
     WINDOW *win_separator_vertic;   /* vertical separator (optional)        */
+    int layout_id;                  /* id of layout (for lines height)      */
+    int layout_generation;          /* generation of layout                 */
+    int layout_width;               /* chat width                           */
+    struct t_gui_lines *layout_lines; /* lines displayed (own/mixed)        */
+    int layout_prefix_max_length;   /* max length for prefix align          */
+    int layout_buffer_max_length;   /* max length for buffer name           */
+    int layout_flags;               /* time for each line, tags displayed   */
+    struct t_gui_line *chat_last_line; /* last line displayed in chat (NULL */
+                                    /* if all lines must be drawn)          */
+    int chat_last_line_y;           /* row of last line displayed           */
+    int chat_last_line_height;      /* height of last line displayed        */
+    int chat_last_line_context;     /* context of last line displayed       */
+    int chat_layout_id;             /* layout id when chat was drawn        */
+    int chat_rows;                  /* number of rows used in chat          */
 };
 
 extern int gui_window_current_color_attr;
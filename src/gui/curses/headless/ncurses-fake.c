@@ -216,6 +216,24 @@ wclrtoeol (WINDOW *win)
     return OK;
 }
 
+int
+scrollok (WINDOW *win, bool bf)
+{
+    (void) win;
+    (void) bf;
+
+    return OK;
+}
+
+int
+wscrl (WINDOW *win, int n)
+{
+    (void) win;
+    (void) n;
+
+    return OK;
+}
+
 int
 mvwprintw (WINDOW *win, int y, int x, const char *fmt, ...)
 {
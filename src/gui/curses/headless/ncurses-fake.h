@@ -104,6 +104,8 @@ extern int refresh ();
 extern int wrefresh (WINDOW *win);
 extern int wnoutrefresh (WINDOW *win);
 extern int wclrtoeol (WINDOW *win);
+extern int scrollok (WINDOW *win, bool bf);
+extern int wscrl (WINDOW *win, int n);
 extern int mvwprintw (WINDOW *win, int y, int x, const char *fmt, ...);
 extern int init_pair (short pair, short f, short b);
 extern bool has_colors ();
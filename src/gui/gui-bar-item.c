@@ -877,7 +877,7 @@ gui_bar_item_input_text_cb (const void *pointer, void *data,
 
     /* execute modifier with basic string (without cursor tag) */
     ptr_input = NULL;
-    if (!gui_cursor_mode)
+    if (!gui_cursor_mode && hook_modifier_has_hooks ("input_text_display"))
     {
         ptr_input = hook_modifier_exec (NULL,
                                         "input_text_display",
@@ -927,7 +927,8 @@ gui_bar_item_input_text_cb (const void *pointer, void *data,
     }
 
     /* execute modifier with cursor in string */
-    if (!gui_cursor_mode)
+    if (!gui_cursor_mode
+        && hook_modifier_has_hooks ("input_text_display_with_cursor"))
     {
         ptr_input2 = hook_modifier_exec (NULL,
                                          "input_text_display_with_cursor",
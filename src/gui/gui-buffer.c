@@ -65,6 +65,7 @@
 struct t_gui_buffer *gui_buffers = NULL;           /* first buffer          */
 struct t_gui_buffer *last_gui_buffer = NULL;       /* last buffer           */
 int gui_buffers_count = 0;                         /* number of buffers     */
+struct t_hashtable *gui_buffers_pointers = NULL;   /* pointers of buffers   */
 
 /* history of last visited buffers */
 struct t_gui_buffer_visited *gui_buffers_visited = NULL;
@@ -223,6 +224,10 @@ gui_buffer_build_full_name (struct t_gui_buffer *buffer)
     if (!buffer)
         return;
 
+    /* line hooks and filters matching the buffer depend on its full name */
+    hook_line_buffer_changed (buffer);
+    buffer->filters_matching_generation = -1;
+
     if (buffer->full_name)
         free (buffer->full_name);
     length = strlen (gui_buffer_get_plugin_name (buffer)) + 1 +
@@ -250,6 +255,7 @@ gui_buffer_local_var_add (struct t_gui_buffer *buffer, const char *name,
 
     ptr_value = hashtable_get (buffer->local_variables, name);
     hashtable_set (buffer->local_variables, name, value);
+    gui_buffer_reset_highlight_words_compiled (buffer);
     (void) hook_signal_send ((ptr_value) ?
                              "buffer_localvar_changed" : "buffer_localvar_added",
                              WEECHAT_HOOK_SIGNAL_POINTER, buffer);
@@ -271,6 +277,7 @@ gui_buffer_local_var_remove (struct t_gui_buffer *buffer, const char *name)
     if (ptr_value)
     {
         hashtable_remove (buffer->local_variables, name);
+        gui_buffer_reset_highlight_words_compiled (buffer);
         (void) hook_signal_send ("buffer_localvar_removed",
                                  WEECHAT_HOOK_SIGNAL_POINTER, buffer);
     }
@@ -286,6 +293,7 @@ gui_buffer_local_var_remove_all (struct t_gui_buffer *buffer)
     if (buffer && buffer->local_variables)
     {
         hashtable_remove_all (buffer->local_variables);
+        gui_buffer_reset_highlight_words_compiled (buffer);
         (void) hook_signal_send ("buffer_localvar_removed",
                                  WEECHAT_HOOK_SIGNAL_POINTER, buffer);
     }
@@ -728,6 +736,12 @@ gui_buffer_new_props (struct t_weechat_plugin *plugin,
     new_buffer->day_change = 1;
     new_buffer->clear = 1;
     new_buffer->filter = 1;
+    new_buffer->filters_matching = NULL;
+    new_buffer->filters_matching_count = 0;
+    new_buffer->filters_matching_generation = -1;
+    new_buffer->filter_pending = 0;
+    new_buffer->filter_next_line = NULL;
+    new_buffer->filter_lines_changed = 0;
 
     /* close callback */
     new_buffer->close_callback = close_callback;
@@ -742,9 +756,11 @@ gui_buffer_new_props (struct t_weechat_plugin *plugin,
     new_buffer->own_lines = gui_line_lines_alloc ();
     new_buffer->mixed_lines = NULL;
     new_buffer->lines = new_buffer->own_lines;
+    new_buffer->lines_arena = NULL;
     new_buffer->next_line_id = 0;
     new_buffer->time_for_each_line = 1;
     new_buffer->chat_refresh_needed = 2;
+    new_buffer->chat_refresh_lines_added = 0;
 
     /* nicklist */
     new_buffer->nicklist = 0;
@@ -758,7 +774,13 @@ gui_buffer_new_props (struct t_weechat_plugin *plugin,
     new_buffer->nicklist_groups_visible_count = 0;
     new_buffer->nicklist_nicks_count = 0;
     new_buffer->nicklist_nicks_visible_count = 0;
+    new_buffer->nicklist_index = hashtable_new (32,
+                                                WEECHAT_HASHTABLE_STRING,
+                                                WEECHAT_HASHTABLE_POINTER,
+                                                NULL, NULL);
+    new_buffer->nicklist_index_missing = 0;
     new_buffer->nickcmp_callback = NULL;
+    new_buffer->nickcmp_key_callback = NULL;
     new_buffer->nickcmp_callback_pointer = NULL;
     new_buffer->nickcmp_callback_data = NULL;
     gui_nicklist_add_group (new_buffer, NULL, "root", NULL, 0);
@@ -804,6 +826,7 @@ gui_buffer_new_props (struct t_weechat_plugin *plugin,
 
     /* highlight */
     new_buffer->highlight_words = NULL;
+    new_buffer->highlight_words_compiled = NULL;
     new_buffer->highlight_disable_regex = NULL;
     new_buffer->highlight_disable_regex_compiled = NULL;
     new_buffer->highlight_regex = NULL;
@@ -840,6 +863,7 @@ gui_buffer_new_props (struct t_weechat_plugin *plugin,
 
     /* add buffer to buffers list */
     first_buffer_creation = (gui_buffers == NULL);
+    hdata_pointers_add (&gui_buffers_pointers, gui_buffers, new_buffer);
     gui_buffer_insert (new_buffer);
 
     gui_buffers_count++;
@@ -1396,6 +1420,25 @@ gui_buffer_get_pointer (struct t_gui_buffer *buffer, const char *property)
     return NULL;
 }
 
+/*
+ * Sets flag "chat_refresh_needed" after lines have been added at the end of
+ * buffer: if nothing else has changed in buffer, the chat can display only
+ * the new lines (without drawing again the other lines).
+ */
+
+void
+gui_buffer_ask_chat_refresh_lines_added (struct t_gui_buffer *buffer)
+{
+    if (!buffer)
+        return;
+
+    if (buffer->chat_refresh_needed == 0)
+    {
+        buffer->chat_refresh_needed = 1;
+        buffer->chat_refresh_lines_added = 1;
+    }
+}
+
 /*
  * Sets flag "chat_refresh_needed".
  */
@@ -1408,6 +1451,8 @@ gui_buffer_ask_chat_refresh (struct t_gui_buffer *buffer, int refresh)
 
     if (refresh > buffer->chat_refresh_needed)
         buffer->chat_refresh_needed = refresh;
+    if (refresh > 0)
+        buffer->chat_refresh_lines_added = 0;
 }
 
 /*
@@ -1476,8 +1521,7 @@ gui_buffer_set_short_name (struct t_gui_buffer *buffer, const char *short_name)
     buffer->short_name = (short_name && short_name[0]) ?
         strdup (short_name) : NULL;
 
-    if (buffer->mixed_lines)
-        buffer->mixed_lines->buffer_max_length_refresh = 1;
+    gui_line_ask_buffer_max_length_refresh (buffer->mixed_lines);
     gui_buffer_ask_chat_refresh (buffer, 1);
 
     (void) hook_signal_send ("buffer_renamed",
@@ -1502,6 +1546,9 @@ gui_buffer_set_type (struct t_gui_buffer *buffer, enum t_gui_buffer_type type)
 
     buffer->type = type;
 
+    /* line hooks matching the buffer depend on its type */
+    hook_line_buffer_changed (buffer);
+
     switch (type)
     {
         case GUI_BUFFER_TYPE_FORMATTED:
@@ -1624,6 +1671,93 @@ gui_buffer_set_highlight_words (struct t_gui_buffer *buffer,
         free (buffer->highlight_words);
     buffer->highlight_words = (new_highlight_words && new_highlight_words[0]) ?
         strdup (new_highlight_words) : NULL;
+
+    gui_buffer_reset_highlight_words_compiled (buffer);
+}
+
+/*
+ * Gets highlight words compiled for a buffer: buffer highlight words and
+ * global highlight words (option "weechat.look.highlight"), with local
+ * variables replaced.
+ *
+ * The words are compiled on first call and kept in buffer until highlight
+ * words, local variables or option "weechat.look.highlight" are changed.
+ *
+ * Returns pointer to compiled highlight words, NULL if error.
+ */
+
+struct t_string_highlight *
+gui_buffer_get_highlight_words_compiled (struct t_gui_buffer *buffer)
+{
+    char *buffer_words, *global_words, **words;
+
+    if (!buffer)
+        return NULL;
+
+    if (buffer->highlight_words_compiled)
+        return buffer->highlight_words_compiled;
+
+    words = string_dyn_alloc (256);
+    if (!words)
+        return NULL;
+
+    buffer_words = gui_buffer_string_replace_local_var (
+        buffer, buffer->highlight_words);
+    global_words = gui_buffer_string_replace_local_var (
+        buffer, CONFIG_STRING(config_look_highlight));
+
+    string_dyn_concat (words,
+                       (buffer_words) ? buffer_words : buffer->highlight_words,
+                       -1);
+    string_dyn_concat (words, ",", -1);
+    string_dyn_concat (words,
+                       (global_words) ?
+                       global_words : CONFIG_STRING(config_look_highlight),
+                       -1);
+
+    buffer->highlight_words_compiled = string_highlight_compile (*words);
+
+    if (buffer_words)
+        free (buffer_words);
+    if (global_words)
+        free (global_words);
+    string_dyn_free (words, 1);
+
+    return buffer->highlight_words_compiled;
+}
+
+/*
+ * Resets highlight words compiled for a buffer (they will be compiled again
+ * on next highlight check).
+ */
+
+void
+gui_buffer_reset_highlight_words_compiled (struct t_gui_buffer *buffer)
+{
+    if (!buffer)
+        return;
+
+    if (buffer->highlight_words_compiled)
+    {
+        string_highlight_free (buffer->highlight_words_compiled);
+        buffer->highlight_words_compiled = NULL;
+    }
+}
+
+/*
+ * Resets highlight words compiled for all buffers.
+ */
+
+void
+gui_buffer_reset_highlight_words_compiled_all ()
+{
+    struct t_gui_buffer *ptr_buffer;
+
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        gui_buffer_reset_highlight_words_compiled (ptr_buffer);
+    }
 }
 
 /*
@@ -2548,6 +2682,12 @@ gui_buffer_set_pointer (struct t_gui_buffer *buffer, const char *property,
     else if (strcmp (property, "nickcmp_callback") == 0)
     {
         buffer->nickcmp_callback = pointer;
+        gui_nicklist_index_rebuild (buffer);
+    }
+    else if (strcmp (property, "nickcmp_key_callback") == 0)
+    {
+        buffer->nickcmp_key_callback = pointer;
+        gui_nicklist_index_rebuild (buffer);
     }
     else if (strcmp (property, "nickcmp_callback_pointer") == 0)
     {
@@ -3409,10 +3549,10 @@ gui_buffer_close (struct t_gui_buffer *buffer)
 
     /* free all lines */
     gui_line_free_all (buffer);
-    if (buffer->own_lines)
-        free (buffer->own_lines);
-    if (buffer->mixed_lines)
-        free (buffer->mixed_lines);
+    gui_line_lines_free (buffer->own_lines);
+    gui_line_lines_free (buffer->mixed_lines);
+    if (buffer->lines_arena)
+        gui_line_arena_unref (buffer->lines_arena);
 
     /* free some data */
     gui_buffer_undo_free_all (buffer);
@@ -3421,6 +3561,7 @@ gui_buffer_close (struct t_gui_buffer *buffer)
         gui_completion_free (buffer->completion);
     gui_nicklist_remove_all (buffer);
     gui_nicklist_remove_group (buffer, buffer->nicklist_root);
+    gui_nicklist_index_free (buffer);
     if (buffer->hotlist_max_level_nicks)
         hashtable_free (buffer->hotlist_max_level_nicks);
     gui_key_free_all (-1, &buffer->keys, &buffer->last_key,
@@ -3452,6 +3593,10 @@ gui_buffer_close (struct t_gui_buffer *buffer)
     }
     if (buffer->highlight_words)
         free (buffer->highlight_words);
+    if (buffer->highlight_words_compiled)
+        string_highlight_free (buffer->highlight_words_compiled);
+    if (buffer->filters_matching)
+        free (buffer->filters_matching);
     if (buffer->highlight_disable_regex)
         free (buffer->highlight_disable_regex);
     if (buffer->highlight_disable_regex_compiled)
@@ -3490,6 +3635,7 @@ gui_buffer_close (struct t_gui_buffer *buffer)
         gui_buffers = buffer->next_buffer;
     if (last_gui_buffer == buffer)
         last_gui_buffer = buffer->prev_buffer;
+    hdata_pointers_remove (&gui_buffers_pointers, buffer);
 
     for (ptr_window = gui_windows; ptr_window;
          ptr_window = ptr_window->next_window)
@@ -3507,6 +3653,10 @@ gui_buffer_close (struct t_gui_buffer *buffer)
     (void) hook_signal_send ("buffer_closed",
                              WEECHAT_HOOK_SIGNAL_POINTER, buffer);
 
+    /* remove buffer from cache of print/line hooks */
+    hook_print_buffer_closed (buffer);
+    hook_line_buffer_changed (buffer);
+
     free (buffer);
 }
 
@@ -4258,10 +4408,7 @@ gui_buffer_unmerge (struct t_gui_buffer *buffer, int number)
     gui_buffer_compute_num_displayed ();
 
     if (ptr_new_active_buffer)
-    {
-        ptr_new_active_buffer->mixed_lines->prefix_max_length_refresh = 1;
-        ptr_new_active_buffer->mixed_lines->buffer_max_length_refresh = 1;
-    }
+        gui_line_ask_buffer_max_length_refresh (ptr_new_active_buffer->mixed_lines);
 
     gui_window_ask_refresh (1);
 
@@ -4883,6 +5030,7 @@ gui_buffer_hdata_buffer_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_buffer, nicklist_nicks_count, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nicklist_nicks_visible_count, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nickcmp_callback, POINTER, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, nickcmp_key_callback, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nickcmp_callback_pointer, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nickcmp_callback_data, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, input, INTEGER, 0, NULL, NULL);
@@ -4934,7 +5082,8 @@ gui_buffer_hdata_buffer_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_buffer, local_variables, HASHTABLE, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, prev_buffer, POINTER, 0, NULL, hdata_name);
         HDATA_VAR(struct t_gui_buffer, next_buffer, POINTER, 0, NULL, hdata_name);
-        HDATA_LIST(gui_buffers, WEECHAT_HDATA_LIST_CHECK_POINTERS);
+        HDATA_LIST_POINTERS(gui_buffers, WEECHAT_HDATA_LIST_CHECK_POINTERS,
+                            gui_buffers_pointers);
         HDATA_LIST(last_gui_buffer, 0);
         HDATA_LIST(gui_buffer_last_displayed, 0);
     }
@@ -5305,6 +5454,7 @@ gui_buffer_print_log ()
         log_printf ("  next_line_id. . . . . . : %d",    ptr_buffer->next_line_id);
         log_printf ("  time_for_each_line. . . : %d",    ptr_buffer->time_for_each_line);
         log_printf ("  chat_refresh_needed . . : %d",    ptr_buffer->chat_refresh_needed);
+        log_printf ("  chat_refresh_lines_added: %d",    ptr_buffer->chat_refresh_lines_added);
         log_printf ("  nicklist. . . . . . . . : %d",    ptr_buffer->nicklist);
         log_printf ("  nicklist_case_sensitive : %d",    ptr_buffer->nicklist_case_sensitive);
         log_printf ("  nicklist_root . . . . . : 0x%lx", ptr_buffer->nicklist_root);
@@ -5316,7 +5466,10 @@ gui_buffer_print_log ()
         log_printf ("  nicklist_groups_vis_cnt : %d",    ptr_buffer->nicklist_groups_visible_count);
         log_printf ("  nicklist_nicks_count. . : %d",    ptr_buffer->nicklist_nicks_count);
         log_printf ("  nicklist_nicks_vis_cnt. : %d",    ptr_buffer->nicklist_nicks_visible_count);
+        log_printf ("  nicklist_index. . . . . : 0x%lx", ptr_buffer->nicklist_index);
+        log_printf ("  nicklist_index_missing. : %d",    ptr_buffer->nicklist_index_missing);
         log_printf ("  nickcmp_callback. . . . : 0x%lx", ptr_buffer->nickcmp_callback);
+        log_printf ("  nickcmp_key_callback. . : 0x%lx", ptr_buffer->nickcmp_key_callback);
         log_printf ("  nickcmp_callback_pointer: 0x%lx", ptr_buffer->nickcmp_callback_pointer);
         log_printf ("  nickcmp_callback_data . : 0x%lx", ptr_buffer->nickcmp_callback_data);
         log_printf ("  input . . . . . . . . . : %d",    ptr_buffer->input);
@@ -5359,6 +5512,7 @@ gui_buffer_print_log ()
         log_printf ("  text_search_found . . . . . . . : %d",    ptr_buffer->text_search_found);
         log_printf ("  text_search_input . . . . . . . : '%s'",  ptr_buffer->text_search_input);
         log_printf ("  highlight_words . . . . . . . . : '%s'",  ptr_buffer->highlight_words);
+        log_printf ("  highlight_words_compiled. . . . : 0x%lx", ptr_buffer->highlight_words_compiled);
         log_printf ("  highlight_disable_regex . . . . : '%s'",  ptr_buffer->highlight_disable_regex);
         log_printf ("  highlight_disable_regex_compiled: 0x%lx", ptr_buffer->highlight_disable_regex_compiled);
         log_printf ("  highlight_regex . . . . . . . . : '%s'",  ptr_buffer->highlight_regex);
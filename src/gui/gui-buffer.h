@@ -24,7 +24,9 @@
 #include <regex.h>
 
 struct t_hashtable;
+struct t_string_highlight;
 struct t_gui_window;
+struct t_gui_filter;
 struct t_infolist;
 
 enum t_gui_buffer_type
@@ -107,6 +109,17 @@ struct t_gui_buffer
     int clear;                         /* 1 if clear of buffer is allowed   */
                                        /* with command /buffer clear        */
     int filter;                        /* 1 if filters enabled for buffer   */
+    struct t_gui_filter **filters_matching; /* filters matching buffer name */
+    int filters_matching_count;        /* number of filters matching        */
+    int filters_matching_generation;   /* generation of filters used to     */
+                                       /* build filters_matching (-1 if it  */
+                                       /* must be built again)              */
+    int filter_pending;                /* 1 if lines are being filtered     */
+                                       /* (by chunks, with a timer)         */
+    struct t_gui_line *filter_next_line; /* next line to filter (from last  */
+                                       /* line to first line)               */
+    int filter_lines_changed;          /* 1 if lines displayed/hidden have  */
+                                       /* changed during filtering          */
 
     /* close callback */
     int (*close_callback)(const void *pointer, /* called when buffer is     */
@@ -124,11 +137,14 @@ struct t_gui_buffer
     struct t_gui_lines *mixed_lines;   /* mixed lines (if buffers merged)   */
     struct t_gui_lines *lines;         /* pointer to "own_lines" or         */
                                        /* "mixed_lines"                     */
+    struct t_gui_line_arena *lines_arena; /* current arena chunk for lines  */
     int next_line_id;                  /* next line id                      */
                                        /* (used with formatted type only)   */
     int time_for_each_line;            /* time is displayed for each line?  */
     int chat_refresh_needed;           /* refresh for chat is needed ?      */
                                        /* (1=refresh, 2=erase+refresh)      */
+    int chat_refresh_lines_added;      /* 1 if refresh is only for lines    */
+                                       /* added at the end of buffer        */
 
     /* nicklist */
     int nicklist;                      /* = 1 if nicklist is enabled        */
@@ -142,11 +158,18 @@ struct t_gui_buffer
     int nicklist_groups_visible_count; /* number of groups displayed        */
     int nicklist_nicks_count;          /* number of nicks                   */
     int nicklist_nicks_visible_count;  /* number of nicks displayed         */
+    struct t_hashtable *nicklist_index; /* nicks by name (fast search)      */
+    int nicklist_index_missing;        /* nicks not in index (same key as   */
+                                       /* another nick in index)            */
     int (*nickcmp_callback)(const void *pointer, /* called to compare nicks */
                             void *data,          /* (search in nicklist)    */
                             struct t_gui_buffer *buffer,
                             const char *nick1,
                             const char *nick2);
+    char *(*nickcmp_key_callback)(const void *pointer, /* key of nick in    */
+                                  void *data,          /* index of nicks    */
+                                  struct t_gui_buffer *buffer,
+                                  const char *nick);
     const void *nickcmp_callback_pointer; /* pointer for callback           */
     void *nickcmp_callback_data;       /* data for callback                 */
 
@@ -199,6 +222,8 @@ struct t_gui_buffer
 
     /* highlight settings for buffer */
     char *highlight_words;             /* list of words to highlight        */
+    struct t_string_highlight *highlight_words_compiled; /* buffer and      */
+                                       /* global highlight words compiled   */
     char *highlight_regex;             /* regex for highlight               */
     regex_t *highlight_regex_compiled; /* compiled regex                    */
     char *highlight_disable_regex;     /* regex for disabling highlight     */
@@ -241,6 +266,7 @@ struct t_gui_buffer_visited
 extern struct t_gui_buffer *gui_buffers;
 extern struct t_gui_buffer *last_gui_buffer;
 extern int gui_buffers_count;
+extern struct t_hashtable *gui_buffers_pointers;
 extern struct t_gui_buffer_visited *gui_buffers_visited;
 extern struct t_gui_buffer_visited *last_gui_buffer_visited;
 extern int gui_buffers_visited_index;
@@ -313,12 +339,16 @@ extern const char *gui_buffer_get_string (struct t_gui_buffer *buffer,
                                           const char *property);
 extern void *gui_buffer_get_pointer (struct t_gui_buffer *buffer,
                                      const char *property);
+extern void gui_buffer_ask_chat_refresh_lines_added (struct t_gui_buffer *buffer);
 extern void gui_buffer_ask_chat_refresh (struct t_gui_buffer *buffer,
                                          int refresh);
 extern void gui_buffer_set_title (struct t_gui_buffer *buffer,
                                   const char *new_title);
 extern void gui_buffer_set_highlight_words (struct t_gui_buffer *buffer,
                                             const char *new_highlight_words);
+extern struct t_string_highlight *gui_buffer_get_highlight_words_compiled (struct t_gui_buffer *buffer);
+extern void gui_buffer_reset_highlight_words_compiled (struct t_gui_buffer *buffer);
+extern void gui_buffer_reset_highlight_words_compiled_all ();
 extern void gui_buffer_set_highlight_disable_regex (struct t_gui_buffer *buffer,
                                                     const char *new_regex);
 extern void gui_buffer_set_highlight_regex (struct t_gui_buffer *buffer,
@@ -57,6 +57,8 @@ struct t_gui_buffer *gui_chat_mute_buffer = NULL; /* mute buffer            */
 int gui_chat_display_tags = 0;                  /* display tags?            */
 char **gui_chat_lines_waiting_buffer = NULL;    /* lines waiting for core   */
                                                 /* buffer                   */
+long gui_chat_draw_full_count = 0;              /* number of chat draws     */
+long gui_chat_draw_partial_count = 0;           /* (full/only new lines)    */
 
 
 /*
@@ -529,9 +531,10 @@ gui_chat_change_time_format ()
         {
             if (ptr_line->data->date != 0)
             {
-                if (ptr_line->data->str_time)
-                    free (ptr_line->data->str_time);
+                gui_line_free_string (ptr_line->data,
+                                      ptr_line->data->str_time);
                 ptr_line->data->str_time = gui_chat_get_time_string (ptr_line->data->date);
+                gui_line_reset_height (ptr_line->data);
             }
         }
     }
@@ -639,14 +642,20 @@ gui_chat_printf_date_tags_internal (struct t_gui_buffer *buffer,
     if (!new_line->data->buffer)
         goto no_print;
 
-    /* call modifier for message printed ("weechat_print") */
-    length_data = 64 + 1 + ((tags) ? strlen (tags) : 0) + 1;
-    modifier_data = malloc (length_data);
-    length_str = ((new_line->data->prefix && new_line->data->prefix[0]) ? strlen (new_line->data->prefix) : 1) +
-        1 +
-        (new_line->data->message ? strlen (new_line->data->message) : 0) +
-        1;
-    string = malloc (length_str);
+    /*
+     * call modifier for message printed ("weechat_print"), only if there are
+     * hooks on it (avoid building and copying the message for nothing)
+     */
+    if (hook_modifier_has_hooks ("weechat_print"))
+    {
+        length_data = 64 + 1 + ((tags) ? strlen (tags) : 0) + 1;
+        modifier_data = malloc (length_data);
+        length_str = ((new_line->data->prefix && new_line->data->prefix[0]) ? strlen (new_line->data->prefix) : 1) +
+            1 +
+            (new_line->data->message ? strlen (new_line->data->message) : 0) +
+            1;
+        string = malloc (length_str);
+    }
     if (modifier_data && string)
     {
         snprintf (modifier_data, length_data,
@@ -728,8 +737,8 @@ gui_chat_printf_date_tags_internal (struct t_gui_buffer *buffer,
                 }
                 new_line->data->prefix_length = gui_chat_strlen_screen (
                     new_line->data->prefix);
-                if (new_line->data->message)
-                    free (new_line->data->message);
+                gui_line_free_string (new_line->data,
+                                      new_line->data->message);
                 new_line->data->message = strdup (ptr_msg);
             }
         }
@@ -742,7 +751,7 @@ gui_chat_printf_date_tags_internal (struct t_gui_buffer *buffer,
     if (new_line->data->buffer && new_line->data->buffer->print_hooks_enabled)
         hook_print_exec (new_line->data->buffer, new_line);
 
-    gui_buffer_ask_chat_refresh (new_line->data->buffer, 1);
+    gui_buffer_ask_chat_refresh_lines_added (new_line->data->buffer);
 
     if (string)
         free (string);
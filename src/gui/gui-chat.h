@@ -66,6 +66,8 @@ extern int gui_chat_time_length;
 extern int gui_chat_mute;
 extern struct t_gui_buffer *gui_chat_mute_buffer;
 extern int gui_chat_display_tags;
+extern long gui_chat_draw_full_count;
+extern long gui_chat_draw_partial_count;
 
 /* chat functions */
 
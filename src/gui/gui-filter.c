@@ -46,8 +46,108 @@
 struct t_gui_filter *gui_filters = NULL;           /* first filter          */
 struct t_gui_filter *last_gui_filter = NULL;       /* last filter           */
 int gui_filters_enabled = 1;                       /* filters enabled?      */
+int gui_filters_generation = 0;                    /* incremented when      */
+                                                   /* filters are added or  */
+                                                   /* removed               */
+struct t_hook *gui_filter_timer = NULL;            /* timer to filter lines */
+                                                   /* by chunks             */
 
 
+/*
+ * Builds the list of filters matching a buffer name, if filters have been
+ * added or removed (or buffer renamed) since the last build.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+gui_filter_buffer_build_matching (struct t_gui_buffer *buffer)
+{
+    struct t_gui_filter *ptr_filter, **new_filters;
+    int count;
+
+    if (buffer->filters_matching_generation == gui_filters_generation)
+        return 1;
+
+    count = 0;
+    for (ptr_filter = gui_filters; ptr_filter;
+         ptr_filter = ptr_filter->next_filter)
+    {
+        if (string_match_list (buffer->full_name,
+                               (const char **)ptr_filter->buffers, 0))
+        {
+            count++;
+        }
+    }
+
+    new_filters = NULL;
+    if (count > 0)
+    {
+        new_filters = malloc (count * sizeof (*new_filters));
+        if (!new_filters)
+            return 0;
+        count = 0;
+        for (ptr_filter = gui_filters; ptr_filter;
+             ptr_filter = ptr_filter->next_filter)
+        {
+            if (string_match_list (buffer->full_name,
+                                   (const char **)ptr_filter->buffers, 0))
+            {
+                new_filters[count++] = ptr_filter;
+            }
+        }
+    }
+
+    if (buffer->filters_matching)
+        free (buffer->filters_matching);
+    buffer->filters_matching = new_filters;
+    buffer->filters_matching_count = count;
+    buffer->filters_matching_generation = gui_filters_generation;
+
+    return 1;
+}
+
+/*
+ * Checks if a line is hidden by a filter (the buffer is not checked).
+ *
+ * Returns:
+ *   1: line is hidden by the filter
+ *   0: line is not hidden by the filter
+ */
+
+int
+gui_filter_line_hidden_by_filter (struct t_gui_line_data *line_data,
+                                  struct t_gui_filter *filter)
+{
+    int rc;
+
+    if (!filter->enabled)
+        return 0;
+
+    if ((strcmp (filter->tags, "*") != 0)
+        && !gui_line_match_tags_mask (line_data, filter->tags_mask))
+    {
+        return 0;
+    }
+
+    /* check line with regex */
+    rc = 1;
+    if (!filter->regex_prefix && !filter->regex_message)
+        rc = 0;
+    if (gui_line_match_regex (line_data,
+                              filter->regex_prefix,
+                              filter->regex_message))
+    {
+        rc = 0;
+    }
+    if (filter->regex && (filter->regex[0] == '!'))
+        rc ^= 1;
+
+    return (rc == 0) ? 1 : 0;
+}
+
 /*
  * Checks if a line must be displayed or not (filtered).
  *
@@ -60,7 +160,7 @@ int
 gui_filter_check_line (struct t_gui_line_data *line_data)
 {
     struct t_gui_filter *ptr_filter;
-    int rc;
+    int i;
 
     /* line is always displayed if filters are disabled (globally or in buffer) */
     if (!gui_filters_enabled || !line_data->buffer->filter)
@@ -69,36 +169,29 @@ gui_filter_check_line (struct t_gui_line_data *line_data)
     if (gui_line_has_tag_no_filter (line_data))
         return 1;
 
-    for (ptr_filter = gui_filters; ptr_filter;
-         ptr_filter = ptr_filter->next_filter)
+    if (gui_filter_buffer_build_matching (line_data->buffer))
     {
-        if (ptr_filter->enabled)
+        /* check only filters matching the buffer */
+        for (i = 0; i < line_data->buffer->filters_matching_count; i++)
+        {
+            if (gui_filter_line_hidden_by_filter (
+                    line_data, line_data->buffer->filters_matching[i]))
+            {
+                return 0;
+            }
+        }
+    }
+    else
+    {
+        for (ptr_filter = gui_filters; ptr_filter;
+             ptr_filter = ptr_filter->next_filter)
         {
-            /* check buffer */
             if (string_match_list (line_data->buffer->full_name,
                                    (const char **)ptr_filter->buffers,
-                                   0))
+                                   0)
+                && gui_filter_line_hidden_by_filter (line_data, ptr_filter))
             {
-                if ((strcmp (ptr_filter->tags, "*") == 0)
-                    || (gui_line_match_tags (line_data,
-                                             ptr_filter->tags_count,
-                                             ptr_filter->tags_array)))
-                {
-                    /* check line with regex */
-                    rc = 1;
-                    if (!ptr_filter->regex_prefix && !ptr_filter->regex_message)
-                        rc = 0;
-                    if (gui_line_match_regex (line_data,
-                                              ptr_filter->regex_prefix,
-                                              ptr_filter->regex_message))
-                    {
-                        rc = 0;
-                    }
-                    if (ptr_filter->regex && (ptr_filter->regex[0] == '!'))
-                        rc ^= 1;
-                    if (rc == 0)
-                        return 0;
-                }
+                return 0;
             }
         }
     }
@@ -107,22 +200,252 @@ gui_filter_check_line (struct t_gui_line_data *line_data)
     return 1;
 }
 
+/*
+ * Checks that a scroll in windows is not on a hidden line (if this happens,
+ * uses the previous displayed line as scroll).
+ */
+
+void
+gui_filter_check_scroll (struct t_gui_buffer *buffer)
+{
+    struct t_gui_window *ptr_window;
+
+    for (ptr_window = gui_windows; ptr_window;
+         ptr_window = ptr_window->next_window)
+    {
+        if ((!buffer || (ptr_window->buffer == buffer))
+            && ptr_window->scroll->start_line
+            && !ptr_window->scroll->start_line->data->displayed)
+        {
+            ptr_window->scroll->start_line =
+                gui_line_get_prev_displayed (ptr_window->scroll->start_line);
+            ptr_window->scroll->start_line_pos = 0;
+        }
+    }
+}
+
+/*
+ * Filters some lines of a buffer being filtered by chunks (from the last line
+ * to the first line).
+ *
+ * Returns the number of lines filtered.
+ */
+
+int
+gui_filter_buffer_chunk (struct t_gui_buffer *buffer, int max_lines)
+{
+    struct t_gui_buffer *ptr_buffer;
+    struct t_gui_line_data *ptr_line_data;
+    int count, lines_changed, line_displayed;
+
+    count = 0;
+    lines_changed = 0;
+
+    while (buffer->filter_next_line && (count < max_lines))
+    {
+        ptr_line_data = buffer->filter_next_line->data;
+
+        line_displayed = gui_filter_check_line (ptr_line_data);
+
+        if (ptr_line_data->displayed != line_displayed)
+        {
+            lines_changed = 1;
+            if (line_displayed)
+            {
+                if (buffer->own_lines->lines_hidden > 0)
+                    buffer->own_lines->lines_hidden--;
+                if (buffer->mixed_lines
+                    && (buffer->mixed_lines->lines_hidden > 0))
+                {
+                    buffer->mixed_lines->lines_hidden--;
+                }
+            }
+            else
+            {
+                buffer->own_lines->lines_hidden++;
+                if (buffer->mixed_lines)
+                    buffer->mixed_lines->lines_hidden++;
+            }
+        }
+
+        gui_line_set_displayed (ptr_line_data, line_displayed);
+
+        buffer->filter_next_line = buffer->filter_next_line->prev_line;
+        count++;
+    }
+
+    if (lines_changed)
+    {
+        buffer->filter_lines_changed = 1;
+
+        /* force a full refresh of buffer (and buffers merged with it) */
+        for (ptr_buffer = gui_buffers; ptr_buffer;
+             ptr_buffer = ptr_buffer->next_buffer)
+        {
+            if ((ptr_buffer == buffer)
+                || (buffer->mixed_lines
+                    && (ptr_buffer->mixed_lines == buffer->mixed_lines)))
+            {
+                gui_buffer_ask_chat_refresh (ptr_buffer, 2);
+            }
+        }
+
+        gui_filter_check_scroll (NULL);
+    }
+
+    if (!buffer->filter_next_line)
+    {
+        /* all lines filtered */
+        buffer->filter_pending = 0;
+        if (buffer->filter_lines_changed)
+        {
+            buffer->filter_lines_changed = 0;
+            (void) hook_signal_send ("buffer_lines_hidden",
+                                     WEECHAT_HOOK_SIGNAL_POINTER, buffer);
+        }
+    }
+
+    return count;
+}
+
+/*
+ * Filters lines of buffers being filtered by chunks, with a maximum number
+ * of lines filtered.
+ *
+ * Returns the number of buffers still being filtered.
+ */
+
+int
+gui_filter_buffers_chunk (int max_lines)
+{
+    struct t_gui_buffer *ptr_buffer;
+    int count;
+
+    count = 0;
+
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        if (!ptr_buffer->filter_pending)
+            continue;
+        if (max_lines > 0)
+            max_lines -= gui_filter_buffer_chunk (ptr_buffer, max_lines);
+        if (ptr_buffer->filter_pending)
+            count++;
+    }
+
+    return count;
+}
+
+/*
+ * Callback for timer used to filter lines by chunks.
+ */
+
+int
+gui_filter_timer_cb (const void *pointer, void *data, int remaining_calls)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) remaining_calls;
+
+    if (gui_filter_buffers_chunk (GUI_FILTER_CHUNK_LINES) == 0)
+    {
+        unhook (gui_filter_timer);
+        gui_filter_timer = NULL;
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Hooks the timer used to filter lines by chunks (if not already hooked).
+ */
+
+void
+gui_filter_hook_timer ()
+{
+    if (!gui_filter_timer)
+    {
+        gui_filter_timer = hook_timer (NULL, 1, 0, 0,
+                                       &gui_filter_timer_cb, NULL, NULL);
+    }
+}
+
+/*
+ * Starts filtering of all lines in a buffer by chunks of lines (with a timer),
+ * so that WeeChat is still responsive when filtering buffers with many lines.
+ *
+ * Lines are filtered from the last one (most likely displayed) to the first
+ * one.
+ */
+
+void
+gui_filter_buffer_start (struct t_gui_buffer *buffer)
+{
+    struct t_gui_buffer *ptr_buffer;
+
+    /* filter all lines of buffer and buffers merged with it */
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        if ((ptr_buffer == buffer)
+            || (buffer->mixed_lines
+                && (ptr_buffer->mixed_lines == buffer->mixed_lines)))
+        {
+            ptr_buffer->filter_pending = 1;
+            ptr_buffer->filter_next_line = ptr_buffer->own_lines->last_line;
+        }
+    }
+
+    gui_filter_hook_timer ();
+
+    /* filter immediately the first chunk of lines */
+    (void) gui_filter_buffer_chunk (buffer, GUI_FILTER_CHUNK_LINES);
+}
+
 /*
  * Filters a buffer, using message filters.
  *
  * If line_data is NULL, filters all lines in buffer.
  * If line_data is not NULL, filters only this line_data.
+ *
+ * If the buffer has more than GUI_FILTER_CHUNK_LINES lines, they are
+ * filtered by chunks with a timer (see function gui_filter_buffer_start).
  */
 
 void
 gui_filter_buffer (struct t_gui_buffer *buffer,
                    struct t_gui_line_data *line_data)
 {
+    struct t_gui_buffer *ptr_buffer;
     struct t_gui_line *ptr_line;
     struct t_gui_line_data *ptr_line_data;
-    struct t_gui_window *ptr_window;
     int lines_changed, line_displayed, lines_hidden;
 
+    if (!line_data)
+    {
+        if (buffer->lines->lines_count > GUI_FILTER_CHUNK_LINES)
+        {
+            gui_filter_buffer_start (buffer);
+            return;
+        }
+
+        /* all lines are filtered now: cancel filtering by chunks */
+        for (ptr_buffer = gui_buffers; ptr_buffer;
+             ptr_buffer = ptr_buffer->next_buffer)
+        {
+            if ((ptr_buffer == buffer)
+                || (buffer->mixed_lines
+                    && (ptr_buffer->mixed_lines == buffer->mixed_lines)))
+            {
+                ptr_buffer->filter_pending = 0;
+                ptr_buffer->filter_next_line = NULL;
+                ptr_buffer->filter_lines_changed = 0;
+            }
+        }
+    }
+
     lines_changed = 0;
     lines_hidden = buffer->lines->lines_hidden;
 
@@ -139,7 +462,7 @@ gui_filter_buffer (struct t_gui_buffer *buffer,
             lines_hidden += (line_displayed) ? -1 : 1;
         }
 
-        ptr_line_data->displayed = line_displayed;
+        gui_line_set_displayed (ptr_line_data, line_displayed);
 
         if (line_data)
             break;
@@ -147,11 +470,6 @@ gui_filter_buffer (struct t_gui_buffer *buffer,
         ptr_line = ptr_line->next_line;
     }
 
-    if (line_data)
-        line_data->buffer->lines->prefix_max_length_refresh = 1;
-    else
-        buffer->lines->prefix_max_length_refresh = 1;
-
     if (buffer->lines->lines_hidden != lines_hidden)
     {
         buffer->lines->lines_hidden = lines_hidden;
@@ -169,19 +487,36 @@ gui_filter_buffer (struct t_gui_buffer *buffer,
          * hidden line (if this happens, use the previous displayed line as
          * scroll)
          */
-        for (ptr_window = gui_windows; ptr_window;
-             ptr_window = ptr_window->next_window)
+        gui_filter_check_scroll (buffer);
+    }
+}
+
+/*
+ * Checks if lines of a buffer are displayed in a window (buffer displayed,
+ * or merged with the buffer displayed).
+ *
+ * Returns:
+ *   1: buffer is displayed in a window
+ *   0: buffer is not displayed
+ */
+
+int
+gui_filter_buffer_is_displayed (struct t_gui_buffer *buffer)
+{
+    struct t_gui_window *ptr_window;
+
+    for (ptr_window = gui_windows; ptr_window;
+         ptr_window = ptr_window->next_window)
+    {
+        if ((ptr_window->buffer == buffer)
+            || (buffer->mixed_lines
+                && (ptr_window->buffer->mixed_lines == buffer->mixed_lines)))
         {
-            if ((ptr_window->buffer == buffer)
-                && ptr_window->scroll->start_line
-                && !ptr_window->scroll->start_line->data->displayed)
-            {
-                ptr_window->scroll->start_line =
-                    gui_line_get_prev_displayed (ptr_window->scroll->start_line);
-                ptr_window->scroll->start_line_pos = 0;
-            }
+            return 1;
         }
     }
+
+    return 0;
 }
 
 /*
@@ -189,12 +524,20 @@ gui_filter_buffer (struct t_gui_buffer *buffer,
  *
  * If filter is NULL, filters all buffers.
  * If filter is not NULL, filters only buffers matched by this filter.
+ *
+ * Only buffers displayed in a window are filtered immediately: other buffers
+ * are filtered later by chunks (with a timer), all buffers sharing the same
+ * maximum number of lines filtered on each timer call
+ * (see function gui_filter_buffers_chunk).
  */
 
 void
 gui_filter_all_buffers (struct t_gui_filter *filter)
 {
     struct t_gui_buffer *ptr_buffer;
+    int pending;
+
+    pending = 0;
 
     for (ptr_buffer = gui_buffers; ptr_buffer;
          ptr_buffer = ptr_buffer->next_buffer)
@@ -203,9 +546,21 @@ gui_filter_all_buffers (struct t_gui_filter *filter)
             || string_match_list (ptr_buffer->full_name,
                                   (const char **)filter->buffers, 0))
         {
-            gui_filter_buffer (ptr_buffer, NULL);
+            if (gui_filter_buffer_is_displayed (ptr_buffer))
+            {
+                gui_filter_buffer (ptr_buffer, NULL);
+            }
+            else
+            {
+                ptr_buffer->filter_pending = 1;
+                ptr_buffer->filter_next_line = ptr_buffer->own_lines->last_line;
+                pending = 1;
+            }
         }
     }
+
+    if (pending)
+        gui_filter_hook_timer ();
 }
 
 /*
@@ -481,11 +836,14 @@ gui_filter_new (int enabled, const char *name, const char *buffer_name,
         new_filter->tags = (tags) ? strdup (tags) : NULL;
         new_filter->tags_array = string_split_tags (new_filter->tags,
                                                     &new_filter->tags_count);
+        new_filter->tags_mask = gui_line_tags_mask_compile (
+            new_filter->tags_count, new_filter->tags_array);
         new_filter->regex = strdup (regex);
         new_filter->regex_prefix = regex1;
         new_filter->regex_message = regex2;
 
         gui_filter_add_to_list (new_filter);
+        gui_filters_generation++;
 
         (void) hook_signal_send ("filter_added",
                                  WEECHAT_HOOK_SIGNAL_POINTER, new_filter);
@@ -549,6 +907,8 @@ gui_filter_free (struct t_gui_filter *filter)
         free (filter->tags);
     if (filter->tags_array)
         string_free_split_tags (filter->tags_array);
+    if (filter->tags_mask)
+        gui_line_tags_mask_free (filter->tags_mask);
     if (filter->regex)
         free (filter->regex);
     if (filter->regex_prefix)
@@ -563,6 +923,7 @@ gui_filter_free (struct t_gui_filter *filter)
     }
 
     gui_filter_remove_from_list (filter);
+    gui_filters_generation++;
 
     free (filter);
 
@@ -24,9 +24,14 @@
 
 #define GUI_FILTER_TAG_NO_FILTER "no_filter"
 
+/* buffers with more lines are filtered by chunks of lines (with a timer) */
+#define GUI_FILTER_CHUNK_LINES 5000
+
 /* filter structures */
 
+struct t_gui_buffer;
 struct t_gui_line_data;
+struct t_gui_line_tag_mask;
 
 struct t_gui_filter
 {
@@ -38,6 +43,7 @@ struct t_gui_filter
     char *tags;                        /* tags                              */
     int tags_count;                    /* number of tags                    */
     char ***tags_array;                /* array of tags                     */
+    struct t_gui_line_tag_mask *tags_mask; /* compiled tags (fast match) */
     char *regex;                       /* regex                             */
     regex_t *regex_prefix;             /* regex for line prefix             */
     regex_t *regex_message;            /* regex for line message            */
@@ -50,10 +56,12 @@ struct t_gui_filter
 extern struct t_gui_filter *gui_filters;
 extern struct t_gui_filter *last_gui_filter;
 extern int gui_filters_enabled;
+extern int gui_filters_generation;
 
 /* filter functions */
 
 extern int gui_filter_check_line (struct t_gui_line_data *line_data);
+extern int gui_filter_buffers_chunk (int max_lines);
 extern void gui_filter_buffer (struct t_gui_buffer *buffer,
                                struct t_gui_line_data *line_data);
 extern void gui_filter_all_buffers (struct t_gui_filter *filter);
@@ -48,6 +48,13 @@
 #include "gui-window.h"
 
 
+int gui_line_arena_count = 0;          /* number of arena chunks            */
+long gui_line_arena_size = 0;          /* total size of arena chunks        */
+int gui_line_arena_lines = 0;          /* number of lines in arena chunks   */
+int gui_line_max_length_refresh_needed = 0; /* 1 if max length of buffer    */
+                                            /* or prefix must be computed   */
+
+
 /*
  * Allocates structure "t_gui_lines" and initializes it.
  *
@@ -72,6 +79,8 @@ gui_line_lines_alloc ()
         new_lines->buffer_max_length_refresh = 0;
         new_lines->prefix_max_length = CONFIG_INTEGER(config_look_prefix_align_min);
         new_lines->prefix_max_length_refresh = 0;
+        new_lines->prefix_length_count = NULL;
+        new_lines->prefix_length_count_size = 0;
     }
 
     return new_lines;
@@ -87,29 +96,242 @@ gui_line_lines_free (struct t_gui_lines *lines)
     if (!lines)
         return;
 
+    if (lines->prefix_length_count)
+        free (lines->prefix_length_count);
+
     free (lines);
 }
 
+/*
+ * Allocates memory for a line in the arena of a buffer: data of lines and
+ * their strings are packed in chunks, which are freed when all their lines
+ * have been freed (old lines are removed first, so chunks are freed one
+ * after the other).
+ *
+ * The first chunk of a buffer is small, and each new chunk is twice bigger
+ * (up to GUI_LINE_ARENA_MAX_SIZE bytes), so that buffers with few lines use
+ * little memory.
+ *
+ * The chunk used is returned in *arena, and memory must be released with
+ * function gui_line_arena_unref.
+ *
+ * Returns pointer to memory allocated, NULL if error or if size is too big
+ * (then the caller must use malloc).
+ */
+
+void *
+gui_line_arena_alloc (struct t_gui_buffer *buffer, int size,
+                      struct t_gui_line_arena **arena)
+{
+    struct t_gui_line_arena *ptr_arena, *new_arena;
+    int new_size;
+    void *ptr_data;
+
+    *arena = NULL;
+
+    /* align size on 8 bytes */
+    size = (size + 7) & ~7;
+    if ((size <= 0) || (size > GUI_LINE_ARENA_MAX_SIZE / 4))
+        return NULL;
+
+    ptr_arena = buffer->lines_arena;
+
+    /* reuse current chunk if no line uses it any more */
+    if (ptr_arena && (ptr_arena->refcount == 1))
+        ptr_arena->used = 0;
+
+    if (!ptr_arena || (ptr_arena->used + size > ptr_arena->size))
+    {
+        new_size = (ptr_arena) ?
+            ptr_arena->size * 2 : GUI_LINE_ARENA_MIN_SIZE;
+        if (new_size > GUI_LINE_ARENA_MAX_SIZE)
+            new_size = GUI_LINE_ARENA_MAX_SIZE;
+        new_arena = malloc (sizeof (*new_arena) + new_size);
+        if (!new_arena)
+            return NULL;
+        new_arena->size = new_size;
+        new_arena->used = 0;
+        new_arena->refcount = 1;
+        new_arena->data = (char *)(new_arena + 1);
+        gui_line_arena_count++;
+        gui_line_arena_size += new_size;
+        if (ptr_arena)
+            gui_line_arena_unref (ptr_arena);
+        buffer->lines_arena = new_arena;
+        ptr_arena = new_arena;
+    }
+
+    ptr_data = ptr_arena->data + ptr_arena->used;
+    ptr_arena->used += size;
+    ptr_arena->refcount++;
+    gui_line_arena_lines++;
+
+    *arena = ptr_arena;
+
+    return ptr_data;
+}
+
+/*
+ * Releases a reference on an arena chunk (line freed or buffer closed),
+ * and frees the chunk if it is not used any more.
+ */
+
+void
+gui_line_arena_unref (struct t_gui_line_arena *arena)
+{
+    if (!arena)
+        return;
+
+    arena->refcount--;
+    if (arena->refcount <= 0)
+    {
+        gui_line_arena_count--;
+        gui_line_arena_size -= arena->size;
+        free (arena);
+    }
+}
+
+/*
+ * Frees a string of a line data (message or time), unless it is stored in
+ * the arena chunk of the line.
+ */
+
+void
+gui_line_free_string (struct t_gui_line_data *line_data, char *string)
+{
+    if (!string)
+        return;
+
+    if (line_data->arena
+        && (string >= line_data->arena->data)
+        && (string < line_data->arena->data + line_data->arena->size))
+    {
+        return;
+    }
+
+    free (string);
+}
+
+/*
+ * Returns a tag converted to lower case, as a shared string, NULL if the tag
+ * contains non-ASCII chars.
+ *
+ * Note: result must be freed after use with function string_shared_free.
+ */
+
+char *
+gui_line_tag_lower_shared (const char *tag)
+{
+    const char *ptr_tag;
+    char *tag_lower, *result;
+    int upper;
+
+    upper = 0;
+    for (ptr_tag = tag; ptr_tag[0]; ptr_tag++)
+    {
+        if ((unsigned char)(ptr_tag[0]) & 0x80)
+            return NULL;
+        if ((ptr_tag[0] >= 'A') && (ptr_tag[0] <= 'Z'))
+            upper = 1;
+    }
+
+    if (!upper)
+        return (char *)string_shared_get (tag);
+
+    tag_lower = string_tolower (tag);
+    if (!tag_lower)
+        return NULL;
+    result = (char *)string_shared_get (tag_lower);
+    free (tag_lower);
+
+    return result;
+}
+
+/*
+ * Checks if a tag is in lower case and has only ASCII chars.
+ *
+ * Returns:
+ *   1: tag is in lower case (ASCII only)
+ *   0: tag has upper case or non-ASCII chars
+ */
+
+int
+gui_line_tag_is_lower (const char *tag)
+{
+    const char *ptr_tag;
+
+    for (ptr_tag = tag; ptr_tag[0]; ptr_tag++)
+    {
+        if (((unsigned char)(ptr_tag[0]) & 0x80)
+            || ((ptr_tag[0] >= 'A') && (ptr_tag[0] <= 'Z')))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 /*
  * Allocates array with tags in a line_data.
+ *
+ * If some tags are not in lower case, the array contains the tags, a NULL
+ * pointer, then the tags in lower case (see macro GUI_LINE_TAGS_LOWER), used
+ * to quickly match tag masks; tags already in lower case are not duplicated.
  */
 
 void
 gui_line_tags_alloc (struct t_gui_line_data *line_data, const char *tags)
 {
+    char **tags_array, **ptr_lower;
+    int i;
+
     if (!line_data)
         return;
 
-    if (tags)
+    line_data->tags_count = 0;
+    line_data->tags_array = NULL;
+    line_data->tags_lower = 0;
+
+    if (!tags)
+        return;
+
+    tags_array = string_split_shared (tags, ",", NULL, 0, 0,
+                                      &line_data->tags_count);
+    if (!tags_array)
     {
-        line_data->tags_array = string_split_shared (tags, ",", NULL, 0, 0,
-                                                     &line_data->tags_count);
+        line_data->tags_count = 0;
+        return;
     }
-    else
+    for (i = 0; i < line_data->tags_count; i++)
     {
-        line_data->tags_count = 0;
-        line_data->tags_array = NULL;
+        if (!gui_line_tag_is_lower (tags_array[i]))
+        {
+            line_data->tags_lower = 1;
+            break;
+        }
     }
+    if (line_data->tags_lower)
+    {
+        ptr_lower = realloc (
+            tags_array,
+            ((line_data->tags_count * 2) + 1) * sizeof (*tags_array));
+        if (!ptr_lower)
+        {
+            string_free_split_shared (tags_array);
+            line_data->tags_count = 0;
+            line_data->tags_lower = 0;
+            return;
+        }
+        tags_array = ptr_lower;
+        for (i = 0; i < line_data->tags_count; i++)
+        {
+            tags_array[line_data->tags_count + 1 + i] =
+                (gui_line_tag_is_lower (tags_array[i])) ?
+                tags_array[i] : gui_line_tag_lower_shared (tags_array[i]);
+        }
+    }
+    line_data->tags_array = tags_array;
 }
 
 /*
@@ -119,14 +341,27 @@ gui_line_tags_alloc (struct t_gui_line_data *line_data, const char *tags)
 void
 gui_line_tags_free (struct t_gui_line_data *line_data)
 {
+    const char **ptr_lower;
+    int i;
+
     if (!line_data)
         return;
 
     if (line_data->tags_array)
     {
+        if (line_data->tags_lower)
+        {
+            ptr_lower = GUI_LINE_TAGS_LOWER(line_data);
+            for (i = 0; i < line_data->tags_count; i++)
+            {
+                if (ptr_lower[i] && (ptr_lower[i] != line_data->tags_array[i]))
+                    string_shared_free (ptr_lower[i]);
+            }
+        }
         string_free_split_shared (line_data->tags_array);
         line_data->tags_count = 0;
         line_data->tags_array = NULL;
+        line_data->tags_lower = 0;
     }
 }
 
@@ -811,6 +1046,229 @@ gui_line_match_tags (struct t_gui_line_data *line_data,
     return 0;
 }
 
+/*
+ * Compiles tags (format returned by function string_split_tags) to an array
+ * of tag masks, which is faster to match with lines than the tags.
+ *
+ * Tags without wildcard (like "irc_privmsg") and tags with a single wildcard
+ * at the end (like "nick_*" or "irc_*") are converted to lower case shared
+ * strings: they are compared with lower case tags of lines by pointer or by
+ * prefix, without any allocation; other masks are matched with function
+ * string_match.
+ *
+ * The array ends with an element having a NULL mask.
+ *
+ * Note: result must be freed after use with function gui_line_tags_mask_free.
+ */
+
+struct t_gui_line_tag_mask *
+gui_line_tags_mask_compile (int tags_count, char ***tags_array)
+{
+    struct t_gui_line_tag_mask *tags_mask, *ptr_mask;
+    const char *ptr_tag;
+    char *tag_lower;
+    int i, j, num_masks, length;
+
+    if ((tags_count <= 0) || !tags_array)
+        return NULL;
+
+    num_masks = 0;
+    for (i = 0; i < tags_count; i++)
+    {
+        for (j = 0; tags_array[i][j]; j++)
+        {
+            num_masks++;
+        }
+        if (j == 0)
+            num_masks++;
+    }
+
+    tags_mask = calloc (num_masks + 1, sizeof (*tags_mask));
+    if (!tags_mask)
+        return NULL;
+
+    ptr_mask = tags_mask;
+    for (i = 0; i < tags_count; i++)
+    {
+        if (!tags_array[i][0])
+        {
+            /* empty combination of tags: matches any line */
+            ptr_mask->type = GUI_LINE_TAG_MASK_ANY;
+            ptr_mask->last = 1;
+            ptr_mask->mask = (char *)string_shared_get ("*");
+            ptr_mask++;
+            continue;
+        }
+        for (j = 0; tags_array[i][j]; j++)
+        {
+            ptr_tag = tags_array[i][j];
+
+            /* check if tag is negated (prefixed with a '!') */
+            if ((ptr_tag[0] == '!') && ptr_tag[1])
+            {
+                ptr_tag++;
+                ptr_mask->negated = 1;
+            }
+
+            ptr_mask->last = (tags_array[i][j + 1]) ? 0 : 1;
+            ptr_mask->mask = (char *)string_shared_get (ptr_tag);
+
+            ptr_mask->type = GUI_LINE_TAG_MASK_MASK;
+            if (strcmp (ptr_tag, "*") == 0)
+            {
+                ptr_mask->type = GUI_LINE_TAG_MASK_ANY;
+            }
+            else if (ptr_tag[0])
+            {
+                length = strlen (ptr_tag);
+                tag_lower = NULL;
+                if (!strchr (ptr_tag, '*'))
+                {
+                    tag_lower = gui_line_tag_lower_shared (ptr_tag);
+                    if (tag_lower)
+                        ptr_mask->type = GUI_LINE_TAG_MASK_EXACT;
+                }
+                else if ((ptr_tag[length - 1] == '*')
+                         && (strchr (ptr_tag, '*') == ptr_tag + length - 1))
+                {
+                    tag_lower = gui_line_tag_lower_shared (ptr_tag);
+                    if (tag_lower)
+                    {
+                        ptr_mask->type = GUI_LINE_TAG_MASK_PREFIX;
+                        ptr_mask->length = length - 1;
+                    }
+                }
+                ptr_mask->tag = tag_lower;
+            }
+            ptr_mask++;
+        }
+    }
+
+    return tags_mask;
+}
+
+/*
+ * Frees an array of tag masks.
+ */
+
+void
+gui_line_tags_mask_free (struct t_gui_line_tag_mask *tags_mask)
+{
+    struct t_gui_line_tag_mask *ptr_mask;
+
+    if (!tags_mask)
+        return;
+
+    for (ptr_mask = tags_mask; ptr_mask->mask; ptr_mask++)
+    {
+        if (ptr_mask->tag)
+            string_shared_free (ptr_mask->tag);
+        string_shared_free (ptr_mask->mask);
+    }
+
+    free (tags_mask);
+}
+
+/*
+ * Checks if line matches tag masks (compiled with function
+ * gui_line_tags_mask_compile).
+ *
+ * The result is the same as function gui_line_match_tags with the tags
+ * used to compile the masks.
+ *
+ * Returns:
+ *   1: line matches tags
+ *   0: line does not match tags
+ */
+
+int
+gui_line_match_tags_mask (struct t_gui_line_data *line_data,
+                          struct t_gui_line_tag_mask *tags_mask)
+{
+    struct t_gui_line_tag_mask *ptr_mask;
+    const char **tags_lower;
+    int k, match, tag_found;
+
+    if (!line_data || !tags_mask)
+        return 0;
+
+    tags_lower = (line_data->tags_count > 0) ?
+        GUI_LINE_TAGS_LOWER(line_data) : NULL;
+
+    ptr_mask = tags_mask;
+    while (ptr_mask->mask)
+    {
+        match = 1;
+        while (ptr_mask->mask)
+        {
+            tag_found = 0;
+            switch (ptr_mask->type)
+            {
+                case GUI_LINE_TAG_MASK_ANY:
+                    tag_found = 1;
+                    break;
+                case GUI_LINE_TAG_MASK_EXACT:
+                    for (k = 0; k < line_data->tags_count; k++)
+                    {
+                        if ((tags_lower[k] == ptr_mask->tag)
+                            || (!tags_lower[k]
+                                && string_match (line_data->tags_array[k],
+                                                 ptr_mask->mask, 0)))
+                        {
+                            tag_found = 1;
+                            break;
+                        }
+                    }
+                    break;
+                case GUI_LINE_TAG_MASK_PREFIX:
+                    for (k = 0; k < line_data->tags_count; k++)
+                    {
+                        if ((tags_lower[k]
+                             && (strncmp (tags_lower[k], ptr_mask->tag,
+                                          ptr_mask->length) == 0))
+                            || (!tags_lower[k]
+                                && string_match (line_data->tags_array[k],
+                                                 ptr_mask->mask, 0)))
+                        {
+                            tag_found = 1;
+                            break;
+                        }
+                    }
+                    break;
+                default:
+                    for (k = 0; k < line_data->tags_count; k++)
+                    {
+                        if (string_match (line_data->tags_array[k],
+                                          ptr_mask->mask, 0))
+                        {
+                            tag_found = 1;
+                            break;
+                        }
+                    }
+                    break;
+            }
+            if (tag_found && ptr_mask->negated)
+                return 0;
+            if (!tag_found && !ptr_mask->negated)
+                match = 0;
+            if (!match || ptr_mask->last)
+                break;
+            ptr_mask++;
+        }
+        if (match)
+            return 1;
+        /* skip other tags of this combination */
+        while (ptr_mask->mask && !ptr_mask->last)
+        {
+            ptr_mask++;
+        }
+        if (ptr_mask->mask)
+            ptr_mask++;
+    }
+
+    return 0;
+}
+
 /*
  * Returns pointer on tag starting with "tag", NULL if such tag is not found.
  */
@@ -867,7 +1325,7 @@ int
 gui_line_has_highlight (struct t_gui_line *line)
 {
     int rc, rc_regex, i, no_highlight, action, length;
-    char *msg_no_color, *ptr_msg_no_color, *highlight_words;
+    char *msg_no_color, *ptr_msg_no_color;
     const char *ptr_nick;
     regmatch_t regex_match;
 
@@ -1015,25 +1473,12 @@ gui_line_has_highlight (struct t_gui_line *line)
 
     /*
      * there is highlight on line if one of buffer highlight words matches line
-     * or one of global highlight words matches line
+     * or one of global highlight words matches line (all words are compiled
+     * once and checked in a single pass on the message)
      */
-    highlight_words = gui_buffer_string_replace_local_var (line->data->buffer,
-                                                           line->data->buffer->highlight_words);
-    rc = string_has_highlight (ptr_msg_no_color,
-                               (highlight_words) ?
-                               highlight_words : line->data->buffer->highlight_words);
-    if (highlight_words)
-        free (highlight_words);
-    if (rc)
-        goto end;
-
-    highlight_words = gui_buffer_string_replace_local_var (line->data->buffer,
-                                                           CONFIG_STRING(config_look_highlight));
-    rc = string_has_highlight (ptr_msg_no_color,
-                               (highlight_words) ?
-                               highlight_words : CONFIG_STRING(config_look_highlight));
-    if (highlight_words)
-        free (highlight_words);
+    rc = string_highlight_match (
+        gui_buffer_get_highlight_words_compiled (line->data->buffer),
+        ptr_msg_no_color);
     if (rc)
         goto end;
 
@@ -1087,6 +1532,41 @@ gui_line_has_offline_nick (struct t_gui_line *line)
     return 0;
 }
 
+/*
+ * Asks for a refresh of "buffer_max_length" in a "t_gui_lines" structure
+ * (it is computed in the next main loop).
+ */
+
+void
+gui_line_ask_buffer_max_length_refresh (struct t_gui_lines *lines)
+{
+    if (!lines)
+        return;
+
+    lines->buffer_max_length_refresh = 1;
+    gui_line_max_length_refresh_needed = 1;
+}
+
+/*
+ * Asks for a refresh of "prefix_max_length" in a "t_gui_lines" structure:
+ * the number of lines by length of prefix is computed again with all lines
+ * (in the next main loop).
+ *
+ * This is needed only if the length of prefix of lines may have changed
+ * (options changed or prefix of a line updated); lines added, removed or
+ * filtered update the max length directly.
+ */
+
+void
+gui_line_ask_prefix_max_length_refresh (struct t_gui_lines *lines)
+{
+    if (!lines)
+        return;
+
+    lines->prefix_max_length_refresh = 1;
+    gui_line_max_length_refresh_needed = 1;
+}
+
 /*
  * Computes "buffer_max_length" for a "t_gui_lines" structure.
  */
@@ -1117,34 +1597,211 @@ gui_line_compute_buffer_max_length (struct t_gui_buffer *buffer,
 }
 
 /*
- * Computes "prefix_max_length" for a "t_gui_lines" structure.
+ * Gets the max length of prefix that can be displayed for a line (used to
+ * compute "prefix_max_length").
+ *
+ * It does not depend on other lines: a line with a nick can be displayed
+ * with its prefix (and nick prefix/suffix) or with the value of options
+ * "weechat.look.prefix_same_nick" and "weechat.look.prefix_same_nick_middle"
+ * if the nick is the same as previous line, so the max of these lengths is
+ * returned.
+ */
+
+int
+gui_line_get_prefix_length_max (struct t_gui_line_data *line_data)
+{
+    int i, length, prefix_nick;
+
+    if (!line_data)
+        return 0;
+
+    length = line_data->prefix_length;
+
+    prefix_nick = 0;
+    for (i = 0; i < line_data->tags_count; i++)
+    {
+        if (strncmp (line_data->tags_array[i], "prefix_nick", 11) == 0)
+        {
+            prefix_nick = 1;
+            if (line_data->tags_array[i][11] == '_')
+            {
+                length += config_length_nick_prefix_suffix;
+                break;
+            }
+        }
+    }
+
+    if (prefix_nick
+        && CONFIG_STRING(config_look_prefix_same_nick)
+        && CONFIG_STRING(config_look_prefix_same_nick)[0])
+    {
+        if ((strcmp (CONFIG_STRING(config_look_prefix_same_nick), " ") != 0)
+            && (config_length_prefix_same_nick > length))
+        {
+            length = config_length_prefix_same_nick;
+        }
+        if (CONFIG_STRING(config_look_prefix_same_nick_middle)
+            && CONFIG_STRING(config_look_prefix_same_nick_middle)[0]
+            && (strcmp (CONFIG_STRING(config_look_prefix_same_nick_middle), " ") != 0)
+            && (config_length_prefix_same_nick_middle > length))
+        {
+            length = config_length_prefix_same_nick_middle;
+        }
+    }
+
+    return length;
+}
+
+/*
+ * Adds (if count > 0) or removes (if count < 0) lines with a prefix length
+ * in a "t_gui_lines" structure, and updates "prefix_max_length".
+ *
+ * The max is updated without reading lines: it is the highest length with
+ * at least one displayed line (and at least the value of option
+ * "weechat.look.prefix_align_min").
+ */
+
+void
+gui_line_prefix_length_count (struct t_gui_lines *lines, int length,
+                              int count)
+{
+    int *new_count, new_size, i;
+
+    if (!lines || (length < 0) || (count == 0))
+        return;
+
+    if (count > 0)
+    {
+        if (length >= lines->prefix_length_count_size)
+        {
+            new_size = (lines->prefix_length_count_size > 0) ?
+                lines->prefix_length_count_size : 32;
+            while (new_size <= length)
+            {
+                new_size *= 2;
+            }
+            new_count = realloc (lines->prefix_length_count,
+                                 new_size * sizeof (*new_count));
+            if (!new_count)
+            {
+                gui_line_ask_prefix_max_length_refresh (lines);
+                return;
+            }
+            for (i = lines->prefix_length_count_size; i < new_size; i++)
+            {
+                new_count[i] = 0;
+            }
+            lines->prefix_length_count = new_count;
+            lines->prefix_length_count_size = new_size;
+        }
+        lines->prefix_length_count[length] += count;
+        if (length > lines->prefix_max_length)
+            lines->prefix_max_length = length;
+    }
+    else
+    {
+        if ((length >= lines->prefix_length_count_size)
+            || (lines->prefix_length_count[length] <= 0))
+        {
+            return;
+        }
+        lines->prefix_length_count[length] += count;
+        if (lines->prefix_length_count[length] < 0)
+            lines->prefix_length_count[length] = 0;
+        if ((lines->prefix_length_count[length] == 0)
+            && (length == lines->prefix_max_length))
+        {
+            while ((length > 0) && (lines->prefix_length_count[length] == 0))
+            {
+                length--;
+            }
+            lines->prefix_max_length =
+                (length > CONFIG_INTEGER(config_look_prefix_align_min)) ?
+                length : CONFIG_INTEGER(config_look_prefix_align_min);
+        }
+    }
+}
+
+/*
+ * Computes "prefix_max_length" for a "t_gui_lines" structure, with the
+ * number of lines by length of prefix (all lines are read).
  */
 
 void
 gui_line_compute_prefix_max_length (struct t_gui_lines *lines)
 {
     struct t_gui_line *ptr_line;
-    int prefix_length, prefix_is_nick;
 
     lines->prefix_max_length = CONFIG_INTEGER(config_look_prefix_align_min);
 
+    if (lines->prefix_length_count)
+    {
+        memset (lines->prefix_length_count, 0,
+                lines->prefix_length_count_size *
+                sizeof (*lines->prefix_length_count));
+    }
+
     for (ptr_line = lines->first_line; ptr_line;
          ptr_line = ptr_line->next_line)
     {
         if (ptr_line->data->displayed)
         {
-            gui_line_get_prefix_for_display (ptr_line, NULL, &prefix_length,
-                                             NULL, &prefix_is_nick);
-            if (prefix_is_nick)
-                prefix_length += config_length_nick_prefix_suffix;
-            if (prefix_length > lines->prefix_max_length)
-                lines->prefix_max_length = prefix_length;
+            gui_line_prefix_length_count (
+                lines, gui_line_get_prefix_length_max (ptr_line->data), 1);
         }
     }
 
     lines->prefix_max_length_refresh = 0;
 }
 
+/*
+ * Resets the heights of a line on screen cached for windows layouts (they will
+ * be computed again on next display).
+ */
+
+void
+gui_line_reset_height (struct t_gui_line_data *line_data)
+{
+    int i;
+
+    for (i = 0; i < GUI_LINE_HEIGHT_CACHE_SIZE; i++)
+    {
+        line_data->height_layout_id[i] = 0;
+    }
+}
+
+/*
+ * Sets flag "displayed" in a line and updates the number of lines by length
+ * of prefix in lines of its buffer (own lines and mixed lines).
+ *
+ * The line must already be in the lines of its buffer.
+ */
+
+void
+gui_line_set_displayed (struct t_gui_line_data *line_data, int displayed)
+{
+    int length;
+
+    if (!line_data)
+        return;
+
+    displayed = (displayed) ? 1 : 0;
+
+    if (line_data->displayed == displayed)
+        return;
+
+    line_data->displayed = displayed;
+
+    if (!line_data->buffer)
+        return;
+
+    length = gui_line_get_prefix_length_max (line_data);
+    gui_line_prefix_length_count (line_data->buffer->own_lines, length,
+                                  (displayed) ? 1 : -1);
+    gui_line_prefix_length_count (line_data->buffer->mixed_lines, length,
+                                  (displayed) ? 1 : -1);
+}
+
 /*
  * Adds a line to a "t_gui_lines" structure.
  */
@@ -1153,8 +1810,6 @@ void
 gui_line_add_to_list (struct t_gui_lines *lines,
                       struct t_gui_line *line)
 {
-    int prefix_length, prefix_is_nick;
-
     if (lines->last_line)
         (lines->last_line)->next_line = line;
     else
@@ -1165,16 +1820,12 @@ gui_line_add_to_list (struct t_gui_lines *lines,
 
     /*
      * adjust "prefix_max_length" if this prefix length is > max
-     * (only if the line is displayed
+     * (only if the line is displayed)
      */
     if (line->data->displayed)
     {
-        gui_line_get_prefix_for_display (line, NULL, &prefix_length, NULL,
-                                         &prefix_is_nick);
-        if (prefix_is_nick)
-            prefix_length += config_length_nick_prefix_suffix;
-        if (prefix_length > lines->prefix_max_length)
-            lines->prefix_max_length = prefix_length;
+        gui_line_prefix_length_count (
+            lines, gui_line_get_prefix_length_max (line->data), 1);
     }
     else
     {
@@ -1192,14 +1843,20 @@ gui_line_add_to_list (struct t_gui_lines *lines,
 void
 gui_line_free_data (struct t_gui_line *line)
 {
-    if (line->data->str_time)
-        free (line->data->str_time);
+    gui_line_free_string (line->data, line->data->str_time);
     gui_line_tags_free (line->data);
     if (line->data->prefix)
         string_shared_free (line->data->prefix);
-    if (line->data->message)
-        free (line->data->message);
-    free (line->data);
+    gui_line_free_string (line->data, line->data->message);
+    if (line->data->arena)
+    {
+        gui_line_arena_lines--;
+        gui_line_arena_unref (line->data->arena);
+    }
+    else
+    {
+        free (line->data);
+    }
 
     line->data = NULL;
 }
@@ -1216,7 +1873,6 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
 {
     struct t_gui_window *ptr_win;
     struct t_gui_window_scroll *ptr_scroll;
-    int prefix_length, prefix_is_nick;
 
     for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
     {
@@ -1244,16 +1900,17 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
             if (ptr_scroll->text_search_start_line == line)
                 ptr_scroll->text_search_start_line = NULL;
         }
-        /* remove line from coords */
-        gui_window_coords_remove_line (ptr_win, line);
+        /* remove line from coords (if displayed, chat must be drawn again) */
+        if (gui_window_coords_remove_line (ptr_win, line) > 0)
+            gui_buffer_ask_chat_refresh (buffer, 1);
     }
 
-    gui_line_get_prefix_for_display (line, NULL, &prefix_length, NULL,
-                                     &prefix_is_nick);
-    if (prefix_is_nick)
-        prefix_length += config_length_nick_prefix_suffix;
-    if (prefix_length == lines->prefix_max_length)
-        lines->prefix_max_length_refresh = 1;
+    /* adjust "prefix_max_length" if the line was displayed */
+    if (line->data->displayed)
+    {
+        gui_line_prefix_length_count (
+            lines, gui_line_get_prefix_length_max (line->data), -1);
+    }
 
     /* move read marker if it was on line we are removing */
     if (lines->last_read_line == line)
@@ -1267,6 +1924,13 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
     if (!line->data->displayed && (lines->lines_hidden > 0))
         (lines->lines_hidden)--;
 
+    /* skip line if it is the next one to filter (buffer being filtered) */
+    if (line->data->buffer
+        && (line->data->buffer->filter_next_line == line))
+    {
+        line->data->buffer->filter_next_line = line->prev_line;
+    }
+
     /* free data */
     if (free_data)
         gui_line_free_data (line);
@@ -1486,7 +2150,9 @@ gui_line_new (struct t_gui_buffer *buffer, int y, time_t date,
 {
     struct t_gui_line *new_line;
     struct t_gui_line_data *new_line_data;
-    int max_notify_level;
+    struct t_gui_line_arena *arena;
+    char *str_time;
+    int max_notify_level, length_message, length_time;
 
     if (!buffer)
         return NULL;
@@ -1496,18 +2162,59 @@ gui_line_new (struct t_gui_buffer *buffer, int y, time_t date,
     if (!new_line)
         return NULL;
 
-    /* create data for line */
-    new_line_data = malloc (sizeof (*new_line_data));
-    if (!new_line_data)
+    str_time = (buffer->type == GUI_BUFFER_TYPE_FORMATTED) ?
+        gui_chat_get_time_string (date) : NULL;
+
+    /*
+     * create data for line: in the arena of buffer with the message and time
+     * for a formatted buffer (lines of buffers with free content are often
+     * updated), otherwise with malloc
+     */
+    new_line_data = NULL;
+    arena = NULL;
+    length_message = (message) ? strlen (message) + 1 : 1;
+    length_time = (str_time) ? strlen (str_time) + 1 : 0;
+    if (buffer->type == GUI_BUFFER_TYPE_FORMATTED)
     {
-        free (new_line);
-        return NULL;
+        new_line_data = gui_line_arena_alloc (
+            buffer,
+            sizeof (*new_line_data) + length_message + length_time,
+            &arena);
+    }
+    if (new_line_data)
+    {
+        new_line_data->message = (char *)(new_line_data + 1);
+        memcpy (new_line_data->message, (message) ? message : "",
+                length_message);
+        if (str_time)
+        {
+            new_line_data->str_time = new_line_data->message + length_message;
+            memcpy (new_line_data->str_time, str_time, length_time);
+            free (str_time);
+        }
+        else
+        {
+            new_line_data->str_time = NULL;
+        }
     }
+    else
+    {
+        new_line_data = malloc (sizeof (*new_line_data));
+        if (!new_line_data)
+        {
+            if (str_time)
+                free (str_time);
+            free (new_line);
+            return NULL;
+        }
+        new_line_data->message = (message) ? strdup (message) : strdup ("");
+        new_line_data->str_time = str_time;
+    }
+    new_line_data->arena = arena;
     new_line->data = new_line_data;
 
     /* fill data in new line */
     new_line->data->buffer = buffer;
-    new_line->data->message = (message) ? strdup (message) : strdup ("");
 
     if (buffer->type == GUI_BUFFER_TYPE_FORMATTED)
     {
@@ -1524,7 +2231,6 @@ gui_line_new (struct t_gui_buffer *buffer, int y, time_t date,
         new_line->data->y = -1;
         new_line->data->date = date;
         new_line->data->date_printed = date_printed;
-        new_line->data->str_time = gui_chat_get_time_string (date);
         gui_line_tags_alloc (new_line->data, tags);
         new_line->data->refresh_needed = 0;
         new_line->data->prefix = (prefix) ?
@@ -1543,7 +2249,6 @@ gui_line_new (struct t_gui_buffer *buffer, int y, time_t date,
         new_line->data->y = y;
         new_line->data->date = date;
         new_line->data->date_printed = date_printed;
-        new_line->data->str_time = NULL;
         gui_line_tags_alloc (new_line->data, tags);
         new_line->data->refresh_needed = 1;
         new_line->data->prefix = NULL;
@@ -1552,6 +2257,13 @@ gui_line_new (struct t_gui_buffer *buffer, int y, time_t date,
         new_line->data->highlight = 0;
     }
 
+    /* height on screen is not yet computed */
+    memset (new_line->data->height_context, 0,
+            sizeof (new_line->data->height_context));
+    memset (new_line->data->height_layout_id, 0,
+            sizeof (new_line->data->height_layout_id));
+    memset (new_line->data->height, 0, sizeof (new_line->data->height));
+
     /* set display flag (check if line is filtered or not) */
     new_line->data->displayed = gui_filter_check_line (new_line->data);
 
@@ -1644,8 +2356,7 @@ gui_line_hook_update (struct t_gui_line *line,
         if (error && !error[0] && (value >= 0))
         {
             line->data->date = (time_t)value;
-            if (line->data->str_time)
-                free (line->data->str_time);
+            gui_line_free_string (line->data, line->data->str_time);
             line->data->str_time = gui_chat_get_time_string (line->data->date);
         }
     }
@@ -1663,8 +2374,7 @@ gui_line_hook_update (struct t_gui_line *line,
     ptr_value2 = hashtable_get (hashtable2, "str_time");
     if (ptr_value2 && (!ptr_value || (strcmp (ptr_value, ptr_value2) != 0)))
     {
-        if (line->data->str_time)
-            free (line->data->str_time);
+        gui_line_free_string (line->data, line->data->str_time);
         line->data->str_time = (ptr_value2) ? strdup (ptr_value2) : NULL;
     }
 
@@ -1717,11 +2427,13 @@ gui_line_hook_update (struct t_gui_line *line,
     ptr_value2 = hashtable_get (hashtable2, "message");
     if (ptr_value2 && (!ptr_value || (strcmp (ptr_value, ptr_value2) != 0)))
     {
-        if (line->data->message)
-            free (line->data->message);
+        gui_line_free_string (line->data, line->data->message);
         line->data->message = (ptr_value2) ? strdup (ptr_value2) : NULL;
     }
 
+    /* content may have changed: height on screen must be computed again */
+    gui_line_reset_height (line->data);
+
     max_notify_level = gui_line_get_max_notify_level (line);
 
     /* if tags were updated but not notify_level, adjust notify level */
@@ -1970,7 +2682,7 @@ gui_line_clear (struct t_gui_line *line)
     line->data->date_printed = 0;
     if (line->data->str_time)
     {
-        free (line->data->str_time);
+        gui_line_free_string (line->data, line->data->str_time);
         line->data->str_time = NULL;
     }
     gui_line_tags_free (line->data);
@@ -1982,8 +2694,7 @@ gui_line_clear (struct t_gui_line *line)
     line->data->prefix_length = 0;
     line->data->notify_level = 0;
     line->data->highlight = 0;
-    if (line->data->message)
-        free (line->data->message);
+    gui_line_free_string (line->data, line->data->message);
     line->data->message = strdup ("");
 }
 
@@ -2057,15 +2768,14 @@ gui_line_mix_buffers (struct t_gui_buffer *buffer)
         }
     }
 
-    /* ask refresh of prefix/buffer max length for mixed lines */
-    new_lines->prefix_max_length_refresh = 1;
-    new_lines->buffer_max_length_refresh = 1;
+    /* ask refresh of buffer max length for mixed lines */
+    gui_line_ask_buffer_max_length_refresh (new_lines);
 
     /* free old mixed lines */
     if (ptr_buffer_found->mixed_lines)
     {
         gui_line_mixed_free_all (ptr_buffer_found);
-        free (ptr_buffer_found->mixed_lines);
+        gui_line_lines_free (ptr_buffer_found->mixed_lines);
     }
 
     /* use new structure with mixed lines in all buffers with correct number */
@@ -2165,8 +2875,7 @@ gui_line_hdata_line_data_update_cb (void *data,
         if (value)
         {
             hdata_set (hdata, pointer, "date", value);
-            if (line_data->str_time)
-                free (line_data->str_time);
+            gui_line_free_string (line_data, line_data->str_time);
             line_data->str_time = gui_chat_get_time_string (line_data->date);
             rc++;
             update_coords = 1;
@@ -2188,6 +2897,8 @@ gui_line_hdata_line_data_update_cb (void *data,
         value = hashtable_get (hashtable, "tags_array");
         gui_line_tags_free (line_data);
         gui_line_tags_alloc (line_data, value);
+        gui_line_ask_prefix_max_length_refresh (line_data->buffer->own_lines);
+        gui_line_ask_prefix_max_length_refresh (line_data->buffer->mixed_lines);
         rc++;
     }
 
@@ -2197,7 +2908,8 @@ gui_line_hdata_line_data_update_cb (void *data,
         hdata_set (hdata, pointer, "prefix", value);
         line_data->prefix_length = (line_data->prefix) ?
             gui_chat_strlen_screen (line_data->prefix) : 0;
-        line_data->buffer->lines->prefix_max_length_refresh = 1;
+        gui_line_ask_prefix_max_length_refresh (line_data->buffer->own_lines);
+        gui_line_ask_prefix_max_length_refresh (line_data->buffer->mixed_lines);
         rc++;
         update_coords = 1;
     }
@@ -2205,13 +2917,15 @@ gui_line_hdata_line_data_update_cb (void *data,
     if (hashtable_has_key (hashtable, "message"))
     {
         value = hashtable_get (hashtable, "message");
-        hdata_set (hdata, pointer, "message", value);
+        gui_line_free_string (line_data, line_data->message);
+        line_data->message = (value) ? strdup (value) : NULL;
         rc++;
         update_coords = 1;
     }
 
     if (rc > 0)
     {
+        gui_line_reset_height (line_data);
         if (update_coords)
         {
             for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
@@ -2363,5 +3077,7 @@ gui_lines_print_log (struct t_gui_lines *lines)
         log_printf ("    buffer_max_length_refresh: %d",    lines->buffer_max_length_refresh);
         log_printf ("    prefix_max_length. . . . : %d",    lines->prefix_max_length);
         log_printf ("    prefix_max_length_refresh: %d",    lines->prefix_max_length_refresh);
+        log_printf ("    prefix_length_count. . . : 0x%lx", lines->prefix_length_count);
+        log_printf ("    prefix_length_count_size : %d",    lines->prefix_length_count_size);
     }
 }
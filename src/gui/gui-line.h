@@ -25,8 +25,66 @@
 
 struct t_infolist;
 
+/*
+ * lower case tags of a line: each one is a shared string, so it can be
+ * compared by pointer with a tag mask compiled by gui_line_tags_mask_compile
+ * (NULL if the tag has non-ASCII chars: then string_match is used);
+ * if all tags are already in lower case, this is the tags array itself,
+ * otherwise they are stored in the same array as tags, after the NULL
+ * pointer ending the tags
+ */
+#define GUI_LINE_TAGS_LOWER(__line_data)                                \
+    ((const char **)(((__line_data)->tags_lower) ?                      \
+                     (__line_data)->tags_array                          \
+                     + (__line_data)->tags_count + 1 :                  \
+                     (__line_data)->tags_array))
+
+enum t_gui_line_tag_mask_type
+{
+    GUI_LINE_TAG_MASK_ANY = 0,         /* "*": any tag                      */
+    GUI_LINE_TAG_MASK_EXACT,           /* exact tag (case insensitive)      */
+    GUI_LINE_TAG_MASK_PREFIX,          /* prefix: "nick_*", "irc_*", ...    */
+    GUI_LINE_TAG_MASK_MASK,            /* any other mask (string_match)     */
+    /* number of tag mask types */
+    GUI_LINE_NUM_TAG_MASK_TYPES,
+};
+
+/*
+ * number of heights on screen cached in each line (one per window layout,
+ * so that windows displaying the same buffer with different layouts do not
+ * replace the height computed by each other)
+ */
+#define GUI_LINE_HEIGHT_CACHE_SIZE 2
+
+/* arena chunks: first one is small, next ones are bigger (up to max size) */
+#define GUI_LINE_ARENA_MIN_SIZE 4096
+#define GUI_LINE_ARENA_MAX_SIZE (64 * 1024)
+
 /* line structures */
 
+struct t_gui_line_arena
+{
+    int size;                          /* size of data (bytes)              */
+    int used;                          /* bytes used in data                */
+    int refcount;                      /* number of lines using the chunk,  */
+                                       /* + 1 if it is current chunk of a   */
+                                       /* buffer                            */
+    char *data;                        /* data (lines and their strings)    */
+};
+
+struct t_gui_line_tag_mask
+{
+    int type;                          /* type of mask (see enum above)     */
+    int negated;                       /* 1 if tag is negated ("!tag")      */
+    int last;                          /* 1 if last tag of a combination    */
+                                       /* of tags (tag1+tag2+...)           */
+    int length;                        /* length of tag (type "prefix")     */
+    char *tag;                         /* tag in lower case, shared string  */
+                                       /* (types "exact" and "prefix")      */
+    char *mask;                        /* mask without "!" (shared string), */
+                                       /* NULL for the end of array         */
+};
+
 struct t_gui_line_data
 {
     struct t_gui_buffer *buffer;       /* pointer to buffer                 */
@@ -39,13 +97,25 @@ struct t_gui_line_data
     char *str_time;                    /* time string (for display)         */
     int tags_count;                    /* number of tags for line           */
     char **tags_array;                 /* tags for line                     */
+    char tags_lower;                   /* 1 if lower case tags are stored   */
+                                       /* after tags (see GUI_LINE_TAGS_...)*/
     char displayed;                    /* 1 if line is displayed            */
     char notify_level;                 /* notify level for the line         */
     char highlight;                    /* 1 if line has highlight           */
     char refresh_needed;               /* 1 if refresh asked (free buffer)  */
+    char height_context[GUI_LINE_HEIGHT_CACHE_SIZE]; /* context of line     */
+                                       /* when height was computed          */
+                                       /* (see gui-curses-chat.c)           */
+    int height_layout_id[GUI_LINE_HEIGHT_CACHE_SIZE]; /* layout id of       */
+                                       /* window (0 = none)                 */
+    int height[GUI_LINE_HEIGHT_CACHE_SIZE]; /* height of line on screen     */
+                                       /* (cache)                           */
     char *prefix;                      /* prefix for line (may be NULL)     */
     int prefix_length;                 /* prefix length (on screen)         */
     char *message;                     /* line content (after prefix)       */
+    struct t_gui_line_arena *arena;    /* arena chunk with line data and    */
+                                       /* strings (NULL if allocated with   */
+                                       /* malloc)                           */
 };
 
 struct t_gui_line
@@ -68,15 +138,32 @@ struct t_gui_lines
     int buffer_max_length_refresh;     /* refresh asked for buffer max len. */
     int prefix_max_length;             /* max length for prefix align       */
     int prefix_max_length_refresh;     /* refresh asked for prefix max len. */
+    int *prefix_length_count;          /* number of displayed lines by      */
+                                       /* length of prefix                  */
+    int prefix_length_count_size;      /* size of prefix_length_count       */
 };
 
+/* line variables */
+
+extern int gui_line_arena_count;
+extern long gui_line_arena_size;
+extern int gui_line_arena_lines;
+extern int gui_line_max_length_refresh_needed;
+
 /* line functions */
 
 extern struct t_gui_lines *gui_line_lines_alloc ();
 extern void gui_line_lines_free (struct t_gui_lines *lines);
+extern void *gui_line_arena_alloc (struct t_gui_buffer *buffer, int size,
+                                   struct t_gui_line_arena **arena);
+extern void gui_line_arena_unref (struct t_gui_line_arena *arena);
+extern void gui_line_free_string (struct t_gui_line_data *line_data,
+                                  char *string);
 extern void gui_line_tags_alloc (struct t_gui_line_data *line_data,
                                  const char *tags);
 extern void gui_line_tags_free (struct t_gui_line_data *line_data);
+extern int gui_line_prefix_is_same_nick (struct t_gui_line *line,
+                                         int direction);
 extern void gui_line_get_prefix_for_display (struct t_gui_line *line,
                                              char **prefix, int *length,
                                              char **color, int *prefix_is_nick);
@@ -102,14 +189,27 @@ extern int gui_line_match_regex (struct t_gui_line_data *line_data,
 extern int gui_line_has_tag_no_filter (struct t_gui_line_data *line_data);
 extern int gui_line_match_tags (struct t_gui_line_data *line_data,
                                 int tags_count, char ***tags_array);
+extern struct t_gui_line_tag_mask *gui_line_tags_mask_compile (int tags_count,
+                                                               char ***tags_array);
+extern void gui_line_tags_mask_free (struct t_gui_line_tag_mask *tags_mask);
+extern int gui_line_match_tags_mask (struct t_gui_line_data *line_data,
+                                     struct t_gui_line_tag_mask *tags_mask);
 extern const char *gui_line_search_tag_starting_with (struct t_gui_line *line,
                                                       const char *tag);
 extern const char *gui_line_get_nick_tag (struct t_gui_line *line);
 extern int gui_line_has_highlight (struct t_gui_line *line);
 extern int gui_line_has_offline_nick (struct t_gui_line *line);
+extern void gui_line_ask_buffer_max_length_refresh (struct t_gui_lines *lines);
+extern void gui_line_ask_prefix_max_length_refresh (struct t_gui_lines *lines);
 extern void gui_line_compute_buffer_max_length (struct t_gui_buffer *buffer,
                                                 struct t_gui_lines *lines);
+extern int gui_line_get_prefix_length_max (struct t_gui_line_data *line_data);
+extern void gui_line_prefix_length_count (struct t_gui_lines *lines,
+                                          int length, int count);
 extern void gui_line_compute_prefix_max_length (struct t_gui_lines *lines);
+extern void gui_line_reset_height (struct t_gui_line_data *line_data);
+extern void gui_line_set_displayed (struct t_gui_line_data *line_data,
+                                    int displayed);
 extern void gui_line_mixed_free_buffer (struct t_gui_buffer *buffer);
 extern void gui_line_mixed_free_all (struct t_gui_buffer *buffer);
 extern void gui_line_free_data (struct t_gui_line *line);
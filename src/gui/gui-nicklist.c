@@ -34,6 +34,7 @@
 #include <ctype.h>
 
 #include "../core/weechat.h"
+#include "../core/wee-arraylist.h"
 #include "../core/wee-config.h"
 #include "../core/wee-hashtable.h"
 #include "../core/wee-hdata.h"
@@ -117,6 +118,23 @@ gui_nicklist_send_hsignal (const char *signal, struct t_gui_buffer *buffer,
     (void) hook_hsignal_send (signal, gui_nicklist_hsignal);
 }
 
+/*
+ * Compares two nicks in the arraylist of nicks sorted by name.
+ */
+
+int
+gui_nicklist_nicks_sorted_cmp_cb (void *data,
+                                  struct t_arraylist *arraylist,
+                                  void *pointer1, void *pointer2)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) arraylist;
+
+    return string_strcasecmp (((struct t_gui_nick *)pointer1)->name,
+                              ((struct t_gui_nick *)pointer2)->name);
+}
+
 /*
  * Searches for position of a group (to keep nicklist sorted).
  */
@@ -280,6 +298,10 @@ gui_nicklist_add_group (struct t_gui_buffer *buffer,
     new_group->last_child = NULL;
     new_group->nicks = NULL;
     new_group->last_nick = NULL;
+    new_group->nicks_sorted = arraylist_new (
+        32, 1, 1,
+        &gui_nicklist_nicks_sorted_cmp_cb, NULL,
+        NULL, NULL);
     new_group->prev_group = NULL;
     new_group->next_group = NULL;
 
@@ -310,6 +332,9 @@ gui_nicklist_add_group (struct t_gui_buffer *buffer,
 
 /*
  * Searches for position of a nick (to keep nicklist sorted).
+ *
+ * This function is used only if the group has no arraylist of sorted nicks
+ * (memory error).
  */
 
 struct t_gui_nick *
@@ -340,10 +365,26 @@ gui_nicklist_insert_nick_sorted (struct t_gui_nick_group *group,
                                  struct t_gui_nick *nick)
 {
     struct t_gui_nick *pos_nick;
+    int index;
 
     if (group->nicks)
     {
-        pos_nick = gui_nicklist_find_pos_nick (group, nick);
+        pos_nick = NULL;
+        index = arraylist_add (group->nicks_sorted, nick);
+        if (index >= 0)
+        {
+            if (index + 1 < arraylist_size (group->nicks_sorted))
+                pos_nick = arraylist_get (group->nicks_sorted, index + 1);
+        }
+        else
+        {
+            if (group->nicks_sorted)
+            {
+                arraylist_free (group->nicks_sorted);
+                group->nicks_sorted = NULL;
+            }
+            pos_nick = gui_nicklist_find_pos_nick (group, nick);
+        }
 
         if (pos_nick)
         {
@@ -367,6 +408,7 @@ gui_nicklist_insert_nick_sorted (struct t_gui_nick_group *group,
     }
     else
     {
+        (void) arraylist_add (group->nicks_sorted, nick);
         nick->prev_nick = NULL;
         nick->next_nick = NULL;
         group->nicks = nick;
@@ -375,52 +417,288 @@ gui_nicklist_insert_nick_sorted (struct t_gui_nick_group *group,
 }
 
 /*
- * Searches for a nick in nicklist.
+ * Removes a nick from the arraylist of nicks sorted by name.
+ */
+
+void
+gui_nicklist_remove_nick_sorted (struct t_gui_nick_group *group,
+                                 struct t_gui_nick *nick)
+{
+    int index, size;
+
+    if (!group->nicks_sorted)
+        return;
+
+    if (!arraylist_search (group->nicks_sorted, nick, &index, NULL))
+        return;
+
+    /* nicks with same name (case insensitive) are consecutive */
+    size = arraylist_size (group->nicks_sorted);
+    while ((index < size)
+           && (arraylist_get (group->nicks_sorted, index) != nick))
+    {
+        index++;
+    }
+    if (index < size)
+        arraylist_remove (group->nicks_sorted, index);
+}
+
+/*
+ * Returns the key of a nick in the index of nicks.
  *
- * Returns pointer to nick found, NULL if not found.
+ * If the buffer has a callback to compare nicks, the key is returned by the
+ * callback "nickcmp_key_callback" (nicks considered equal by the callback to
+ * compare nicks must have the same key); otherwise the key is the name.
+ *
+ * Note: result must be freed after use.
  */
 
-struct t_gui_nick *
-gui_nicklist_search_nick (struct t_gui_buffer *buffer,
-                          struct t_gui_nick_group *from_group,
-                          const char *name)
+char *
+gui_nicklist_index_key (struct t_gui_buffer *buffer, const char *name)
 {
-    struct t_gui_nick *ptr_nick;
-    struct t_gui_nick_group *ptr_group;
+    if (!buffer->nickcmp_callback)
+        return strdup (name);
 
-    if (!buffer && !from_group)
+    if (!buffer->nickcmp_key_callback)
         return NULL;
 
-    if (!name)
-        return NULL;
+    return (buffer->nickcmp_key_callback) (buffer->nickcmp_callback_pointer,
+                                           buffer->nickcmp_callback_data,
+                                           buffer,
+                                           name);
+}
 
-    if (!from_group && !buffer->nicklist_root)
-        return NULL;
+/*
+ * Checks if a nick has a name (using the callback to compare nicks if it is
+ * set in buffer).
+ *
+ * Returns:
+ *   1: nick has this name
+ *   0: nick has another name
+ */
 
-    for (ptr_nick = (from_group) ? from_group->nicks : buffer->nicklist_root->nicks;
-         ptr_nick; ptr_nick = ptr_nick->next_nick)
+int
+gui_nicklist_nick_has_name (struct t_gui_buffer *buffer,
+                            struct t_gui_nick *nick, const char *name)
+{
+    if (buffer->nickcmp_callback)
     {
-        if (buffer->nickcmp_callback)
-        {
-            if ((buffer->nickcmp_callback) (buffer->nickcmp_callback_pointer,
+        return ((buffer->nickcmp_callback) (buffer->nickcmp_callback_pointer,
                                             buffer->nickcmp_callback_data,
                                             buffer,
-                                            ptr_nick->name,
-                                            name) == 0)
+                                            nick->name,
+                                            name) == 0) ? 1 : 0;
+    }
+
+    return (strcmp (nick->name, name) == 0) ? 1 : 0;
+}
+
+/*
+ * Frees the index of nicks in a buffer.
+ */
+
+void
+gui_nicklist_index_free (struct t_gui_buffer *buffer)
+{
+    if (!buffer)
+        return;
+
+    if (buffer->nicklist_index)
+    {
+        hashtable_free (buffer->nicklist_index);
+        buffer->nicklist_index = NULL;
+    }
+    buffer->nicklist_index_missing = 0;
+}
+
+/*
+ * Adds a nick in the index of nicks.
+ *
+ * If another nick has the same key, the nick is not added in index and the
+ * counter of missing nicks is incremented (a search of this nick is then
+ * done in the whole nicklist).
+ */
+
+void
+gui_nicklist_index_add (struct t_gui_buffer *buffer, struct t_gui_nick *nick)
+{
+    char *key;
+
+    if (!buffer->nicklist_index)
+        return;
+
+    key = gui_nicklist_index_key (buffer, nick->name);
+    if (!key)
+    {
+        gui_nicklist_index_free (buffer);
+        return;
+    }
+
+    if (hashtable_has_key (buffer->nicklist_index, key))
+        buffer->nicklist_index_missing++;
+    else if (!hashtable_set (buffer->nicklist_index, key, nick))
+        gui_nicklist_index_free (buffer);
+
+    free (key);
+}
+
+/*
+ * Searches for a nick which is not in index and has the given key.
+ *
+ * Returns pointer to nick found, NULL if not found.
+ */
+
+struct t_gui_nick *
+gui_nicklist_index_search_missing (struct t_gui_buffer *buffer,
+                                   const char *key,
+                                   struct t_gui_nick *nick_ignored)
+{
+    struct t_gui_nick_group *ptr_group;
+    struct t_gui_nick *ptr_nick;
+    char *ptr_key;
+    int found;
+
+    ptr_group = NULL;
+    ptr_nick = NULL;
+    gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+    while (ptr_group || ptr_nick)
+    {
+        if (ptr_nick && (ptr_nick != nick_ignored))
+        {
+            ptr_key = gui_nicklist_index_key (buffer, ptr_nick->name);
+            found = (ptr_key && (strcmp (ptr_key, key) == 0)) ? 1 : 0;
+            if (ptr_key)
+                free (ptr_key);
+            if (found)
                 return ptr_nick;
         }
-        else
+        gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+    }
+
+    return NULL;
+}
+
+/*
+ * Removes a nick from the index of nicks.
+ *
+ * If the nick was in index and that some nicks are missing in index, another
+ * nick with the same key is added in index.
+ */
+
+void
+gui_nicklist_index_remove (struct t_gui_buffer *buffer,
+                           struct t_gui_nick *nick)
+{
+    struct t_gui_nick *ptr_nick;
+    char *key;
+
+    if (!buffer->nicklist_index)
+        return;
+
+    key = gui_nicklist_index_key (buffer, nick->name);
+    if (!key)
+    {
+        gui_nicklist_index_free (buffer);
+        return;
+    }
+
+    if (hashtable_get (buffer->nicklist_index, key) == nick)
+    {
+        hashtable_remove (buffer->nicklist_index, key);
+        if (buffer->nicklist_index_missing > 0)
         {
-            if (strcmp (ptr_nick->name, name) == 0)
-                return ptr_nick;
+            ptr_nick = gui_nicklist_index_search_missing (buffer, key, nick);
+            if (ptr_nick)
+            {
+                if (hashtable_set (buffer->nicklist_index, key, ptr_nick))
+                    buffer->nicklist_index_missing--;
+                else
+                    gui_nicklist_index_free (buffer);
+            }
         }
     }
+    else if (buffer->nicklist_index_missing > 0)
+    {
+        buffer->nicklist_index_missing--;
+    }
+
+    free (key);
+}
+
+/*
+ * Rebuilds the index of nicks in a buffer (called when the callbacks to
+ * compare nicks are changed).
+ *
+ * If the buffer has a callback to compare nicks without a callback to get the
+ * key of nicks, there is no index (nicks are searched in the whole nicklist).
+ */
+
+void
+gui_nicklist_index_rebuild (struct t_gui_buffer *buffer)
+{
+    struct t_gui_nick_group *ptr_group;
+    struct t_gui_nick *ptr_nick;
+
+    if (!buffer)
+        return;
+
+    if (buffer->nickcmp_callback && !buffer->nickcmp_key_callback)
+    {
+        gui_nicklist_index_free (buffer);
+        return;
+    }
+
+    if (buffer->nicklist_index)
+    {
+        hashtable_remove_all (buffer->nicklist_index);
+    }
+    else
+    {
+        buffer->nicklist_index = hashtable_new (32,
+                                                WEECHAT_HASHTABLE_STRING,
+                                                WEECHAT_HASHTABLE_POINTER,
+                                                NULL, NULL);
+    }
+    buffer->nicklist_index_missing = 0;
+
+    ptr_group = NULL;
+    ptr_nick = NULL;
+    gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+    while (buffer->nicklist_index && (ptr_group || ptr_nick))
+    {
+        if (ptr_nick)
+            gui_nicklist_index_add (buffer, ptr_nick);
+        gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+    }
+}
+
+/*
+ * Searches for a nick in nicklist, without using the index of nicks
+ * (this function must not be called directly).
+ *
+ * Returns pointer to nick found, NULL if not found.
+ */
+
+struct t_gui_nick *
+gui_nicklist_search_nick_internal (struct t_gui_buffer *buffer,
+                                   struct t_gui_nick_group *from_group,
+                                   const char *name)
+{
+    struct t_gui_nick *ptr_nick;
+    struct t_gui_nick_group *ptr_group;
+
+    for (ptr_nick = (from_group) ? from_group->nicks : buffer->nicklist_root->nicks;
+         ptr_nick; ptr_nick = ptr_nick->next_nick)
+    {
+        if (gui_nicklist_nick_has_name (buffer, ptr_nick, name))
+            return ptr_nick;
+    }
 
     /* search nick in child groups */
     for (ptr_group = (from_group) ? from_group->children : buffer->nicklist_root->children;
          ptr_group; ptr_group = ptr_group->next_group)
     {
-        ptr_nick = gui_nicklist_search_nick (buffer, ptr_group, name);
+        ptr_nick = gui_nicklist_search_nick_internal (buffer, ptr_group, name);
         if (ptr_nick)
             return ptr_nick;
     }
@@ -429,6 +707,60 @@ gui_nicklist_search_nick (struct t_gui_buffer *buffer,
     return NULL;
 }
 
+/*
+ * Searches for a nick in nicklist.
+ *
+ * Returns pointer to nick found, NULL if not found.
+ */
+
+struct t_gui_nick *
+gui_nicklist_search_nick (struct t_gui_buffer *buffer,
+                          struct t_gui_nick_group *from_group,
+                          const char *name)
+{
+    struct t_gui_nick *ptr_nick;
+    struct t_gui_nick_group *ptr_group;
+    char *key;
+
+    if (!buffer || !name)
+        return NULL;
+
+    if (!from_group && !buffer->nicklist_root)
+        return NULL;
+
+    if (!buffer->nicklist_index)
+        return gui_nicklist_search_nick_internal (buffer, from_group, name);
+
+    key = gui_nicklist_index_key (buffer, name);
+    if (!key)
+        return gui_nicklist_search_nick_internal (buffer, from_group, name);
+    ptr_nick = hashtable_get (buffer->nicklist_index, key);
+    free (key);
+
+    if (ptr_nick && !gui_nicklist_nick_has_name (buffer, ptr_nick, name))
+    {
+        /* same key but not same nick: search in whole nicklist if needed */
+        if (buffer->nicklist_index_missing > 0)
+            return gui_nicklist_search_nick_internal (buffer, from_group, name);
+        return NULL;
+    }
+
+    /* check that nick is in "from_group" or one of its children */
+    if (ptr_nick && from_group)
+    {
+        for (ptr_group = ptr_nick->group; ptr_group;
+             ptr_group = ptr_group->parent)
+        {
+            if (ptr_group == from_group)
+                break;
+        }
+        if (!ptr_group)
+            return NULL;
+    }
+
+    return ptr_nick;
+}
+
 /*
  * Adds a nick to nicklist.
  *
@@ -459,6 +791,7 @@ gui_nicklist_add_nick (struct t_gui_buffer *buffer,
     new_nick->visible = visible;
 
     gui_nicklist_insert_nick_sorted (new_nick->group, new_nick);
+    gui_nicklist_index_add (buffer, new_nick);
 
     buffer->nicklist_count++;
     buffer->nicklist_nicks_count++;
@@ -496,7 +829,9 @@ gui_nicklist_remove_nick (struct t_gui_buffer *buffer,
     gui_nicklist_send_signal ("nicklist_nick_removing", buffer, nick_removed);
     gui_nicklist_send_hsignal ("nicklist_nick_removing", buffer, NULL, nick);
 
-    /* remove nick from list */
+    /* remove nick from index and list */
+    gui_nicklist_index_remove (buffer, nick);
+    gui_nicklist_remove_nick_sorted (nick->group, nick);
     if (nick->prev_nick)
         (nick->prev_nick)->next_nick = nick->next_nick;
     if (nick->next_nick)
@@ -589,6 +924,8 @@ gui_nicklist_remove_group (struct t_gui_buffer *buffer,
     }
 
     /* free data */
+    if (group->nicks_sorted)
+        arraylist_free (group->nicks_sorted);
     if (group->name)
         string_shared_free (group->name);
     if (group->color)
@@ -1305,6 +1642,10 @@ gui_nicklist_print_log (struct t_gui_nick_group *group, int indent)
               "%%-%dslast_nick . : 0x%%lx",
               (indent * 2) + 6);
     log_printf (format, " ", group->last_nick);
+    snprintf (format, sizeof (format),
+              "%%-%dsnicks_sorted: 0x%%lx",
+              (indent * 2) + 6);
+    log_printf (format, " ", group->nicks_sorted);
     snprintf (format, sizeof (format),
               "%%-%dsprev_group. : 0x%%lx",
               (indent * 2) + 6);
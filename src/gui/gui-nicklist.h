@@ -20,6 +20,7 @@
 #ifndef WEECHAT_GUI_NICKLIST_H
 #define WEECHAT_GUI_NICKLIST_H
 
+struct t_arraylist;
 struct t_gui_buffer;
 struct t_infolist;
 
@@ -34,6 +35,8 @@ struct t_gui_nick_group
     struct t_gui_nick_group *last_child; /* last child                      */
     struct t_gui_nick *nicks;          /* nicks for group                   */
     struct t_gui_nick *last_nick;      /* last nick for group               */
+    struct t_arraylist *nicks_sorted;  /* nicks sorted by name (to find     */
+                                       /* position of a new nick quickly)   */
     struct t_gui_nick_group *prev_group; /* link to previous group          */
     struct t_gui_nick_group *next_group; /* link to next group              */
 };
@@ -79,6 +82,8 @@ extern void gui_nicklist_get_next_item (struct t_gui_buffer *buffer,
                                         struct t_gui_nick_group **group,
                                         struct t_gui_nick **nick);
 extern const char *gui_nicklist_get_group_start (const char *name);
+extern void gui_nicklist_index_rebuild (struct t_gui_buffer *buffer);
+extern void gui_nicklist_index_free (struct t_gui_buffer *buffer);
 extern void gui_nicklist_compute_visible_count (struct t_gui_buffer *buffer,
                                                 struct t_gui_nick_group *group);
 
@@ -35,6 +35,7 @@
 
 #include "../core/weechat.h"
 #include "../core/wee-config.h"
+#include "../core/wee-hashtable.h"
 #include "../core/wee-hdata.h"
 #include "../core/wee-hook.h"
 #include "../core/wee-infolist.h"
@@ -61,6 +62,7 @@ int gui_window_refresh_needed = 0;              /* = 1 if refresh needed    */
 struct t_gui_window *gui_windows = NULL;        /* first window             */
 struct t_gui_window *last_gui_window = NULL;    /* last window              */
 struct t_gui_window *gui_current_window = NULL; /* current window           */
+struct t_hashtable *gui_windows_pointers = NULL; /* pointers of windows     */
 
 struct t_gui_window_tree *gui_windows_tree = NULL; /* windows tree          */
 
@@ -682,6 +684,7 @@ gui_window_new (struct t_gui_window *parent_window, struct t_gui_buffer *buffer,
     ptr_leaf->window = new_window;
 
     /* add window to windows queue */
+    hdata_pointers_add (&gui_windows_pointers, gui_windows, new_window);
     new_window->prev_window = last_gui_window;
     if (last_gui_window)
         last_gui_window->next_window = new_window;
@@ -906,22 +909,31 @@ gui_window_coords_init_line (struct t_gui_window *window, int line)
 /*
  * Removes a line from coordinates: each time the line is found in the array
  * "coords", it is reinitialized.
+ *
+ * Returns the number of coordinates reinitialized (0 if the line was not
+ * displayed in window).
  */
 
-void
+int
 gui_window_coords_remove_line (struct t_gui_window *window,
                                struct t_gui_line *line)
 {
-    int i;
+    int i, count;
 
     if (!window || !window->coords)
-        return;
+        return 0;
 
+    count = 0;
     for (i = 0; i < window->coords_size; i++)
     {
         if (window->coords[i].line == line)
+        {
             gui_window_coords_init_line (window, i);
+            count++;
+        }
     }
+
+    return count;
 }
 
 /*
@@ -1033,6 +1045,7 @@ gui_window_free (struct t_gui_window *window)
         gui_windows = window->next_window;
     if (last_gui_window == window)
         last_gui_window = window->prev_window;
+    hdata_pointers_remove (&gui_windows_pointers, window);
 
     if (gui_current_window == window)
         gui_current_window = gui_windows;
@@ -1863,7 +1876,8 @@ gui_window_hdata_window_cb (const void *pointer, void *data,
         HDATA_VAR(struct t_gui_window, ptr_tree, POINTER, 0, NULL, "window_tree");
         HDATA_VAR(struct t_gui_window, prev_window, POINTER, 0, NULL, hdata_name);
         HDATA_VAR(struct t_gui_window, next_window, POINTER, 0, NULL, hdata_name);
-        HDATA_LIST(gui_windows, WEECHAT_HDATA_LIST_CHECK_POINTERS);
+        HDATA_LIST_POINTERS(gui_windows, WEECHAT_HDATA_LIST_CHECK_POINTERS,
+                            gui_windows_pointers);
         HDATA_LIST(last_gui_window, 0);
         HDATA_LIST(gui_current_window, 0);
     }
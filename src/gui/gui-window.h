@@ -122,6 +122,7 @@ extern int gui_window_refresh_needed;
 extern struct t_gui_window *gui_windows;
 extern struct t_gui_window *last_gui_window;
 extern struct t_gui_window *gui_current_window;
+extern struct t_hashtable *gui_windows_pointers;
 extern struct t_gui_window_tree *gui_windows_tree;
 extern int gui_window_cursor_x;
 extern int gui_window_cursor_y;
@@ -168,7 +169,7 @@ extern void gui_window_set_layout_plugin_name (struct t_gui_window *window,
 extern void gui_window_set_layout_buffer_name (struct t_gui_window *window,
                                                const char *buffer_name);
 extern void gui_window_coords_init_line (struct t_gui_window *window, int line);
-extern void gui_window_coords_remove_line (struct t_gui_window *window,
+extern int gui_window_coords_remove_line (struct t_gui_window *window,
                                            struct t_gui_line *line);
 extern void gui_window_coords_remove_line_data (struct t_gui_window *window,
                                                 struct t_gui_line_data *line_data);
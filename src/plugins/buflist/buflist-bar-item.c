@@ -36,6 +36,22 @@ struct t_hashtable *buflist_hashtable_extra_vars = NULL;
 struct t_hashtable *buflist_hashtable_options_conditions = NULL;
 struct t_arraylist *buflist_list_buffers[BUFLIST_BAR_NUM_ITEMS] =
 { NULL, NULL, NULL };
+struct t_hashtable *buflist_hashtable_lines[BUFLIST_BAR_NUM_ITEMS] =
+{ NULL, NULL, NULL };
+unsigned long long buflist_bar_item_refresh_count[BUFLIST_BAR_NUM_ITEMS] =
+{ 0, 0, 0 };
+unsigned long long buflist_bar_item_lines_evaluated[BUFLIST_BAR_NUM_ITEMS] =
+{ 0, 0, 0 };
+unsigned long long buflist_bar_item_lines_cached[BUFLIST_BAR_NUM_ITEMS] =
+{ 0, 0, 0 };
+
+/* extra variables set by buflist, used to check if a line is still valid */
+char *buflist_bar_item_line_vars[] =
+{ "current_buffer", "number_displayed", "merged", "nick_prefix",
+  "color_nick_prefix", "format_nick_prefix", "format_buffer", "number",
+  "number2", "format_number", "indent", "name", "format_name",
+  "color_hotlist", "hotlist_priority", "hotlist_priority_number",
+  "format_hotlist", "hotlist", "format_lag", "format_tls_version", NULL };
 
 int old_line_number_current_buffer[BUFLIST_BAR_NUM_ITEMS] = { -1, -1, -1 };
 
@@ -104,16 +120,30 @@ buflist_bar_item_get_index_with_pointer (struct t_gui_bar_item *item)
 /*
  * Updates buflist bar item if buflist is enabled (or if force argument is 1).
  *
+ * If buffer is not NULL, only the line of this buffer is evaluated again
+ * (other lines are taken from cache if the variables used to build them
+ * have not changed). If buffer is NULL, all lines are evaluated again.
+ *
  * If force == 1, all used items are refreshed
  *   (according to option buflist.look.use_items).
  * If force == 2, all items are refreshed.
  */
 
 void
-buflist_bar_item_update (int force)
+buflist_bar_item_update (struct t_gui_buffer *buffer, int force)
 {
     int i, num_items;
 
+    for (i = 0; i < BUFLIST_BAR_NUM_ITEMS; i++)
+    {
+        if (!buflist_hashtable_lines[i])
+            continue;
+        if (buffer)
+            weechat_hashtable_remove (buflist_hashtable_lines[i], buffer);
+        else
+            weechat_hashtable_remove_all (buflist_hashtable_lines[i]);
+    }
+
     if (force || weechat_config_boolean (buflist_config_look_enabled))
     {
         num_items = (force == 2) ?
@@ -126,6 +156,152 @@ buflist_bar_item_update (int force)
     }
 }
 
+/*
+ * Frees a line in cache.
+ */
+
+void
+buflist_bar_item_free_line_cb (struct t_hashtable *hashtable,
+                               const void *key, void *value)
+{
+    struct t_buflist_bar_item_line *ptr_line;
+
+    /* make C compiler happy */
+    (void) hashtable;
+    (void) key;
+
+    ptr_line = (struct t_buflist_bar_item_line *)value;
+
+    if (!ptr_line)
+        return;
+
+    if (ptr_line->vars)
+        free (ptr_line->vars);
+    if (ptr_line->line)
+        free (ptr_line->line);
+
+    free (ptr_line);
+}
+
+/*
+ * Builds a string with the variables used to evaluate the line of a buffer
+ * (pointers and extra variables set by buflist).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+buflist_bar_item_build_line_vars (char **vars)
+{
+    char str_pointers[256];
+    const char *ptr_value;
+    int i;
+
+    snprintf (str_pointers, sizeof (str_pointers),
+              "%p,%p,%p,%p",
+              weechat_hashtable_get (buflist_hashtable_pointers, "bar_item"),
+              weechat_hashtable_get (buflist_hashtable_pointers, "window"),
+              weechat_hashtable_get (buflist_hashtable_pointers, "irc_server"),
+              weechat_hashtable_get (buflist_hashtable_pointers,
+                                     "irc_channel"));
+    if (!weechat_string_dyn_copy (vars, str_pointers))
+        return 0;
+
+    for (i = 0; buflist_bar_item_line_vars[i]; i++)
+    {
+        ptr_value = weechat_hashtable_get (buflist_hashtable_extra_vars,
+                                           buflist_bar_item_line_vars[i]);
+        if (!weechat_string_dyn_concat (vars, "\x01", -1)
+            || !weechat_string_dyn_concat (vars, ptr_value, -1))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Evaluates the line of a buffer: the display conditions and if the buffer is
+ * displayed, the format (pointers and extra variables must be set before
+ * calling this function).
+ *
+ * Returns pointer to new line, NULL if error.
+ */
+
+struct t_buflist_bar_item_line *
+buflist_bar_item_line_new (const char *vars, int current_buffer)
+{
+    struct t_buflist_bar_item_line *new_line;
+    char *condition;
+
+    new_line = malloc (sizeof (*new_line));
+    if (!new_line)
+        return NULL;
+
+    new_line->vars = strdup (vars);
+    new_line->displayed = 0;
+    new_line->line = NULL;
+
+    /* check condition: if false, the buffer is not displayed */
+    condition = weechat_string_eval_expression (
+        weechat_config_string (buflist_config_look_display_conditions),
+        buflist_hashtable_pointers,
+        buflist_hashtable_extra_vars,
+        buflist_hashtable_options_conditions);
+    new_line->displayed = (condition && (strcmp (condition, "1") == 0));
+    if (condition)
+        free (condition);
+
+    /* build string */
+    if (new_line->displayed)
+    {
+        new_line->line = weechat_string_eval_expression (
+            (current_buffer) ?
+            buflist_config_format_buffer_current_eval :
+            buflist_config_format_buffer_eval,
+            buflist_hashtable_pointers,
+            buflist_hashtable_extra_vars,
+            NULL);
+    }
+
+    return new_line;
+}
+
+/*
+ * Displays statistics about buflist bar items: number of refreshes and lines
+ * evaluated or taken from cache.
+ */
+
+void
+buflist_bar_item_print_stats ()
+{
+    unsigned long long total;
+    int i;
+
+    weechat_printf (NULL, "");
+    weechat_printf (NULL, _("%s bar items:"), BUFLIST_PLUGIN_NAME);
+    for (i = 0; i < BUFLIST_BAR_NUM_ITEMS; i++)
+    {
+        total = buflist_bar_item_lines_evaluated[i] +
+            buflist_bar_item_lines_cached[i];
+        weechat_printf (
+            NULL,
+            _("  %s: %llu refreshes, %llu lines evaluated, "
+              "%llu lines from cache (%llu%%), %d lines in cache"),
+            buflist_bar_item_get_name (i),
+            buflist_bar_item_refresh_count[i],
+            buflist_bar_item_lines_evaluated[i],
+            buflist_bar_item_lines_cached[i],
+            (total > 0) ? (buflist_bar_item_lines_cached[i] * 100) / total : 0,
+            (buflist_hashtable_lines[i]) ?
+            weechat_hashtable_get_integer (buflist_hashtable_lines[i],
+                                           "items_count") : 0);
+    }
+}
+
 /*
  * Checks if the bar can be scrolled, the bar must have:
  * - a position "left" or "right"
@@ -299,13 +475,14 @@ buflist_bar_item_buflist_cb (const void *pointer, void *data,
     struct t_gui_buffer *ptr_buffer_prev, *ptr_buffer_next;
     struct t_gui_nick *ptr_gui_nick;
     struct t_gui_hotlist *ptr_hotlist;
+    struct t_buflist_bar_item_line *ptr_line;
     void *ptr_server, *ptr_channel;
-    char **buflist, *str_buflist, *condition;
+    char **buflist, *str_buflist, **line_vars;
     char str_format_number[32], str_format_number_empty[32];
     char str_nick_prefix[32], str_color_nick_prefix[32];
-    char str_number[32], str_number2[32], *line, **hotlist, *str_hotlist;
+    char str_number[32], str_number2[32], **hotlist, *str_hotlist;
     char str_hotlist_count[32];
-    const char *ptr_format, *ptr_format_current, *ptr_format_indent;
+    const char *ptr_format_indent;
     const char *ptr_name, *ptr_type, *ptr_nick, *ptr_nick_prefix;
     const char *ptr_hotlist_format, *ptr_hotlist_priority;
     const char *hotlist_priority_none = "none";
@@ -315,7 +492,7 @@ buflist_bar_item_buflist_cb (const void *pointer, void *data,
     const char *ptr_lag, *ptr_item_name, *ptr_tls_version;
     int item_index, num_buffers, is_channel, is_private;
     int i, j, length_max_number, current_buffer, number, prev_number, priority;
-    int rc, count, line_number, line_number_current_buffer;
+    int count, line_number, line_number_current_buffer;
     int hotlist_priority_number;
 
     /* make C compiler happy */
@@ -331,19 +508,22 @@ buflist_bar_item_buflist_cb (const void *pointer, void *data,
     if (item_index + 1 > weechat_config_integer (buflist_config_look_use_items))
         return NULL;
 
+    buffers = NULL;
     prev_number = -1;
     line_number = 0;
     line_number_current_buffer = 0;
 
     buflist = weechat_string_dyn_alloc (256);
+    line_vars = weechat_string_dyn_alloc (256);
+    if (!buflist || !line_vars)
+        goto error;
+
+    buflist_bar_item_refresh_count[item_index]++;
 
     weechat_hashtable_set (buflist_hashtable_pointers, "bar_item", item);
     if (window)
         weechat_hashtable_set (buflist_hashtable_pointers, "window", window);
 
-    ptr_format = buflist_config_format_buffer_eval;
-    ptr_format_current = buflist_config_format_buffer_current_eval;
-
     ptr_current_buffer = weechat_current_buffer ();
 
     ptr_buffer = weechat_hdata_get_list (buflist_hdata_buffer,
@@ -610,16 +790,35 @@ buflist_bar_item_buflist_cb (const void *pointer, void *data,
             (ptr_tls_version && ptr_tls_version[0]) ?
             weechat_config_string (buflist_config_format_tls_version) : "");
 
-        /* check condition: if false, the buffer is not displayed */
-        condition = weechat_string_eval_expression (
-            weechat_config_string (buflist_config_look_display_conditions),
-            buflist_hashtable_pointers,
-            buflist_hashtable_extra_vars,
-            buflist_hashtable_options_conditions);
-        rc = (condition && (strcmp (condition, "1") == 0));
-        if (condition)
-            free (condition);
-        if (!rc)
+        /*
+         * get line from cache if the variables used to build it have not
+         * changed, otherwise evaluate the line
+         */
+        if (!buflist_bar_item_build_line_vars (line_vars))
+            goto error;
+        ptr_line = weechat_hashtable_get (buflist_hashtable_lines[item_index],
+                                          ptr_buffer);
+        if (ptr_line && ptr_line->vars
+            && (strcmp (ptr_line->vars, *line_vars) == 0))
+        {
+            buflist_bar_item_lines_cached[item_index]++;
+        }
+        else
+        {
+            ptr_line = buflist_bar_item_line_new (*line_vars, current_buffer);
+            if (!ptr_line)
+                goto error;
+            if (!weechat_hashtable_set (buflist_hashtable_lines[item_index],
+                                        ptr_buffer, ptr_line))
+            {
+                buflist_bar_item_free_line_cb (NULL, NULL, ptr_line);
+                goto error;
+            }
+            buflist_bar_item_lines_evaluated[item_index]++;
+        }
+
+        /* if false, the buffer is not displayed */
+        if (!ptr_line->displayed)
             continue;
 
         /* add buffer in list */
@@ -638,17 +837,8 @@ buflist_bar_item_buflist_cb (const void *pointer, void *data,
                 goto error;
         }
 
-        /* build string */
-        line = weechat_string_eval_expression (
-            (current_buffer) ? ptr_format_current : ptr_format,
-            buflist_hashtable_pointers,
-            buflist_hashtable_extra_vars,
-            NULL);
-
         /* concatenate string */
-        rc = weechat_string_dyn_concat (buflist, line, -1);
-        free (line);
-        if (!rc)
+        if (!weechat_string_dyn_concat (buflist, ptr_line->line, -1))
             goto error;
 
         line_number++;
@@ -659,10 +849,13 @@ buflist_bar_item_buflist_cb (const void *pointer, void *data,
     goto end;
 
 error:
-    weechat_string_dyn_free (buflist, 1);
+    if (buflist)
+        weechat_string_dyn_free (buflist, 1);
     str_buflist = NULL;
 
 end:
+    if (line_vars)
+        weechat_string_dyn_free (line_vars, 1);
     weechat_arraylist_free (buffers);
 
     if ((line_number_current_buffer != old_line_number_current_buffer[item_index])
@@ -727,6 +920,35 @@ buflist_bar_item_init ()
     weechat_hashtable_set (buflist_hashtable_options_conditions,
                            "type", "condition");
 
+    /* cache of lines (one hashtable by bar item) */
+    for (i = 0; i < BUFLIST_BAR_NUM_ITEMS; i++)
+    {
+        buflist_hashtable_lines[i] = weechat_hashtable_new (
+            128,
+            WEECHAT_HASHTABLE_POINTER,
+            WEECHAT_HASHTABLE_POINTER,
+            NULL,
+            NULL);
+        if (!buflist_hashtable_lines[i])
+        {
+            while (--i >= 0)
+            {
+                weechat_hashtable_free (buflist_hashtable_lines[i]);
+                buflist_hashtable_lines[i] = NULL;
+            }
+            weechat_hashtable_free (buflist_hashtable_pointers);
+            weechat_hashtable_free (buflist_hashtable_extra_vars);
+            weechat_hashtable_free (buflist_hashtable_options_conditions);
+            return 0;
+        }
+        weechat_hashtable_set_pointer (buflist_hashtable_lines[i],
+                                       "callback_free_value",
+                                       &buflist_bar_item_free_line_cb);
+        buflist_bar_item_refresh_count[i] = 0;
+        buflist_bar_item_lines_evaluated[i] = 0;
+        buflist_bar_item_lines_cached[i] = 0;
+    }
+
     /* bar items */
     for (i = 0; i < BUFLIST_BAR_NUM_ITEMS; i++)
     {
@@ -771,5 +993,10 @@ buflist_bar_item_end ()
             weechat_arraylist_free (buflist_list_buffers[i]);
             buflist_list_buffers[i] = NULL;
         }
+        if (buflist_hashtable_lines[i])
+        {
+            weechat_hashtable_free (buflist_hashtable_lines[i]);
+            buflist_hashtable_lines[i] = NULL;
+        }
     }
 }
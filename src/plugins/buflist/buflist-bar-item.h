@@ -25,14 +25,27 @@
 #define BUFLIST_BAR_NUM_ITEMS 3
 
 struct t_gui_bar_item;
+struct t_gui_buffer;
+
+struct t_buflist_bar_item_line
+{
+    char *vars;                        /* variables used to build the line  */
+    int displayed;                     /* 1 if buffer is displayed          */
+    char *line;                        /* evaluated line (if displayed)     */
+};
 
 extern struct t_gui_bar_item *buflist_bar_item_buflist[BUFLIST_BAR_NUM_ITEMS];
 extern struct t_arraylist *buflist_list_buffers[BUFLIST_BAR_NUM_ITEMS];
+extern struct t_hashtable *buflist_hashtable_lines[BUFLIST_BAR_NUM_ITEMS];
+extern unsigned long long buflist_bar_item_refresh_count[BUFLIST_BAR_NUM_ITEMS];
+extern unsigned long long buflist_bar_item_lines_evaluated[BUFLIST_BAR_NUM_ITEMS];
+extern unsigned long long buflist_bar_item_lines_cached[BUFLIST_BAR_NUM_ITEMS];
 
 extern const char *buflist_bar_item_get_name (int index);
 extern int buflist_bar_item_get_index (const char *item_name);
 extern int buflist_bar_item_get_index_with_pointer (struct t_gui_bar_item *item);
-extern void buflist_bar_item_update (int force);
+extern void buflist_bar_item_update (struct t_gui_buffer *buffer, int force);
+extern void buflist_bar_item_print_stats ();
 extern int buflist_bar_item_init ();
 extern void buflist_bar_item_end ();
 
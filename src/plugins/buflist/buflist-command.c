@@ -72,7 +72,13 @@ buflist_command_buflist (const void *pointer, void *data,
 
     if (weechat_strcmp (argv[1], "refresh") == 0)
     {
-        buflist_bar_item_update (0);
+        buflist_bar_item_update (NULL, 0);
+        return WEECHAT_RC_OK;
+    }
+
+    if (weechat_strcmp (argv[1], "debug") == 0)
+    {
+        buflist_bar_item_print_stats ();
         return WEECHAT_RC_OK;
     }
 
@@ -89,13 +95,15 @@ buflist_command_init ()
     weechat_hook_command (
         "buflist",
         N_("bar item with list of buffers"),
-        "enable|disable|toggle || bar || refresh",
+        "enable|disable|toggle || bar || refresh || debug",
         N_(" enable: enable buflist\n"
            "disable: disable buflist\n"
            " toggle: toggle buflist\n"
            "    bar: add the \"buflist\" bar\n"
            "refresh: force the refresh of the bar items (buflist, buflist2 "
            "and buflist3)\n"
+           "  debug: display statistics about bar items: number of refreshes "
+           "and lines evaluated or taken from cache\n"
            "\n"
            "The lines with buffers are displayed using string evaluation "
            "(see /help eval for the format), with these options:\n"
@@ -173,7 +181,12 @@ buflist_command_init ()
            "there's no lag (evaluation of option buflist.format.lag)\n"
            "    - ${format_tls_version}: indicator of TLS version for a server "
            "buffer, empty for channels (evaluation of option "
-           "buflist.format.tls_version)"),
-        "enable|disable|toggle || bar || refresh",
+           "buflist.format.tls_version)\n"
+           "\n"
+           "Lines of buffers are kept in cache and evaluated again only if "
+           "the buffer has changed (signal received for this buffer or "
+           "change in extra variables above); the command "
+           "\"/buflist refresh\" evaluates again all lines."),
+        "enable|disable|toggle || bar || refresh || debug",
         &buflist_command_buflist, NULL, NULL);
 }
@@ -76,6 +76,12 @@ char *buflist_config_format_buffer_eval = NULL;
 char *buflist_config_format_buffer_current_eval = NULL;
 char *buflist_config_format_hotlist_eval = NULL;
 
+/* signals changing only the line of the buffer received in signal data */
+char *buflist_config_signals_buffer[] =
+{ "buffer_renamed", "buffer_hidden", "buffer_unhidden",
+  "buffer_localvar_added", "buffer_localvar_changed",
+  "buffer_localvar_removed", "hotlist_changed", NULL };
+
 
 /*
  * Reloads buflist configuration file.
@@ -141,6 +147,47 @@ buflist_config_compare_signals (void *data, struct t_arraylist *arraylist,
     return strcmp ((const char *)pointer1, (const char *)pointer2);
 }
 
+/*
+ * Returns the buffer affected by a signal, if the signal changes only the
+ * line of this buffer in buflist.
+ *
+ * Returns NULL if the signal can change any line (for example buffer
+ * opened/closed/moved/switched, or any signal added by user in option
+ * buflist.look.signals_refresh).
+ */
+
+struct t_gui_buffer *
+buflist_config_signal_get_buffer (const char *signal, const char *type_data,
+                                  void *signal_data)
+{
+    unsigned long value;
+    int i, rc;
+
+    if (!signal || !type_data || !signal_data)
+        return NULL;
+
+    if (strcmp (type_data, WEECHAT_HOOK_SIGNAL_POINTER) == 0)
+    {
+        for (i = 0; buflist_config_signals_buffer[i]; i++)
+        {
+            if (strcmp (signal, buflist_config_signals_buffer[i]) == 0)
+                return (struct t_gui_buffer *)signal_data;
+        }
+        return NULL;
+    }
+
+    /* nicklist signals: "0x123abc,nick" */
+    if ((strcmp (type_data, WEECHAT_HOOK_SIGNAL_STRING) == 0)
+        && (strncmp (signal, "nicklist_nick_", 14) == 0))
+    {
+        rc = sscanf ((const char *)signal_data, "0x%lx,", &value);
+        if ((rc != EOF) && (rc >= 1))
+            return (struct t_gui_buffer *)value;
+    }
+
+    return NULL;
+}
+
 /*
  * Callback for a signal on a buffer.
  */
@@ -153,11 +200,10 @@ buflist_config_signal_buffer_cb (const void *pointer, void *data,
     /* make C compiler happy */
     (void) pointer;
     (void) data;
-    (void) signal;
-    (void) type_data;
-    (void) signal_data;
 
-    buflist_bar_item_update (0);
+    buflist_bar_item_update (
+        buflist_config_signal_get_buffer (signal, type_data, signal_data),
+        0);
 
     return WEECHAT_RC_OK;
 }
@@ -259,13 +305,13 @@ buflist_config_change_enabled (const void *pointer, void *data,
         /* buflist enabled */
         buflist_config_hook_signals_refresh ();
         weechat_command (NULL, "/mute /bar show buflist");
-        buflist_bar_item_update (0);
+        buflist_bar_item_update (NULL, 0);
     }
     else
     {
         /* buflist disabled */
         weechat_command (NULL, "/mute /bar hide buflist");
-        buflist_bar_item_update (1);
+        buflist_bar_item_update (NULL, 1);
     }
 }
 
@@ -332,7 +378,7 @@ buflist_config_change_sort (const void *pointer, void *data,
 
     weechat_hashtable_free (hashtable_pointers);
 
-    buflist_bar_item_update (0);
+    buflist_bar_item_update (NULL, 0);
 }
 
 /*
@@ -366,7 +412,7 @@ buflist_config_change_nick_prefix (const void *pointer, void *data,
     (void) option;
 
     buflist_config_change_signals_refresh (NULL, NULL, NULL);
-    buflist_bar_item_update (0);
+    buflist_bar_item_update (NULL, 0);
 }
 
 /*
@@ -382,7 +428,7 @@ buflist_config_change_use_items (const void *pointer, void *data,
     (void) data;
     (void) option;
 
-    buflist_bar_item_update (2);
+    buflist_bar_item_update (NULL, 2);
 }
 
 /*
@@ -398,7 +444,7 @@ buflist_config_change_buflist (const void *pointer, void *data,
     (void) data;
     (void) option;
 
-    buflist_bar_item_update (0);
+    buflist_bar_item_update (NULL, 0);
 }
 
 /*
@@ -459,7 +505,7 @@ buflist_config_change_format (const void *pointer, void *data,
     buflist_config_format_hotlist_eval = buflist_config_add_eval_for_formats (
         weechat_config_string (buflist_config_format_hotlist));
 
-    buflist_bar_item_update (0);
+    buflist_bar_item_update (NULL, 0);
 }
 
 /*
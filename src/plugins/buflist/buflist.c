@@ -461,7 +461,7 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 
     buflist_add_bar ();
 
-    buflist_bar_item_update (0);
+    buflist_bar_item_update (NULL, 0);
 
     buflist_mouse_init ();
 
@@ -284,6 +284,32 @@ irc_buffer_nickcmp_cb (const void *pointer, void *data,
     }
 }
 
+/*
+ * Callback for getting the key of a nick in index of nicks of nicklist (nicks
+ * equal with callback irc_buffer_nickcmp_cb have the same key).
+ * The "casemapping" of server is used to convert nick to lower case.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_buffer_nickcmp_key_cb (const void *pointer, void *data,
+                           struct t_gui_buffer *buffer,
+                           const char *nick)
+{
+    struct t_irc_server *server;
+
+    /* make C compiler happy */
+    (void) data;
+
+    if (pointer)
+        server = (struct t_irc_server *)pointer;
+    else
+        irc_buffer_get_server_and_channel (buffer, &server, NULL);
+
+    return irc_server_string_tolower (server, nick);
+}
+
 /*
  * Searches for the server buffer with the lowest number.
  *
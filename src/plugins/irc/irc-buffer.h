@@ -52,6 +52,9 @@ extern int irc_buffer_close_cb (const void *pointer, void *data,
 extern int irc_buffer_nickcmp_cb (const void *pointer, void *data,
                                   struct t_gui_buffer *buffer,
                                   const char *nick1, const char *nick2);
+extern char *irc_buffer_nickcmp_key_cb (const void *pointer, void *data,
+                                        struct t_gui_buffer *buffer,
+                                        const char *nick);
 extern struct t_gui_buffer *irc_buffer_search_server_lowest_number ();
 extern struct t_gui_buffer *irc_buffer_search_private_lowest_number (struct t_irc_server *server);
 
@@ -378,6 +378,8 @@ irc_channel_create_buffer (struct t_irc_server *server,
                                         &irc_buffer_nickcmp_cb);
             weechat_buffer_set_pointer (ptr_buffer, "nickcmp_callback_pointer",
                                         server);
+            weechat_buffer_set_pointer (ptr_buffer, "nickcmp_key_callback",
+                                        &irc_buffer_nickcmp_key_cb);
         }
 
         /* set highlights settings on channel buffer */
@@ -503,6 +505,11 @@ irc_channel_new (struct t_irc_server *server, int channel_type,
     new_channel->nicks_count = 0;
     new_channel->nicks = NULL;
     new_channel->last_nick = NULL;
+    new_channel->nicks_index = weechat_hashtable_new (
+        32,
+        WEECHAT_HASHTABLE_STRING,
+        WEECHAT_HASHTABLE_POINTER,
+        NULL, NULL);
     new_channel->nicks_speaking[0] = NULL;
     new_channel->nicks_speaking[1] = NULL;
     new_channel->nicks_speaking_time = NULL;
@@ -1548,6 +1555,8 @@ irc_channel_free (struct t_irc_server *server, struct t_irc_channel *channel)
     /* free linked lists */
     irc_nick_free_all (server, channel);
     irc_modelist_free_all (channel);
+    if (channel->nicks_index)
+        weechat_hashtable_free (channel->nicks_index);
 
     /* free channel data */
     if (channel->name)
@@ -1630,6 +1639,7 @@ irc_channel_hdata_channel_cb (const void *pointer, void *data,
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_count, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks, POINTER, 0, NULL, "irc_nick");
         WEECHAT_HDATA_VAR(struct t_irc_channel, last_nick, POINTER, 0, NULL, "irc_nick");
+        WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_index, HASHTABLE, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_speaking, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_channel, nicks_speaking_time, POINTER, 0, NULL, "irc_channel_speaking");
         WEECHAT_HDATA_VAR(struct t_irc_channel, last_nick_speaking_time, POINTER, 0, NULL, "irc_channel_speaking");
@@ -1818,6 +1828,7 @@ irc_channel_print_log (struct t_irc_channel *channel)
     weechat_log_printf ("       nicks_count. . . . . . . : %d",    channel->nicks_count);
     weechat_log_printf ("       nicks. . . . . . . . . . : 0x%lx", channel->nicks);
     weechat_log_printf ("       last_nick. . . . . . . . : 0x%lx", channel->last_nick);
+    weechat_log_printf ("       nicks_index. . . . . . . : 0x%lx", channel->nicks_index);
     weechat_log_printf ("       nicks_speaking[0]. . . . : 0x%lx", channel->nicks_speaking[0]);
     weechat_log_printf ("       nicks_speaking[1]. . . . : 0x%lx", channel->nicks_speaking[1]);
     weechat_log_printf ("       nicks_speaking_time. . . : 0x%lx", channel->nicks_speaking_time);
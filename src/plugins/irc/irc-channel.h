@@ -74,6 +74,8 @@ struct t_irc_channel
     int nicks_count;                   /* # nicks on channel (0 if pv)      */
     struct t_irc_nick *nicks;          /* nicks on the channel              */
     struct t_irc_nick *last_nick;      /* last nick on the channel          */
+    struct t_hashtable *nicks_index;   /* nicks by name (lower case with    */
+                                       /* casemapping of server)            */
     struct t_weelist *nicks_speaking[2]; /* for smart completion: first     */
                                        /* list is nick speaking, second is  */
                                        /* speaking to me (highlight)        */
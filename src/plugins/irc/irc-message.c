@@ -30,6 +30,7 @@
 #include "irc-color.h"
 #include "irc-config.h"
 #include "irc-ignore.h"
+#include "irc-message.h"
 #include "irc-server.h"
 #include "irc-tag.h"
 
@@ -131,82 +132,53 @@ irc_message_parse_params (const char *parameters,
 }
 
 /*
- * Parses an IRC message and returns:
- *   - tags (string)
- *   - message without tags (string)
- *   - nick (string)
- *   - host (string)
- *   - command (string)
- *   - channel (string)
- *   - arguments (string)
- *   - text (string)
- *   - params (array of strings)
- *   - num_params (integer)
- *   - pos_command (integer: command index in message)
- *   - pos_arguments (integer: arguments index in message)
- *   - pos_channel (integer: channel index in message)
- *   - pos_text (integer: text index in message)
+ * Parses an IRC message without any memory allocation: the position (index
+ * in message) and length of each part of the message are stored in "parsed"
+ * (position is -1 if the part is not found in message).
+ *
+ * The arguments and text are not stored with a length because they always
+ * end at the end of message.
  *
  * Example:
  *   @time=2015-06-27T16:40:35.000Z :nick!user@host PRIVMSG #weechat :Hello world!
  *
  * Result:
- *               tags: "time=2015-06-27T16:40:35.000Z"
- *   msg_without_tags: ":nick!user@host PRIVMSG #weechat :Hello world!"
- *               nick: "nick"
- *               user: "user"
- *               host: "nick!user@host"
- *            command: "PRIVMSG"
- *            channel: "#weechat"
- *          arguments: "#weechat :Hello world!"
- *               text: "Hello world!"
- *        pos_command: 47
- *      pos_arguments: 55
- *        pos_channel: 55
- *           pos_text: 65
+ *                    pos_tags: 1 (length: 29)
+ *   pos_message_without_tags: 31
+ *                    pos_nick: 32 (length: 4)
+ *                    pos_user: 37 (length: 4)
+ *                    pos_host: 32 (length: 14)
+ *                 pos_command: 47 (length: 7)
+ *               pos_arguments: 55
+ *                 pos_channel: 55 (length: 8)
+ *                    pos_text: 65
  */
 
 void
-irc_message_parse (struct t_irc_server *server, const char *message,
-                   char **tags, char **message_without_tags, char **nick,
-                   char **user, char **host, char **command, char **channel,
-                   char **arguments, char **text,
-                   char ***params, int *num_params,
-                   int *pos_command, int *pos_arguments, int *pos_channel,
-                   int *pos_text)
+irc_message_parse_pos (struct t_irc_server *server, const char *message,
+                       struct t_irc_message_parsed *parsed)
 {
     const char *ptr_message, *pos, *pos2, *pos3, *pos4;
 
-    if (tags)
-        *tags = NULL;
-    if (message_without_tags)
-        *message_without_tags = NULL;
-    if (nick)
-        *nick = NULL;
-    if (user)
-        *user = NULL;
-    if (host)
-        *host = NULL;
-    if (command)
-        *command = NULL;
-    if (channel)
-        *channel = NULL;
-    if (arguments)
-        *arguments = NULL;
-    if (text)
-        *text = NULL;
-    if (params)
-        *params = NULL;
-    if (num_params)
-        *num_params = 0;
-    if (pos_command)
-        *pos_command = -1;
-    if (pos_arguments)
-        *pos_arguments = -1;
-    if (pos_channel)
-        *pos_channel = -1;
-    if (pos_text)
-        *pos_text = -1;
+    if (!parsed)
+        return;
+
+    parsed->message = message;
+    parsed->pos_tags = -1;
+    parsed->length_tags = 0;
+    parsed->pos_message_without_tags = -1;
+    parsed->pos_nick = -1;
+    parsed->length_nick = 0;
+    parsed->pos_user = -1;
+    parsed->length_user = 0;
+    parsed->pos_host = -1;
+    parsed->length_host = 0;
+    parsed->pos_command = -1;
+    parsed->length_command = 0;
+    parsed->pos_arguments = -1;
+    parsed->pos_channel = -1;
+    parsed->length_channel = 0;
+    parsed->pos_text = -1;
 
     if (!message)
         return;
@@ -229,11 +201,8 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         pos = strchr (ptr_message, ' ');
         if (pos)
         {
-            if (tags)
-            {
-                *tags = weechat_strndup (ptr_message + 1,
-                                         pos - (ptr_message + 1));
-            }
+            parsed->pos_tags = 1;
+            parsed->length_tags = pos - (ptr_message + 1);
             ptr_message = pos + 1;
             while (ptr_message[0] == ' ')
             {
@@ -242,8 +211,7 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         }
     }
 
-    if (message_without_tags)
-        *message_without_tags = strdup (ptr_message);
+    parsed->pos_message_without_tags = ptr_message - message;
 
     /* now we have: ptr_message --> ":nick!user@host PRIVMSG #weechat :Hello world!" */
     if (ptr_message[0] == ':')
@@ -257,23 +225,23 @@ irc_message_parse (struct t_irc_server *server, const char *message,
             pos2 = pos3;
         if (pos2 && pos3 && (pos3 > pos2))
         {
-            if (user)
-                *user = weechat_strndup (pos2 + 1, pos3 - pos2 - 1);
+            parsed->pos_user = pos2 + 1 - message;
+            parsed->length_user = pos3 - pos2 - 1;
         }
         if (pos2 && (!pos || pos > pos2))
         {
-            if (nick)
-                *nick = weechat_strndup (ptr_message + 1, pos2 - (ptr_message + 1));
+            parsed->pos_nick = ptr_message + 1 - message;
+            parsed->length_nick = pos2 - (ptr_message + 1);
         }
         else if (pos)
         {
-            if (nick)
-                *nick = weechat_strndup (ptr_message + 1, pos - (ptr_message + 1));
+            parsed->pos_nick = ptr_message + 1 - message;
+            parsed->length_nick = pos - (ptr_message + 1);
         }
+        parsed->pos_host = ptr_message + 1 - message;
         if (pos)
         {
-            if (host)
-                *host = weechat_strndup (ptr_message + 1, pos - (ptr_message + 1));
+            parsed->length_host = pos - (ptr_message + 1);
             ptr_message = pos + 1;
             while (ptr_message[0] == ' ')
             {
@@ -282,153 +250,224 @@ irc_message_parse (struct t_irc_server *server, const char *message,
         }
         else
         {
-            if (host)
-                *host = strdup (ptr_message + 1);
+            parsed->length_host = strlen (ptr_message + 1);
             ptr_message += strlen (ptr_message);
         }
     }
 
     /* now we have: ptr_message --> "PRIVMSG #weechat :Hello world!" */
-    if (ptr_message[0])
+    if (!ptr_message[0])
+        return;
+
+    parsed->pos_command = ptr_message - message;
+    pos = strchr (ptr_message, ' ');
+    if (!pos)
     {
-        pos = strchr (ptr_message, ' ');
-        if (pos)
+        parsed->length_command = strlen (ptr_message);
+        return;
+    }
+
+    parsed->length_command = pos - ptr_message;
+    pos++;
+    while (pos[0] == ' ')
+    {
+        pos++;
+    }
+    /* now we have: pos --> "#weechat :Hello world!" */
+    parsed->pos_arguments = pos - message;
+    if ((pos[0] == ':')
+        && ((strncmp (ptr_message, "JOIN ", 5) == 0)
+            || (strncmp (ptr_message, "PART ", 5) == 0)))
+    {
+        pos++;
+    }
+    if (pos[0] == ':')
+    {
+        parsed->pos_text = pos - message + 1;
+    }
+    else if (irc_channel_is_channel (server, pos))
+    {
+        pos2 = strchr (pos, ' ');
+        parsed->pos_channel = pos - message;
+        parsed->length_channel = (pos2) ? pos2 - pos : (int)strlen (pos);
+        if (pos2)
         {
-            if (command)
-                *command = weechat_strndup (ptr_message, pos - ptr_message);
-            if (pos_command)
-                *pos_command = ptr_message - message;
-            pos++;
-            while (pos[0] == ' ')
+            while (pos2[0] == ' ')
             {
-                pos++;
+                pos2++;
             }
-            /* now we have: pos --> "#weechat :Hello world!" */
-            if (arguments)
-                *arguments = strdup (pos);
-            if (pos_arguments)
-                *pos_arguments = pos - message;
-            irc_message_parse_params (pos, params, num_params);
-            if ((pos[0] == ':')
-                && ((strncmp (ptr_message, "JOIN ", 5) == 0)
-                    || (strncmp (ptr_message, "PART ", 5) == 0)))
+            if (pos2[0] == ':')
+                pos2++;
+            parsed->pos_text = pos2 - message;
+        }
+    }
+    else
+    {
+        pos2 = strchr (pos, ' ');
+        if (parsed->pos_nick < 0)
+        {
+            parsed->pos_nick = pos - message;
+            parsed->length_nick = (pos2) ? pos2 - pos : (int)strlen (pos);
+        }
+        if (pos2)
+        {
+            pos3 = pos2;
+            pos2++;
+            while (pos2[0] == ' ')
             {
-                pos++;
+                pos2++;
             }
-            if (pos[0] == ':')
+            if (irc_channel_is_channel (server, pos2))
             {
-                if (text)
-                    *text = strdup (pos + 1);
-                if (pos_text)
-                    *pos_text = pos - message + 1;
+                pos4 = strchr (pos2, ' ');
+                parsed->pos_channel = pos2 - message;
+                parsed->length_channel = (pos4) ?
+                    pos4 - pos2 : (int)strlen (pos2);
             }
             else
             {
-                if (irc_channel_is_channel (server, pos))
-                {
-                    pos2 = strchr (pos, ' ');
-                    if (channel)
-                    {
-                        if (pos2)
-                            *channel = weechat_strndup (pos, pos2 - pos);
-                        else
-                            *channel = strdup (pos);
-                    }
-                    if (pos_channel)
-                        *pos_channel = pos - message;
-                    if (pos2)
-                    {
-                        while (pos2[0] == ' ')
-                        {
-                            pos2++;
-                        }
-                        if (pos2[0] == ':')
-                            pos2++;
-                        if (text)
-                            *text = strdup (pos2);
-                        if (pos_text)
-                            *pos_text = pos2 - message;
-                    }
-                }
-                else
+                parsed->pos_channel = pos - message;
+                parsed->length_channel = pos3 - pos;
+                pos4 = strchr (pos3, ' ');
+            }
+            if (pos4)
+            {
+                while (pos4[0] == ' ')
                 {
-                    pos2 = strchr (pos, ' ');
-                    if (nick && !*nick)
-                    {
-                        if (pos2)
-                            *nick = weechat_strndup (pos, pos2 - pos);
-                        else
-                            *nick = strdup (pos);
-                    }
-                    if (pos2)
-                    {
-                        pos3 = pos2;
-                        pos2++;
-                        while (pos2[0] == ' ')
-                        {
-                            pos2++;
-                        }
-                        if (irc_channel_is_channel (server, pos2))
-                        {
-                            pos4 = strchr (pos2, ' ');
-                            if (channel)
-                            {
-                                if (pos4)
-                                    *channel = weechat_strndup (pos2, pos4 - pos2);
-                                else
-                                    *channel = strdup (pos2);
-                            }
-                            if (pos_channel)
-                                *pos_channel = pos2 - message;
-                            if (pos4)
-                            {
-                                while (pos4[0] == ' ')
-                                {
-                                    pos4++;
-                                }
-                                if (pos4[0] == ':')
-                                    pos4++;
-                                if (text)
-                                    *text = strdup (pos4);
-                                if (pos_text)
-                                    *pos_text = pos4 - message;
-                            }
-                        }
-                        else
-                        {
-                            if (channel)
-                                *channel = weechat_strndup (pos, pos3 - pos);
-                            if (pos_channel)
-                                *pos_channel = pos - message;
-                            pos4 = strchr (pos3, ' ');
-                            if (pos4)
-                            {
-                                while (pos4[0] == ' ')
-                                {
-                                    pos4++;
-                                }
-                                if (pos4[0] == ':')
-                                    pos4++;
-                                if (text)
-                                    *text = strdup (pos4);
-                                if (pos_text)
-                                    *pos_text = pos4 - message;
-                            }
-                        }
-                    }
+                    pos4++;
                 }
+                if (pos4[0] == ':')
+                    pos4++;
+                parsed->pos_text = pos4 - message;
             }
         }
-        else
-        {
-            if (command)
-                *command = strdup (ptr_message);
-            if (pos_command)
-                *pos_command = ptr_message - message;
-        }
     }
 }
 
+/*
+ * Parses an IRC message and returns:
+ *   - tags (string)
+ *   - message without tags (string)
+ *   - nick (string)
+ *   - host (string)
+ *   - command (string)
+ *   - channel (string)
+ *   - arguments (string)
+ *   - text (string)
+ *   - params (array of strings)
+ *   - num_params (integer)
+ *   - pos_command (integer: command index in message)
+ *   - pos_arguments (integer: arguments index in message)
+ *   - pos_channel (integer: channel index in message)
+ *   - pos_text (integer: text index in message)
+ *
+ * Example:
+ *   @time=2015-06-27T16:40:35.000Z :nick!user@host PRIVMSG #weechat :Hello world!
+ *
+ * Result:
+ *               tags: "time=2015-06-27T16:40:35.000Z"
+ *   msg_without_tags: ":nick!user@host PRIVMSG #weechat :Hello world!"
+ *               nick: "nick"
+ *               user: "user"
+ *               host: "nick!user@host"
+ *            command: "PRIVMSG"
+ *            channel: "#weechat"
+ *          arguments: "#weechat :Hello world!"
+ *               text: "Hello world!"
+ *        pos_command: 47
+ *      pos_arguments: 55
+ *        pos_channel: 55
+ *           pos_text: 65
+ *
+ * Note: the strings returned must be freed after use.
+ */
+
+void
+irc_message_parse (struct t_irc_server *server, const char *message,
+                   char **tags, char **message_without_tags, char **nick,
+                   char **user, char **host, char **command, char **channel,
+                   char **arguments, char **text,
+                   char ***params, int *num_params,
+                   int *pos_command, int *pos_arguments, int *pos_channel,
+                   int *pos_text)
+{
+    struct t_irc_message_parsed parsed;
+
+    irc_message_parse_pos (server, message, &parsed);
+
+    if (tags)
+    {
+        *tags = (parsed.pos_tags >= 0) ?
+            weechat_strndup (message + parsed.pos_tags,
+                             parsed.length_tags) : NULL;
+    }
+    if (message_without_tags)
+    {
+        *message_without_tags = (parsed.pos_message_without_tags >= 0) ?
+            strdup (message + parsed.pos_message_without_tags) : NULL;
+    }
+    if (nick)
+    {
+        *nick = (parsed.pos_nick >= 0) ?
+            weechat_strndup (message + parsed.pos_nick,
+                             parsed.length_nick) : NULL;
+    }
+    if (user)
+    {
+        *user = (parsed.pos_user >= 0) ?
+            weechat_strndup (message + parsed.pos_user,
+                             parsed.length_user) : NULL;
+    }
+    if (host)
+    {
+        *host = (parsed.pos_host >= 0) ?
+            weechat_strndup (message + parsed.pos_host,
+                             parsed.length_host) : NULL;
+    }
+    if (command)
+    {
+        *command = (parsed.pos_command >= 0) ?
+            weechat_strndup (message + parsed.pos_command,
+                             parsed.length_command) : NULL;
+    }
+    if (channel)
+    {
+        *channel = (parsed.pos_channel >= 0) ?
+            weechat_strndup (message + parsed.pos_channel,
+                             parsed.length_channel) : NULL;
+    }
+    if (arguments)
+    {
+        *arguments = (parsed.pos_arguments >= 0) ?
+            strdup (message + parsed.pos_arguments) : NULL;
+    }
+    if (text)
+    {
+        *text = (parsed.pos_text >= 0) ?
+            strdup (message + parsed.pos_text) : NULL;
+    }
+    if (parsed.pos_arguments >= 0)
+    {
+        irc_message_parse_params (message + parsed.pos_arguments,
+                                  params, num_params);
+    }
+    else
+    {
+        if (params)
+            *params = NULL;
+        if (num_params)
+            *num_params = 0;
+    }
+    if (pos_command)
+        *pos_command = parsed.pos_command;
+    if (pos_arguments)
+        *pos_arguments = parsed.pos_arguments;
+    if (pos_channel)
+        *pos_channel = parsed.pos_channel;
+    if (pos_text)
+        *pos_text = parsed.pos_text;
+}
+
 /*
  * Parses an IRC message and returns hashtable with keys:
  *   - tags
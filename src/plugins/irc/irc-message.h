@@ -23,8 +23,33 @@
 struct t_irc_server;
 struct t_irc_channel;
 
+/* IRC message parsed (positions and lengths of parts in message) */
+
+struct t_irc_message_parsed
+{
+    const char *message;               /* message parsed (not copied)       */
+    int pos_tags;                      /* tags (without "@")                */
+    int length_tags;
+    int pos_message_without_tags;      /* message without tags              */
+    int pos_nick;                      /* nick                              */
+    int length_nick;
+    int pos_user;                      /* user                              */
+    int length_user;
+    int pos_host;                      /* host (nick!user@host)             */
+    int length_host;
+    int pos_command;                   /* command                           */
+    int length_command;
+    int pos_arguments;                 /* arguments (until end of message)  */
+    int pos_channel;                   /* channel                           */
+    int length_channel;
+    int pos_text;                      /* text (until end of message)       */
+};
+
 extern void irc_message_parse_params (const char *parameters,
                                       char ***params, int *num_params);
+extern void irc_message_parse_pos (struct t_irc_server *server,
+                                   const char *message,
+                                   struct t_irc_message_parsed *parsed);
 extern void irc_message_parse (struct t_irc_server *server, const char *message,
                                char **tags, char **message_without_tags,
                                char **nick, char **user, char **host,
@@ -28,6 +28,7 @@
 #include "../weechat-plugin.h"
 #include "irc.h"
 #include "irc-nick.h"
+#include "irc-buffer.h"
 #include "irc-color.h"
 #include "irc-config.h"
 #include "irc-mode.h"
@@ -521,6 +522,85 @@ irc_nick_nicklist_set_color_all ()
     }
 }
 
+/*
+ * Adds a nick in index of nicks of channel.
+ */
+
+void
+irc_nick_index_add (struct t_irc_server *server, struct t_irc_channel *channel,
+                    struct t_irc_nick *nick)
+{
+    char *name;
+
+    if (!channel->nicks_index)
+        return;
+
+    name = irc_server_string_tolower (server, nick->name);
+    if (name)
+    {
+        weechat_hashtable_set (channel->nicks_index, name, nick);
+        free (name);
+    }
+}
+
+/*
+ * Removes a nick from index of nicks of channel.
+ */
+
+void
+irc_nick_index_remove (struct t_irc_server *server,
+                       struct t_irc_channel *channel,
+                       struct t_irc_nick *nick)
+{
+    char *name;
+
+    if (!channel->nicks_index)
+        return;
+
+    name = irc_server_string_tolower (server, nick->name);
+    if (name)
+    {
+        /* the key may have been taken by another nick with same name */
+        if (weechat_hashtable_get (channel->nicks_index, name) == nick)
+            weechat_hashtable_remove (channel->nicks_index, name);
+        free (name);
+    }
+}
+
+/*
+ * Rebuilds index of nicks of all channels of a server and index of nicks in
+ * nicklist of channel buffers (called when the casemapping of server is
+ * changed).
+ */
+
+void
+irc_nick_index_rebuild (struct t_irc_server *server)
+{
+    struct t_irc_channel *ptr_channel;
+    struct t_irc_nick *ptr_nick;
+
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        /* set callback again so that nicklist index is rebuilt */
+        if (ptr_channel->buffer
+            && (ptr_channel->type == IRC_CHANNEL_TYPE_CHANNEL))
+        {
+            weechat_buffer_set_pointer (ptr_channel->buffer,
+                                        "nickcmp_key_callback",
+                                        &irc_buffer_nickcmp_key_cb);
+        }
+        if (!ptr_channel->nicks_index)
+            continue;
+        weechat_hashtable_remove_all (ptr_channel->nicks_index);
+        for (ptr_nick = ptr_channel->nicks; ptr_nick;
+             ptr_nick = ptr_nick->next_nick)
+        {
+            irc_nick_index_add (server, ptr_channel, ptr_nick);
+        }
+    }
+}
+
 /*
  * Adds a new nick in channel.
  *
@@ -606,6 +686,8 @@ irc_nick_new (struct t_irc_server *server, struct t_irc_channel *channel,
     channel->last_nick = new_nick;
     new_nick->next_nick = NULL;
 
+    irc_nick_index_add (server, channel, new_nick);
+
     channel->nicks_count++;
 
     channel->nick_completion_reset = 1;
@@ -636,9 +718,11 @@ irc_nick_change (struct t_irc_server *server, struct t_irc_channel *channel,
         irc_channel_nick_speaking_rename (channel, nick->name, new_nick);
 
     /* change nickname */
+    irc_nick_index_remove (server, channel, nick);
     if (nick->name)
         free (nick->name);
     nick->name = strdup (new_nick);
+    irc_nick_index_add (server, channel, nick);
     if (nick->color)
         free (nick->color);
     if (nick_is_me)
@@ -747,6 +831,7 @@ irc_nick_free (struct t_irc_server *server, struct t_irc_channel *channel,
     irc_nick_nicklist_remove (server, channel, nick);
 
     /* remove nick */
+    irc_nick_index_remove (server, channel, nick);
     if (channel->last_nick == nick)
         channel->last_nick = nick->prev_nick;
     if (nick->prev_nick)
@@ -818,10 +903,21 @@ irc_nick_search (struct t_irc_server *server, struct t_irc_channel *channel,
                  const char *nickname)
 {
     struct t_irc_nick *ptr_nick;
+    char *name;
 
     if (!channel || !nickname)
         return NULL;
 
+    if (channel->nicks_index)
+    {
+        name = irc_server_string_tolower (server, nickname);
+        if (!name)
+            return NULL;
+        ptr_nick = weechat_hashtable_get (channel->nicks_index, name);
+        free (name);
+        return ptr_nick;
+    }
+
     for (ptr_nick = channel->nicks; ptr_nick;
          ptr_nick = ptr_nick->next_nick)
     {
@@ -346,6 +346,54 @@ irc_server_strncasecmp (struct t_irc_server *server,
     return rc;
 }
 
+/*
+ * Converts a string to lower case, using casemapping of server.
+ *
+ * Two strings are equal with function irc_server_strcasecmp if and only if
+ * they are equal (case sensitive) after conversion with this function, so the
+ * result can be used as key in a hashtable.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_server_string_tolower (struct t_irc_server *server, const char *string)
+{
+    char *result, *ptr_result;
+    int casemapping, range;
+
+    if (!string)
+        return NULL;
+
+    casemapping = (server) ? server->casemapping : IRC_SERVER_CASEMAPPING_RFC1459;
+    switch (casemapping)
+    {
+        case IRC_SERVER_CASEMAPPING_RFC1459:
+            range = 30;
+            break;
+        case IRC_SERVER_CASEMAPPING_STRICT_RFC1459:
+            range = 29;
+            break;
+        case IRC_SERVER_CASEMAPPING_ASCII:
+            return weechat_string_tolower (string);
+        default:
+            range = 30;
+            break;
+    }
+
+    result = strdup (string);
+    if (!result)
+        return NULL;
+
+    for (ptr_result = result; ptr_result[0]; ptr_result++)
+    {
+        if ((ptr_result[0] >= 'A') && (ptr_result[0] < 'A' + range))
+            ptr_result[0] += ('a' - 'A');
+    }
+
+    return result;
+}
+
 /*
  * Evaluates a string using the server as context:
  * ${irc_server.xxx} and ${server} are replaced by a server option and the
@@ -1641,6 +1689,7 @@ irc_server_alloc (const char *name)
         WEECHAT_HASHTABLE_STRING,
         WEECHAT_HASHTABLE_TIME,
         NULL, NULL);
+    new_server->recv_tags = NULL;
     new_server->buffer = NULL;
     new_server->buffer_as_string = NULL;
     new_server->channels = NULL;
@@ -2101,6 +2150,8 @@ irc_server_free_data (struct t_irc_server *server)
     weechat_hashtable_free (server->join_manual);
     weechat_hashtable_free (server->join_channel_key);
     weechat_hashtable_free (server->join_noswitch);
+    if (server->recv_tags)
+        weechat_hashtable_free (server->recv_tags);
 
     /* free server data */
     for (i = 0; i < IRC_SERVER_NUM_OPTIONS; i++)
@@ -2724,9 +2775,9 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
     snprintf (str_modifier, sizeof (str_modifier),
               "irc_out_%s",
               (command) ? command : "unknown");
-    new_msg = weechat_hook_modifier_exec (str_modifier,
-                                          server->name,
-                                          message);
+    new_msg = (weechat_hook_modifier_has_hooks (str_modifier)) ?
+        weechat_hook_modifier_exec (str_modifier, server->name, message) :
+        NULL;
 
     /* no changes in new message */
     if (new_msg && (strcmp (message, new_msg) == 0))
@@ -2993,9 +3044,10 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
         snprintf (str_modifier, sizeof (str_modifier),
                   "irc_out1_%s",
                   (command) ? command : "unknown");
-        new_msg = weechat_hook_modifier_exec (str_modifier,
-                                              server->name,
-                                              items[i]);
+        new_msg = (weechat_hook_modifier_has_hooks (str_modifier)) ?
+            weechat_hook_modifier_exec (str_modifier, server->name,
+                                        items[i]) :
+            NULL;
 
         /* no changes in new message */
         if (new_msg && (strcmp (items[i], new_msg) == 0))
@@ -3217,6 +3269,49 @@ irc_server_msgq_add_buffer (struct t_irc_server *server, const char *buffer)
     }
 }
 
+/*
+ * Appends a string with a given length to a buffer (the string is truncated
+ * if the buffer is too small).
+ */
+
+void
+irc_server_msgq_append (char *buffer, int size, const char *string,
+                        int length)
+{
+    int length_buffer;
+
+    length_buffer = strlen (buffer);
+    if (length > size - length_buffer - 1)
+        length = size - length_buffer - 1;
+    if (length <= 0)
+        return;
+
+    memcpy (buffer + length_buffer, string, length);
+    buffer[length_buffer + length] = '\0';
+}
+
+/*
+ * Builds name of modifier for a message received: prefix + command
+ * (or prefix + "unknown" if the message has no command).
+ */
+
+void
+irc_server_msgq_modifier_name (char *modifier, int size, const char *prefix,
+                               struct t_irc_message_parsed *parsed)
+{
+    snprintf (modifier, size, "%s", prefix);
+    if (parsed->pos_command >= 0)
+    {
+        irc_server_msgq_append (modifier, size,
+                                parsed->message + parsed->pos_command,
+                                parsed->length_command);
+    }
+    else
+    {
+        irc_server_msgq_append (modifier, size, "unknown", 7);
+    }
+}
+
 /*
  * Flushes message queue.
  */
@@ -3225,8 +3320,9 @@ void
 irc_server_msgq_flush ()
 {
     struct t_irc_message *next;
+    struct t_irc_message_parsed parsed;
     char *ptr_data, *new_msg, *new_msg2, *ptr_msg, *ptr_msg2, *pos;
-    char *nick, *host, *command, *channel, *arguments;
+    char *command, *channel;
     char *msg_decoded, *msg_decoded_without_color;
     char str_modifier[128], modifier_data[1024];
     int pos_channel, pos_text, pos_decode;
@@ -3253,32 +3349,17 @@ irc_server_msgq_flush ()
                     irc_raw_print (irc_recv_msgq->server, IRC_RAW_FLAG_RECV,
                                    ptr_data);
 
-                    irc_message_parse (irc_recv_msgq->server,
-                                       ptr_data,
-                                       NULL,  /* tags */
-                                       NULL,  /* message_without_tags */
-                                       NULL,  /* nick */
-                                       NULL,  /* user */
-                                       NULL,  /* host */
-                                       &command,
-                                       NULL,  /* channel */
-                                       NULL,  /* arguments */
-                                       NULL,  /* text */
-                                       NULL,  /* params */
-                                       NULL,  /* num_params */
-                                       NULL,  /* pos_command */
-                                       NULL,  /* pos_arguments */
-                                       NULL,  /* pos_channel */
-                                       NULL);  /* pos_text */
-                    snprintf (str_modifier, sizeof (str_modifier),
-                              "irc_in_%s",
-                              (command) ? command : "unknown");
-                    new_msg = weechat_hook_modifier_exec (
-                        str_modifier,
-                        irc_recv_msgq->server->name,
-                        ptr_data);
-                    if (command)
-                        free (command);
+                    irc_message_parse_pos (irc_recv_msgq->server, ptr_data,
+                                           &parsed);
+                    irc_server_msgq_modifier_name (str_modifier,
+                                                   sizeof (str_modifier),
+                                                   "irc_in_", &parsed);
+                    new_msg = (weechat_hook_modifier_has_hooks (str_modifier)) ?
+                        weechat_hook_modifier_exec (
+                            str_modifier,
+                            irc_recv_msgq->server->name,
+                            ptr_data) :
+                        NULL;
 
                     /* no changes in new message */
                     if (new_msg && (strcmp (ptr_data, new_msg) == 0))
@@ -3307,23 +3388,10 @@ irc_server_msgq_flush ()
                                     ptr_msg);
                             }
 
-                            irc_message_parse (irc_recv_msgq->server,
-                                               ptr_msg,
-                                               NULL,  /* tags */
-                                               NULL,  /* message_without_tags */
-                                               &nick,
-                                               NULL,  /* user */
-                                               &host,
-                                               &command,
-                                               &channel,
-                                               &arguments,
-                                               NULL,  /* text */
-                                               NULL,  /* params */
-                                               NULL,  /* num_params */
-                                               NULL,  /* pos_command */
-                                               NULL,  /* pos_arguments */
-                                               &pos_channel,
-                                               &pos_text);
+                            irc_message_parse_pos (irc_recv_msgq->server,
+                                                   ptr_msg, &parsed);
+                            pos_channel = parsed.pos_channel;
+                            pos_text = parsed.pos_text;
 
                             msg_decoded = NULL;
 
@@ -3346,35 +3414,37 @@ irc_server_msgq_flush ()
                             if (pos_decode >= 0)
                             {
                                 /* convert charset for message */
-                                if (channel
-                                    && irc_channel_is_channel (irc_recv_msgq->server,
-                                                               channel))
+                                snprintf (modifier_data, sizeof (modifier_data),
+                                          "%s.%s",
+                                          weechat_plugin->name,
+                                          irc_recv_msgq->server->name);
+                                if ((parsed.pos_channel >= 0)
+                                    && irc_channel_is_channel (
+                                        irc_recv_msgq->server,
+                                        ptr_msg + parsed.pos_channel))
                                 {
-                                    snprintf (modifier_data, sizeof (modifier_data),
-                                              "%s.%s.%s",
-                                              weechat_plugin->name,
-                                              irc_recv_msgq->server->name,
-                                              channel);
+                                    irc_server_msgq_append (
+                                        modifier_data, sizeof (modifier_data),
+                                        ".", 1);
+                                    irc_server_msgq_append (
+                                        modifier_data, sizeof (modifier_data),
+                                        ptr_msg + parsed.pos_channel,
+                                        parsed.length_channel);
                                 }
-                                else
+                                else if ((parsed.pos_nick >= 0)
+                                         && ((parsed.pos_host < 0)
+                                             || (parsed.length_nick != parsed.length_host)
+                                             || (strncmp (ptr_msg + parsed.pos_nick,
+                                                          ptr_msg + parsed.pos_host,
+                                                          parsed.length_nick) != 0)))
                                 {
-                                    if (nick && (!host || (strcmp (nick, host) != 0)))
-                                    {
-                                        snprintf (modifier_data,
-                                                  sizeof (modifier_data),
-                                                  "%s.%s.%s",
-                                                  weechat_plugin->name,
-                                                  irc_recv_msgq->server->name,
-                                                  nick);
-                                    }
-                                    else
-                                    {
-                                        snprintf (modifier_data,
-                                                  sizeof (modifier_data),
-                                                  "%s.%s",
-                                                  weechat_plugin->name,
-                                                  irc_recv_msgq->server->name);
-                                    }
+                                    irc_server_msgq_append (
+                                        modifier_data, sizeof (modifier_data),
+                                        ".", 1);
+                                    irc_server_msgq_append (
+                                        modifier_data, sizeof (modifier_data),
+                                        ptr_msg + parsed.pos_nick,
+                                        parsed.length_nick);
                                 }
                                 msg_decoded = irc_message_convert_charset (
                                     ptr_msg, pos_decode,
@@ -3390,13 +3460,15 @@ irc_server_msgq_flush ()
                             /* call modifier after charset */
                             ptr_msg2 = (msg_decoded_without_color) ?
                                 msg_decoded_without_color : ((msg_decoded) ? msg_decoded : ptr_msg);
-                            snprintf (str_modifier, sizeof (str_modifier),
-                                      "irc_in2_%s",
-                                      (command) ? command : "unknown");
-                            new_msg2 = weechat_hook_modifier_exec (
-                                str_modifier,
-                                irc_recv_msgq->server->name,
-                                ptr_msg2);
+                            irc_server_msgq_modifier_name (str_modifier,
+                                                           sizeof (str_modifier),
+                                                           "irc_in2_", &parsed);
+                            new_msg2 = (weechat_hook_modifier_has_hooks (str_modifier)) ?
+                                weechat_hook_modifier_exec (
+                                    str_modifier,
+                                    irc_recv_msgq->server->name,
+                                    ptr_msg2) :
+                                NULL;
                             if (new_msg2 && (strcmp (ptr_msg2, new_msg2) == 0))
                             {
                                 free (new_msg2);
@@ -3411,9 +3483,17 @@ irc_server_msgq_flush ()
                                     ptr_msg2 = new_msg2;
 
                                 /* parse and execute command */
-                                if (irc_redirect_message (irc_recv_msgq->server,
-                                                          ptr_msg2, command,
-                                                          arguments))
+                                command = (parsed.pos_command >= 0) ?
+                                    weechat_strndup (ptr_msg + parsed.pos_command,
+                                                     parsed.length_command) : NULL;
+                                channel = (parsed.pos_channel >= 0) ?
+                                    weechat_strndup (ptr_msg + parsed.pos_channel,
+                                                     parsed.length_channel) : NULL;
+                                if (irc_redirect_message (
+                                        irc_recv_msgq->server,
+                                        ptr_msg2, command,
+                                        (parsed.pos_arguments >= 0) ?
+                                        ptr_msg + parsed.pos_arguments : NULL))
                                 {
                                     /* message redirected, we'll not display it! */
                                 }
@@ -3426,20 +3506,14 @@ irc_server_msgq_flush ()
                                         command,
                                         channel);
                                 }
+                                if (command)
+                                    free (command);
+                                if (channel)
+                                    free (channel);
                             }
 
                             if (new_msg2)
                                 free (new_msg2);
-                            if (nick)
-                                free (nick);
-                            if (host)
-                                free (host);
-                            if (command)
-                                free (command);
-                            if (channel)
-                                free (channel);
-                            if (arguments)
-                                free (arguments);
                             if (msg_decoded)
                                 free (msg_decoded);
                             if (msg_decoded_without_color)
@@ -6948,6 +7022,7 @@ irc_server_print_log ()
         weechat_log_printf ("  join_noswitch . . . . . . : 0x%lx (hashtable: '%s')",
                             ptr_server->join_noswitch,
                             weechat_hashtable_get_string (ptr_server->join_noswitch, "keys_values"));
+        weechat_log_printf ("  recv_tags . . . . . . . . : 0x%lx", ptr_server->recv_tags);
         weechat_log_printf ("  buffer. . . . . . . . . . : 0x%lx", ptr_server->buffer);
         weechat_log_printf ("  buffer_as_string. . . . . : 0x%lx", ptr_server->buffer_as_string);
         weechat_log_printf ("  channels. . . . . . . . . : 0x%lx", ptr_server->channels);
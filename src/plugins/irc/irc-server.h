@@ -277,6 +277,8 @@ struct t_irc_server
     struct t_hashtable *join_manual;         /* manual joins pending         */
     struct t_hashtable *join_channel_key;    /* keys pending for joins       */
     struct t_hashtable *join_noswitch;       /* joins w/o switch to buffer   */
+    struct t_hashtable *recv_tags;           /* tags of message received     */
+                                             /* (reused for all messages)    */
     struct t_gui_buffer *buffer;          /* GUI buffer allocated for server */
     char *buffer_as_string;               /* used to return buffer info      */
     struct t_irc_channel *channels;       /* opened channels on server       */
@@ -325,6 +327,8 @@ extern int irc_server_strcasecmp (struct t_irc_server *server,
 extern int irc_server_strncasecmp (struct t_irc_server *server,
                                    const char *string1, const char *string2,
                                    int max);
+extern char *irc_server_string_tolower (struct t_irc_server *server,
+                                        const char *string);
 extern char *irc_server_eval_expression (struct t_irc_server *server,
                                          const char *string);
 extern void irc_server_sasl_get_creds (struct t_irc_server *server,
@@ -322,6 +322,9 @@ irc_upgrade_set_buffer_callbacks ()
                                                     "nickcmp_callback_pointer",
                                                     ptr_server);
                     }
+                    weechat_buffer_set_pointer (ptr_buffer,
+                                                "nickcmp_key_callback",
+                                                &irc_buffer_nickcmp_key_cb);
                 }
                 if (strcmp (weechat_infolist_string (infolist, "name"),
                             IRC_RAW_BUFFER_NAME) == 0)
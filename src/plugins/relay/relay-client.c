@@ -26,8 +26,10 @@
 #include <string.h>
 #include <time.h>
 #include <errno.h>
+#include <limits.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <gnutls/gnutls.h>
 
@@ -387,6 +389,10 @@ relay_client_recv_text (struct t_relay_client *client, const char *data)
                         if (rc == 0)
                         {
                             /* handshake from client is valid */
+                            relay_websocket_parse_extensions (
+                                weechat_hashtable_get (client->http_headers,
+                                                       "sec-websocket-extensions"),
+                                client->ws_deflate);
                             handshake  = relay_websocket_build_handshake (client);
                             if (handshake)
                             {
@@ -580,7 +586,8 @@ int
 relay_client_recv_cb (const void *pointer, void *data, int fd)
 {
     struct t_relay_client *client;
-    static char buffer[4096], decoded[8192 + 1];
+    static char buffer[4096];
+    unsigned char *decoded;
     const char *ptr_buffer;
     int num_read, rc;
     unsigned long long decoded_length, length_buffer;
@@ -591,6 +598,10 @@ relay_client_recv_cb (const void *pointer, void *data, int fd)
 
     client = (struct t_relay_client *)pointer;
 
+    /* socket may be writable: flush the outqueue */
+    if (client->outqueue)
+        relay_client_send_outqueue (client);
+
     /*
      * data can be received only during authentication
      * or if connected (authentication was OK)
@@ -612,6 +623,7 @@ relay_client_recv_cb (const void *pointer, void *data, int fd)
         buffer[num_read] = '\0';
         ptr_buffer = buffer;
         length_buffer = num_read;
+        decoded = NULL;
 
         /*
          * if we are receiving the first message from client, check if it looks
@@ -642,10 +654,13 @@ relay_client_recv_cb (const void *pointer, void *data, int fd)
             /* websocket used, decode message */
             rc = relay_websocket_decode_frame ((unsigned char *)buffer,
                                                (unsigned long long)num_read,
-                                               (unsigned char *)decoded,
+                                               client->ws_deflate,
+                                               &decoded,
                                                &decoded_length);
             if (decoded_length == 0)
             {
+                if (decoded)
+                    free (decoded);
                 /*
                  * When decoded length is 0, assume client sent a PONG frame.
                  *
@@ -668,10 +683,12 @@ relay_client_recv_cb (const void *pointer, void *data, int fd)
                     RELAY_COLOR_CHAT_CLIENT,
                     client->desc,
                     RELAY_COLOR_CHAT);
+                if (decoded)
+                    free (decoded);
                 relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
                 return WEECHAT_RC_OK;
             }
-            ptr_buffer = decoded;
+            ptr_buffer = (const char *)decoded;
             length_buffer = decoded_length;
         }
 
@@ -686,6 +703,8 @@ relay_client_recv_cb (const void *pointer, void *data, int fd)
             /* receive buffer as-is (binary data) */
             /* currently, all supported protocols receive only text, no binary */
         }
+        if (decoded)
+            free (decoded);
         relay_buffer_refresh (NULL);
     }
     else
@@ -733,6 +752,80 @@ relay_client_recv_cb (const void *pointer, void *data, int fd)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Creates a new payload (data to send to one or more clients).
+ *
+ * If copy is 1, data is duplicated, otherwise the payload takes ownership of
+ * data (which must have been allocated with malloc).
+ *
+ * Returns pointer to new payload (with one reference), NULL if error.
+ *
+ * Note: result must be freed with relay_client_payload_unref.
+ */
+
+struct t_relay_client_payload *
+relay_client_payload_new (char *data, int size, int copy)
+{
+    struct t_relay_client_payload *new_payload;
+
+    if (!data || (size <= 0))
+        return NULL;
+
+    new_payload = malloc (sizeof (*new_payload));
+    if (!new_payload)
+        return NULL;
+
+    if (copy)
+    {
+        new_payload->data = malloc (size);
+        if (!new_payload->data)
+        {
+            free (new_payload);
+            return NULL;
+        }
+        memcpy (new_payload->data, data, size);
+    }
+    else
+    {
+        new_payload->data = data;
+    }
+    new_payload->size = size;
+    new_payload->refcount = 1;
+
+    return new_payload;
+}
+
+/*
+ * Removes a reference on a payload, and frees it if it is not used any more.
+ */
+
+void
+relay_client_payload_unref (struct t_relay_client_payload *payload)
+{
+    if (!payload)
+        return;
+
+    payload->refcount--;
+    if (payload->refcount > 0)
+        return;
+
+    if (payload->data)
+        free (payload->data);
+    free (payload);
+}
+
+/*
+ * Stops watching the socket of client for writing (when the outqueue becomes
+ * empty).
+ */
+
+void
+relay_client_outqueue_unhook_send (struct t_relay_client *client)
+{
+    if (client->hook_fd)
+        weechat_hook_set (client->hook_fd, "flag_write", "0");
+}
+
 /*
  * Frees a message in out queue.
  */
@@ -760,13 +853,10 @@ relay_client_outqueue_free (struct t_relay_client *client,
     if (outqueue->next_outqueue)
         (outqueue->next_outqueue)->prev_outqueue = outqueue->prev_outqueue;
 
+    client->outqueue_size -= outqueue->data_size;
+
     /* free data */
-    if (outqueue->data)
-        free (outqueue->data);
-    if (outqueue->raw_message[0])
-        free (outqueue->raw_message[0]);
-    if (outqueue->raw_message[1])
-        free (outqueue->raw_message[1]);
+    relay_client_payload_unref (outqueue->payload);
     free (outqueue);
 
     /* set new head */
@@ -784,84 +874,92 @@ relay_client_outqueue_free_all (struct t_relay_client *client)
     {
         relay_client_outqueue_free (client, client->outqueue);
     }
+    client->outqueue_size = 0;
+
+    relay_client_outqueue_unhook_send (client);
+}
+
+/*
+ * Removes bytes sent from the beginning of out queue.
+ */
+
+void
+relay_client_outqueue_remove_sent (struct t_relay_client *client,
+                                   int num_sent)
+{
+    while (client->outqueue && (num_sent > 0))
+    {
+        if (num_sent >= client->outqueue->data_size)
+        {
+            /* whole message sent, remove it from outqueue */
+            num_sent -= client->outqueue->data_size;
+            relay_client_outqueue_free (client, client->outqueue);
+        }
+        else
+        {
+            /* message partially sent */
+            client->outqueue->data_offset += num_sent;
+            client->outqueue->data_size -= num_sent;
+            client->outqueue_size -= num_sent;
+            num_sent = 0;
+        }
+    }
 }
 
 /*
  * Sends messages in outqueue for a client.
+ *
+ * Without SSL, many messages are sent at once with writev().
  */
 
 void
 relay_client_send_outqueue (struct t_relay_client *client)
 {
-    int i, num_sent;
-    char *buf;
+    struct iovec iov[RELAY_CLIENT_OUTQUEUE_IOV_MAX];
+    struct t_relay_client_outqueue *ptr_outqueue;
+    int num_iov, num_sent, size;
 
     while (client->outqueue)
     {
         if (client->ssl)
         {
-            num_sent = gnutls_record_send (client->gnutls_sess,
-                                           client->outqueue->data,
-                                           client->outqueue->data_size);
+            size = client->outqueue->data_size;
+            num_sent = gnutls_record_send (
+                client->gnutls_sess,
+                client->outqueue->payload->data + client->outqueue->data_offset,
+                size);
         }
         else
         {
-            num_sent = send (client->sock,
-                             client->outqueue->data,
-                             client->outqueue->data_size, 0);
+            size = 0;
+            num_iov = 0;
+            for (ptr_outqueue = client->outqueue;
+                 ptr_outqueue && (num_iov < RELAY_CLIENT_OUTQUEUE_IOV_MAX)
+                     && (size <= INT_MAX - ptr_outqueue->data_size);
+                 ptr_outqueue = ptr_outqueue->next_outqueue)
+            {
+                iov[num_iov].iov_base = ptr_outqueue->payload->data
+                    + ptr_outqueue->data_offset;
+                iov[num_iov].iov_len = ptr_outqueue->data_size;
+                size += ptr_outqueue->data_size;
+                num_iov++;
+            }
+            num_sent = writev (client->sock, iov, num_iov);
         }
         if (num_sent >= 0)
         {
-            for (i = 0; i < 2; i++)
-            {
-                if (client->outqueue->raw_message[i])
-                {
-                    /*
-                     * print raw message and remove it from outqueue
-                     * (so that it is displayed only one time, even if
-                     * message is sent in many chunks)
-                     */
-                    relay_raw_print (
-                        client,
-                        client->outqueue->raw_msg_type[i],
-                        client->outqueue->raw_flags[i],
-                        client->outqueue->raw_message[i],
-                        client->outqueue->raw_size[i]);
-                    client->outqueue->raw_flags[i] = 0;
-                    free (client->outqueue->raw_message[i]);
-                    client->outqueue->raw_message[i] = NULL;
-                    client->outqueue->raw_size[i] = 0;
-                }
-            }
             if (num_sent > 0)
             {
                 client->bytes_sent += num_sent;
                 relay_buffer_refresh (NULL);
             }
-            if (num_sent == client->outqueue->data_size)
-            {
-                /* whole data sent, remove outqueue */
-                relay_client_outqueue_free (client, client->outqueue);
-            }
-            else
+            relay_client_outqueue_remove_sent (client, num_sent);
+            if (num_sent < size)
             {
                 /*
-                 * some data was not sent, update outqueue and stop
-                 * sending data from outqueue
+                 * some data was not sent, stop sending data from outqueue
+                 * (we will retry when the socket is writable)
                  */
-                if (num_sent > 0)
-                {
-                    buf = malloc (client->outqueue->data_size - num_sent);
-                    if (buf)
-                    {
-                        memcpy (buf,
-                                client->outqueue->data + num_sent,
-                                client->outqueue->data_size - num_sent);
-                        free (client->outqueue->data);
-                        client->outqueue->data = buf;
-                        client->outqueue->data_size = client->outqueue->data_size - num_sent;
-                    }
-                }
                 break;
             }
         }
@@ -893,7 +991,8 @@ relay_client_send_outqueue (struct t_relay_client *client)
             }
             else
             {
-                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                if ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                    || (errno == EINTR))
                 {
                     /* we will retry later this client's queue */
                     break;
@@ -917,35 +1016,23 @@ relay_client_send_outqueue (struct t_relay_client *client)
         }
     }
 
-    if (!client->outqueue && client->hook_timer_send)
-    {
-        weechat_unhook (client->hook_timer_send);
-        client->hook_timer_send = NULL;
-    }
+    if (!client->outqueue)
+        relay_client_outqueue_unhook_send (client);
 }
 
 /*
- * Timer called for a client when outqueue is not empty.
+ * Watches the socket of client for writing, to flush the outqueue as soon as
+ * the socket is writable (in callback relay_client_recv_cb).
  *
- * This timer is automatically removed when the outqueue becomes empty
- * (done in the function relay_client_send_outqueue).
+ * The socket is not watched any more for writing when the outqueue becomes
+ * empty (done in the function relay_client_send_outqueue).
  */
 
-int
-relay_client_timer_send_cb (const void *pointer, void *data,
-                            int remaining_calls)
+void
+relay_client_outqueue_hook_send (struct t_relay_client *client)
 {
-    struct t_relay_client *ptr_client;
-
-    /* make C compiler happy */
-    (void) data;
-    (void) remaining_calls;
-
-    ptr_client = (struct t_relay_client *)pointer;
-
-    relay_client_send_outqueue (ptr_client);
-
-    return WEECHAT_RC_OK;
+    if (client->hook_fd)
+        weechat_hook_set (client->hook_fd, "flag_write", "1");
 }
 
 /*
@@ -954,50 +1041,25 @@ relay_client_timer_send_cb (const void *pointer, void *data,
 
 void
 relay_client_outqueue_add (struct t_relay_client *client,
-                           const char *data, int data_size,
-                           enum t_relay_client_msg_type raw_msg_type[2],
-                           int raw_flags[2],
-                           const char *raw_message[2],
-                           int raw_size[2])
+                           struct t_relay_client_payload *payload,
+                           int data_offset, int data_size)
 {
     struct t_relay_client_outqueue *new_outqueue;
-    int i;
 
-    if (!client || !data || (data_size <= 0))
+    if (!client || !payload || (data_offset < 0) || (data_size <= 0)
+        || (data_offset + data_size > payload->size))
+    {
         return;
+    }
 
     new_outqueue = malloc (sizeof (*new_outqueue));
     if (!new_outqueue)
         return;
 
-    new_outqueue->data = malloc (data_size);
-    if (!new_outqueue->data)
-    {
-        free (new_outqueue);
-        return;
-    }
-
-    memcpy (new_outqueue->data, data, data_size);
+    payload->refcount++;
+    new_outqueue->payload = payload;
+    new_outqueue->data_offset = data_offset;
     new_outqueue->data_size = data_size;
-    for (i = 0; i < 2; i++)
-    {
-        new_outqueue->raw_msg_type[i] = RELAY_CLIENT_MSG_STANDARD;
-        new_outqueue->raw_flags[i] = 0;
-        new_outqueue->raw_message[i] = NULL;
-        new_outqueue->raw_size[i] = 0;
-        if (raw_message && raw_message[i] && (raw_size[i] > 0))
-        {
-            new_outqueue->raw_message[i] = malloc (raw_size[i]);
-            if (new_outqueue->raw_message[i])
-            {
-                new_outqueue->raw_msg_type[i] = raw_msg_type[i];
-                new_outqueue->raw_flags[i] = raw_flags[i];
-                memcpy (new_outqueue->raw_message[i], raw_message[i],
-                        raw_size[i]);
-                new_outqueue->raw_size[i] = raw_size[i];
-            }
-        }
-    }
 
     new_outqueue->prev_outqueue = client->last_outqueue;
     new_outqueue->next_outqueue = NULL;
@@ -1007,17 +1069,102 @@ relay_client_outqueue_add (struct t_relay_client *client,
         client->outqueue = new_outqueue;
     client->last_outqueue = new_outqueue;
 
-    if (!client->hook_timer_send)
+    client->outqueue_size += data_size;
+
+    relay_client_outqueue_hook_send (client);
+}
+
+/*
+ * Adds data that can not be sent now in out queue.
+ *
+ * Data is not copied if it is a websocket frame (the outqueue takes ownership
+ * of the frame, and *websocket_frame is set to NULL) or if a pointer to a
+ * shared payload is given: it is created on first use (with a copy of data),
+ * then it is used by all clients receiving the same data.
+ */
+
+void
+relay_client_outqueue_add_data (struct t_relay_client *client,
+                                char **websocket_frame,
+                                const char *data, int data_size,
+                                int data_offset,
+                                struct t_relay_client_payload **payload)
+{
+    struct t_relay_client_payload *ptr_payload;
+
+    if (*websocket_frame)
+    {
+        ptr_payload = relay_client_payload_new (*websocket_frame, data_size,
+                                                0);
+        if (ptr_payload)
+            *websocket_frame = NULL;
+    }
+    else if (payload)
+    {
+        if (!*payload)
+            *payload = relay_client_payload_new ((char *)data, data_size, 1);
+        ptr_payload = *payload;
+        if (ptr_payload)
+            ptr_payload->refcount++;
+    }
+    else
+    {
+        ptr_payload = relay_client_payload_new ((char *)data, data_size, 1);
+    }
+
+    if (!ptr_payload)
+        return;
+
+    relay_client_outqueue_add (client, ptr_payload,
+                               data_offset, data_size - data_offset);
+
+    relay_client_payload_unref (ptr_payload);
+}
+
+/*
+ * Checks size of out queue: if the max size is reached (client too slow or
+ * not reading data), the client is disconnected.
+ *
+ * Returns:
+ *   1: size of out queue is OK
+ *   0: max size reached, client has been disconnected
+ */
+
+int
+relay_client_outqueue_check_size (struct t_relay_client *client)
+{
+    int max_size;
+
+    max_size = weechat_config_integer (relay_config_network_max_outqueue_size);
+    if ((max_size == 0)
+        || (client->outqueue_size <= (unsigned long long)max_size * 1024))
     {
-        client->hook_timer_send = weechat_hook_timer (
-            1, 0, 0,
-            &relay_client_timer_send_cb, client, NULL);
+        return 1;
     }
+
+    weechat_printf_date_tags (
+        NULL, 0, "relay_client",
+        _("%s%s: too much data waiting to be sent to client %s%s%s "
+          "(%llu bytes), disconnecting"),
+        weechat_prefix ("error"),
+        RELAY_PLUGIN_NAME,
+        RELAY_COLOR_CHAT_CLIENT,
+        client->desc,
+        RELAY_COLOR_CHAT,
+        client->outqueue_size);
+    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+
+    return 0;
 }
 
 /*
  * Sends data to client (adds in out queue if it's impossible to send now).
  *
+ * If "payload" is not NULL, it is a pointer to a payload shared by all
+ * clients receiving the same data (it can point to NULL, and then the payload
+ * is created if data is added in out queue); the caller must free it with
+ * relay_client_payload_unref after sending data to all clients.
+ *
  * If "message_raw_buffer" is not NULL, it is used for display in raw buffer
  * and replaces display of data, which is default.
  *
@@ -1025,12 +1172,13 @@ relay_client_outqueue_add (struct t_relay_client *client,
  */
 
 int
-relay_client_send (struct t_relay_client *client,
-                   enum t_relay_client_msg_type msg_type,
-                   const char *data,
-                   int data_size, const char *message_raw_buffer)
+relay_client_send_payload (struct t_relay_client *client,
+                           enum t_relay_client_msg_type msg_type,
+                           const char *data, int data_size,
+                           struct t_relay_client_payload **payload,
+                           const char *message_raw_buffer)
 {
-    int num_sent, raw_size[2], raw_flags[2], opcode, i;
+    int num_sent, raw_size[2], raw_flags[2], opcode, i, error;
     enum t_relay_client_msg_type raw_msg_type[2];
     char *websocket_frame;
     unsigned long long length_frame;
@@ -1114,7 +1262,8 @@ relay_client_send (struct t_relay_client *client,
                     WEBSOCKET_FRAME_OPCODE_TEXT : WEBSOCKET_FRAME_OPCODE_BINARY;
                 break;
         }
-        websocket_frame = relay_websocket_encode_frame (opcode, data,
+        websocket_frame = relay_websocket_encode_frame (client->ws_deflate,
+                                                        opcode, data,
                                                         data_size,
                                                         &length_frame);
         if (websocket_frame)
@@ -1125,6 +1274,7 @@ relay_client_send (struct t_relay_client *client,
     }
 
     num_sent = -1;
+    error = 0;
 
     /*
      * if outqueue is not empty, add to outqueue
@@ -1132,8 +1282,8 @@ relay_client_send (struct t_relay_client *client,
      */
     if (client->outqueue)
     {
-        relay_client_outqueue_add (client, ptr_data, data_size,
-                                   raw_msg_type, raw_flags, raw_msg, raw_size);
+        relay_client_outqueue_add_data (client, &websocket_frame,
+                                        ptr_data, data_size, 0, payload);
     }
     else
     {
@@ -1144,14 +1294,6 @@ relay_client_send (struct t_relay_client *client,
 
         if (num_sent >= 0)
         {
-            for (i = 0; i < 2; i++)
-            {
-                if (raw_msg[i])
-                {
-                    relay_raw_print (client, raw_msg_type[i], raw_flags[i],
-                                     raw_msg[i], raw_size[i]);
-                }
-            }
             if (num_sent > 0)
             {
                 client->bytes_sent += num_sent;
@@ -1160,10 +1302,9 @@ relay_client_send (struct t_relay_client *client,
             if (num_sent < data_size)
             {
                 /* some data was not sent, add it to outqueue */
-                relay_client_outqueue_add (client,
-                                           ptr_data + num_sent,
-                                           data_size - num_sent,
-                                           NULL, NULL, NULL, NULL);
+                relay_client_outqueue_add_data (client, &websocket_frame,
+                                                ptr_data, data_size,
+                                                num_sent, payload);
             }
         }
         else
@@ -1174,10 +1315,9 @@ relay_client_send (struct t_relay_client *client,
                     || (num_sent == GNUTLS_E_INTERRUPTED))
                 {
                     /* add message to queue (will be sent later) */
-                    relay_client_outqueue_add (client,
-                                               ptr_data, data_size,
-                                               raw_msg_type, raw_flags,
-                                               raw_msg, raw_size);
+                    relay_client_outqueue_add_data (client, &websocket_frame,
+                                                    ptr_data, data_size, 0,
+                                                    payload);
                 }
                 else
                 {
@@ -1192,6 +1332,7 @@ relay_client_send (struct t_relay_client *client,
                         num_sent,
                         gnutls_strerror (num_sent));
                     relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+                    error = 1;
                 }
             }
             else
@@ -1199,9 +1340,9 @@ relay_client_send (struct t_relay_client *client,
                 if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
                 {
                     /* add message to queue (will be sent later) */
-                    relay_client_outqueue_add (client, ptr_data, data_size,
-                                               raw_msg_type, raw_flags,
-                                               raw_msg, raw_size);
+                    relay_client_outqueue_add_data (client, &websocket_frame,
+                                                    ptr_data, data_size, 0,
+                                                    payload);
                 }
                 else
                 {
@@ -1216,17 +1357,56 @@ relay_client_send (struct t_relay_client *client,
                         errno,
                         strerror (errno));
                     relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+                    error = 1;
                 }
             }
         }
     }
 
+    /*
+     * display message in raw buffer (now, even if the message is in outqueue,
+     * so that raw messages are not copied in outqueue)
+     */
+    if (!error)
+    {
+        for (i = 0; i < 2; i++)
+        {
+            if (raw_msg[i])
+            {
+                relay_raw_print (client, raw_msg_type[i], raw_flags[i],
+                                 raw_msg[i], raw_size[i]);
+            }
+        }
+    }
+
     if (websocket_frame)
         free (websocket_frame);
 
+    if (!error && client->outqueue)
+        relay_client_outqueue_check_size (client);
+
     return num_sent;
 }
 
+/*
+ * Sends data to client (adds in out queue if it's impossible to send now).
+ *
+ * If "message_raw_buffer" is not NULL, it is used for display in raw buffer
+ * and replaces display of data, which is default.
+ *
+ * Returns number of bytes sent to client, -1 if error.
+ */
+
+int
+relay_client_send (struct t_relay_client *client,
+                   enum t_relay_client_msg_type msg_type,
+                   const char *data,
+                   int data_size, const char *message_raw_buffer)
+{
+    return relay_client_send_payload (client, msg_type, data, data_size,
+                                      NULL, message_raw_buffer);
+}
+
 /*
  * Timer callback, called each second.
  */
@@ -1311,6 +1491,7 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
         new_client->gnutls_handshake_ok = 0;
         new_client->websocket = RELAY_CLIENT_WEBSOCKET_NOT_USED;
         new_client->http_headers = NULL;
+        new_client->ws_deflate = relay_websocket_deflate_alloc ();
         new_client->address = strdup ((address && address[0]) ?
                                       address : "local");
         new_client->real_ip = NULL;
@@ -1331,7 +1512,6 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
         new_client->start_time = time (NULL);
         new_client->end_time = 0;
         new_client->hook_fd = NULL;
-        new_client->hook_timer_send = NULL;
         new_client->last_activity = new_client->start_time;
         new_client->bytes_recv = 0;
         new_client->bytes_sent = 0;
@@ -1430,6 +1610,7 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
 
         new_client->outqueue = NULL;
         new_client->last_outqueue = NULL;
+        new_client->outqueue_size = 0;
 
         new_client->prev_client = NULL;
         new_client->next_client = relay_clients;
@@ -1502,6 +1683,8 @@ relay_client_new_with_infolist (struct t_infolist *infolist)
 {
     struct t_relay_client *new_client;
     const char *str;
+    void *buf;
+    int size;
 
     new_client = malloc (sizeof (*new_client));
     if (new_client)
@@ -1516,6 +1699,31 @@ relay_client_new_with_infolist (struct t_infolist *infolist)
         new_client->gnutls_handshake_ok = 0;
         new_client->websocket = weechat_infolist_integer (infolist, "websocket");
         new_client->http_headers = NULL;
+        new_client->ws_deflate = relay_websocket_deflate_alloc ();
+        /* "ws_deflate_enabled" is new in WeeChat 4.0.0 */
+        if (new_client->ws_deflate
+            && weechat_infolist_search_var (infolist, "ws_deflate_enabled"))
+        {
+            new_client->ws_deflate->enabled = weechat_infolist_integer (infolist, "ws_deflate_enabled");
+            new_client->ws_deflate->server_context_takeover = weechat_infolist_integer (infolist, "ws_deflate_server_context_takeover");
+            new_client->ws_deflate->client_context_takeover = weechat_infolist_integer (infolist, "ws_deflate_client_context_takeover");
+            new_client->ws_deflate->window_bits_deflate = weechat_infolist_integer (infolist, "ws_deflate_window_bits_deflate");
+            new_client->ws_deflate->window_bits_inflate = weechat_infolist_integer (infolist, "ws_deflate_window_bits_inflate");
+            /*
+             * the deflate stream is restarted (the client can decompress
+             * it with its current stream), but the inflate stream needs the
+             * data previously received from client (if context takeover is
+             * used by client)
+             */
+            buf = weechat_infolist_buffer (infolist, "ws_deflate_inflate_dict",
+                                           &size);
+            if (buf && (size > 0)
+                && relay_websocket_deflate_init_stream_inflate (new_client->ws_deflate))
+            {
+                inflateSetDictionary (new_client->ws_deflate->strm_inflate,
+                                      buf, size);
+            }
+        }
         new_client->address = strdup (weechat_infolist_string (infolist, "address"));
         str = weechat_infolist_string (infolist, "real_ip");
         new_client->real_ip = (str) ? strdup (str) : NULL;
@@ -1555,7 +1763,6 @@ relay_client_new_with_infolist (struct t_infolist *infolist)
         }
         else
             new_client->hook_fd = NULL;
-        new_client->hook_timer_send = NULL;
         new_client->last_activity = weechat_infolist_time (infolist, "last_activity");
         sscanf (weechat_infolist_string (infolist, "bytes_recv"),
                 "%llu", &(new_client->bytes_recv));
@@ -1588,6 +1795,7 @@ relay_client_new_with_infolist (struct t_infolist *infolist)
 
         new_client->outqueue = NULL;
         new_client->last_outqueue = NULL;
+        new_client->outqueue_size = 0;
 
         new_client->prev_client = NULL;
         new_client->next_client = relay_clients;
@@ -1653,11 +1861,6 @@ relay_client_set_status (struct t_relay_client *client,
             weechat_unhook (client->hook_fd);
             client->hook_fd = NULL;
         }
-        if (client->hook_timer_send)
-        {
-            weechat_unhook (client->hook_timer_send);
-            client->hook_timer_send = NULL;
-        }
         switch (client->protocol)
         {
             case RELAY_PROTOCOL_WEECHAT:
@@ -1752,10 +1955,10 @@ relay_client_free (struct t_relay_client *client)
         weechat_unhook (client->hook_timer_handshake);
     if (client->http_headers)
         weechat_hashtable_free (client->http_headers);
+    if (client->ws_deflate)
+        relay_websocket_deflate_free (client->ws_deflate);
     if (client->hook_fd)
         weechat_unhook (client->hook_fd);
-    if (client->hook_timer_send)
-        weechat_unhook (client->hook_timer_send);
     if (client->partial_message)
         free (client->partial_message);
     if (client->protocol_data)
@@ -1847,6 +2050,8 @@ relay_client_add_to_infolist (struct t_infolist *infolist,
 {
     struct t_infolist_item *ptr_item;
     char value[128];
+    Bytef *dict;
+    uInt dict_size;
 
     if (!infolist || !client)
         return 0;
@@ -1895,6 +2100,42 @@ relay_client_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "websocket", client->websocket))
         return 0;
+    if (client->ws_deflate)
+    {
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_enabled", client->ws_deflate->enabled))
+            return 0;
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_server_context_takeover", client->ws_deflate->server_context_takeover))
+            return 0;
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_client_context_takeover", client->ws_deflate->client_context_takeover))
+            return 0;
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_window_bits_deflate", client->ws_deflate->window_bits_deflate))
+            return 0;
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_window_bits_inflate", client->ws_deflate->window_bits_inflate))
+            return 0;
+        if (client->ws_deflate->strm_inflate
+            && client->ws_deflate->client_context_takeover)
+        {
+            /* save the sliding window, to restore inflate stream on /upgrade */
+            dict = malloc (1 << MAX_WBITS);
+            if (dict)
+            {
+                dict_size = 0;
+                if ((inflateGetDictionary (client->ws_deflate->strm_inflate,
+                                           dict, &dict_size) == Z_OK)
+                    && (dict_size > 0))
+                {
+                    if (!weechat_infolist_new_var_buffer (ptr_item,
+                                                          "ws_deflate_inflate_dict",
+                                                          dict, dict_size))
+                    {
+                        free (dict);
+                        return 0;
+                    }
+                }
+                free (dict);
+            }
+        }
+    }
     if (!weechat_infolist_new_var_string (ptr_item, "address", client->address))
         return 0;
     if (!weechat_infolist_new_var_string (ptr_item, "real_ip", client->real_ip))
@@ -1921,8 +2162,6 @@ relay_client_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_pointer (ptr_item, "hook_fd", client->hook_fd))
         return 0;
-    if (!weechat_infolist_new_var_pointer (ptr_item, "hook_timer_send", client->hook_timer_send))
-        return 0;
     if (!weechat_infolist_new_var_time (ptr_item, "last_activity", client->last_activity))
         return 0;
     snprintf (value, sizeof (value), "%llu", client->bytes_recv);
@@ -1979,6 +2218,17 @@ relay_client_print_log ()
         weechat_log_printf ("  http_headers. . . . . . . : 0x%lx (hashtable: '%s')",
                             ptr_client->http_headers,
                             weechat_hashtable_get_string (ptr_client->http_headers, "keys_values"));
+        weechat_log_printf ("  ws_deflate. . . . . . . . : 0x%lx", ptr_client->ws_deflate);
+        if (ptr_client->ws_deflate)
+        {
+            weechat_log_printf ("    enabled . . . . . . . . : %d",   ptr_client->ws_deflate->enabled);
+            weechat_log_printf ("    server_context_takeover : %d",   ptr_client->ws_deflate->server_context_takeover);
+            weechat_log_printf ("    client_context_takeover : %d",   ptr_client->ws_deflate->client_context_takeover);
+            weechat_log_printf ("    window_bits_deflate . . : %d",   ptr_client->ws_deflate->window_bits_deflate);
+            weechat_log_printf ("    window_bits_inflate . . : %d",   ptr_client->ws_deflate->window_bits_inflate);
+            weechat_log_printf ("    strm_deflate. . . . . . : 0x%lx", ptr_client->ws_deflate->strm_deflate);
+            weechat_log_printf ("    strm_inflate. . . . . . : 0x%lx", ptr_client->ws_deflate->strm_inflate);
+        }
         weechat_log_printf ("  address . . . . . . . . . : '%s'", ptr_client->address);
         weechat_log_printf ("  real_ip . . . . . . . . . : '%s'", ptr_client->real_ip);
         weechat_log_printf ("  status. . . . . . . . . . : %d (%s)",
@@ -1999,7 +2249,6 @@ relay_client_print_log ()
         weechat_log_printf ("  start_time. . . . . . . . : %lld",  (long long)ptr_client->start_time);
         weechat_log_printf ("  end_time. . . . . . . . . : %lld",  (long long)ptr_client->end_time);
         weechat_log_printf ("  hook_fd . . . . . . . . . : 0x%lx", ptr_client->hook_fd);
-        weechat_log_printf ("  hook_timer_send . . . . . : 0x%lx", ptr_client->hook_timer_send);
         weechat_log_printf ("  last_activity . . . . . . : %lld",  (long long)ptr_client->last_activity);
         weechat_log_printf ("  bytes_recv. . . . . . . . : %llu",  ptr_client->bytes_recv);
         weechat_log_printf ("  bytes_sent. . . . . . . . : %llu",  ptr_client->bytes_sent);
@@ -2024,6 +2273,7 @@ relay_client_print_log ()
         }
         weechat_log_printf ("  outqueue. . . . . . . . . : 0x%lx", ptr_client->outqueue);
         weechat_log_printf ("  last_outqueue . . . . . . : 0x%lx", ptr_client->last_outqueue);
+        weechat_log_printf ("  outqueue_size . . . . . . : %llu",  ptr_client->outqueue_size);
         weechat_log_printf ("  prev_client . . . . . . . : 0x%lx", ptr_client->prev_client);
         weechat_log_printf ("  next_client . . . . . . . : 0x%lx", ptr_client->next_client);
     }
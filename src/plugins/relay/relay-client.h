@@ -79,16 +79,26 @@ enum t_relay_client_msg_type
     ((client->status == RELAY_STATUS_AUTH_FAILED) ||                    \
      (client->status == RELAY_STATUS_DISCONNECTED))
 
+/* max number of messages in outqueue sent with a single system call */
+
+#define RELAY_CLIENT_OUTQUEUE_IOV_MAX 64
+
+/* data to send, which can be shared by the outqueues of many clients */
+
+struct t_relay_client_payload
+{
+    char *data;                         /* data to send                     */
+    int size;                           /* number of bytes                  */
+    int refcount;                       /* number of references             */
+};
+
 /* output queue of messages to client */
 
 struct t_relay_client_outqueue
 {
-    char *data;                         /* data to send                     */
-    int data_size;                      /* number of bytes                  */
-    int raw_msg_type[2];                /* msgs types                       */
-    int raw_flags[2];                   /* flags for raw messages           */
-    char *raw_message[2];               /* msgs for raw buffer (can be NULL)*/
-    int raw_size[2];                    /* size (in bytes) of raw messages  */
+    struct t_relay_client_payload *payload; /* data to send                 */
+    int data_offset;                    /* offset of data not yet sent      */
+    int data_size;                      /* number of bytes not yet sent     */
     struct t_relay_client_outqueue *next_outqueue; /* next msg in queue     */
     struct t_relay_client_outqueue *prev_outqueue; /* prev msg in queue     */
 };
@@ -107,6 +117,7 @@ struct t_relay_client
     int gnutls_handshake_ok;           /* 1 if handshake was done and OK    */
     enum t_relay_client_websocket_status websocket; /* websocket status     */
     struct t_hashtable *http_headers;  /* HTTP headers for websocket        */
+    struct t_relay_websocket_deflate *ws_deflate; /* websocket compression  */
     char *address;                     /* string with IP address            */
     char *real_ip;                     /* real IP (X-Real-IP HTTP header)   */
     enum t_relay_status status;        /* status (connecting, active,..)    */
@@ -121,7 +132,7 @@ struct t_relay_client
     time_t start_time;                 /* time of client connection         */
     time_t end_time;                   /* time of client disconnection      */
     struct t_hook *hook_fd;            /* hook for socket or child pipe     */
-    struct t_hook *hook_timer_send;    /* timer to quickly flush outqueue   */
+                                       /* (writable if outqueue is used)    */
     time_t last_activity;              /* time of last byte received/sent   */
     unsigned long long bytes_recv;     /* bytes received from client        */
     unsigned long long bytes_sent;     /* bytes sent to client              */
@@ -131,6 +142,7 @@ struct t_relay_client
     void *protocol_data;               /* data depending on protocol used   */
     struct t_relay_client_outqueue *outqueue; /* queue for outgoing msgs    */
     struct t_relay_client_outqueue *last_outqueue; /* last outgoing msg     */
+    unsigned long long outqueue_size;  /* bytes waiting in outqueue         */
     struct t_relay_client *prev_client;/* link to previous client           */
     struct t_relay_client *next_client;/* link to next client               */
 };
@@ -149,6 +161,17 @@ extern int relay_client_status_search (const char *name);
 extern int relay_client_count_active_by_port (int server_port);
 extern void relay_client_set_desc (struct t_relay_client *client);
 extern int relay_client_recv_cb (const void *pointer, void *data, int fd);
+extern struct t_relay_client_payload *relay_client_payload_new (char *data,
+                                                                int size,
+                                                                int copy);
+extern void relay_client_payload_unref (struct t_relay_client_payload *payload);
+extern void relay_client_outqueue_free_all (struct t_relay_client *client);
+extern void relay_client_send_outqueue (struct t_relay_client *client);
+extern int relay_client_send_payload (struct t_relay_client *client,
+                                      enum t_relay_client_msg_type msg_type,
+                                      const char *data, int data_size,
+                                      struct t_relay_client_payload **payload,
+                                      const char *message_raw_buffer);
 extern int relay_client_send (struct t_relay_client *client,
                               enum t_relay_client_msg_type msg_type,
                               const char *data,
@@ -31,6 +31,7 @@
 #include "relay-network.h"
 #include "relay-raw.h"
 #include "relay-server.h"
+#include "weechat/relay-weechat.h"
 
 
 /*
@@ -108,6 +109,9 @@ relay_command_client_list (int full)
                             RELAY_COLOR_CHAT,
                             date_start);
         }
+
+        if (ptr_client->protocol == RELAY_PROTOCOL_WEECHAT)
+            relay_weechat_display_compression (ptr_client);
     }
 
     if (num_found == 0)
@@ -76,6 +76,7 @@ struct t_config_option *relay_config_network_clients_purge_delay = NULL;
 struct t_config_option *relay_config_network_compression = NULL;
 struct t_config_option *relay_config_network_ipv6 = NULL;
 struct t_config_option *relay_config_network_max_clients = NULL;
+struct t_config_option *relay_config_network_max_outqueue_size = NULL;
 struct t_config_option *relay_config_network_nonce_size = NULL;
 struct t_config_option *relay_config_network_password = NULL;
 struct t_config_option *relay_config_network_password_hash_algo = NULL;
@@ -85,6 +86,7 @@ struct t_config_option *relay_config_network_ssl_priorities = NULL;
 struct t_config_option *relay_config_network_totp_secret = NULL;
 struct t_config_option *relay_config_network_totp_window = NULL;
 struct t_config_option *relay_config_network_websocket_allowed_origins = NULL;
+struct t_config_option *relay_config_network_websocket_permessage_deflate = NULL;
 
 /* relay config, irc section */
 
@@ -1073,7 +1075,9 @@ relay_config_init ()
             relay_config_file, relay_config_section_network,
             "compression", "integer",
             N_("compression of messages sent to clients with \"weechat\" "
-               "protocol: 0 = disable compression, 1 = low compression / fast "
+               "protocol and websocket clients using extension "
+               "\"permessage-deflate\": "
+               "0 = disable compression, 1 = low compression / fast "
                "... 100 = best compression / slow; the value is a percentage "
                "converted to 1-9 for zlib and 1-19 for zstd; "
                "the default value is recommended, it offers a good "
@@ -1096,6 +1100,14 @@ relay_config_init ()
             N_("maximum number of clients connecting to a port (0 = no limit)"),
             NULL, 0, INT_MAX, "5", NULL, 0,
             NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+        relay_config_network_max_outqueue_size = weechat_config_new_option (
+            relay_config_file, relay_config_section_network,
+            "max_outqueue_size", "integer",
+            N_("maximum size of data waiting to be sent to a client, in "
+               "kilobytes (0 = no limit); if this size is reached (client too "
+               "slow or not reading data), the client is disconnected"),
+            NULL, 0, INT_MAX / 1024, "65536", NULL, 0,
+            NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
         relay_config_network_nonce_size = weechat_config_new_option (
             relay_config_file, relay_config_section_network,
             "nonce_size", "integer",
@@ -1197,6 +1209,16 @@ relay_config_init ()
             NULL, NULL, NULL,
             &relay_config_change_network_websocket_allowed_origins, NULL, NULL,
             NULL, NULL, NULL);
+        relay_config_network_websocket_permessage_deflate = weechat_config_new_option (
+            relay_config_file, relay_config_section_network,
+            "websocket_permessage_deflate", "boolean",
+            N_("enable websocket extension \"permessage-deflate\" (RFC 7692) "
+               "to compress data sent and received, if the client offers it; "
+               "the compression level is set by option "
+               "relay.network.compression; the new value is used only for "
+               "new websocket clients"),
+            NULL, 0, 0, "off", NULL, 0,
+            NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
     }
 
     /* section irc */
@@ -37,6 +37,79 @@
  */
 #define WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
 
+/*
+ * bytes removed at the end of each message compressed with extension
+ * "permessage-deflate", and added before decompressing it (RFC 7692)
+ */
+static unsigned char relay_websocket_deflate_tail[4] = { 0x00, 0x00, 0xFF, 0xFF };
+
+
+/*
+ * Allocates a t_relay_websocket_deflate structure (extension
+ * "permessage-deflate" is disabled by default).
+ *
+ * Returns pointer to new structure, NULL if error.
+ */
+
+struct t_relay_websocket_deflate *
+relay_websocket_deflate_alloc ()
+{
+    struct t_relay_websocket_deflate *new_ws_deflate;
+
+    new_ws_deflate = malloc (sizeof (*new_ws_deflate));
+    if (!new_ws_deflate)
+        return NULL;
+
+    new_ws_deflate->enabled = 0;
+    new_ws_deflate->server_context_takeover = 1;
+    new_ws_deflate->client_context_takeover = 1;
+    new_ws_deflate->window_bits_deflate = 15;
+    new_ws_deflate->window_bits_inflate = 15;
+    new_ws_deflate->strm_deflate = NULL;
+    new_ws_deflate->strm_inflate = NULL;
+
+    return new_ws_deflate;
+}
+
+/*
+ * Frees deflate and inflate streams.
+ */
+
+void
+relay_websocket_deflate_free_streams (struct t_relay_websocket_deflate *ws_deflate)
+{
+    if (!ws_deflate)
+        return;
+
+    if (ws_deflate->strm_deflate)
+    {
+        deflateEnd (ws_deflate->strm_deflate);
+        free (ws_deflate->strm_deflate);
+        ws_deflate->strm_deflate = NULL;
+    }
+    if (ws_deflate->strm_inflate)
+    {
+        inflateEnd (ws_deflate->strm_inflate);
+        free (ws_deflate->strm_inflate);
+        ws_deflate->strm_inflate = NULL;
+    }
+}
+
+/*
+ * Frees a t_relay_websocket_deflate structure.
+ */
+
+void
+relay_websocket_deflate_free (struct t_relay_websocket_deflate *ws_deflate)
+{
+    if (!ws_deflate)
+        return;
+
+    relay_websocket_deflate_free_streams (ws_deflate);
+
+    free (ws_deflate);
+}
+
 
 /*
  * Checks if a message is a HTTP GET with resource "/weechat".
@@ -176,6 +249,159 @@ relay_websocket_client_handshake_valid (struct t_relay_client *client)
     return 0;
 }
 
+/*
+ * Parses the value of a "max_window_bits" parameter of extension
+ * "permessage-deflate".
+ *
+ * Returns the number of bits (between 8 and 15), -1 if the value is invalid.
+ */
+
+int
+relay_websocket_parse_window_bits (const char *value)
+{
+    char *error;
+    long number;
+
+    if (!value || !value[0])
+        return -1;
+
+    error = NULL;
+    number = strtol (value, &error, 10);
+    if (!error || error[0] || (number < 8) || (number > 15))
+        return -1;
+
+    return (int)number;
+}
+
+/*
+ * Parses the HTTP header "Sec-WebSocket-Extensions" sent by client and
+ * enables extension "permessage-deflate" (RFC 7692) if it is offered by the
+ * client with parameters supported by WeeChat.
+ *
+ * The header looks like:
+ *   permessage-deflate; client_max_window_bits, x-webkit-deflate-frame
+ *
+ * Offers are checked in order, the first valid "permessage-deflate" offer is
+ * accepted.
+ */
+
+void
+relay_websocket_parse_extensions (const char *extensions,
+                                  struct t_relay_websocket_deflate *ws_deflate)
+{
+    char **exts, **params, *pos, *name, *value;
+    int i, j, num_exts, num_params, valid, flags, bits;
+    int server_context_takeover, client_context_takeover;
+    int window_bits_deflate, window_bits_inflate;
+
+    if (!extensions || !ws_deflate)
+        return;
+
+    if (!weechat_config_boolean (relay_config_network_websocket_permessage_deflate)
+        || (weechat_config_integer (relay_config_network_compression) == 0))
+    {
+        return;
+    }
+
+    flags = WEECHAT_STRING_SPLIT_STRIP_LEFT
+        | WEECHAT_STRING_SPLIT_STRIP_RIGHT
+        | WEECHAT_STRING_SPLIT_COLLAPSE_SEPS;
+
+    exts = weechat_string_split (extensions, ",", " ", flags, 0, &num_exts);
+    if (!exts)
+        return;
+
+    for (i = 0; (i < num_exts) && !ws_deflate->enabled; i++)
+    {
+        params = weechat_string_split (exts[i], ";", " ", flags, 0,
+                                       &num_params);
+        if (!params)
+            continue;
+        if ((num_params > 0)
+            && (strcmp (params[0], "permessage-deflate") == 0))
+        {
+            valid = 1;
+            server_context_takeover = 1;
+            client_context_takeover = 1;
+            window_bits_deflate = 15;
+            window_bits_inflate = 15;
+            for (j = 1; valid && (j < num_params); j++)
+            {
+                pos = strchr (params[j], '=');
+                if (pos)
+                {
+                    name = weechat_strndup (params[j], pos - params[j]);
+                    value = weechat_string_remove_quotes (pos + 1, "\"");
+                }
+                else
+                {
+                    name = strdup (params[j]);
+                    value = NULL;
+                }
+                if (!name)
+                {
+                    if (value)
+                        free (value);
+                    valid = 0;
+                    break;
+                }
+                if (strcmp (name, "server_no_context_takeover") == 0)
+                {
+                    server_context_takeover = 0;
+                    if (value)
+                        valid = 0;
+                }
+                else if (strcmp (name, "client_no_context_takeover") == 0)
+                {
+                    client_context_takeover = 0;
+                    if (value)
+                        valid = 0;
+                }
+                else if (strcmp (name, "server_max_window_bits") == 0)
+                {
+                    /* zlib does not support 8 bits for a raw deflate */
+                    bits = relay_websocket_parse_window_bits (value);
+                    if (bits < 9)
+                        valid = 0;
+                    else
+                        window_bits_deflate = bits;
+                }
+                else if (strcmp (name, "client_max_window_bits") == 0)
+                {
+                    /* value is optional, it's just a hint without value */
+                    if (value)
+                    {
+                        bits = relay_websocket_parse_window_bits (value);
+                        if (bits < 0)
+                            valid = 0;
+                        else
+                            window_bits_inflate = bits;
+                    }
+                }
+                else
+                {
+                    /* unknown parameter */
+                    valid = 0;
+                }
+                free (name);
+                if (value)
+                    free (value);
+            }
+            if (valid)
+            {
+                ws_deflate->enabled = 1;
+                ws_deflate->server_context_takeover = server_context_takeover;
+                ws_deflate->client_context_takeover = client_context_takeover;
+                ws_deflate->window_bits_deflate = window_bits_deflate;
+                ws_deflate->window_bits_inflate = window_bits_inflate;
+            }
+        }
+        weechat_string_free_split (params);
+    }
+
+    weechat_string_free_split (exts);
+}
+
 /*
  * Builds the handshake that will be returned to client, to initialize and use
  * the websocket.
@@ -185,6 +411,11 @@ relay_websocket_client_handshake_valid (struct t_relay_client *client)
  *   Upgrade: websocket
  *   Connection: Upgrade
  *   Sec-WebSocket-Accept: 73OzoF/IyV9znm7Tsb4EtlEEmn4=
+ *   Sec-WebSocket-Extensions: permessage-deflate
+ *
+ * The header "Sec-WebSocket-Extensions" is sent only if the extension
+ * "permessage-deflate" has been enabled for the client
+ * (see function relay_websocket_parse_extensions).
  *
  * Note: result must be freed after use.
  */
@@ -194,6 +425,7 @@ relay_websocket_build_handshake (struct t_relay_client *client)
 {
     const char *sec_websocket_key;
     char *key, sec_websocket_accept[128], handshake[1024], hash[160 / 8];
+    char extensions[256], *ptr_ext;
     int length, hash_size;
 
     sec_websocket_key = weechat_hashtable_get (client->http_headers,
@@ -226,14 +458,49 @@ relay_websocket_build_handshake (struct t_relay_client *client)
 
     free (key);
 
+    /* build the extensions accepted (with parameters applied) */
+    extensions[0] = '\0';
+    if (client->ws_deflate && client->ws_deflate->enabled)
+    {
+        ptr_ext = extensions;
+        ptr_ext += snprintf (ptr_ext, sizeof (extensions) - (ptr_ext - extensions),
+                             "Sec-WebSocket-Extensions: permessage-deflate");
+        if (!client->ws_deflate->server_context_takeover)
+        {
+            ptr_ext += snprintf (ptr_ext, sizeof (extensions) - (ptr_ext - extensions),
+                                 "; server_no_context_takeover");
+        }
+        if (!client->ws_deflate->client_context_takeover)
+        {
+            ptr_ext += snprintf (ptr_ext, sizeof (extensions) - (ptr_ext - extensions),
+                                 "; client_no_context_takeover");
+        }
+        if (client->ws_deflate->window_bits_deflate < 15)
+        {
+            ptr_ext += snprintf (ptr_ext, sizeof (extensions) - (ptr_ext - extensions),
+                                 "; server_max_window_bits=%d",
+                                 client->ws_deflate->window_bits_deflate);
+        }
+        if (client->ws_deflate->window_bits_inflate < 15)
+        {
+            ptr_ext += snprintf (ptr_ext, sizeof (extensions) - (ptr_ext - extensions),
+                                 "; client_max_window_bits=%d",
+                                 client->ws_deflate->window_bits_inflate);
+        }
+        snprintf (ptr_ext, sizeof (extensions) - (ptr_ext - extensions),
+                  "\r\n");
+    }
+
     /* build the handshake (it will be sent as-is to client) */
     snprintf (handshake, sizeof (handshake),
               "HTTP/1.1 101 Switching Protocols\r\n"
               "Upgrade: websocket\r\n"
               "Connection: Upgrade\r\n"
               "Sec-WebSocket-Accept: %s\r\n"
+              "%s"
               "\r\n",
-              sec_websocket_accept);
+              sec_websocket_accept,
+              extensions);
 
     return strdup (handshake);
 }
@@ -263,31 +530,292 @@ relay_websocket_send_http (struct t_relay_client *client,
     }
 }
 
+/*
+ * Initializes the deflate stream (used to compress data sent to client).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+relay_websocket_deflate_init_stream_deflate (struct t_relay_websocket_deflate *ws_deflate)
+{
+    int compression, compression_level;
+
+    ws_deflate->strm_deflate = calloc (1, sizeof (*ws_deflate->strm_deflate));
+    if (!ws_deflate->strm_deflate)
+        return 0;
+
+    /* convert % to zlib compression level (1-9) */
+    compression = weechat_config_integer (relay_config_network_compression);
+    compression_level = (((compression - 1) * 9) / 100) + 1;
+
+    /* negative window bits: raw deflate, without zlib header */
+    if (deflateInit2 (ws_deflate->strm_deflate,
+                      compression_level,
+                      Z_DEFLATED,
+                      -(ws_deflate->window_bits_deflate),
+                      8,
+                      Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        free (ws_deflate->strm_deflate);
+        ws_deflate->strm_deflate = NULL;
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Initializes the inflate stream (used to decompress data received from
+ * client).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+relay_websocket_deflate_init_stream_inflate (struct t_relay_websocket_deflate *ws_deflate)
+{
+    ws_deflate->strm_inflate = calloc (1, sizeof (*ws_deflate->strm_inflate));
+    if (!ws_deflate->strm_inflate)
+        return 0;
+
+    /*
+     * negative window bits: raw inflate, without zlib header;
+     * the window bits negotiated with client (client_max_window_bits) are
+     * a limit for the client compressor only: the max window is always used
+     * to decompress, so that any data compressed by client can be inflated
+     */
+    if (inflateInit2 (ws_deflate->strm_inflate, -MAX_WBITS) != Z_OK)
+    {
+        free (ws_deflate->strm_inflate);
+        ws_deflate->strm_inflate = NULL;
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Compresses data with the deflate stream (extension "permessage-deflate").
+ *
+ * The 4 bytes 0x00 0x00 0xFF 0xFF at the end of compressed data are removed
+ * (RFC 7692, section 7.2.1).
+ *
+ * Returns compressed data, NULL if error.
+ * Argument "size_deflated" is set with the size of compressed data.
+ *
+ * Note: result must be freed after use.
+ */
+
+unsigned char *
+relay_websocket_deflate (struct t_relay_websocket_deflate *ws_deflate,
+                         const char *data, unsigned long long size,
+                         unsigned long long *size_deflated)
+{
+    unsigned char *deflated, *deflated2;
+    unsigned long long deflated_alloc;
+    int rc;
+
+    *size_deflated = 0;
+
+    if (!ws_deflate->strm_deflate
+        && !relay_websocket_deflate_init_stream_deflate (ws_deflate))
+    {
+        return NULL;
+    }
+
+    deflated_alloc = size + 64;
+    deflated = malloc (deflated_alloc);
+    if (!deflated)
+        return NULL;
+
+    ws_deflate->strm_deflate->next_in = (Bytef *)data;
+    ws_deflate->strm_deflate->avail_in = size;
+    while (1)
+    {
+        ws_deflate->strm_deflate->next_out = deflated + *size_deflated;
+        ws_deflate->strm_deflate->avail_out = deflated_alloc - *size_deflated;
+        rc = deflate (ws_deflate->strm_deflate, Z_SYNC_FLUSH);
+        if ((rc != Z_OK) && (rc != Z_BUF_ERROR))
+            goto error;
+        *size_deflated = deflated_alloc - ws_deflate->strm_deflate->avail_out;
+        if (ws_deflate->strm_deflate->avail_out > 0)
+            break;
+        deflated2 = realloc (deflated, deflated_alloc * 2);
+        if (!deflated2)
+            goto error;
+        deflated = deflated2;
+        deflated_alloc *= 2;
+    }
+
+    /* remove the empty block added by the sync flush */
+    if ((*size_deflated >= 4)
+        && (memcmp (deflated + *size_deflated - 4,
+                    relay_websocket_deflate_tail, 4) == 0))
+    {
+        *size_deflated -= 4;
+    }
+
+    /*
+     * nothing was flushed (empty message right after another flush): send an
+     * empty stored block without its tail (RFC 7692, section 7.2.3.6)
+     */
+    if (*size_deflated == 0)
+    {
+        deflated[0] = 0x00;
+        *size_deflated = 1;
+    }
+
+    if (!ws_deflate->server_context_takeover)
+        deflateReset (ws_deflate->strm_deflate);
+
+    return deflated;
+
+error:
+    free (deflated);
+    *size_deflated = 0;
+    /* the stream can not be used any more */
+    deflateEnd (ws_deflate->strm_deflate);
+    free (ws_deflate->strm_deflate);
+    ws_deflate->strm_deflate = NULL;
+    return NULL;
+}
+
+/*
+ * Decompresses data with the inflate stream (extension "permessage-deflate"),
+ * and adds it to the decoded data (which is reallocated if needed).
+ *
+ * The 4 bytes 0x00 0x00 0xFF 0xFF are added at the end of data before
+ * decompressing it (RFC 7692, section 7.2.2).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+relay_websocket_inflate (struct t_relay_websocket_deflate *ws_deflate,
+                         const unsigned char *data, unsigned long long size,
+                         unsigned char **decoded,
+                         unsigned long long *decoded_alloc,
+                         unsigned long long *decoded_length)
+{
+    unsigned char *decoded2;
+    int i, rc;
+
+    /* empty payload: nothing to decompress */
+    if (size == 0)
+        return 1;
+
+    if (!ws_deflate->strm_inflate
+        && !relay_websocket_deflate_init_stream_inflate (ws_deflate))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+        ws_deflate->strm_inflate->next_in = (i == 0) ?
+            (Bytef *)data : relay_websocket_deflate_tail;
+        ws_deflate->strm_inflate->avail_in = (i == 0) ? size : 4;
+        while (1)
+        {
+            /* keep room for the final '\0' */
+            if (*decoded_length + 1 >= *decoded_alloc)
+            {
+                decoded2 = realloc (*decoded, *decoded_alloc * 2);
+                if (!decoded2)
+                    return 0;
+                *decoded = decoded2;
+                *decoded_alloc *= 2;
+            }
+            ws_deflate->strm_inflate->next_out = *decoded + *decoded_length;
+            ws_deflate->strm_inflate->avail_out = *decoded_alloc - *decoded_length - 1;
+            rc = inflate (ws_deflate->strm_inflate, Z_SYNC_FLUSH);
+            if ((rc != Z_OK) && (rc != Z_BUF_ERROR) && (rc != Z_STREAM_END))
+                return 0;
+            *decoded_length = *decoded_alloc - 1 - ws_deflate->strm_inflate->avail_out;
+            if (rc == Z_STREAM_END)
+            {
+                /* final block received: next message starts a new stream */
+                inflateReset (ws_deflate->strm_inflate);
+                break;
+            }
+            if ((ws_deflate->strm_inflate->avail_in == 0)
+                && (ws_deflate->strm_inflate->avail_out > 0))
+            {
+                break;
+            }
+            if ((rc == Z_BUF_ERROR) && (ws_deflate->strm_inflate->avail_out > 0))
+                return 0;
+        }
+        if (rc == Z_STREAM_END)
+            break;
+    }
+
+    if (!ws_deflate->client_context_takeover)
+        inflateReset (ws_deflate->strm_inflate);
+
+    return 1;
+}
+
 /*
  * Decodes a websocket frame.
  *
+ * The decoded data contains, for each frame: the message type (one byte),
+ * the payload (uncompressed if extension "permessage-deflate" is used and if
+ * the frame is compressed) and a final '\0'.
+ *
  * Returns:
  *   1: frame decoded successfully
  *   0: error decoding frame (connection must be closed if it happens)
+ *
+ * Note: *decoded must be freed after use (it is allocated even in case of
+ * error).
  */
 
 int
 relay_websocket_decode_frame (const unsigned char *buffer,
                               unsigned long long buffer_length,
-                              unsigned char *decoded,
+                              struct t_relay_websocket_deflate *ws_deflate,
+                              unsigned char **decoded,
                               unsigned long long *decoded_length)
 {
     unsigned long long i, index_buffer, length_frame_size, length_frame;
-    unsigned char opcode;
+    unsigned long long decoded_alloc;
+    unsigned char opcode, *decoded2, *payload;
+    int compressed, rc;
 
     *decoded_length = 0;
     index_buffer = 0;
 
+    /* a frame is at least 6 bytes, so the decoded data is never bigger */
+    decoded_alloc = buffer_length + 1;
+    *decoded = malloc (decoded_alloc);
+    if (!*decoded)
+        return 0;
+
     /* loop to decode all frames in message */
     while (index_buffer + 1 < buffer_length)
     {
         opcode = buffer[index_buffer] & 15;
 
+        /*
+         * RSV1 bit is set if the frame is compressed, this is allowed only if
+         * extension "permessage-deflate" is used, and not in control frames
+         * (see RFC 7692)
+         */
+        compressed = (buffer[index_buffer] & WEBSOCKET_FRAME_RSV1) ? 1 : 0;
+        if (compressed
+            && (!ws_deflate || !ws_deflate->enabled || (opcode & 0x08)))
+        {
+            return 0;
+        }
+
         /*
          * check if frame is masked: client MUST send a masked frame; if frame is
          * not masked, we MUST reject it and close the connection (see RFC 6455)
@@ -327,13 +855,13 @@ relay_websocket_decode_frame (const unsigned char *buffer,
         switch (opcode)
         {
             case WEBSOCKET_FRAME_OPCODE_PING:
-                decoded[*decoded_length] = RELAY_CLIENT_MSG_PING;
+                (*decoded)[*decoded_length] = RELAY_CLIENT_MSG_PING;
                 break;
             case WEBSOCKET_FRAME_OPCODE_CLOSE:
-                decoded[*decoded_length] = RELAY_CLIENT_MSG_CLOSE;
+                (*decoded)[*decoded_length] = RELAY_CLIENT_MSG_CLOSE;
                 break;
             default:
-                decoded[*decoded_length] = RELAY_CLIENT_MSG_STANDARD;
+                (*decoded)[*decoded_length] = RELAY_CLIENT_MSG_STANDARD;
                 break;
         }
         *decoded_length += 1;
@@ -344,12 +872,42 @@ relay_websocket_decode_frame (const unsigned char *buffer,
         {
             return 0;
         }
-        for (i = 0; i < length_frame; i++)
+        if (compressed)
         {
-            decoded[*decoded_length + i] = (int)((unsigned char)buffer[index_buffer + i]) ^ masks[i % 4];
+            payload = malloc (length_frame + 1);
+            if (!payload)
+                return 0;
+            for (i = 0; i < length_frame; i++)
+            {
+                payload[i] = (int)((unsigned char)buffer[index_buffer + i]) ^ masks[i % 4];
+            }
+            rc = relay_websocket_inflate (ws_deflate, payload, length_frame,
+                                          decoded, &decoded_alloc,
+                                          decoded_length);
+            free (payload);
+            if (!rc)
+                return 0;
+            (*decoded)[*decoded_length] = '\0';
+            *decoded_length += 1;
+            /* keep room for the uncompressed frames that follow */
+            if (decoded_alloc - *decoded_length < buffer_length + 1)
+            {
+                decoded2 = realloc (*decoded, *decoded_length + buffer_length + 1);
+                if (!decoded2)
+                    return 0;
+                *decoded = decoded2;
+                decoded_alloc = *decoded_length + buffer_length + 1;
+            }
+        }
+        else
+        {
+            for (i = 0; i < length_frame; i++)
+            {
+                (*decoded)[*decoded_length + i] = (int)((unsigned char)buffer[index_buffer + i]) ^ masks[i % 4];
+            }
+            (*decoded)[*decoded_length + length_frame] = '\0';
+            *decoded_length += length_frame + 1;
         }
-        decoded[*decoded_length + length_frame] = '\0';
-        *decoded_length += length_frame + 1;
         index_buffer += length_frame;
     }
 
@@ -359,6 +917,9 @@ relay_websocket_decode_frame (const unsigned char *buffer,
 /*
  * Encodes data in a websocket frame.
  *
+ * If extension "permessage-deflate" is used (ws_deflate is not NULL and
+ * enabled), data frames (text and binary) are compressed.
+ *
  * Returns websocket frame, NULL if error.
  * Argument "length_frame" is set with the length of frame built.
  *
@@ -366,22 +927,44 @@ relay_websocket_decode_frame (const unsigned char *buffer,
  */
 
 char *
-relay_websocket_encode_frame (int opcode,
+relay_websocket_encode_frame (struct t_relay_websocket_deflate *ws_deflate,
+                              int opcode,
                               const char *buffer,
                               unsigned long long length,
                               unsigned long long *length_frame)
 {
-    unsigned char *frame;
-    unsigned long long index;
+    unsigned char *frame, *deflated;
+    unsigned long long index, length_deflated;
 
     *length_frame = 0;
 
+    deflated = NULL;
+    if (ws_deflate && ws_deflate->enabled
+        && ((opcode == WEBSOCKET_FRAME_OPCODE_TEXT)
+            || (opcode == WEBSOCKET_FRAME_OPCODE_BINARY)))
+    {
+        /* if compression fails, the frame is sent uncompressed */
+        deflated = relay_websocket_deflate (ws_deflate, buffer, length,
+                                            &length_deflated);
+        if (deflated)
+        {
+            buffer = (const char *)deflated;
+            length = length_deflated;
+        }
+    }
+
     frame = malloc (length + 10);
     if (!frame)
+    {
+        if (deflated)
+            free (deflated);
         return NULL;
+    }
 
     frame[0] = 0x80;
     frame[0] |= opcode;
+    if (deflated)
+        frame[0] |= WEBSOCKET_FRAME_RSV1;
 
     if (length <= 125)
     {
@@ -417,5 +1000,8 @@ relay_websocket_encode_frame (int opcode,
 
     *length_frame = index + length;
 
+    if (deflated)
+        free (deflated);
+
     return (char *)frame;
 }
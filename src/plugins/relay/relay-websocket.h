@@ -20,6 +20,8 @@
 #ifndef WEECHAT_PLUGIN_RELAY_WEBSOCKET_H
 #define WEECHAT_PLUGIN_RELAY_WEBSOCKET_H
 
+#include <zlib.h>
+
 #define WEBSOCKET_FRAME_OPCODE_CONTINUATION 0x00
 #define WEBSOCKET_FRAME_OPCODE_TEXT         0x01
 #define WEBSOCKET_FRAME_OPCODE_BINARY       0x02
@@ -27,18 +29,42 @@
 #define WEBSOCKET_FRAME_OPCODE_PING         0x09
 #define WEBSOCKET_FRAME_OPCODE_PONG         0x0A
 
+#define WEBSOCKET_FRAME_RSV1                0x40
+
+/* websocket extension "permessage-deflate" (RFC 7692) */
+
+struct t_relay_websocket_deflate
+{
+    int enabled;                       /* 1 if permessage-deflate is used   */
+    int server_context_takeover;       /* 1 if deflate stream is kept       */
+    int client_context_takeover;       /* 1 if inflate stream is kept       */
+    int window_bits_deflate;           /* window bits for deflate (9-15)    */
+    int window_bits_inflate;           /* window bits for client (8-15)     */
+    z_stream *strm_deflate;            /* stream to compress sent data      */
+    z_stream *strm_inflate;            /* stream to decompress recv data    */
+};
+
+extern struct t_relay_websocket_deflate *relay_websocket_deflate_alloc ();
+extern int relay_websocket_deflate_init_stream_deflate (struct t_relay_websocket_deflate *ws_deflate);
+extern int relay_websocket_deflate_init_stream_inflate (struct t_relay_websocket_deflate *ws_deflate);
+extern void relay_websocket_deflate_free_streams (struct t_relay_websocket_deflate *ws_deflate);
+extern void relay_websocket_deflate_free (struct t_relay_websocket_deflate *ws_deflate);
 extern int relay_websocket_is_http_get_weechat (const char *message);
 extern void relay_websocket_save_header (struct t_relay_client *client,
                                          const char *message);
 extern int relay_websocket_client_handshake_valid (struct t_relay_client *client);
+extern void relay_websocket_parse_extensions (const char *extensions,
+                                             struct t_relay_websocket_deflate *ws_deflate);
 extern char *relay_websocket_build_handshake (struct t_relay_client *client);
 extern void relay_websocket_send_http (struct t_relay_client *client,
                                        const char *http);
 extern int relay_websocket_decode_frame (const unsigned char *buffer,
                                          unsigned long long length,
-                                         unsigned char *decoded,
+                                         struct t_relay_websocket_deflate *ws_deflate,
+                                         unsigned char **decoded,
                                          unsigned long long *decoded_length);
-extern char *relay_websocket_encode_frame (int opcode,
+extern char *relay_websocket_encode_frame (struct t_relay_websocket_deflate *ws_deflate,
+                                           int opcode,
                                            const char *buffer,
                                            unsigned long long length,
                                            unsigned long long *length_frame);
@@ -52,6 +52,7 @@ struct t_relay_weechat_msg *
 relay_weechat_msg_new (const char *id)
 {
     struct t_relay_weechat_msg *new_msg;
+    int i;
 
     new_msg = malloc (sizeof (*new_msg));
     if (!new_msg)
@@ -66,6 +67,13 @@ relay_weechat_msg_new (const char *id)
     }
     new_msg->data_alloc = RELAY_WEECHAT_MSG_INITIAL_ALLOC;
     new_msg->data_size = 0;
+    for (i = 0; i < RELAY_WEECHAT_NUM_COMPRESSIONS; i++)
+    {
+        new_msg->compressed_data[i] = NULL;
+        new_msg->compressed_size[i] = 0;
+        new_msg->compressed_raw[i] = NULL;
+        new_msg->payload[i] = NULL;
+    }
 
     /* add size and compression flag (they will be set later) */
     relay_weechat_msg_add_int (new_msg, 0);
@@ -1030,14 +1038,16 @@ relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
 /*
  * Compresses the message with zlib.
  *
+ * The compressed data is kept in message, so that the message is compressed
+ * only once when it is sent to multiple clients.
+ *
  * Returns:
- *   1: OK, message compressed and sent
- *   0: error, no message sent
+ *   1: OK, message compressed
+ *   0: error, message not compressed
  */
 
 int
-relay_weechat_msg_compress_zlib (struct t_relay_client *client,
-                                 struct t_relay_weechat_msg *msg)
+relay_weechat_msg_compress_zlib (struct t_relay_weechat_msg *msg)
 {
     char raw_message[1024];
     uint32_t size32;
@@ -1045,10 +1055,7 @@ relay_weechat_msg_compress_zlib (struct t_relay_client *client,
     uLongf dest_size;
     struct timeval tv1, tv2;
     long long time_diff;
-    int rc, rc_compress, compression, compression_level;
-
-    rc = 0;
-    dest = NULL;
+    int rc_compress, compression, compression_level;
 
     dest_size = compressBound (msg->data_size - 5);
     dest = malloc (dest_size + 5);
@@ -1076,7 +1083,7 @@ relay_weechat_msg_compress_zlib (struct t_relay_client *client,
     memcpy (dest, &size32, 4);
     dest[4] = RELAY_WEECHAT_COMPRESSION_ZLIB;
 
-    /* display message in raw buffer */
+    /* message displayed in raw buffer */
     snprintf (raw_message, sizeof (raw_message),
               "obj: %d/%d bytes (zlib: %d%%, %.2fms), id: %s",
               (int)dest_size + 5,
@@ -1085,31 +1092,33 @@ relay_weechat_msg_compress_zlib (struct t_relay_client *client,
               ((float)time_diff) / 1000,
               msg->id);
 
-    /* send compressed data */
-    relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
-                       (const char *)dest, dest_size + 5,
-                       raw_message);
+    msg->compressed_data[RELAY_WEECHAT_COMPRESSION_ZLIB] = (char *)dest;
+    msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZLIB] = dest_size + 5;
+    msg->compressed_raw[RELAY_WEECHAT_COMPRESSION_ZLIB] = strdup (raw_message);
 
-    rc = 1;
+    return 1;
 
 error:
     if (dest)
         free (dest);
+    msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZLIB] = -1;
 
-    return rc;
+    return 0;
 }
 
 /*
  * Compresses the message with zstd.
  *
+ * The compressed data is kept in message, so that the message is compressed
+ * only once when it is sent to multiple clients.
+ *
  * Returns:
- *   1: OK, message compressed and sent
- *   0: error, no message sent
+ *   1: OK, message compressed
+ *   0: error, message not compressed
  */
 
 int
-relay_weechat_msg_compress_zstd (struct t_relay_client *client,
-                                 struct t_relay_weechat_msg *msg)
+relay_weechat_msg_compress_zstd (struct t_relay_weechat_msg *msg)
 {
     char raw_message[1024];
     uint32_t size32;
@@ -1117,10 +1126,7 @@ relay_weechat_msg_compress_zstd (struct t_relay_client *client,
     size_t dest_size, comp_size;
     struct timeval tv1, tv2;
     long long time_diff;
-    int rc, compression, compression_level;
-
-    rc = 0;
-    dest = NULL;
+    int compression, compression_level;
 
     dest_size = ZSTD_compressBound (msg->data_size - 5);
     dest = malloc (dest_size + 5);
@@ -1148,7 +1154,7 @@ relay_weechat_msg_compress_zstd (struct t_relay_client *client,
     memcpy (dest, &size32, 4);
     dest[4] = RELAY_WEECHAT_COMPRESSION_ZSTD;
 
-    /* display message in raw buffer */
+    /* message displayed in raw buffer */
     snprintf (raw_message, sizeof (raw_message),
               "obj: %d/%d bytes (zstd: %d%%, %.2fms), id: %s",
               (int)comp_size + 5,
@@ -1157,22 +1163,272 @@ relay_weechat_msg_compress_zstd (struct t_relay_client *client,
               ((float)time_diff) / 1000,
               msg->id);
 
-    /* send compressed data */
-    relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
-                       (const char *)dest, comp_size + 5,
-                       raw_message);
+    msg->compressed_data[RELAY_WEECHAT_COMPRESSION_ZSTD] = (char *)dest;
+    msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZSTD] = comp_size + 5;
+    msg->compressed_raw[RELAY_WEECHAT_COMPRESSION_ZSTD] = strdup (raw_message);
 
-    rc = 1;
+    return 1;
 
 error:
     if (dest)
         free (dest);
+    msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZSTD] = -1;
 
-    return rc;
+    return 0;
+}
+
+/*
+ * Compresses the message with the zlib stream of client: the stream is kept
+ * for the whole session, so that the messages are compressed against the
+ * previous ones (each message is ended with a sync flush, so that the client
+ * can decompress it immediately).
+ *
+ * Returns:
+ *   1: OK, compressed data is in *dest (with size and compression flag)
+ *   0: error
+ *
+ * Note: *dest must be freed after use.
+ */
+
+int
+relay_weechat_msg_compress_zlib_stream (struct t_relay_client *client,
+                                        struct t_relay_weechat_msg *msg,
+                                        char **dest, int *dest_size)
+{
+    z_stream *stream;
+    char *dest2;
+    int dest_alloc, rc, compression, compression_level;
+
+    *dest = NULL;
+    *dest_size = 0;
+
+    stream = RELAY_WEECHAT_DATA(client, zlib_stream);
+    if (!stream)
+    {
+        stream = calloc (1, sizeof (*stream));
+        if (!stream)
+            return 0;
+        /* convert % to zlib compression level (1-9) */
+        compression = weechat_config_integer (relay_config_network_compression);
+        compression_level = (((compression - 1) * 9) / 100) + 1;
+        if (deflateInit (stream, compression_level) != Z_OK)
+        {
+            free (stream);
+            return 0;
+        }
+        RELAY_WEECHAT_DATA(client, zlib_stream) = stream;
+    }
+
+    dest_alloc = msg->data_size + 64;
+    *dest = malloc (dest_alloc);
+    if (!*dest)
+        return 0;
+
+    stream->next_in = (Bytef *)(msg->data + 5);
+    stream->avail_in = msg->data_size - 5;
+    *dest_size = 5;
+    while (1)
+    {
+        stream->next_out = (Bytef *)(*dest + *dest_size);
+        stream->avail_out = dest_alloc - *dest_size;
+        rc = deflate (stream, Z_SYNC_FLUSH);
+        if ((rc != Z_OK) && (rc != Z_BUF_ERROR))
+            goto error;
+        *dest_size = dest_alloc - stream->avail_out;
+        if (stream->avail_out > 0)
+            break;
+        dest2 = realloc (*dest, dest_alloc * 2);
+        if (!dest2)
+            goto error;
+        *dest = dest2;
+        dest_alloc *= 2;
+    }
+
+    return 1;
+
+error:
+    free (*dest);
+    *dest = NULL;
+    *dest_size = 0;
+    return 0;
+}
+
+/*
+ * Compresses the message with the zstd stream of client: the stream is kept
+ * for the whole session, so that the messages are compressed against the
+ * previous ones (the stream is flushed after each message, so that the client
+ * can decompress it immediately).
+ *
+ * Returns:
+ *   1: OK, compressed data is in *dest (with size and compression flag)
+ *   0: error
+ *
+ * Note: *dest must be freed after use.
+ */
+
+int
+relay_weechat_msg_compress_zstd_stream (struct t_relay_client *client,
+                                        struct t_relay_weechat_msg *msg,
+                                        char **dest, int *dest_size)
+{
+    ZSTD_CStream *stream;
+    ZSTD_inBuffer buffer_in;
+    ZSTD_outBuffer buffer_out;
+    char *dest2;
+    size_t dest_alloc, rc;
+    int compression, compression_level;
+
+    *dest = NULL;
+    *dest_size = 0;
+
+    stream = RELAY_WEECHAT_DATA(client, zstd_stream);
+    if (!stream)
+    {
+        stream = ZSTD_createCStream ();
+        if (!stream)
+            return 0;
+        /* convert % to zstd compression level (1-19) */
+        compression = weechat_config_integer (relay_config_network_compression);
+        compression_level = (((compression - 1) * 19) / 100) + 1;
+        if (ZSTD_isError (ZSTD_initCStream (stream, compression_level)))
+        {
+            ZSTD_freeCStream (stream);
+            return 0;
+        }
+        RELAY_WEECHAT_DATA(client, zstd_stream) = stream;
+    }
+
+    dest_alloc = ZSTD_compressBound (msg->data_size - 5) + 5;
+    *dest = malloc (dest_alloc);
+    if (!*dest)
+        return 0;
+
+    buffer_in.src = msg->data + 5;
+    buffer_in.size = msg->data_size - 5;
+    buffer_in.pos = 0;
+    buffer_out.dst = *dest;
+    buffer_out.size = dest_alloc;
+    buffer_out.pos = 5;
+    while (1)
+    {
+        if (buffer_in.pos < buffer_in.size)
+        {
+            rc = ZSTD_compressStream (stream, &buffer_out, &buffer_in);
+            if (ZSTD_isError (rc))
+                goto error;
+        }
+        else
+        {
+            rc = ZSTD_flushStream (stream, &buffer_out);
+            if (ZSTD_isError (rc))
+                goto error;
+            if (rc == 0)
+                break;
+        }
+        if (buffer_out.pos == buffer_out.size)
+        {
+            dest2 = realloc (*dest, dest_alloc * 2);
+            if (!dest2)
+                goto error;
+            *dest = dest2;
+            dest_alloc *= 2;
+            buffer_out.dst = *dest;
+            buffer_out.size = dest_alloc;
+        }
+    }
+
+    *dest_size = buffer_out.pos;
+
+    return 1;
+
+error:
+    free (*dest);
+    *dest = NULL;
+    *dest_size = 0;
+    return 0;
+}
+
+/*
+ * Sends a message compressed with the stream of client.
+ *
+ * Returns:
+ *   1: OK, message compressed and sent
+ *   0: error, no message sent
+ */
+
+int
+relay_weechat_msg_send_stream (struct t_relay_client *client,
+                               struct t_relay_weechat_msg *msg)
+{
+    char *dest, raw_message[1024];
+    int rc, dest_size, ratio_total;
+    uint32_t size32;
+    enum t_relay_weechat_compression compression;
+    struct timeval tv1, tv2;
+    long long time_diff;
+
+    compression = RELAY_WEECHAT_DATA(client, compression);
+
+    gettimeofday (&tv1, NULL);
+    rc = (compression == RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM) ?
+        relay_weechat_msg_compress_zlib_stream (client, msg,
+                                                &dest, &dest_size) :
+        relay_weechat_msg_compress_zstd_stream (client, msg,
+                                                &dest, &dest_size);
+    gettimeofday (&tv2, NULL);
+    time_diff = weechat_util_timeval_diff (&tv1, &tv2);
+
+    if (!rc)
+    {
+        /*
+         * the stream can not be used any more (the client would not be able
+         * to decompress next messages): continue without stream
+         */
+        relay_weechat_msg_free_streams (client);
+        RELAY_WEECHAT_DATA(client, compression) =
+            (compression == RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM) ?
+            RELAY_WEECHAT_COMPRESSION_ZLIB : RELAY_WEECHAT_COMPRESSION_ZSTD;
+        return 0;
+    }
+
+    /* set size and compression flag */
+    size32 = htonl ((uint32_t)dest_size);
+    memcpy (dest, &size32, 4);
+    dest[4] = compression;
+
+    RELAY_WEECHAT_DATA(client, compression_bytes_in) += msg->data_size;
+    RELAY_WEECHAT_DATA(client, compression_bytes_out) += dest_size;
+    RELAY_WEECHAT_DATA(client, compression_time) += time_diff;
+    ratio_total = 100 - (int)((RELAY_WEECHAT_DATA(client, compression_bytes_out) * 100)
+                              / RELAY_WEECHAT_DATA(client, compression_bytes_in));
+
+    /* display message in raw buffer */
+    snprintf (raw_message, sizeof (raw_message),
+              "obj: %d/%d bytes (%s: %d%%, %.2fms, total: %d%%), id: %s",
+              dest_size,
+              msg->data_size,
+              relay_weechat_compression_string[compression],
+              100 - ((dest_size * 100) / msg->data_size),
+              ((float)time_diff) / 1000,
+              ratio_total,
+              msg->id);
+
+    /* send compressed data */
+    relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
+                       dest, dest_size, raw_message);
+
+    free (dest);
+
+    return 1;
 }
 
 /*
  * Sends a message.
+ *
+ * The message can be sent to multiple clients: it is compressed only once for
+ * each compression type (except with a stream, which is specific to each
+ * client), and if it can not be sent immediately, the data added in the out
+ * queue of clients is shared (it is copied only once).
  */
 
 void
@@ -1181,21 +1437,56 @@ relay_weechat_msg_send (struct t_relay_client *client,
 {
     char compression, raw_message[1024];
     uint32_t size32;
+    enum t_relay_weechat_compression client_compression;
+    struct timeval tv1, tv2;
 
-    if (weechat_config_integer (relay_config_network_compression) > 0)
+    client_compression = RELAY_WEECHAT_DATA(client, compression);
+
+    if ((weechat_config_integer (relay_config_network_compression) > 0)
+        && (client_compression > RELAY_WEECHAT_COMPRESSION_OFF)
+        && (client_compression < RELAY_WEECHAT_NUM_COMPRESSIONS))
     {
-        switch (RELAY_WEECHAT_DATA(client, compression))
+        if ((client_compression == RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM)
+            || (client_compression == RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM))
         {
-            case RELAY_WEECHAT_COMPRESSION_ZLIB:
-                if (relay_weechat_msg_compress_zlib (client, msg))
-                    return;
-                break;
-            case RELAY_WEECHAT_COMPRESSION_ZSTD:
-                if (relay_weechat_msg_compress_zstd (client, msg))
-                    return;
-                break;
-            default:
-                break;
+            if (relay_weechat_msg_send_stream (client, msg))
+                return;
+        }
+        else
+        {
+            if (msg->compressed_size[client_compression] == 0)
+            {
+                gettimeofday (&tv1, NULL);
+                switch (client_compression)
+                {
+                    case RELAY_WEECHAT_COMPRESSION_ZLIB:
+                        relay_weechat_msg_compress_zlib (msg);
+                        break;
+                    case RELAY_WEECHAT_COMPRESSION_ZSTD:
+                        relay_weechat_msg_compress_zstd (msg);
+                        break;
+                    default:
+                        break;
+                }
+                gettimeofday (&tv2, NULL);
+                RELAY_WEECHAT_DATA(client, compression_time) +=
+                    weechat_util_timeval_diff (&tv1, &tv2);
+            }
+            RELAY_WEECHAT_DATA(client, compression_bytes_in) += msg->data_size;
+            if (msg->compressed_size[client_compression] > 0)
+            {
+                RELAY_WEECHAT_DATA(client, compression_bytes_out) +=
+                    msg->compressed_size[client_compression];
+                /* send compressed data */
+                relay_client_send_payload (
+                    client, RELAY_CLIENT_MSG_STANDARD,
+                    msg->compressed_data[client_compression],
+                    msg->compressed_size[client_compression],
+                    &msg->payload[client_compression],
+                    msg->compressed_raw[client_compression]);
+                return;
+            }
+            RELAY_WEECHAT_DATA(client, compression_bytes_out) += msg->data_size;
         }
     }
 
@@ -1210,8 +1501,33 @@ relay_weechat_msg_send (struct t_relay_client *client,
     /* send uncompressed data */
     snprintf (raw_message, sizeof (raw_message),
               "obj: %d bytes, id: %s", msg->data_size, msg->id);
-    relay_client_send (client, RELAY_CLIENT_MSG_STANDARD,
-                       msg->data, msg->data_size, raw_message);
+    relay_client_send_payload (client, RELAY_CLIENT_MSG_STANDARD,
+                               msg->data, msg->data_size,
+                               &msg->payload[RELAY_WEECHAT_COMPRESSION_OFF],
+                               raw_message);
+}
+
+/*
+ * Frees compression streams of a client.
+ */
+
+void
+relay_weechat_msg_free_streams (struct t_relay_client *client)
+{
+    if (!client || !client->protocol_data)
+        return;
+
+    if (RELAY_WEECHAT_DATA(client, zlib_stream))
+    {
+        deflateEnd (RELAY_WEECHAT_DATA(client, zlib_stream));
+        free (RELAY_WEECHAT_DATA(client, zlib_stream));
+        RELAY_WEECHAT_DATA(client, zlib_stream) = NULL;
+    }
+    if (RELAY_WEECHAT_DATA(client, zstd_stream))
+    {
+        ZSTD_freeCStream (RELAY_WEECHAT_DATA(client, zstd_stream));
+        RELAY_WEECHAT_DATA(client, zstd_stream) = NULL;
+    }
 }
 
 /*
@@ -1221,6 +1537,8 @@ relay_weechat_msg_send (struct t_relay_client *client,
 void
 relay_weechat_msg_free (struct t_relay_weechat_msg *msg)
 {
+    int i;
+
     if (!msg)
         return;
 
@@ -1228,6 +1546,15 @@ relay_weechat_msg_free (struct t_relay_weechat_msg *msg)
         free (msg->id);
     if (msg->data)
         free (msg->data);
+    for (i = 0; i < RELAY_WEECHAT_NUM_COMPRESSIONS; i++)
+    {
+        if (msg->compressed_data[i])
+            free (msg->compressed_data[i]);
+        if (msg->compressed_raw[i])
+            free (msg->compressed_raw[i]);
+        if (msg->payload[i])
+            relay_client_payload_unref (msg->payload[i]);
+    }
 
     free (msg);
 }
@@ -22,6 +22,7 @@
 
 #include <time.h>
 
+struct t_relay_client_payload;
 struct t_relay_weechat_nicklist;
 
 #define RELAY_WEECHAT_MSG_INITIAL_ALLOC 4096
@@ -46,6 +47,14 @@ struct t_relay_weechat_msg
     char *data;                        /* binary buffer                     */
     int data_alloc;                    /* currently allocated size          */
     int data_size;                     /* current size of buffer            */
+    /* compressed data, shared by all clients receiving the message */
+    char *compressed_data[RELAY_WEECHAT_NUM_COMPRESSIONS]; /* data          */
+    int compressed_size[RELAY_WEECHAT_NUM_COMPRESSIONS]; /* size (0 = not   */
+                                       /* compressed yet, -1 = error)       */
+    char *compressed_raw[RELAY_WEECHAT_NUM_COMPRESSIONS]; /* message for    */
+                                       /* raw buffer                        */
+    /* data queued for slow clients (shared by all clients) */
+    struct t_relay_client_payload *payload[RELAY_WEECHAT_NUM_COMPRESSIONS];
 };
 
 extern struct t_relay_weechat_msg *relay_weechat_msg_new (const char *id);
@@ -83,6 +92,7 @@ extern void relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
                                             struct t_relay_weechat_nicklist *nicklist);
 extern void relay_weechat_msg_send (struct t_relay_client *client,
                                     struct t_relay_weechat_msg *msg);
+extern void relay_weechat_msg_free_streams (struct t_relay_client *client);
 extern void relay_weechat_msg_free (struct t_relay_weechat_msg *msg);
 
 #endif /* WEECHAT_PLUGIN_RELAY_WEECHAT_MSG_H */
@@ -852,6 +852,9 @@ error:
 
 /*
  * Callback for signals "buffer_*".
+ *
+ * This callback is common to all clients: the message is built only once and
+ * sent to all clients synchronized with the buffer.
  */
 
 int
@@ -867,259 +870,69 @@ relay_weechat_protocol_signal_buffer_cb (const void *pointer, void *data,
     struct t_gui_buffer *ptr_buffer;
     struct t_relay_weechat_msg *msg;
     char cmd_hdata[64], str_signal[128];
-    const char *ptr_old_full_name;
-    int *ptr_old_flags, flags;
+    const char *ptr_old_full_name, *keys;
+    int *ptr_old_flags, flags, sync_flags, renamed, closing;
 
     /* make C compiler happy */
+    (void) pointer;
     (void) data;
     (void) type_data;
 
-    ptr_client = (struct t_relay_client *)pointer;
-    if (!ptr_client || !relay_client_valid (ptr_client))
+    if (!signal_data)
         return WEECHAT_RC_OK;
 
     snprintf (str_signal, sizeof (str_signal), "_%s", signal);
 
+    ptr_buffer = (struct t_gui_buffer *)signal_data;
+    sync_flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
+        RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+    renamed = 0;
+    closing = 0;
+    keys = NULL;
+    snprintf (cmd_hdata, sizeof (cmd_hdata),
+              "buffer:0x%lx", (unsigned long)ptr_buffer);
+
     if (strcmp (signal, "buffer_opened") == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,short_name,"
-                                             "nicklist,title,local_variables,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        keys = "number,full_name,short_name,nicklist,title,local_variables,"
+            "prev_buffer,next_buffer";
     }
     else if (strcmp (signal, "buffer_type_changed") == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,type");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
-    }
-    else if (strcmp (signal, "buffer_moved") == 0)
-    {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
-    }
-    else if ((strcmp (signal, "buffer_merged") == 0)
-             || (strcmp (signal, "buffer_unmerged") == 0))
-    {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        keys = "number,full_name,type";
     }
-    else if ((strcmp (signal, "buffer_hidden") == 0)
+    else if ((strcmp (signal, "buffer_moved") == 0)
+             || (strcmp (signal, "buffer_merged") == 0)
+             || (strcmp (signal, "buffer_unmerged") == 0)
+             || (strcmp (signal, "buffer_hidden") == 0)
              || (strcmp (signal, "buffer_unhidden") == 0))
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        keys = "number,full_name,prev_buffer,next_buffer";
     }
     else if (strcmp (signal, "buffer_renamed") == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* rename old buffer name if present in hashtable "buffers_sync" */
-        ptr_old_full_name = weechat_buffer_get_string (ptr_buffer,
-                                                       "old_full_name");
-        if (ptr_old_full_name && ptr_old_full_name[0])
-        {
-            ptr_old_flags = weechat_hashtable_get (
-                RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
-                ptr_old_full_name);
-            if (ptr_old_flags)
-            {
-                flags = *ptr_old_flags;
-                weechat_hashtable_remove (
-                    RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
-                    ptr_old_full_name);
-                weechat_hashtable_set (
-                    RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
-                    weechat_buffer_get_string (ptr_buffer, "full_name"),
-                    &flags);
-            }
-        }
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,short_name,"
-                                             "local_variables");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        keys = "number,full_name,short_name,local_variables";
+        renamed = 1;
     }
     else if (strcmp (signal, "buffer_title_changed") == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,title");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        keys = "number,full_name,title";
     }
     else if (strncmp (signal, "buffer_localvar_", 16) == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,local_variables");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        keys = "number,full_name,local_variables";
     }
     else if (strcmp (signal, "buffer_cleared") == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer || relay_weechat_is_relay_buffer (ptr_buffer))
+        if (relay_weechat_is_relay_buffer (ptr_buffer))
             return WEECHAT_RC_OK;
-
+        keys = "number,full_name";
         /* send signal only if sync with flag "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        sync_flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
     }
     else if (strcmp (signal, "buffer_line_added") == 0)
     {
         ptr_line = (struct t_gui_line *)signal_data;
-        if (!ptr_line)
-            return WEECHAT_RC_OK;
 
         ptr_hdata_line = weechat_hdata_get ("line");
         if (!ptr_hdata_line)
@@ -1138,58 +951,83 @@ relay_weechat_protocol_signal_buffer_cb (const void *pointer, void *data,
         if (!ptr_buffer || relay_weechat_is_relay_buffer (ptr_buffer))
             return WEECHAT_RC_OK;
 
+        snprintf (cmd_hdata, sizeof (cmd_hdata),
+                  "line_data:0x%lx", (unsigned long)ptr_line_data);
+        keys = "buffer,date,date_printed,displayed,notify_level,highlight,"
+            "tags_array,prefix,message";
         /* send signal only if sync with flag "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
+        sync_flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+    }
+    else if (strcmp (signal, "buffer_closing") == 0)
+    {
+        keys = "number,full_name";
+        closing = 1;
+    }
+
+    if (!keys)
+        return WEECHAT_RC_OK;
+
+    msg = NULL;
+
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
+    {
+        if (!RELAY_WEECHAT_CLIENT_HAS_SIGNALS(ptr_client))
+            continue;
+
+        if (renamed)
         {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
+            /* rename old buffer name if present in hashtable "buffers_sync" */
+            ptr_old_full_name = weechat_buffer_get_string (ptr_buffer,
+                                                           "old_full_name");
+            if (ptr_old_full_name && ptr_old_full_name[0])
             {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "line_data:0x%lx",
-                          (unsigned long)ptr_line_data);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "buffer,date,date_printed,"
-                                             "displayed,notify_level,"
-                                             "highlight,tags_array,prefix,"
-                                             "message");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
+                ptr_old_flags = weechat_hashtable_get (
+                    RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
+                    ptr_old_full_name);
+                if (ptr_old_flags)
+                {
+                    flags = *ptr_old_flags;
+                    weechat_hashtable_remove (
+                        RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
+                        ptr_old_full_name);
+                    weechat_hashtable_set (
+                        RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
+                        weechat_buffer_get_string (ptr_buffer, "full_name"),
+                        &flags);
+                }
             }
         }
-    }
-    else if (strcmp (signal, "buffer_closing") == 0)
-    {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
 
-        /* send signal only if sync with flag "buffers" or "buffer" */
         if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
+                                            sync_flags))
         {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
+            /* build message only once, for the first client */
+            if (!msg)
             {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (unsigned long)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
+                msg = relay_weechat_msg_new (str_signal);
+                if (msg)
+                    relay_weechat_msg_add_hdata (msg, cmd_hdata, keys);
             }
+            if (msg)
+                relay_weechat_msg_send (ptr_client, msg);
         }
 
-        /* remove buffer from hashtables */
-        weechat_hashtable_remove (
-            RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
-            weechat_buffer_get_string (ptr_buffer, "full_name"));
-        weechat_hashtable_remove (
-            RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
-            ptr_buffer);
+        if (closing)
+        {
+            /* remove buffer from hashtables */
+            weechat_hashtable_remove (
+                RELAY_WEECHAT_DATA(ptr_client, buffers_sync),
+                weechat_buffer_get_string (ptr_buffer, "full_name"));
+            weechat_hashtable_remove (
+                RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
+                ptr_buffer);
+        }
     }
 
+    if (msg)
+        relay_weechat_msg_free (msg);
+
     return WEECHAT_RC_OK;
 }
 
@@ -1276,8 +1114,64 @@ relay_weechat_protocol_timer_nicklist_cb (const void *pointer, void *data,
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Adds a nicklist diff for a client (called for hsignals "nicklist_*").
+ */
+
+void
+relay_weechat_protocol_nicklist_add_diff (struct t_relay_client *client,
+                                          struct t_gui_buffer *buffer,
+                                          char diff,
+                                          struct t_gui_nick_group *parent_group,
+                                          struct t_gui_nick_group *group,
+                                          struct t_gui_nick *nick)
+{
+    struct t_relay_weechat_nicklist *ptr_nicklist;
+
+    ptr_nicklist = weechat_hashtable_get (RELAY_WEECHAT_DATA(client,
+                                                             buffers_nicklist),
+                                          buffer);
+    if (!ptr_nicklist)
+    {
+        ptr_nicklist = relay_weechat_nicklist_new ();
+        if (!ptr_nicklist)
+            return;
+        ptr_nicklist->nicklist_count = weechat_buffer_get_integer (buffer,
+                                                                   "nicklist_count");
+        weechat_hashtable_set (RELAY_WEECHAT_DATA(client, buffers_nicklist),
+                               buffer,
+                               ptr_nicklist);
+    }
+
+    if (diff != RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN)
+    {
+        /*
+         * add items if nicklist was not empty or very small (otherwise we will
+         * send full nicklist)
+         */
+        if (ptr_nicklist->nicklist_count > 1)
+        {
+            /* add nicklist item for parent group and group/nick */
+            relay_weechat_nicklist_add_item (ptr_nicklist,
+                                             RELAY_WEECHAT_NICKLIST_DIFF_PARENT,
+                                             parent_group, NULL);
+            relay_weechat_nicklist_add_item (ptr_nicklist, diff, group, nick);
+        }
+
+        /* add timer to send nicklist */
+        if (RELAY_WEECHAT_DATA(client, hook_timer_nicklist))
+        {
+            weechat_unhook (RELAY_WEECHAT_DATA(client, hook_timer_nicklist));
+            RELAY_WEECHAT_DATA(client, hook_timer_nicklist) = NULL;
+        }
+        relay_weechat_hook_timer_nicklist (client);
+    }
+}
+
 /*
  * Callback for hsignals "nicklist_*".
+ *
+ * This callback is common to all clients.
  */
 
 int
@@ -1289,22 +1183,13 @@ relay_weechat_protocol_hsignal_nicklist_cb (const void *pointer, void *data,
     struct t_gui_nick_group *parent_group, *group;
     struct t_gui_nick *nick;
     struct t_gui_buffer *ptr_buffer;
-    struct t_relay_weechat_nicklist *ptr_nicklist;
     char diff;
 
     /* make C compiler happy */
+    (void) pointer;
     (void) data;
 
-    ptr_client = (struct t_relay_client *)pointer;
-    if (!ptr_client || !relay_client_valid (ptr_client))
-        return WEECHAT_RC_OK;
-
-    /* check if buffer is synchronized with flag "nicklist" */
     ptr_buffer = weechat_hashtable_get (hashtable, "buffer");
-    if (!relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                         RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST))
-        return WEECHAT_RC_OK;
-
     parent_group = weechat_hashtable_get (hashtable, "parent_group");
     group = weechat_hashtable_get (hashtable, "group");
     nick = weechat_hashtable_get (hashtable, "nick");
@@ -1313,21 +1198,6 @@ relay_weechat_protocol_hsignal_nicklist_cb (const void *pointer, void *data,
     if (!parent_group)
         return WEECHAT_RC_OK;
 
-    ptr_nicklist = weechat_hashtable_get (RELAY_WEECHAT_DATA(ptr_client,
-                                                             buffers_nicklist),
-                                          ptr_buffer);
-    if (!ptr_nicklist)
-    {
-        ptr_nicklist = relay_weechat_nicklist_new ();
-        if (!ptr_nicklist)
-            return WEECHAT_RC_OK;
-        ptr_nicklist->nicklist_count = weechat_buffer_get_integer (ptr_buffer,
-                                                                   "nicklist_count");
-        weechat_hashtable_set (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
-                               ptr_buffer,
-                               ptr_nicklist);
-    }
-
     /* set diff type */
     diff = RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN;
     if ((strcmp (signal, "nicklist_group_added") == 0)
@@ -1346,28 +1216,18 @@ relay_weechat_protocol_hsignal_nicklist_cb (const void *pointer, void *data,
         diff = RELAY_WEECHAT_NICKLIST_DIFF_CHANGED;
     }
 
-    if (diff != RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN)
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
     {
-        /*
-         * add items if nicklist was not empty or very small (otherwise we will
-         * send full nicklist)
-         */
-        if (ptr_nicklist->nicklist_count > 1)
+        /* check if buffer is synchronized with flag "nicklist" */
+        if (RELAY_WEECHAT_CLIENT_HAS_SIGNALS(ptr_client)
+            && relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
+                                               RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST))
         {
-            /* add nicklist item for parent group and group/nick */
-            relay_weechat_nicklist_add_item (ptr_nicklist,
-                                             RELAY_WEECHAT_NICKLIST_DIFF_PARENT,
-                                             parent_group, NULL);
-            relay_weechat_nicklist_add_item (ptr_nicklist, diff, group, nick);
+            relay_weechat_protocol_nicklist_add_diff (ptr_client, ptr_buffer,
+                                                      diff, parent_group,
+                                                      group, nick);
         }
-
-        /* add timer to send nicklist */
-        if (RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist))
-        {
-            weechat_unhook (RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist));
-            RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist) = NULL;
-        }
-        relay_weechat_hook_timer_nicklist (ptr_client);
     }
 
     return WEECHAT_RC_OK;
@@ -1375,6 +1235,8 @@ relay_weechat_protocol_hsignal_nicklist_cb (const void *pointer, void *data,
 
 /*
  * Callback for signals "upgrade*".
+ *
+ * This callback is common to all clients.
  */
 
 int
@@ -1388,32 +1250,39 @@ relay_weechat_protocol_signal_upgrade_cb (const void *pointer, void *data,
     char str_signal[128];
 
     /* make C compiler happy */
+    (void) pointer;
     (void) data;
     (void) type_data;
     (void) signal_data;
 
-    ptr_client = (struct t_relay_client *)pointer;
-    if (!ptr_client || !relay_client_valid (ptr_client))
+    if ((strcmp (signal, "upgrade") != 0)
+        && (strcmp (signal, "upgrade_ended") != 0))
+    {
         return WEECHAT_RC_OK;
+    }
 
     snprintf (str_signal, sizeof (str_signal), "_%s", signal);
 
-    if ((strcmp (signal, "upgrade") == 0)
-        || (strcmp (signal, "upgrade_ended") == 0))
+    msg = NULL;
+
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
     {
         /* send signal only if client is synchronized with flag "upgrade" */
-        if (relay_weechat_protocol_is_sync (ptr_client, NULL,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_UPGRADE))
+        if (RELAY_WEECHAT_CLIENT_HAS_SIGNALS(ptr_client)
+            && relay_weechat_protocol_is_sync (ptr_client, NULL,
+                                               RELAY_WEECHAT_PROTOCOL_SYNC_UPGRADE))
         {
-            msg = relay_weechat_msg_new (str_signal);
+            if (!msg)
+                msg = relay_weechat_msg_new (str_signal);
             if (msg)
-            {
                 relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
         }
     }
 
+    if (msg)
+        relay_weechat_msg_free (msg);
+
     return WEECHAT_RC_OK;
 }
 
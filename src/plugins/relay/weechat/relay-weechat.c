@@ -33,6 +33,7 @@
 #include "../../weechat-plugin.h"
 #include "../relay.h"
 #include "relay-weechat.h"
+#include "relay-weechat-msg.h"
 #include "relay-weechat-nicklist.h"
 #include "relay-weechat-protocol.h"
 #include "../relay-client.h"
@@ -41,7 +42,14 @@
 
 
 char *relay_weechat_compression_string[] = /* strings for compression       */
-{ "off", "zlib", "zstd" };
+{ "off", "zlib", "zstd", "zlib_stream", "zstd_stream" };
+
+/* hooks common to all clients */
+struct t_hook *relay_weechat_hook_signal_buffer = NULL;
+struct t_hook *relay_weechat_hook_hsignal_nicklist = NULL;
+struct t_hook *relay_weechat_hook_signal_upgrade = NULL;
+int relay_weechat_num_clients_signals = 0; /* number of clients receiving   */
+                                           /* signals                       */
 
 
 /*
@@ -71,46 +79,77 @@ relay_weechat_compression_search (const char *compression)
 
 /*
  * Hooks signals for a client.
+ *
+ * The hooks are common to all clients: they are created for the first client
+ * and the callbacks send each event to all clients receiving signals (so that
+ * the message is built only once).
  */
 
 void
 relay_weechat_hook_signals (struct t_relay_client *client)
 {
-    RELAY_WEECHAT_DATA(client, hook_signal_buffer) =
-        weechat_hook_signal ("buffer_*",
-                             &relay_weechat_protocol_signal_buffer_cb,
-                             client, NULL);
-    RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) =
-        weechat_hook_hsignal ("nicklist_*",
-                              &relay_weechat_protocol_hsignal_nicklist_cb,
-                              client, NULL);
-    RELAY_WEECHAT_DATA(client, hook_signal_upgrade) =
-        weechat_hook_signal ("upgrade*",
-                             &relay_weechat_protocol_signal_upgrade_cb,
-                             client, NULL);
+    if (!RELAY_WEECHAT_DATA(client, signals_hooked))
+    {
+        RELAY_WEECHAT_DATA(client, signals_hooked) = 1;
+        relay_weechat_num_clients_signals++;
+    }
+
+    if (!relay_weechat_hook_signal_buffer)
+    {
+        relay_weechat_hook_signal_buffer =
+            weechat_hook_signal ("buffer_*",
+                                 &relay_weechat_protocol_signal_buffer_cb,
+                                 NULL, NULL);
+    }
+    if (!relay_weechat_hook_hsignal_nicklist)
+    {
+        relay_weechat_hook_hsignal_nicklist =
+            weechat_hook_hsignal ("nicklist_*",
+                                  &relay_weechat_protocol_hsignal_nicklist_cb,
+                                  NULL, NULL);
+    }
+    if (!relay_weechat_hook_signal_upgrade)
+    {
+        relay_weechat_hook_signal_upgrade =
+            weechat_hook_signal ("upgrade*",
+                                 &relay_weechat_protocol_signal_upgrade_cb,
+                                 NULL, NULL);
+    }
 }
 
 /*
  * Unhooks signals for a client.
+ *
+ * The hooks are removed when there are no more clients receiving signals.
  */
 
 void
 relay_weechat_unhook_signals (struct t_relay_client *client)
 {
-    if (RELAY_WEECHAT_DATA(client, hook_signal_buffer))
+    if (!RELAY_WEECHAT_DATA(client, signals_hooked))
+        return;
+
+    RELAY_WEECHAT_DATA(client, signals_hooked) = 0;
+    relay_weechat_num_clients_signals--;
+
+    if (relay_weechat_num_clients_signals > 0)
+        return;
+
+    relay_weechat_num_clients_signals = 0;
+    if (relay_weechat_hook_signal_buffer)
     {
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_buffer));
-        RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
+        weechat_unhook (relay_weechat_hook_signal_buffer);
+        relay_weechat_hook_signal_buffer = NULL;
     }
-    if (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist))
+    if (relay_weechat_hook_hsignal_nicklist)
     {
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist));
-        RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
+        weechat_unhook (relay_weechat_hook_hsignal_nicklist);
+        relay_weechat_hook_hsignal_nicklist = NULL;
     }
-    if (RELAY_WEECHAT_DATA(client, hook_signal_upgrade))
+    if (relay_weechat_hook_signal_upgrade)
     {
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
-        RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
+        weechat_unhook (relay_weechat_hook_signal_upgrade);
+        relay_weechat_hook_signal_upgrade = NULL;
     }
 }
 
@@ -184,14 +223,17 @@ relay_weechat_alloc (struct t_relay_client *client)
     RELAY_WEECHAT_DATA(client, password_ok) = 0;
     RELAY_WEECHAT_DATA(client, totp_ok) = 0;
     RELAY_WEECHAT_DATA(client, compression) = RELAY_WEECHAT_COMPRESSION_OFF;
+    RELAY_WEECHAT_DATA(client, zlib_stream) = NULL;
+    RELAY_WEECHAT_DATA(client, zstd_stream) = NULL;
+    RELAY_WEECHAT_DATA(client, compression_bytes_in) = 0;
+    RELAY_WEECHAT_DATA(client, compression_bytes_out) = 0;
+    RELAY_WEECHAT_DATA(client, compression_time) = 0;
     RELAY_WEECHAT_DATA(client, buffers_sync) =
         weechat_hashtable_new (32,
                                WEECHAT_HASHTABLE_STRING,
                                WEECHAT_HASHTABLE_INTEGER,
                                NULL, NULL);
-    RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
-    RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
-    RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
+    RELAY_WEECHAT_DATA(client, signals_hooked) = 0;
     RELAY_WEECHAT_DATA(client, buffers_nicklist) =
         weechat_hashtable_new (32,
                                WEECHAT_HASHTABLE_POINTER,
@@ -217,7 +259,7 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
 {
     int index, value;
     char name[64];
-    const char *key;
+    const char *key, *str;
 
     client->protocol_data = malloc (sizeof (struct t_relay_weechat_data));
     if (client->protocol_data)
@@ -237,6 +279,45 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
             RELAY_WEECHAT_DATA(client, totp_ok) = 1;
         RELAY_WEECHAT_DATA(client, compression) = weechat_infolist_integer (
             infolist, "compression");
+        /*
+         * the compression streams can not be saved: the client continues
+         * with the same compression without stream
+         */
+        switch (RELAY_WEECHAT_DATA(client, compression))
+        {
+            case RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM:
+                RELAY_WEECHAT_DATA(client, compression) = RELAY_WEECHAT_COMPRESSION_ZLIB;
+                break;
+            case RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM:
+                RELAY_WEECHAT_DATA(client, compression) = RELAY_WEECHAT_COMPRESSION_ZSTD;
+                break;
+            default:
+                break;
+        }
+        RELAY_WEECHAT_DATA(client, zlib_stream) = NULL;
+        RELAY_WEECHAT_DATA(client, zstd_stream) = NULL;
+        RELAY_WEECHAT_DATA(client, compression_bytes_in) = 0;
+        RELAY_WEECHAT_DATA(client, compression_bytes_out) = 0;
+        RELAY_WEECHAT_DATA(client, compression_time) = 0;
+        /* compression statistics are new in WeeChat 4.0.0 */
+        str = weechat_infolist_string (infolist, "compression_bytes_in");
+        if (str)
+        {
+            sscanf (str, "%llu",
+                    &(RELAY_WEECHAT_DATA(client, compression_bytes_in)));
+        }
+        str = weechat_infolist_string (infolist, "compression_bytes_out");
+        if (str)
+        {
+            sscanf (str, "%llu",
+                    &(RELAY_WEECHAT_DATA(client, compression_bytes_out)));
+        }
+        str = weechat_infolist_string (infolist, "compression_time");
+        if (str)
+        {
+            sscanf (str, "%lld",
+                    &(RELAY_WEECHAT_DATA(client, compression_time)));
+        }
 
         /* sync of buffers */
         RELAY_WEECHAT_DATA(client, buffers_sync) = weechat_hashtable_new (
@@ -258,9 +339,7 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
                                    &value);
             index++;
         }
-        RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
-        RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
-        RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
+        RELAY_WEECHAT_DATA(client, signals_hooked) = 0;
         RELAY_WEECHAT_DATA(client, buffers_nicklist) =
             weechat_hashtable_new (32,
                                    WEECHAT_HASHTABLE_POINTER,
@@ -271,13 +350,7 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
                                        &relay_weechat_free_buffers_nicklist);
         RELAY_WEECHAT_DATA(client, hook_timer_nicklist) = NULL;
 
-        if (RELAY_CLIENT_HAS_ENDED(client))
-        {
-            RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
-            RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
-            RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
-        }
-        else
+        if (!RELAY_CLIENT_HAS_ENDED(client))
             relay_weechat_hook_signals (client);
     }
 }
@@ -311,12 +384,8 @@ relay_weechat_free (struct t_relay_client *client)
     {
         if (RELAY_WEECHAT_DATA(client, buffers_sync))
             weechat_hashtable_free (RELAY_WEECHAT_DATA(client, buffers_sync));
-        if (RELAY_WEECHAT_DATA(client, hook_signal_buffer))
-            weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_buffer));
-        if (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist))
-            weechat_unhook (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist));
-        if (RELAY_WEECHAT_DATA(client, hook_signal_upgrade))
-            weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
+        relay_weechat_unhook_signals (client);
+        relay_weechat_msg_free_streams (client);
         if (RELAY_WEECHAT_DATA(client, buffers_nicklist))
             weechat_hashtable_free (RELAY_WEECHAT_DATA(client, buffers_nicklist));
 
@@ -343,6 +412,8 @@ relay_weechat_add_to_infolist (struct t_infolist_item *item,
                                struct t_relay_client *client,
                                int force_disconnected_state)
 {
+    char value[128];
+
     if (!item || !client)
         return 0;
 
@@ -357,12 +428,50 @@ relay_weechat_add_to_infolist (struct t_infolist_item *item,
         return 0;
     if (!weechat_infolist_new_var_integer (item, "compression", RELAY_WEECHAT_DATA(client, compression)))
         return 0;
+    snprintf (value, sizeof (value), "%llu", RELAY_WEECHAT_DATA(client, compression_bytes_in));
+    if (!weechat_infolist_new_var_string (item, "compression_bytes_in", value))
+        return 0;
+    snprintf (value, sizeof (value), "%llu", RELAY_WEECHAT_DATA(client, compression_bytes_out));
+    if (!weechat_infolist_new_var_string (item, "compression_bytes_out", value))
+        return 0;
+    snprintf (value, sizeof (value), "%lld", RELAY_WEECHAT_DATA(client, compression_time));
+    if (!weechat_infolist_new_var_string (item, "compression_time", value))
+        return 0;
     if (!weechat_hashtable_add_to_infolist (RELAY_WEECHAT_DATA(client, buffers_sync), item, "buffers_sync"))
         return 0;
 
     return 1;
 }
 
+/*
+ * Displays compression statistics of a client (used in command "/relay list").
+ */
+
+void
+relay_weechat_display_compression (struct t_relay_client *client)
+{
+    unsigned long long bytes_in, bytes_out;
+
+    if (!client || !client->protocol_data
+        || (RELAY_WEECHAT_DATA(client, compression) == RELAY_WEECHAT_COMPRESSION_OFF))
+    {
+        return;
+    }
+
+    bytes_in = RELAY_WEECHAT_DATA(client, compression_bytes_in);
+    bytes_out = RELAY_WEECHAT_DATA(client, compression_bytes_out);
+
+    weechat_printf (NULL,
+                    _("    compression: %s, bytes: %llu -> %llu (%d%%), "
+                      "time: %.2fms"),
+                    relay_weechat_compression_string[RELAY_WEECHAT_DATA(client, compression)],
+                    bytes_in,
+                    bytes_out,
+                    (bytes_in > 0) ?
+                    100 - (int)((bytes_out * 100) / bytes_in) : 0,
+                    ((float)RELAY_WEECHAT_DATA(client, compression_time)) / 1000);
+}
+
 /*
  * Prints client WeeChat data in WeeChat log file (usually for crash dump).
  */
@@ -376,13 +485,16 @@ relay_weechat_print_log (struct t_relay_client *client)
         weechat_log_printf ("    password_ok . . . . . . : %d",   RELAY_WEECHAT_DATA(client, password_ok));
         weechat_log_printf ("    totp_ok . . . . . . . . : %d",   RELAY_WEECHAT_DATA(client, totp_ok));
         weechat_log_printf ("    compression . . . . . . : %d",   RELAY_WEECHAT_DATA(client, compression));
+        weechat_log_printf ("    zlib_stream . . . . . . : 0x%lx", RELAY_WEECHAT_DATA(client, zlib_stream));
+        weechat_log_printf ("    zstd_stream . . . . . . : 0x%lx", RELAY_WEECHAT_DATA(client, zstd_stream));
+        weechat_log_printf ("    compression_bytes_in. . : %llu", RELAY_WEECHAT_DATA(client, compression_bytes_in));
+        weechat_log_printf ("    compression_bytes_out . : %llu", RELAY_WEECHAT_DATA(client, compression_bytes_out));
+        weechat_log_printf ("    compression_time. . . . : %lld", RELAY_WEECHAT_DATA(client, compression_time));
         weechat_log_printf ("    buffers_sync. . . . . . : 0x%lx (hashtable: '%s')",
                             RELAY_WEECHAT_DATA(client, buffers_sync),
                             weechat_hashtable_get_string (RELAY_WEECHAT_DATA(client, buffers_sync),
                                                           "keys_values"));
-        weechat_log_printf ("    hook_signal_buffer. . . : 0x%lx", RELAY_WEECHAT_DATA(client, hook_signal_buffer));
-        weechat_log_printf ("    hook_hsignal_nicklist . : 0x%lx", RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist));
-        weechat_log_printf ("    hook_signal_upgrade . . : 0x%lx", RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
+        weechat_log_printf ("    signals_hooked. . . . . : %d",   RELAY_WEECHAT_DATA(client, signals_hooked));
         weechat_log_printf ("    buffers_nicklist. . . . : 0x%lx (hashtable: '%s')",
                             RELAY_WEECHAT_DATA(client, buffers_nicklist),
                             weechat_hashtable_get_string (RELAY_WEECHAT_DATA(client, buffers_nicklist),
@@ -30,11 +30,18 @@ enum t_relay_status;
     ((RELAY_WEECHAT_DATA(client, password_ok)                    \
       && RELAY_WEECHAT_DATA(client, totp_ok)))
 
+#define RELAY_WEECHAT_CLIENT_HAS_SIGNALS(client)                 \
+    ((client->protocol == RELAY_PROTOCOL_WEECHAT)                \
+     && client->protocol_data                                    \
+     && RELAY_WEECHAT_DATA(client, signals_hooked))
+
 enum t_relay_weechat_compression
 {
     RELAY_WEECHAT_COMPRESSION_OFF = 0, /* no compression of binary objects  */
     RELAY_WEECHAT_COMPRESSION_ZLIB,    /* zlib compression                  */
     RELAY_WEECHAT_COMPRESSION_ZSTD,    /* Zstandard compression             */
+    RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM, /* zlib stream (one per client)  */
+    RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM, /* zstd stream (one per client)  */
     /* number of compressions */
     RELAY_WEECHAT_NUM_COMPRESSIONS,
 };
@@ -51,17 +58,27 @@ struct t_relay_weechat_data
     /* options set by client (init command) */
     enum t_relay_weechat_compression compression; /* compression type       */
 
+    /* compression */
+    void *zlib_stream;                 /* zlib stream (z_stream *)          */
+    void *zstd_stream;                 /* zstd stream (ZSTD_CStream *)      */
+    unsigned long long compression_bytes_in;  /* bytes before compression   */
+    unsigned long long compression_bytes_out; /* bytes after compression    */
+    long long compression_time;        /* time spent in compression (µs)    */
+
     /* sync of buffers */
     struct t_hashtable *buffers_sync;  /* buffers synchronized (events      */
                                        /* received for these buffers)       */
-    struct t_hook *hook_signal_buffer;    /* hook for signals "buffer_*"    */
-    struct t_hook *hook_hsignal_nicklist; /* hook for hsignals "nicklist_*" */
-    struct t_hook *hook_signal_upgrade;   /* hook for signals "upgrade*"    */
+    int signals_hooked;                /* 1 if client receives signals      */
+                                       /* (hooks are common to all clients) */
     struct t_hashtable *buffers_nicklist; /* send nicklist for these buffers*/
     struct t_hook *hook_timer_nicklist;   /* timer for sending nicklist     */
 };
 
 extern char *relay_weechat_compression_string[];
+extern struct t_hook *relay_weechat_hook_signal_buffer;
+extern struct t_hook *relay_weechat_hook_hsignal_nicklist;
+extern struct t_hook *relay_weechat_hook_signal_upgrade;
+extern int relay_weechat_num_clients_signals;
 
 extern int relay_weechat_compression_search (const char *compression);
 extern void relay_weechat_hook_signals (struct t_relay_client *client);
@@ -78,6 +95,7 @@ extern void relay_weechat_free (struct t_relay_client *client);
 extern int relay_weechat_add_to_infolist (struct t_infolist_item *item,
                                           struct t_relay_client *client,
                                           int force_disconnected_state);
+extern void relay_weechat_display_compression (struct t_relay_client *client);
 extern void relay_weechat_print_log (struct t_relay_client *client);
 
 #endif /* WEECHAT_PLUGIN_RELAY_WEECHAT_H */
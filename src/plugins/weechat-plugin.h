@@ -68,7 +68,7 @@ struct timeval;
  * please change the date with current one; for a second change at same
  * date, increment the 01, otherwise please keep 01.
  */
-#define WEECHAT_PLUGIN_API_VERSION "20230220-01"
+#define WEECHAT_PLUGIN_API_VERSION "20261016-01"
 
 /* macros for defining plugin infos */
 #define WEECHAT_PLUGIN_NAME(__name)                                     \
@@ -849,6 +849,7 @@ struct t_weechat_plugin
                                  const char *modifier,
                                  const char *modifier_data,
                                  const char *string);
+    int (*hook_modifier_has_hooks) (const char *modifier);
     struct t_hook *(*hook_info) (struct t_weechat_plugin *plugin,
                                  const char *info_name,
                                  const char *description,
@@ -1861,6 +1862,8 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
                                    __string)                            \
     (weechat_plugin->hook_modifier_exec)(weechat_plugin, __modifier,    \
                                          __modifier_data, __string)
+#define weechat_hook_modifier_has_hooks(__modifier)                     \
+    (weechat_plugin->hook_modifier_has_hooks)(__modifier)
 #define weechat_hook_info(__info_name, __description,                   \
                           __args_description, __callback, __pointer,    \
                           __data)                                       \
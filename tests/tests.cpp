@@ -72,6 +72,8 @@ IMPORT_TEST_GROUP(CoreNetwork);
 IMPORT_TEST_GROUP(CoreSecure);
 IMPORT_TEST_GROUP(CoreSignal);
 IMPORT_TEST_GROUP(CoreString);
+IMPORT_TEST_GROUP(CoreUpgrade);
+IMPORT_TEST_GROUP(CoreUpgradeFile);
 IMPORT_TEST_GROUP(CoreUrl);
 IMPORT_TEST_GROUP(CoreUtf8);
 IMPORT_TEST_GROUP(CoreUtil);
@@ -88,6 +90,7 @@ IMPORT_TEST_GROUP(GuiInput);
 IMPORT_TEST_GROUP(GuiKey);
 IMPORT_TEST_GROUP(GuiLine);
 IMPORT_TEST_GROUP(GuiNick);
+IMPORT_TEST_GROUP(GuiNicklist);
 /* scripts */
 IMPORT_TEST_GROUP(Scripts);
 
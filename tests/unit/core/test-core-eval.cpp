@@ -26,12 +26,14 @@ extern "C"
 #include <stdio.h>
 #include <string.h>
 #include <regex.h>
+#include <sys/time.h>
 #include "src/core/wee-eval.h"
 #include "src/core/wee-config.h"
 #include "src/core/wee-config-file.h"
 #include "src/core/wee-hashtable.h"
 #include "src/core/wee-secure.h"
 #include "src/core/wee-string.h"
+#include "src/core/wee-util.h"
 #include "src/core/wee-version.h"
 #include "src/gui/gui-buffer.h"
 #include "src/gui/gui-line.h"
@@ -1128,3 +1130,339 @@ TEST(CoreEval, EvalReplaceRegex)
     hashtable_free (extra_vars);
     hashtable_free (options);
 }
+
+/*
+ * Tests functions:
+ *   eval_vars_compile
+ *   eval_vars_free
+ */
+
+TEST(CoreEval, VarsCompile)
+{
+    struct t_eval_vars *vars;
+
+    POINTERS_EQUAL(NULL, eval_vars_compile (NULL, NULL, NULL));
+    POINTERS_EQUAL(NULL, eval_vars_compile ("test", NULL, "}"));
+    POINTERS_EQUAL(NULL, eval_vars_compile ("test", "${", NULL));
+    POINTERS_EQUAL(NULL, eval_vars_compile ("test", "", "}"));
+
+    /* empty string */
+    vars = eval_vars_compile ("", "${", "}");
+    CHECK(vars);
+    LONGS_EQUAL(0, vars->num_segments);
+    STRCMP_EQUAL("", vars->static_value);
+    eval_vars_free (vars);
+
+    /* text only, with escaped prefix */
+    vars = eval_vars_compile ("abc \\${x}", "${", "}");
+    CHECK(vars);
+    LONGS_EQUAL(1, vars->num_segments);
+    LONGS_EQUAL(EVAL_SEGMENT_TEXT, vars->segments[0].type);
+    STRCMP_EQUAL("abc ${x}", vars->segments[0].text);
+    STRCMP_EQUAL("abc ${x}", vars->static_value);
+    eval_vars_free (vars);
+
+    /* text and variables */
+    vars = eval_vars_compile ("a ${x} b ${y_${z}}${if:${x}}", "${", "}");
+    CHECK(vars);
+    POINTERS_EQUAL(NULL, vars->static_value);
+    LONGS_EQUAL(5, vars->num_segments);
+    LONGS_EQUAL(EVAL_SEGMENT_TEXT, vars->segments[0].type);
+    STRCMP_EQUAL("a ", vars->segments[0].text);
+    LONGS_EQUAL(EVAL_SEGMENT_VAR, vars->segments[1].type);
+    STRCMP_EQUAL("x", vars->segments[1].text);
+    LONGS_EQUAL(2, vars->segments[1].offset);
+    POINTERS_EQUAL(NULL, vars->segments[1].vars);
+    LONGS_EQUAL(EVAL_SEGMENT_TEXT, vars->segments[2].type);
+    STRCMP_EQUAL(" b ", vars->segments[2].text);
+    LONGS_EQUAL(EVAL_SEGMENT_VAR, vars->segments[3].type);
+    STRCMP_EQUAL("y_${z}", vars->segments[3].text);
+    CHECK(vars->segments[3].vars);
+    LONGS_EQUAL(2, vars->segments[3].vars->num_segments);
+    LONGS_EQUAL(EVAL_SEGMENT_VAR, vars->segments[4].type);
+    STRCMP_EQUAL("if:${x}", vars->segments[4].text);
+    POINTERS_EQUAL(NULL, vars->segments[4].vars);
+    eval_vars_free (vars);
+
+    /* prefix without suffix */
+    vars = eval_vars_compile ("a ${x", "${", "}");
+    CHECK(vars);
+    LONGS_EQUAL(2, vars->num_segments);
+    LONGS_EQUAL(EVAL_SEGMENT_TEXT, vars->segments[0].type);
+    LONGS_EQUAL(EVAL_SEGMENT_ERROR, vars->segments[1].type);
+    STRCMP_EQUAL("a ", vars->static_value);
+    eval_vars_free (vars);
+
+    /* custom prefix/suffix */
+    vars = eval_vars_compile ("${x} %(y)", "%(", ")");
+    CHECK(vars);
+    LONGS_EQUAL(2, vars->num_segments);
+    STRCMP_EQUAL("${x} ", vars->segments[0].text);
+    STRCMP_EQUAL("y", vars->segments[1].text);
+    eval_vars_free (vars);
+
+    eval_vars_free (NULL);
+}
+
+/*
+ * Tests functions:
+ *   eval_node_compile
+ *   eval_node_free
+ */
+
+TEST(CoreEval, NodeCompile)
+{
+    struct t_eval_context context;
+    struct t_eval_node *node;
+
+    memset (&context, 0, sizeof (context));
+    context.prefix = EVAL_DEFAULT_PREFIX;
+    context.length_prefix = strlen (EVAL_DEFAULT_PREFIX);
+    context.suffix = EVAL_DEFAULT_SUFFIX;
+    context.length_suffix = strlen (EVAL_DEFAULT_SUFFIX);
+
+    POINTERS_EQUAL(NULL, eval_node_compile (NULL, &context));
+
+    node = eval_node_compile ("  ", &context);
+    CHECK(node);
+    LONGS_EQUAL(EVAL_NODE_EMPTY, node->type);
+    eval_node_free (node);
+
+    node = eval_node_compile (" ${a} == 1 || (${b} && ${c}) ", &context);
+    CHECK(node);
+    LONGS_EQUAL(EVAL_NODE_LOGICAL, node->type);
+    LONGS_EQUAL(EVAL_LOGICAL_OP_OR, node->op);
+    LONGS_EQUAL(EVAL_NODE_COMPARE, node->left->type);
+    LONGS_EQUAL(EVAL_COMPARE_EQUAL, node->left->op);
+    LONGS_EQUAL(EVAL_NODE_VARS, node->left->left->type);
+    LONGS_EQUAL(EVAL_NODE_VARS, node->left->right->type);
+    STRCMP_EQUAL("1", node->left->right->vars_left->static_value);
+    LONGS_EQUAL(EVAL_NODE_PARENTHESES, node->right->type);
+    STRCMP_EQUAL("", node->right->text);
+    LONGS_EQUAL(EVAL_NODE_LOGICAL, node->right->left->type);
+    LONGS_EQUAL(EVAL_LOGICAL_OP_AND, node->right->left->op);
+    eval_node_free (node);
+
+    /* regex without variables: compiled */
+    node = eval_node_compile ("${a} =~ ^abc$", &context);
+    CHECK(node);
+    LONGS_EQUAL(EVAL_NODE_COMPARE, node->type);
+    LONGS_EQUAL(EVAL_COMPARE_REGEX_MATCHING, node->op);
+    CHECK(node->vars_left);
+    CHECK(node->vars_right);
+    CHECK(node->regex);
+    LONGS_EQUAL(0, node->regex_error);
+    eval_node_free (node);
+
+    /* invalid regex */
+    node = eval_node_compile ("${a} !~ (abc", &context);
+    CHECK(node);
+    POINTERS_EQUAL(NULL, node->regex);
+    LONGS_EQUAL(1, node->regex_error);
+    eval_node_free (node);
+
+    /* regex with variables: not compiled */
+    node = eval_node_compile ("${a} =~ ^${b}$", &context);
+    CHECK(node);
+    POINTERS_EQUAL(NULL, node->regex);
+    LONGS_EQUAL(0, node->regex_error);
+    eval_node_free (node);
+
+    /* missing closing parenthesis */
+    node = eval_node_compile ("(abc", &context);
+    CHECK(node);
+    LONGS_EQUAL(EVAL_NODE_ERROR, node->type);
+    eval_node_free (node);
+
+    eval_node_free (NULL);
+}
+
+/*
+ * Tests functions:
+ *   eval_compiled_get
+ *   eval_compiled_unref
+ *   eval_compiled_free_all
+ */
+
+TEST(CoreEval, Compiled)
+{
+    struct t_eval_context context;
+    struct t_eval_compiled *compiled, *compiled2;
+    struct t_hashtable *options;
+    char str_expr[64], *value;
+    int i;
+
+    memset (&context, 0, sizeof (context));
+    context.prefix = EVAL_DEFAULT_PREFIX;
+    context.length_prefix = strlen (EVAL_DEFAULT_PREFIX);
+    context.suffix = EVAL_DEFAULT_SUFFIX;
+    context.length_suffix = strlen (EVAL_DEFAULT_SUFFIX);
+
+    eval_compiled_free_all ();
+    LONGS_EQUAL(0, eval_compiled_count);
+    POINTERS_EQUAL(NULL, eval_compiled);
+    POINTERS_EQUAL(NULL, last_eval_compiled);
+
+    POINTERS_EQUAL(NULL,
+                   eval_compiled_get (EVAL_COMPILED_VARS, NULL, &context));
+
+    /* compile and add in cache */
+    compiled = eval_compiled_get (EVAL_COMPILED_VARS, "${a}", &context);
+    CHECK(compiled);
+    CHECK(compiled->vars);
+    POINTERS_EQUAL(NULL, compiled->node);
+    LONGS_EQUAL(2, compiled->refcount);
+    LONGS_EQUAL(1, eval_compiled_count);
+    eval_compiled_unref (compiled);
+    LONGS_EQUAL(1, compiled->refcount);
+
+    /* same expression: found in cache */
+    compiled2 = eval_compiled_get (EVAL_COMPILED_VARS, "${a}", &context);
+    POINTERS_EQUAL(compiled, compiled2);
+    eval_compiled_unref (compiled2);
+
+    /* same expression evaluated as condition: another compiled expression */
+    compiled2 = eval_compiled_get (EVAL_COMPILED_CONDITION, "${a}", &context);
+    CHECK(compiled2);
+    CHECK(compiled != compiled2);
+    CHECK(compiled2->node);
+    POINTERS_EQUAL(NULL, compiled2->vars);
+    LONGS_EQUAL(2, eval_compiled_count);
+    POINTERS_EQUAL(compiled2, eval_compiled);
+    POINTERS_EQUAL(compiled, last_eval_compiled);
+    eval_compiled_unref (compiled2);
+
+    /* same expression with another prefix: another compiled expression */
+    context.prefix = "%(";
+    context.length_prefix = 2;
+    compiled2 = eval_compiled_get (EVAL_COMPILED_VARS, "${a}", &context);
+    CHECK(compiled2);
+    CHECK(compiled != compiled2);
+    LONGS_EQUAL(3, eval_compiled_count);
+    eval_compiled_unref (compiled2);
+    context.prefix = EVAL_DEFAULT_PREFIX;
+    context.length_prefix = strlen (EVAL_DEFAULT_PREFIX);
+
+    /* least recently used is moved at beginning of list when used */
+    compiled2 = eval_compiled_get (EVAL_COMPILED_VARS, "${a}", &context);
+    POINTERS_EQUAL(compiled, compiled2);
+    POINTERS_EQUAL(compiled, eval_compiled);
+    CHECK(last_eval_compiled != compiled);
+
+    /* fill the cache: least recently used are removed */
+    for (i = 0; i < EVAL_COMPILED_MAX + 10; i++)
+    {
+        snprintf (str_expr, sizeof (str_expr), "${test%d}", i);
+        eval_compiled_unref (
+            eval_compiled_get (EVAL_COMPILED_VARS, str_expr, &context));
+    }
+    LONGS_EQUAL(EVAL_COMPILED_MAX, eval_compiled_count);
+    LONGS_EQUAL(EVAL_COMPILED_MAX,
+                eval_hashtable_compiled->items_count);
+
+    /* compiled expression still in use, removed from cache */
+    LONGS_EQUAL(1, compiled->refcount);
+    POINTERS_EQUAL(NULL, compiled->prev_compiled);
+    POINTERS_EQUAL(NULL, compiled->next_compiled);
+    eval_compiled_unref (compiled);
+
+    eval_compiled_free_all ();
+    LONGS_EQUAL(0, eval_compiled_count);
+    LONGS_EQUAL(0, eval_hashtable_compiled->items_count);
+    POINTERS_EQUAL(NULL, eval_compiled);
+    POINTERS_EQUAL(NULL, last_eval_compiled);
+
+    /* debug mode: expression is not compiled */
+    options = hashtable_new (32,
+                             WEECHAT_HASHTABLE_STRING,
+                             WEECHAT_HASHTABLE_STRING,
+                             NULL, NULL);
+    CHECK(options);
+    hashtable_set (options, "type", "condition");
+    hashtable_set (options, "debug", "1");
+    value = eval_expression ("${a} == 1", NULL, NULL, options);
+    STRCMP_EQUAL("0", value);
+    free (value);
+    LONGS_EQUAL(0, eval_compiled_count);
+    hashtable_remove (options, "debug");
+    value = eval_expression ("${a} == 1", NULL, NULL, options);
+    STRCMP_EQUAL("0", value);
+    free (value);
+    LONGS_EQUAL(1, eval_compiled_count);
+    hashtable_free (options);
+
+    /* no variables in string: not compiled */
+    eval_compiled_free_all ();
+    value = eval_expression ("test", NULL, NULL, NULL);
+    STRCMP_EQUAL("test", value);
+    free (value);
+    LONGS_EQUAL(0, eval_compiled_count);
+}
+
+/*
+ * Benchmarks evaluation of an expression "count" times, with compiled
+ * expression kept in cache and compiled again before each evaluation.
+ */
+
+void
+test_eval_benchmark (const char *expr, int condition, int count)
+{
+    struct t_hashtable *extra_vars, *options;
+    struct timeval tv_start, tv_cached, tv_not_cached;
+    char *value;
+    int i;
+
+    extra_vars = hashtable_new (32,
+                                WEECHAT_HASHTABLE_STRING,
+                                WEECHAT_HASHTABLE_STRING,
+                                NULL, NULL);
+    CHECK(extra_vars);
+    hashtable_set (extra_vars, "number", "42");
+    hashtable_set (extra_vars, "name", "#weechat");
+    options = hashtable_new (32,
+                             WEECHAT_HASHTABLE_STRING,
+                             WEECHAT_HASHTABLE_STRING,
+                             NULL, NULL);
+    CHECK(options);
+    if (condition)
+        hashtable_set (options, "type", "condition");
+
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < count; i++)
+    {
+        value = eval_expression (expr, NULL, extra_vars, options);
+        free (value);
+    }
+    gettimeofday (&tv_cached, NULL);
+    for (i = 0; i < count; i++)
+    {
+        eval_compiled_free_all ();
+        value = eval_expression (expr, NULL, extra_vars, options);
+        free (value);
+    }
+    gettimeofday (&tv_not_cached, NULL);
+
+    printf ("\n  %7d evaluations: cached: %8lld us, not cached: %8lld us "
+            "(\"%s\")",
+            count,
+            util_timeval_diff (&tv_start, &tv_cached),
+            util_timeval_diff (&tv_cached, &tv_not_cached),
+            expr);
+
+    hashtable_free (extra_vars);
+    hashtable_free (options);
+}
+
+/*
+ * Benchmark of eval (ignored by default, can be run with:
+ * "tests -ri -g CoreEval -n Benchmark").
+ */
+
+IGNORE_TEST(CoreEval, Benchmark)
+{
+    test_eval_benchmark ("${number}. ${if:${name}=~^#?${color:green}:}${name}",
+                         0, 100000);
+    test_eval_benchmark ("${number} > 10 && ${name} =~ ^#wee "
+                         "&& (${name} !~ chat$ || ${number} < 50)",
+                         1, 100000);
+}
@@ -25,9 +25,11 @@ extern "C"
 {
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 #include "src/core/wee-hashtable.h"
 #include "src/core/wee-infolist.h"
 #include "src/core/wee-list.h"
+#include "src/core/wee-util.h"
 #include "src/plugins/plugin.h"
 }
 
@@ -472,6 +474,112 @@ TEST(CoreHashtable, SetGetRemove)
     hashtable_free (hashtable);
 }
 
+/*
+ * Tests functions:
+ *   hashtable_set
+ *   hashtable_get
+ *   hashtable_remove
+ *   hashtable_remove_all
+ * (with automatic growth of htable)
+ */
+
+TEST(CoreHashtable, Grow)
+{
+    struct t_hashtable *hashtable;
+    struct t_hashtable_item *ptr_item;
+    char str_key[64];
+    int i, value;
+
+    hashtable = hashtable_new (8,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_INTEGER,
+                               NULL,
+                               NULL);
+    LONGS_EQUAL(8, hashtable->size);
+
+    /* add items: htable grows, rehash is done incrementally */
+    for (i = 0; i < 1000; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        ptr_item = hashtable_set (hashtable, str_key, &i);
+        CHECK(ptr_item);
+        LONGS_EQUAL(1, ptr_item->key_inline);
+        POINTERS_EQUAL(ptr_item + 1, ptr_item->key);
+    }
+    LONGS_EQUAL(1000, hashtable->items_count);
+    LONGS_EQUAL(1024, hashtable->size);
+
+    /* all items can be found, in old or new htable */
+    for (i = 0; i < 1000; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        LONGS_EQUAL(i, *((int *)hashtable_get (hashtable, str_key)));
+    }
+    POINTERS_EQUAL(NULL, hashtable_get (hashtable, "key1000"));
+    POINTERS_EQUAL(NULL, hashtable->htable_old);
+    LONGS_EQUAL(0, hashtable->size_old);
+
+    /* order of creation is kept */
+    ptr_item = hashtable->oldest_item;
+    for (i = 0; i < 1000; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        STRCMP_EQUAL(str_key, (const char *)ptr_item->key);
+        ptr_item = ptr_item->next_created_item;
+    }
+    POINTERS_EQUAL(NULL, ptr_item);
+
+    /* linked lists in htable are still sorted */
+    for (i = 0; i < hashtable->size; i++)
+    {
+        for (ptr_item = hashtable->htable[i];
+             ptr_item && ptr_item->next_item;
+             ptr_item = ptr_item->next_item)
+        {
+            CHECK(strcmp ((const char *)ptr_item->key,
+                          (const char *)ptr_item->next_item->key) < 0);
+        }
+    }
+
+    /* remove half of items */
+    for (i = 0; i < 1000; i += 2)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        hashtable_remove (hashtable, str_key);
+    }
+    LONGS_EQUAL(500, hashtable->items_count);
+    for (i = 0; i < 1000; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        LONGS_EQUAL((i % 2 == 0) ? 0 : 1,
+                    hashtable_has_key (hashtable, str_key));
+    }
+
+    /* replace a value */
+    value = 123456;
+    hashtable_set (hashtable, "key1", &value);
+    LONGS_EQUAL(500, hashtable->items_count);
+    LONGS_EQUAL(123456, *((int *)hashtable_get (hashtable, "key1")));
+
+    hashtable_remove_all (hashtable);
+    LONGS_EQUAL(0, hashtable->items_count);
+    POINTERS_EQUAL(NULL, hashtable->oldest_item);
+    POINTERS_EQUAL(NULL, hashtable->newest_item);
+
+    hashtable_free (hashtable);
+
+    /* key of type "pointer" is never allocated with the item */
+    hashtable = hashtable_new (8,
+                               WEECHAT_HASHTABLE_POINTER,
+                               WEECHAT_HASHTABLE_POINTER,
+                               NULL,
+                               NULL);
+    ptr_item = hashtable_set (hashtable, (void *)0x123, NULL);
+    LONGS_EQUAL(0, ptr_item->key_inline);
+    POINTERS_EQUAL((void *)0x123, ptr_item->key);
+    hashtable_free (hashtable);
+}
+
 void
 test_hashtable_map_string_cb (void *data,
                               struct t_hashtable *hashtable,
@@ -768,3 +876,68 @@ TEST(CoreHashtable, PrintLog)
 {
     /* TODO: write tests */
 }
+
+/*
+ * Benchmarks hashtable with string keys: set, get and remove of "count"
+ * items, in a hashtable created with size 32.
+ */
+
+void
+test_hashtable_benchmark (int count)
+{
+    struct t_hashtable *hashtable;
+    struct timeval tv_start, tv_set, tv_get, tv_remove;
+    char str_key[64];
+    int i;
+
+    hashtable = hashtable_new (32,
+                               WEECHAT_HASHTABLE_STRING,
+                               WEECHAT_HASHTABLE_STRING,
+                               NULL,
+                               NULL);
+    CHECK(hashtable);
+
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < count; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        hashtable_set (hashtable, str_key, str_key);
+    }
+    gettimeofday (&tv_set, NULL);
+    for (i = 0; i < count; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        CHECK(hashtable_get (hashtable, str_key));
+    }
+    gettimeofday (&tv_get, NULL);
+    for (i = 0; i < count; i++)
+    {
+        snprintf (str_key, sizeof (str_key), "key%d", i);
+        hashtable_remove (hashtable, str_key);
+    }
+    gettimeofday (&tv_remove, NULL);
+
+    LONGS_EQUAL(0, hashtable->items_count);
+
+    printf ("\n  %7d items (size: %7d): "
+            "set: %8lld us, get: %8lld us, remove: %8lld us",
+            count,
+            hashtable->size,
+            util_timeval_diff (&tv_start, &tv_set),
+            util_timeval_diff (&tv_set, &tv_get),
+            util_timeval_diff (&tv_get, &tv_remove));
+
+    hashtable_free (hashtable);
+}
+
+/*
+ * Benchmark of hashtable (ignored by default, can be run with:
+ * "tests -ri -g CoreHashtable -n Benchmark").
+ */
+
+IGNORE_TEST(CoreHashtable, Benchmark)
+{
+    test_hashtable_benchmark (10);
+    test_hashtable_benchmark (1000);
+    test_hashtable_benchmark (1000000);
+}
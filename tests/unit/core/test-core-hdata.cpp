@@ -281,6 +281,7 @@ TEST(CoreHdata, NewList)
     CHECK(list);
     POINTERS_EQUAL(0x123, list->pointer);
     LONGS_EQUAL(0, list->flags);
+    POINTERS_EQUAL(NULL, list->pointers);
 
     hdata_new_list (hdata, "list2", (void *)0x456,
                     WEECHAT_HDATA_LIST_CHECK_POINTERS);
@@ -293,6 +294,122 @@ TEST(CoreHdata, NewList)
     hashtable_remove (weechat_hdata, "test_hdata");
 }
 
+/*
+ * Tests functions:
+ *   hdata_new_list_pointers
+ *   hdata_pointers_add
+ *   hdata_pointers_remove
+ */
+
+TEST(CoreHdata, NewListPointers)
+{
+    struct t_hdata *hdata;
+    struct t_hdata_list *list;
+    struct t_hashtable *pointers;
+
+    hdata = hdata_new (NULL, "test_hdata", "prev", "next", 1, 0,
+                       &callback_update_dummy, (void *)0x123);
+    CHECK(hdata);
+
+    pointers = NULL;
+    hdata_new_list_pointers (hdata, "list1", (void *)0x123,
+                             WEECHAT_HDATA_LIST_CHECK_POINTERS, &pointers);
+    LONGS_EQUAL(1, hdata->hash_list->items_count);
+    list = (struct t_hdata_list *)hashtable_get (hdata->hash_list, "list1");
+    CHECK(list);
+    POINTERS_EQUAL(0x123, list->pointer);
+    LONGS_EQUAL(WEECHAT_HDATA_LIST_CHECK_POINTERS, list->flags);
+    POINTERS_EQUAL(&pointers, list->pointers);
+    POINTERS_EQUAL(list, hdata->lists_pointers);
+    POINTERS_EQUAL(NULL, list->next_list_pointers);
+
+    /* list without pointers: not added in lists with pointers */
+    hdata_new_list (hdata, "list2", (void *)0x456, 0);
+    LONGS_EQUAL(2, hdata->hash_list->items_count);
+    POINTERS_EQUAL(list, hdata->lists_pointers);
+    POINTERS_EQUAL(NULL, list->next_list_pointers);
+
+    /* list with same name: replaced in lists with pointers */
+    hdata_new_list_pointers (hdata, "list1", (void *)0x123,
+                             WEECHAT_HDATA_LIST_CHECK_POINTERS, &pointers);
+    LONGS_EQUAL(2, hdata->hash_list->items_count);
+    list = (struct t_hdata_list *)hashtable_get (hdata->hash_list, "list1");
+    CHECK(list);
+    POINTERS_EQUAL(list, hdata->lists_pointers);
+    POINTERS_EQUAL(NULL, list->next_list_pointers);
+    hdata_new_list (hdata, "list1", (void *)0x123, 0);
+    POINTERS_EQUAL(NULL, hdata->lists_pointers);
+    hdata_new_list_pointers (hdata, "list1", (void *)0x123,
+                             WEECHAT_HDATA_LIST_CHECK_POINTERS, &pointers);
+    list = (struct t_hdata_list *)hashtable_get (hdata->hash_list, "list1");
+    POINTERS_EQUAL(list, hdata->lists_pointers);
+
+    hdata_pointers_add (NULL, NULL, (void *)0x1);
+    hdata_pointers_add (&pointers, NULL, NULL);
+    POINTERS_EQUAL(NULL, pointers);
+    hdata_pointers_remove (NULL, (void *)0x1);
+    hdata_pointers_remove (&pointers, (void *)0x1);
+    POINTERS_EQUAL(NULL, pointers);
+
+    /* list not empty: hashtable is not created */
+    hdata_pointers_add (&pointers, (void *)0x1, (void *)0x2);
+    POINTERS_EQUAL(NULL, pointers);
+
+    /* list empty: hashtable is created */
+    hdata_pointers_add (&pointers, NULL, (void *)0x1);
+    CHECK(pointers);
+    LONGS_EQUAL(1, pointers->items_count);
+    hdata_pointers_add (&pointers, (void *)0x1, (void *)0x2);
+    LONGS_EQUAL(2, pointers->items_count);
+    CHECK(hashtable_has_key (pointers, (void *)0x1));
+    CHECK(hashtable_has_key (pointers, (void *)0x2));
+
+    /* remove pointers: hashtable is freed when empty */
+    hdata_pointers_remove (&pointers, (void *)0x3);
+    LONGS_EQUAL(2, pointers->items_count);
+    hdata_pointers_remove (&pointers, (void *)0x1);
+    LONGS_EQUAL(1, pointers->items_count);
+    CHECK(hashtable_has_key (pointers, (void *)0x2));
+    hdata_pointers_remove (&pointers, (void *)0x2);
+    POINTERS_EQUAL(NULL, pointers);
+
+    hashtable_remove (weechat_hdata, "test_hdata");
+}
+
+/*
+ * Tests functions:
+ *   hdata_check_pointer (with hashtable of pointers: buffers)
+ */
+
+TEST(CoreHdata, CheckPointerBuffers)
+{
+    struct t_hdata *hdata;
+    struct t_gui_buffer *buffer;
+
+    hdata = hook_hdata_get (NULL, "buffer");
+    CHECK(hdata);
+
+    CHECK(gui_buffers_pointers);
+    LONGS_EQUAL(gui_buffers_count, gui_buffers_pointers->items_count);
+
+    buffer = gui_buffer_new (NULL, "test_hdata",
+                             NULL, NULL, NULL,
+                             NULL, NULL, NULL);
+    CHECK(buffer);
+    LONGS_EQUAL(gui_buffers_count, gui_buffers_pointers->items_count);
+    LONGS_EQUAL(1, hdata_check_pointer (hdata, NULL, buffer));
+    LONGS_EQUAL(1, hdata_check_pointer (hdata, gui_buffers, buffer));
+    LONGS_EQUAL(1, hdata_check_pointer (hdata, last_gui_buffer, buffer));
+    LONGS_EQUAL(1, hdata_check_pointer (hdata, NULL, gui_buffers));
+    LONGS_EQUAL(0, hdata_check_pointer (hdata, NULL, (void *)0x1));
+    LONGS_EQUAL(0, hdata_check_pointer (hdata, gui_buffers, (void *)0x1));
+
+    gui_buffer_close (buffer);
+    LONGS_EQUAL(gui_buffers_count, gui_buffers_pointers->items_count);
+    LONGS_EQUAL(0, hdata_check_pointer (hdata, NULL, buffer));
+    LONGS_EQUAL(0, hdata_check_pointer (hdata, gui_buffers, buffer));
+}
+
 TEST_GROUP(CoreHdataWithList)
 {
     static int callback_update (void *data,
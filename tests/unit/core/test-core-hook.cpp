@@ -23,19 +23,184 @@
 
 extern "C"
 {
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include "src/core/wee-hashtable.h"
 #include "src/core/wee-hook.h"
 #include "src/core/wee-string.h"
 #include "src/gui/gui-buffer.h"
 #include "src/gui/gui-chat.h"
+#include "src/gui/gui-color.h"
 #include "src/gui/gui-line.h"
 #include "src/plugins/plugin.h"
 }
 
 #define TEST_BUFFER_NAME "test"
 
+extern "C"
+{
+extern struct t_hook **hook_timer_heap;
+extern int hook_timer_heap_size;
+extern int hook_timer_heap_alloc;
+extern int hook_timer_heap_cmp (struct t_hook *timer1, struct t_hook *timer2);
+extern int hook_timer_heap_add (struct t_hook *hook);
+extern void hook_timer_heap_remove (struct t_hook *hook);
+extern void hook_timer_heap_rebuild ();
+extern void hook_timer_check_system_clock ();
+}
+
+struct t_hook *hook_test_fd[2] = { NULL, NULL };
+int hook_test_fd_calls = 0;
+int hook_test_signal_calls = 0;
+struct t_hook *hook_test_timer_unhook = NULL;
+int hook_test_timer_calls[16];
+int hook_test_timer_remaining[16];
+int hook_test_timer_num_calls = 0;
+
 TEST_GROUP(CoreHook)
 {
+    /*
+     * Callback for fd hooks: unhooks the other fd hook.
+     */
+
+    static int
+    test_fd_cb (const void *pointer, void *data, int fd)
+    {
+        int index;
+        char buf[16];
+
+        /* make C++ compiler happy */
+        (void) data;
+
+        (void) read (fd, buf, sizeof (buf));
+
+        index = (pointer == &hook_test_fd[0]) ? 1 : 0;
+        if (hook_test_fd[index])
+        {
+            unhook (hook_test_fd[index]);
+            hook_test_fd[index] = NULL;
+        }
+        hook_test_fd_calls++;
+
+        return WEECHAT_RC_OK;
+    }
+
+    /*
+     * Callback for signal hooks: sends many other signals when signal
+     * "test_signal_flood" is received.
+     */
+
+    static int
+    test_signal_cb (const void *pointer, void *data, const char *signal,
+                    const char *type_data, void *signal_data)
+    {
+        char name[64];
+        int i;
+
+        /* make C++ compiler happy */
+        (void) pointer;
+        (void) data;
+        (void) type_data;
+        (void) signal_data;
+
+        hook_test_signal_calls++;
+
+        if (strcmp (signal, "test_signal_flood") == 0)
+        {
+            for (i = 0; i < HOOK_MATCH_CACHE_MAX_SIZE + 10; i++)
+            {
+                snprintf (name, sizeof (name), "test_signal_other_%d", i);
+                hook_signal_send (name, WEECHAT_HOOK_SIGNAL_STRING, NULL);
+            }
+        }
+
+        return WEECHAT_RC_OK;
+    }
+
+    /*
+     * Callback for timer hooks: saves the number of timer (pointer) and
+     * unhooks timer "hook_test_timer_unhook" (if set).
+     */
+
+    static int
+    test_timer_cb (const void *pointer, void *data, int remaining_calls)
+    {
+        /* make C++ compiler happy */
+        (void) data;
+
+        if (hook_test_timer_num_calls < 16)
+        {
+            hook_test_timer_calls[hook_test_timer_num_calls] =
+                (int)((long)pointer);
+            hook_test_timer_remaining[hook_test_timer_num_calls] =
+                remaining_calls;
+            hook_test_timer_num_calls++;
+        }
+
+        if (hook_test_timer_unhook)
+        {
+            unhook (hook_test_timer_unhook);
+            hook_test_timer_unhook = NULL;
+        }
+
+        return WEECHAT_RC_OK;
+    }
+
+    /*
+     * Sets date of next execution of a timer (in seconds), and moves it in
+     * heap.
+     */
+
+    static void
+    test_timer_set_next_exec (struct t_hook *hook, long seconds)
+    {
+        hook_timer_heap_remove (hook);
+        HOOK_TIMER(hook, next_exec).tv_sec = seconds;
+        HOOK_TIMER(hook, next_exec).tv_usec = 0;
+        LONGS_EQUAL(1, hook_timer_heap_add (hook));
+    }
+
+    /*
+     * Checks if a timer is in heap.
+     *
+     * Returns:
+     *   1: timer is in heap
+     *   0: timer is not in heap
+     */
+
+    static int
+    test_timer_in_heap (struct t_hook *hook)
+    {
+        int i;
+
+        for (i = 0; i < hook_timer_heap_size; i++)
+        {
+            if (hook_timer_heap[i] == hook)
+                return 1;
+        }
+        return 0;
+    }
+
+    /*
+     * Checks order of timers in heap and their index.
+     */
+
+    static void
+    test_timer_check_heap ()
+    {
+        int i;
+
+        for (i = 0; i < hook_timer_heap_size; i++)
+        {
+            LONGS_EQUAL(i, HOOK_TIMER(hook_timer_heap[i], heap_index));
+            if (i > 0)
+            {
+                CHECK(hook_timer_heap_cmp (hook_timer_heap[(i - 1) / 2],
+                                           hook_timer_heap[i]) <= 0);
+            }
+        }
+    }
 };
 
 /*
@@ -91,11 +256,72 @@ TEST(CoreHook, Connect)
 /*
  * Tests functions:
  *   hook_fd
+ *   hook_fd_exec
+ *   hook_set (flags of fd hook)
  */
 
 TEST(CoreHook, Fd)
 {
-    /* TODO: write tests */
+    int pipe1[2], pipe2[2], i;
+    unsigned int generation[2];
+
+    LONGS_EQUAL(0, pipe (pipe1));
+    LONGS_EQUAL(0, pipe (pipe2));
+
+    POINTERS_EQUAL(NULL, hook_fd (NULL, -1, 1, 0, 0, &test_fd_cb, NULL, NULL));
+    POINTERS_EQUAL(NULL, hook_fd (NULL, pipe1[0], 1, 0, 0, NULL, NULL, NULL));
+
+    hook_test_fd[0] = hook_fd (NULL, pipe1[0], 1, 0, 0,
+                               &test_fd_cb, &hook_test_fd[0], NULL);
+    CHECK(hook_test_fd[0]);
+    hook_test_fd[1] = hook_fd (NULL, pipe2[0], 1, 0, 0,
+                               &test_fd_cb, &hook_test_fd[1], NULL);
+    CHECK(hook_test_fd[1]);
+
+    /* same fd can not be hooked twice */
+    POINTERS_EQUAL(NULL, hook_fd (NULL, pipe1[0], 1, 0, 0,
+                                  &test_fd_cb, NULL, NULL));
+
+    /* change flags of a fd hook */
+    LONGS_EQUAL(HOOK_FD_FLAG_READ, HOOK_FD(hook_test_fd[0], flags));
+    hook_set (hook_test_fd[0], "flag_write", "1");
+    LONGS_EQUAL(HOOK_FD_FLAG_READ | HOOK_FD_FLAG_WRITE,
+                HOOK_FD(hook_test_fd[0], flags));
+    hook_set (hook_test_fd[0], "flag_exception", "1");
+    LONGS_EQUAL(HOOK_FD_FLAG_READ | HOOK_FD_FLAG_WRITE
+                | HOOK_FD_FLAG_EXCEPTION,
+                HOOK_FD(hook_test_fd[0], flags));
+    hook_set (hook_test_fd[0], "flag_read", "0");
+    hook_set (hook_test_fd[0], "flag_write", "0");
+    hook_set (hook_test_fd[0], "flag_exception", "0");
+    LONGS_EQUAL(0, HOOK_FD(hook_test_fd[0], flags));
+    hook_set (hook_test_fd[0], "flag_read", "1");
+    LONGS_EQUAL(HOOK_FD_FLAG_READ, HOOK_FD(hook_test_fd[0], flags));
+
+    /*
+     * both fds are readable: the first callback called unhooks the other
+     * fd, so its pending event must be ignored (without rebuilding epoll,
+     * which would change generation of hooks)
+     */
+    generation[0] = HOOK_FD(hook_test_fd[0], generation);
+    generation[1] = HOOK_FD(hook_test_fd[1], generation);
+    hook_test_fd_calls = 0;
+    LONGS_EQUAL(1, write (pipe1[1], "a", 1));
+    LONGS_EQUAL(1, write (pipe2[1], "b", 1));
+    hook_fd_exec ();
+    LONGS_EQUAL(1, hook_test_fd_calls);
+    CHECK((hook_test_fd[0] && !hook_test_fd[1])
+          || (!hook_test_fd[0] && hook_test_fd[1]));
+    i = (hook_test_fd[0]) ? 0 : 1;
+    LONGS_EQUAL(generation[i], HOOK_FD(hook_test_fd[i], generation));
+
+    unhook (hook_test_fd[i]);
+    hook_test_fd[i] = NULL;
+
+    close (pipe1[0]);
+    close (pipe1[1]);
+    close (pipe2[0]);
+    close (pipe2[1]);
 }
 
 /*
@@ -158,14 +384,90 @@ TEST(CoreHook, Infolist)
     /* TODO: write tests */
 }
 
+int test_hook_line_count = 0;
+
+struct t_hashtable *
+test_hook_line_cb (const void *pointer, void *data, struct t_hashtable *line)
+{
+    /* make C++ compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) line;
+
+    test_hook_line_count++;
+
+    return NULL;
+}
+
 /*
  * Tests functions:
  *   hook_line
+ *   hook_line_exec
+ *   hook_line_buffer_changed
  */
 
 TEST(CoreHook, Line)
 {
-    /* TODO: write tests */
+    struct t_gui_buffer *test_buffer;
+    struct t_hook *hook1, *hook2;
+    char str_buffer[64];
+
+    /* create/open a test buffer */
+    test_buffer = gui_buffer_new (NULL, TEST_BUFFER_NAME,
+                                  NULL, NULL, NULL,
+                                  NULL, NULL, NULL);
+    CHECK(test_buffer);
+    snprintf (str_buffer, sizeof (str_buffer),
+              "0x%lx", (unsigned long)test_buffer);
+
+    hook1 = hook_line (NULL, NULL, "core." TEST_BUFFER_NAME "*", NULL,
+                       &test_hook_line_cb, NULL, NULL);
+    CHECK(hook1);
+    hook2 = hook_line (NULL, "free", "*", NULL,
+                       &test_hook_line_cb, NULL, NULL);
+    CHECK(hook2);
+
+    /* hook1 matches the buffer */
+    test_hook_line_count = 0;
+    gui_chat_printf (test_buffer, "test");
+    LONGS_EQUAL(1, test_hook_line_count);
+    CHECK(hashtable_has_key (hook_match_cache[HOOK_TYPE_LINE], str_buffer));
+
+    /* tags must match */
+    unhook (hook1);
+    hook1 = hook_line (NULL, NULL, "core." TEST_BUFFER_NAME, "tag1",
+                       &test_hook_line_cb, NULL, NULL);
+    CHECK(hook1);
+    test_hook_line_count = 0;
+    gui_chat_printf (test_buffer, "test");
+    LONGS_EQUAL(0, test_hook_line_count);
+    gui_chat_printf_date_tags (test_buffer, 0, "tag1", "test");
+    LONGS_EQUAL(1, test_hook_line_count);
+
+    /* rename buffer: hook1 does not match any more */
+    gui_buffer_set (test_buffer, "name", TEST_BUFFER_NAME "2");
+    CHECK(!hashtable_has_key (hook_match_cache[HOOK_TYPE_LINE], str_buffer));
+    test_hook_line_count = 0;
+    gui_chat_printf_date_tags (test_buffer, 0, "tag1", "test");
+    LONGS_EQUAL(0, test_hook_line_count);
+    gui_buffer_set (test_buffer, "name", TEST_BUFFER_NAME);
+    gui_chat_printf_date_tags (test_buffer, 0, "tag1", "test");
+    LONGS_EQUAL(1, test_hook_line_count);
+
+    /* change buffer type: hook2 matches */
+    test_hook_line_count = 0;
+    gui_chat_printf (test_buffer, "test");
+    LONGS_EQUAL(0, test_hook_line_count);
+    gui_buffer_set (test_buffer, "type", "free");
+    gui_chat_printf_y (test_buffer, 0, "test");
+    LONGS_EQUAL(1, test_hook_line_count);
+
+    unhook (hook1);
+    unhook (hook2);
+
+    /* close the test buffer: buffer removed from cache */
+    gui_buffer_close (test_buffer);
+    CHECK(!hashtable_has_key (hook_match_cache[HOOK_TYPE_LINE], str_buffer));
 }
 
 char *
@@ -276,6 +578,8 @@ error:
 /*
  * Tests functions:
  *   hook_modifier
+ *   hook_modifier_has_hooks
+ *   hook_modifier_exec
  */
 
 TEST(CoreHook, Modifier)
@@ -283,6 +587,20 @@ TEST(CoreHook, Modifier)
     struct t_gui_buffer *test_buffer;
     struct t_gui_line *ptr_line;
     struct t_hook *hook;
+    char *str, name[64];
+    int i;
+
+    LONGS_EQUAL(0, hook_modifier_has_hooks (NULL));
+    LONGS_EQUAL(0, hook_modifier_has_hooks (""));
+    LONGS_EQUAL(0, hook_modifier_has_hooks ("test_no_hooks"));
+
+    /* modifier without hooks: copy of string returned */
+    POINTERS_EQUAL(NULL, hook_modifier_exec (NULL, NULL, NULL, "test"));
+    POINTERS_EQUAL(NULL, hook_modifier_exec (NULL, "test_no_hooks", NULL,
+                                             NULL));
+    str = hook_modifier_exec (NULL, "test_no_hooks", NULL, "test");
+    STRCMP_EQUAL("test", str);
+    free (str);
 
     /* create/open a test buffer */
     test_buffer = gui_buffer_new (NULL, TEST_BUFFER_NAME,
@@ -306,6 +624,22 @@ TEST(CoreHook, Modifier)
     POINTERS_EQUAL(&test_modifier_cb, HOOK_MODIFIER(hook, callback));
     STRCMP_EQUAL("weechat_print", HOOK_MODIFIER(hook, modifier));
 
+    LONGS_EQUAL(1, hook_modifier_has_hooks ("weechat_print"));
+    LONGS_EQUAL(1, hook_modifier_has_hooks ("WEECHAT_PRINT"));
+    LONGS_EQUAL(0, hook_modifier_has_hooks ("test_no_hooks"));
+
+    /* cache of modifiers is bounded */
+    for (i = 0; i < HOOK_MATCH_CACHE_MAX_SIZE + 10; i++)
+    {
+        snprintf (name, sizeof (name), "irc_in_test%d", i);
+        LONGS_EQUAL(0, hook_modifier_has_hooks (name));
+    }
+    CHECK(hook_match_cache[HOOK_TYPE_MODIFIER]->items_count
+          <= HOOK_MATCH_CACHE_MAX_SIZE);
+    CHECK(!hashtable_has_key (hook_match_cache[HOOK_TYPE_MODIFIER],
+                              "weechat_print"));
+    LONGS_EQUAL(1, hook_modifier_has_hooks ("weechat_print"));
+
     /* message without prefix: unchanged */
     gui_chat_printf_date_tags (test_buffer, 0, NULL, " \tmessage");
     ptr_line = test_buffer->own_lines->last_line;
@@ -366,18 +700,100 @@ TEST(CoreHook, Modifier)
     POINTERS_EQUAL(NULL, ptr_line->data->prefix);
     STRCMP_EQUAL("message (modified)", ptr_line->data->message);
 
+    unhook (hook);
+
     /* close the test buffer */
     gui_buffer_close (test_buffer);
 }
 
+int test_hook_print_count = 0;
+char test_hook_print_message[1024];
+
+int
+test_hook_print_cb (const void *pointer, void *data,
+               struct t_gui_buffer *buffer,
+               time_t date, int tags_count, const char **tags,
+               int displayed, int highlight,
+               const char *prefix, const char *message)
+{
+    /* make C++ compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) buffer;
+    (void) date;
+    (void) tags_count;
+    (void) tags;
+    (void) displayed;
+    (void) highlight;
+    (void) prefix;
+
+    test_hook_print_count++;
+    snprintf (test_hook_print_message, sizeof (test_hook_print_message),
+              "%s", message);
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Tests functions:
  *   hook_print
+ *   hook_print_exec
+ *   hook_print_buffer_closed
  */
 
 TEST(CoreHook, Print)
 {
-    /* TODO: write tests */
+    struct t_gui_buffer *test_buffer;
+    struct t_hook *hook1, *hook2;
+    char str_buffer[64];
+
+    /* create/open a test buffer */
+    test_buffer = gui_buffer_new (NULL, TEST_BUFFER_NAME,
+                                  NULL, NULL, NULL,
+                                  NULL, NULL, NULL);
+    CHECK(test_buffer);
+    snprintf (str_buffer, sizeof (str_buffer),
+              "0x%lx", (unsigned long)test_buffer);
+
+    /* hook on the test buffer, keeping colors */
+    hook1 = hook_print (NULL, test_buffer, NULL, NULL, 0,
+                        &test_hook_print_cb, NULL, NULL);
+    CHECK(hook1);
+
+    test_hook_print_count = 0;
+    gui_chat_printf (test_buffer, "%stest", gui_color_get_custom ("red"));
+    LONGS_EQUAL(1, test_hook_print_count);
+    CHECK(strcmp (test_hook_print_message, "test") != 0);
+    CHECK(hashtable_has_key (hook_match_cache[HOOK_TYPE_PRINT], str_buffer));
+
+    /* hook on the core buffer: not called */
+    unhook (hook1);
+    hook1 = hook_print (NULL, gui_buffers, NULL, NULL, 1,
+                        &test_hook_print_cb, NULL, NULL);
+    CHECK(hook1);
+    test_hook_print_count = 0;
+    gui_chat_printf (test_buffer, "test");
+    LONGS_EQUAL(0, test_hook_print_count);
+
+    /* hook on all buffers with a message, stripping colors */
+    hook2 = hook_print (NULL, NULL, "tag1", "ABC", 1,
+                        &test_hook_print_cb, NULL, NULL);
+    CHECK(hook2);
+    gui_chat_printf (test_buffer, "test abc");
+    LONGS_EQUAL(0, test_hook_print_count);
+    gui_chat_printf_date_tags (test_buffer, 0, "tag1", "test");
+    LONGS_EQUAL(0, test_hook_print_count);
+    gui_chat_printf_date_tags (test_buffer, 0, "tag1",
+                               "%stest abc", gui_color_get_custom ("red"));
+    LONGS_EQUAL(1, test_hook_print_count);
+    STRCMP_EQUAL("test abc", test_hook_print_message);
+
+    unhook (hook1);
+    unhook (hook2);
+
+    /* close the test buffer: buffer removed from cache */
+    gui_buffer_close (test_buffer);
+    CHECK(!hashtable_has_key (hook_match_cache[HOOK_TYPE_PRINT], str_buffer));
 }
 
 /*
@@ -394,19 +810,224 @@ TEST(CoreHook, Process)
 /*
  * Tests functions:
  *   hook_signal
+ *   hook_signal_send
  */
 
 TEST(CoreHook, Signal)
 {
-    /* TODO: write tests */
+    struct t_hook *hook, *hook2;
+    struct t_hook_match *ptr_match;
+    char name[64];
+    int i;
+
+    hook = hook_signal (NULL, "test_signal_*", &test_signal_cb, NULL, NULL);
+    CHECK(hook);
+
+    /* names sent are kept in cache */
+    hook_test_signal_calls = 0;
+    LONGS_EQUAL(WEECHAT_RC_OK,
+                hook_signal_send ("test_signal_1", WEECHAT_HOOK_SIGNAL_STRING,
+                                  NULL));
+    LONGS_EQUAL(1, hook_test_signal_calls);
+    ptr_match = (struct t_hook_match *)hashtable_get (
+        hook_match_cache[HOOK_TYPE_SIGNAL], "test_signal_1");
+    CHECK(ptr_match);
+    LONGS_EQUAL(1, ptr_match->num_hooks);
+    LONGS_EQUAL(1, ptr_match->count);
+    LONGS_EQUAL(0, ptr_match->running);
+    POINTERS_EQUAL(ptr_match, hook_match_first[HOOK_TYPE_SIGNAL]);
+
+    /* cache is bounded: least recently used names are removed */
+    for (i = 0; i < HOOK_MATCH_CACHE_MAX_SIZE + 10; i++)
+    {
+        snprintf (name, sizeof (name), "test_unknown_signal_%d", i);
+        LONGS_EQUAL(WEECHAT_RC_OK,
+                    hook_signal_send (name, WEECHAT_HOOK_SIGNAL_STRING, NULL));
+    }
+    LONGS_EQUAL(1, hook_test_signal_calls);
+    CHECK(hook_match_cache[HOOK_TYPE_SIGNAL]->items_count
+          <= HOOK_MATCH_CACHE_MAX_SIZE);
+    CHECK(!hashtable_has_key (hook_match_cache[HOOK_TYPE_SIGNAL],
+                              "test_signal_1"));
+    CHECK(hashtable_has_key (hook_match_cache[HOOK_TYPE_SIGNAL], name));
+    POINTERS_EQUAL(
+        hashtable_get (hook_match_cache[HOOK_TYPE_SIGNAL], name),
+        hook_match_first[HOOK_TYPE_SIGNAL]);
+
+    /* entry is not removed while its callbacks are running */
+    hook2 = hook_signal (NULL, "test_signal_other_*", &test_signal_cb,
+                         NULL, NULL);
+    CHECK(hook2);
+    hook_test_signal_calls = 0;
+    LONGS_EQUAL(WEECHAT_RC_OK,
+                hook_signal_send ("test_signal_flood",
+                                  WEECHAT_HOOK_SIGNAL_STRING, NULL));
+    LONGS_EQUAL(HOOK_MATCH_CACHE_MAX_SIZE + 11, hook_test_signal_calls);
+    CHECK(hook_match_cache[HOOK_TYPE_SIGNAL]->items_count
+          <= HOOK_MATCH_CACHE_MAX_SIZE);
+    ptr_match = (struct t_hook_match *)hashtable_get (
+        hook_match_cache[HOOK_TYPE_SIGNAL], "test_signal_flood");
+    CHECK(ptr_match);
+    LONGS_EQUAL(1, ptr_match->count);
+    LONGS_EQUAL(0, ptr_match->running);
+
+    unhook (hook);
+    unhook (hook2);
 }
 
 /*
  * Tests functions:
  *   hook_timer
+ *   hook_timer_heap_add
+ *   hook_timer_heap_remove
+ *   hook_timer_heap_rebuild
+ *   hook_timer_check_system_clock
+ *   hook_timer_get_time_to_next
+ *   hook_timer_exec
  */
 
 TEST(CoreHook, Timer)
 {
-    /* TODO: write tests */
+    struct t_hook **old_heap, *timer1, *timer2, *timer3, *timer4;
+    int old_heap_size, old_heap_alloc, timeout;
+
+    /* use an empty heap, so that only timers of this test are executed */
+    old_heap = hook_timer_heap;
+    old_heap_size = hook_timer_heap_size;
+    old_heap_alloc = hook_timer_heap_alloc;
+    hook_timer_heap = NULL;
+    hook_timer_heap_size = 0;
+    hook_timer_heap_alloc = 0;
+
+    POINTERS_EQUAL(NULL, hook_timer (NULL, 0, 0, 0, &test_timer_cb,
+                                     NULL, NULL));
+    POINTERS_EQUAL(NULL, hook_timer (NULL, 1000, 0, 0, NULL, NULL, NULL));
+
+    /* no timer: default timeout is 2 seconds */
+    LONGS_EQUAL(2000, hook_timer_get_time_to_next ());
+
+    timer1 = hook_timer (NULL, 100000, 0, 0, &test_timer_cb,
+                         (void *)1, NULL);
+    CHECK(timer1);
+    timer2 = hook_timer (NULL, 100000, 0, 0, &test_timer_cb,
+                         (void *)2, NULL);
+    CHECK(timer2);
+    timer3 = hook_timer (NULL, 100000, 0, 0, &test_timer_cb,
+                         (void *)3, NULL);
+    CHECK(timer3);
+    LONGS_EQUAL(3, hook_timer_heap_size);
+    test_timer_check_heap ();
+
+    /* timeout follows the first timer in heap */
+    LONGS_EQUAL(2000, hook_timer_get_time_to_next ());
+    timer4 = hook_timer (NULL, 500, 0, 0, &test_timer_cb, (void *)4, NULL);
+    CHECK(timer4);
+    POINTERS_EQUAL(timer4, hook_timer_heap[0]);
+    timeout = hook_timer_get_time_to_next ();
+    CHECK((timeout >= 1) && (timeout <= 500));
+    unhook (timer4);
+    LONGS_EQUAL(3, hook_timer_heap_size);
+    test_timer_check_heap ();
+    LONGS_EQUAL(2000, hook_timer_get_time_to_next ());
+    test_timer_set_next_exec (timer2, 1000);
+    POINTERS_EQUAL(timer2, hook_timer_heap[0]);
+    LONGS_EQUAL(1, hook_timer_get_time_to_next ());
+
+    /* timers are executed in order of next execution */
+    test_timer_set_next_exec (timer1, 3000);
+    test_timer_set_next_exec (timer2, 1000);
+    test_timer_set_next_exec (timer3, 2000);
+    test_timer_check_heap ();
+    hook_test_timer_num_calls = 0;
+    hook_timer_exec ();
+    LONGS_EQUAL(3, hook_test_timer_num_calls);
+    LONGS_EQUAL(2, hook_test_timer_calls[0]);
+    LONGS_EQUAL(3, hook_test_timer_calls[1]);
+    LONGS_EQUAL(1, hook_test_timer_calls[2]);
+    LONGS_EQUAL(-1, hook_test_timer_remaining[0]);
+    LONGS_EQUAL(3, hook_timer_heap_size);
+    test_timer_check_heap ();
+    LONGS_EQUAL(1100, HOOK_TIMER(timer2, next_exec).tv_sec);
+
+    /* timers with same date are executed in order of creation */
+    test_timer_set_next_exec (timer3, 1000);
+    test_timer_set_next_exec (timer2, 1000);
+    test_timer_set_next_exec (timer1, 1000);
+    hook_test_timer_num_calls = 0;
+    hook_timer_exec ();
+    LONGS_EQUAL(3, hook_test_timer_num_calls);
+    LONGS_EQUAL(1, hook_test_timer_calls[0]);
+    LONGS_EQUAL(2, hook_test_timer_calls[1]);
+    LONGS_EQUAL(3, hook_test_timer_calls[2]);
+    test_timer_check_heap ();
+
+    /* timer due, unhooked by another timer: not executed, removed from heap */
+    test_timer_set_next_exec (timer1, 1000);
+    test_timer_set_next_exec (timer2, 2000);
+    test_timer_set_next_exec (timer3, 3000);
+    hook_test_timer_unhook = timer2;
+    hook_test_timer_num_calls = 0;
+    hook_timer_exec ();
+    POINTERS_EQUAL(NULL, hook_test_timer_unhook);
+    LONGS_EQUAL(2, hook_test_timer_num_calls);
+    LONGS_EQUAL(1, hook_test_timer_calls[0]);
+    LONGS_EQUAL(3, hook_test_timer_calls[1]);
+    LONGS_EQUAL(2, hook_timer_heap_size);
+    CHECK(!test_timer_in_heap (timer2));
+    test_timer_check_heap ();
+
+    /* timer with max calls: removed from heap after last call */
+    timer2 = hook_timer (NULL, 100000, 0, 2, &test_timer_cb,
+                         (void *)2, NULL);
+    CHECK(timer2);
+    test_timer_set_next_exec (timer1, 5000);
+    test_timer_set_next_exec (timer3, 5000);
+    test_timer_set_next_exec (timer2, 1000);
+    hook_test_timer_num_calls = 0;
+    hook_timer_exec ();
+    LONGS_EQUAL(3, hook_test_timer_num_calls);
+    LONGS_EQUAL(2, hook_test_timer_calls[0]);
+    LONGS_EQUAL(1, hook_test_timer_remaining[0]);
+    CHECK(test_timer_in_heap (timer2));
+    LONGS_EQUAL(1, HOOK_TIMER(timer2, remaining_calls));
+    test_timer_set_next_exec (timer1, 5000);
+    test_timer_set_next_exec (timer3, 5000);
+    test_timer_set_next_exec (timer2, 1000);
+    hook_test_timer_num_calls = 0;
+    hook_timer_exec ();
+    LONGS_EQUAL(3, hook_test_timer_num_calls);
+    LONGS_EQUAL(2, hook_test_timer_calls[0]);
+    LONGS_EQUAL(0, hook_test_timer_remaining[0]);
+    LONGS_EQUAL(2, hook_timer_heap_size);
+    CHECK(!test_timer_in_heap (timer2));
+    test_timer_check_heap ();
+
+    /* clock skew: timers are reinitialized and heap is rebuilt */
+    timer4 = hook_timer (NULL, 500, 0, 0, &test_timer_cb, (void *)4, NULL);
+    CHECK(timer4);
+    test_timer_set_next_exec (timer1, 1000);
+    test_timer_set_next_exec (timer3, 2000);
+    test_timer_set_next_exec (timer4, 3000);
+    POINTERS_EQUAL(timer1, hook_timer_heap[0]);
+    hook_last_system_time = time (NULL) - 3600;
+    hook_timer_check_system_clock ();
+    CHECK(HOOK_TIMER(timer1, next_exec).tv_sec > 1000);
+    POINTERS_EQUAL(timer4, hook_timer_heap[0]);
+    test_timer_check_heap ();
+    hook_test_timer_num_calls = 0;
+    hook_timer_exec ();
+    LONGS_EQUAL(0, hook_test_timer_num_calls);
+
+    unhook (timer1);
+    unhook (timer3);
+    unhook (timer4);
+    LONGS_EQUAL(0, hook_timer_heap_size);
+
+    /* restore heap (dates of timers may have changed with clock skew) */
+    if (hook_timer_heap)
+        free (hook_timer_heap);
+    hook_timer_heap = old_heap;
+    hook_timer_heap_size = old_heap_size;
+    hook_timer_heap_alloc = old_heap_alloc;
+    hook_timer_heap_rebuild ();
 }
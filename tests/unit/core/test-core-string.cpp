@@ -1246,6 +1246,86 @@ TEST(CoreString, Highlight)
     WEE_HAS_HL_REGEX(0, 0, "test here", "teste.*");
 }
 
+/*
+ * Tests functions:
+ *   string_highlight_compile
+ *   string_highlight_match
+ *   string_highlight_free
+ *   string_has_highlight
+ */
+
+TEST(CoreString, HighlightCompiled)
+{
+    struct t_string_highlight *highlight;
+    const char *words = "test,(?-i)Abc,*xyz,d\u00E9f*,*mid*,he,hello";
+    const char *messages[] = { "this is a TEST", "this is a tests",
+                               "Abc: hi", "abc: hi", "the abcxyz",
+                               "the xyzabc", "d\u00E9fine", "ad\u00E9f",
+                               "amidst", "hello!", "hell he", "hell",
+                               "test\u00A0here", "(he)", NULL };
+    int i;
+
+    LONGS_EQUAL(0, string_highlight_match (NULL, NULL));
+    LONGS_EQUAL(0, string_highlight_match (NULL, "test"));
+
+    highlight = string_highlight_compile (NULL);
+    CHECK(highlight);
+    LONGS_EQUAL(0, highlight->num_words);
+    LONGS_EQUAL(0, string_highlight_match (highlight, "test"));
+    string_highlight_free (highlight);
+
+    /* empty words and single wildcards are ignored */
+    highlight = string_highlight_compile (",*,**,,");
+    CHECK(highlight);
+    LONGS_EQUAL(0, highlight->num_words);
+    LONGS_EQUAL(0, string_highlight_match (highlight, "test"));
+    string_highlight_free (highlight);
+
+    highlight = string_highlight_compile (
+        "test,(?-i)Abc,*xyz,d\u00E9f*,*mid*,he,hello,\u00C9T\u00C9");
+    CHECK(highlight);
+    LONGS_EQUAL(8, highlight->num_words);
+    LONGS_EQUAL(5, highlight->max_length);
+    LONGS_EQUAL(0, string_highlight_match (highlight, NULL));
+    LONGS_EQUAL(0, string_highlight_match (highlight, ""));
+    LONGS_EQUAL(0, string_highlight_match (highlight, "nothing here"));
+
+    /* case insensitive word */
+    LONGS_EQUAL(1, string_highlight_match (highlight, "this is a TEST"));
+    LONGS_EQUAL(0, string_highlight_match (highlight, "this is a tests"));
+
+    /* case sensitive word */
+    LONGS_EQUAL(1, string_highlight_match (highlight, "Abc: hi"));
+    LONGS_EQUAL(0, string_highlight_match (highlight, "abc: hi"));
+
+    /* wildcards */
+    LONGS_EQUAL(1, string_highlight_match (highlight, "the abcxyz"));
+    LONGS_EQUAL(0, string_highlight_match (highlight, "the xyzabc"));
+    LONGS_EQUAL(1, string_highlight_match (highlight, "d\u00C9fine"));
+    LONGS_EQUAL(0, string_highlight_match (highlight, "ad\u00E9f"));
+    LONGS_EQUAL(1, string_highlight_match (highlight, "amidst"));
+
+    /* words sharing a prefix or a suffix */
+    LONGS_EQUAL(1, string_highlight_match (highlight, "hello!"));
+    LONGS_EQUAL(1, string_highlight_match (highlight, "hell he"));
+    LONGS_EQUAL(0, string_highlight_match (highlight, "hell"));
+
+    /* UTF-8 chars converted to lower case */
+    LONGS_EQUAL(1, string_highlight_match (highlight, "un \u00E9t\u00E9 chaud"));
+
+    string_highlight_free (highlight);
+
+    /* same result as function string_has_highlight (words not compiled) */
+    highlight = string_highlight_compile (words);
+    CHECK(highlight);
+    for (i = 0; messages[i]; i++)
+    {
+        LONGS_EQUAL(string_has_highlight (messages[i], words),
+                    string_highlight_match (highlight, messages[i]));
+    }
+    string_highlight_free (highlight);
+}
+
 /*
  * Test callback for function string_replace_with_callback.
  *
@@ -0,0 +1,270 @@
+/*
+ * test-core-upgrade-file.cpp - test upgrade file functions
+ *
+ * Copyright (C) 2023 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#ifndef HAVE_CONFIG_H
+#define HAVE_CONFIG_H
+#endif
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "src/core/weechat.h"
+#include "src/core/wee-infolist.h"
+#include "src/core/wee-string.h"
+#include "src/core/wee-upgrade-file.h"
+#include "src/plugins/weechat-plugin.h"
+}
+
+#define TEST_UPGRADE_FILENAME "test_upgrade_file"
+#define TEST_RECORDS 20000
+
+int upgrade_file_test_objects = 0;
+int upgrade_file_test_blocks = 0;
+int upgrade_file_test_chunks = 0;
+char upgrade_file_test_data[TEST_RECORDS * 16];
+int upgrade_file_test_data_length = 0;
+
+TEST_GROUP(CoreUpgradeFile)
+{
+    /*
+     * Callback for objects read in upgrade file.
+     */
+
+    static int
+    test_read_cb (const void *pointer, void *data,
+                  struct t_upgrade_file *upgrade_file,
+                  int object_id,
+                  struct t_infolist *infolist)
+    {
+        /* make C++ compiler happy */
+        (void) pointer;
+        (void) data;
+        (void) upgrade_file;
+
+        LONGS_EQUAL(upgrade_file_test_objects + 1, object_id);
+        CHECK(infolist_next (infolist));
+        STRCMP_EQUAL("test", infolist_string (infolist, "name"));
+        upgrade_file_test_objects++;
+
+        return WEECHAT_RC_OK;
+    }
+
+    /*
+     * Callback for chunks of binary blocks read in upgrade file.
+     */
+
+    static int
+    test_read_block_cb (const void *pointer, void *data,
+                        struct t_upgrade_file *upgrade_file,
+                        int object_id, int version,
+                        const char *chunk, int size)
+    {
+        /* make C++ compiler happy */
+        (void) pointer;
+        (void) data;
+        (void) upgrade_file;
+
+        LONGS_EQUAL(10, object_id);
+        LONGS_EQUAL(upgrade_file_test_blocks + 1, version);
+        if (chunk)
+        {
+            CHECK(size > 0);
+            CHECK(upgrade_file_test_data_length + size
+                  < (int)sizeof (upgrade_file_test_data));
+            memcpy (upgrade_file_test_data + upgrade_file_test_data_length,
+                    chunk, size);
+            upgrade_file_test_data_length += size;
+            upgrade_file_test_chunks++;
+        }
+        else
+        {
+            upgrade_file_test_blocks++;
+        }
+
+        return WEECHAT_RC_OK;
+    }
+
+    /*
+     * Writes an object with an infolist in upgrade file.
+     */
+
+    static void
+    test_write_object (struct t_upgrade_file *upgrade_file, int object_id)
+    {
+        struct t_infolist *infolist;
+        struct t_infolist_item *item;
+
+        infolist = infolist_new (NULL);
+        CHECK(infolist);
+        item = infolist_new_item (infolist);
+        CHECK(item);
+        CHECK(infolist_new_var_string (item, "name", "test"));
+        LONGS_EQUAL(1, upgrade_file_write_object (upgrade_file, object_id,
+                                                  infolist));
+        infolist_free (infolist);
+    }
+};
+
+/*
+ * Tests functions:
+ *   upgrade_file_new
+ *   upgrade_file_write_object
+ *   upgrade_file_write_block_start
+ *   upgrade_file_write_block_data
+ *   upgrade_file_write_block_end_record
+ *   upgrade_file_write_block_end
+ *   upgrade_file_read
+ *   upgrade_file_close
+ */
+
+TEST(CoreUpgradeFile, WriteReadBlock)
+{
+    struct t_upgrade_file *upgrade_file;
+    char record[64], **expected, filename[PATH_MAX];
+    int i, length;
+
+    expected = string_dyn_alloc (256);
+    CHECK(expected);
+
+    /* write file: object, block (compressed), block (not compressed), object */
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_FILENAME, NULL, NULL, NULL);
+    CHECK(upgrade_file);
+    test_write_object (upgrade_file, 1);
+    LONGS_EQUAL(1, upgrade_file_write_block_start (upgrade_file, 10, 1, 1));
+    for (i = 0; i < TEST_RECORDS; i++)
+    {
+        length = snprintf (record, sizeof (record), "record %d;", i);
+        LONGS_EQUAL(1, upgrade_file_write_block_data (upgrade_file,
+                                                      record, 7));
+        LONGS_EQUAL(1, upgrade_file_write_block_data (upgrade_file,
+                                                      record + 7,
+                                                      length - 7));
+        LONGS_EQUAL(1, upgrade_file_write_block_end_record (upgrade_file));
+        string_dyn_concat (expected, record, -1);
+    }
+    LONGS_EQUAL(1, upgrade_file_write_block_end (upgrade_file));
+    LONGS_EQUAL(1, upgrade_file_write_block_start (upgrade_file, 10, 2, 0));
+    LONGS_EQUAL(1, upgrade_file_write_block_data (upgrade_file, "end", 3));
+    LONGS_EQUAL(1, upgrade_file_write_block_end_record (upgrade_file));
+    LONGS_EQUAL(1, upgrade_file_write_block_end (upgrade_file));
+    string_dyn_concat (expected, "end", -1);
+    test_write_object (upgrade_file, 2);
+    upgrade_file_close (upgrade_file);
+
+    /* read file with callback for blocks */
+    upgrade_file_test_objects = 0;
+    upgrade_file_test_blocks = 0;
+    upgrade_file_test_chunks = 0;
+    upgrade_file_test_data_length = 0;
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_FILENAME,
+                                     &test_read_cb, NULL, NULL);
+    CHECK(upgrade_file);
+    upgrade_file->callback_read_block = &test_read_block_cb;
+    LONGS_EQUAL(1, upgrade_file_read (upgrade_file));
+    upgrade_file_close (upgrade_file);
+    LONGS_EQUAL(2, upgrade_file_test_objects);
+    LONGS_EQUAL(2, upgrade_file_test_blocks);
+    CHECK(upgrade_file_test_chunks > 2);
+    upgrade_file_test_data[upgrade_file_test_data_length] = '\0';
+    STRCMP_EQUAL(*expected, upgrade_file_test_data);
+
+    /* read file without callback for blocks: blocks are skipped */
+    upgrade_file_test_objects = 0;
+    upgrade_file_test_blocks = 0;
+    upgrade_file_test_chunks = 0;
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_FILENAME,
+                                     &test_read_cb, NULL, NULL);
+    CHECK(upgrade_file);
+    LONGS_EQUAL(1, upgrade_file_read (upgrade_file));
+    upgrade_file_close (upgrade_file);
+    LONGS_EQUAL(2, upgrade_file_test_objects);
+    LONGS_EQUAL(0, upgrade_file_test_blocks);
+    LONGS_EQUAL(0, upgrade_file_test_chunks);
+
+    snprintf (filename, sizeof (filename), "%s/%s.upgrade",
+              weechat_data_dir, TEST_UPGRADE_FILENAME);
+    unlink (filename);
+
+    string_dyn_free (expected, 1);
+}
+
+/*
+ * Tests functions:
+ *   upgrade_file_read (signature)
+ */
+
+TEST(CoreUpgradeFile, Signature)
+{
+    struct t_upgrade_file *upgrade_file;
+    char filename[PATH_MAX], content[1024], *pos;
+    FILE *file;
+    int size;
+
+    snprintf (filename, sizeof (filename), "%s/%s.upgrade",
+              weechat_data_dir, TEST_UPGRADE_FILENAME);
+
+    /* write file with an object */
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_FILENAME, NULL, NULL, NULL);
+    CHECK(upgrade_file);
+    test_write_object (upgrade_file, 1);
+    upgrade_file_close (upgrade_file);
+    file = fopen (filename, "rb");
+    CHECK(file);
+    size = fread (content, 1, sizeof (content), file);
+    fclose (file);
+    CHECK(size > 0);
+    pos = (char *)memmem (content, size, "v2.3", 4);
+    CHECK(pos);
+
+    /* signature of previous version (without binary blocks): OK */
+    memcpy (pos, "v2.2", 4);
+    file = fopen (filename, "wb");
+    CHECK(file);
+    LONGS_EQUAL(size, fwrite (content, 1, size, file));
+    fclose (file);
+    upgrade_file_test_objects = 0;
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_FILENAME,
+                                     &test_read_cb, NULL, NULL);
+    CHECK(upgrade_file);
+    LONGS_EQUAL(1, upgrade_file_read (upgrade_file));
+    upgrade_file_close (upgrade_file);
+    LONGS_EQUAL(1, upgrade_file_test_objects);
+
+    /* unknown signature: error */
+    memcpy (pos, "v9.9", 4);
+    file = fopen (filename, "wb");
+    CHECK(file);
+    LONGS_EQUAL(size, fwrite (content, 1, size, file));
+    fclose (file);
+    upgrade_file_test_objects = 0;
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_FILENAME,
+                                     &test_read_cb, NULL, NULL);
+    CHECK(upgrade_file);
+    LONGS_EQUAL(0, upgrade_file_read (upgrade_file));
+    upgrade_file_close (upgrade_file);
+    LONGS_EQUAL(0, upgrade_file_test_objects);
+
+    unlink (filename);
+}
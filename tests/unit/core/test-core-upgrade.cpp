@@ -0,0 +1,345 @@
+/*
+ * test-core-upgrade.cpp - test upgrade functions
+ *
+ * Copyright (C) 2023 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#ifndef HAVE_CONFIG_H
+#define HAVE_CONFIG_H
+#endif
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "src/core/weechat.h"
+#include "src/core/wee-string.h"
+#include "src/core/wee-upgrade.h"
+#include "src/core/wee-upgrade-file.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-line.h"
+#include "src/plugins/weechat-plugin.h"
+
+extern struct t_gui_buffer *upgrade_current_buffer;
+extern int upgrade_lines_strings_count;
+extern int upgrade_weechat_save_buffer_lines (struct t_upgrade_file *upgrade_file,
+                                              struct t_gui_buffer *buffer);
+extern void upgrade_weechat_lines_strings_free ();
+extern int upgrade_weechat_read_buffer_lines (const char *chunk, int size);
+extern int upgrade_weechat_read_block_cb (const void *pointer, void *data,
+                                          struct t_upgrade_file *upgrade_file,
+                                          int object_id, int version,
+                                          const char *chunk, int size);
+}
+
+#define TEST_UPGRADE_FILENAME "test_upgrade_lines"
+
+TEST_GROUP(CoreUpgrade)
+{
+    /*
+     * Callback for objects read in upgrade file (no object is expected).
+     */
+
+    static int
+    test_read_cb (const void *pointer, void *data,
+                  struct t_upgrade_file *upgrade_file,
+                  int object_id,
+                  struct t_infolist *infolist)
+    {
+        /* make C++ compiler happy */
+        (void) pointer;
+        (void) data;
+        (void) upgrade_file;
+        (void) object_id;
+        (void) infolist;
+
+        FAIL("unexpected object in upgrade file");
+
+        return WEECHAT_RC_ERROR;
+    }
+
+    /*
+     * Builds a chunk of buffer lines with two strings ("tag1" and "prefix")
+     * and one line using them.
+     *
+     * Returns size of chunk.
+     */
+
+    static int
+    test_build_chunk (char *chunk,
+                      struct t_upgrade_weechat_line_record *record,
+                      int tag_index, int string_length,
+                      const char *message, int message_length)
+    {
+        int pos, length;
+
+        pos = 0;
+
+        chunk[pos++] = UPGRADE_WEECHAT_LINES_RECORD_STRING;
+        memcpy (chunk + pos, &string_length, sizeof (string_length));
+        pos += sizeof (string_length);
+        memcpy (chunk + pos, "tag1", 5);
+        pos += 5;
+
+        chunk[pos++] = UPGRADE_WEECHAT_LINES_RECORD_STRING;
+        length = 7;
+        memcpy (chunk + pos, &length, sizeof (length));
+        pos += sizeof (length);
+        memcpy (chunk + pos, "prefix", 7);
+        pos += 7;
+
+        chunk[pos++] = UPGRADE_WEECHAT_LINES_RECORD_LINE;
+        memcpy (chunk + pos, record, sizeof (*record));
+        pos += sizeof (*record);
+        memcpy (chunk + pos, &tag_index, sizeof (tag_index));
+        pos += sizeof (tag_index);
+        memcpy (chunk + pos, message, message_length);
+        pos += message_length;
+
+        return pos;
+    }
+};
+
+/*
+ * Tests functions:
+ *   upgrade_weechat_save_buffer_lines
+ *   upgrade_weechat_read_block_cb
+ *   upgrade_weechat_read_buffer_lines
+ *   upgrade_weechat_add_buffer_line
+ */
+
+TEST(CoreUpgrade, BufferLinesWriteRead)
+{
+    struct t_upgrade_file *upgrade_file;
+    struct t_gui_buffer *buffer, *buffer2;
+    struct t_gui_line *line, *line2;
+    char *tags, *tags2, filename[PATH_MAX];
+    int count;
+
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer);
+    buffer2 = gui_buffer_new_user ("test2", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer2);
+
+    /* line with tags, prefix and message */
+    line = gui_line_new (buffer, -1, 1000000000, 1000000001,
+                         "irc_privmsg,nick_Alice,log1", "Alice", "hello");
+    CHECK(line);
+    gui_line_add (line);
+
+    /* same tags and prefix, empty message, highlight, last read line */
+    line = gui_line_new (buffer, -1, 1000000002, 1000000003,
+                         "irc_privmsg,nick_Alice,log1", "Alice", "");
+    CHECK(line);
+    gui_line_add (line);
+    line->data->highlight = 1;
+    buffer->own_lines->last_read_line = line;
+
+    /* no tags, no prefix, no message */
+    line = gui_line_new (buffer, -1, 1000000004, 1000000005,
+                         NULL, NULL, NULL);
+    CHECK(line);
+    gui_line_add (line);
+
+    /* write lines */
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_FILENAME, NULL, NULL, NULL);
+    CHECK(upgrade_file);
+    LONGS_EQUAL(1, upgrade_weechat_save_buffer_lines (upgrade_file, buffer));
+    upgrade_file_close (upgrade_file);
+
+    /* read lines in another buffer */
+    upgrade_current_buffer = buffer2;
+    upgrade_file = upgrade_file_new (TEST_UPGRADE_FILENAME,
+                                     &test_read_cb, NULL, NULL);
+    CHECK(upgrade_file);
+    upgrade_file->callback_read_block = &upgrade_weechat_read_block_cb;
+    LONGS_EQUAL(1, upgrade_file_read (upgrade_file));
+    upgrade_file_close (upgrade_file);
+    upgrade_current_buffer = NULL;
+
+    /* strings are freed at the end of block */
+    LONGS_EQUAL(0, upgrade_lines_strings_count);
+
+    /* compare lines */
+    LONGS_EQUAL(3, buffer2->own_lines->lines_count);
+    count = 0;
+    line = buffer->own_lines->first_line;
+    line2 = buffer2->own_lines->first_line;
+    while (line && line2)
+    {
+        LONGS_EQUAL(line->data->id, line2->data->id);
+        LONGS_EQUAL(line->data->date, line2->data->date);
+        LONGS_EQUAL(line->data->date_printed, line2->data->date_printed);
+        LONGS_EQUAL(line->data->tags_count, line2->data->tags_count);
+        tags = string_rebuild_split_string (
+            (const char **)line->data->tags_array, ",", 0, -1);
+        tags2 = string_rebuild_split_string (
+            (const char **)line2->data->tags_array, ",", 0, -1);
+        STRCMP_EQUAL(tags, tags2);
+        if (tags)
+            free (tags);
+        if (tags2)
+            free (tags2);
+        STRCMP_EQUAL(line->data->prefix, line2->data->prefix);
+        STRCMP_EQUAL(line->data->message, line2->data->message);
+        LONGS_EQUAL(line->data->highlight, line2->data->highlight);
+        LONGS_EQUAL((buffer->own_lines->last_read_line == line) ? 1 : 0,
+                    (buffer2->own_lines->last_read_line == line2) ? 1 : 0);
+        count++;
+        line = line->next_line;
+        line2 = line2->next_line;
+    }
+    LONGS_EQUAL(3, count);
+    POINTERS_EQUAL(NULL, line2);
+    STRCMP_EQUAL("nick_Alice",
+                 buffer2->own_lines->first_line->data->tags_array[1]);
+    LONGS_EQUAL(1, buffer2->own_lines->first_line->next_line->data->highlight);
+    STRCMP_EQUAL("", buffer2->own_lines->last_line->data->message);
+
+    snprintf (filename, sizeof (filename), "%s/%s.upgrade",
+              weechat_data_dir, TEST_UPGRADE_FILENAME);
+    unlink (filename);
+
+    gui_buffer_close (buffer);
+    gui_buffer_close (buffer2);
+}
+
+/*
+ * Tests functions:
+ *   upgrade_weechat_read_buffer_lines (truncated or corrupted chunks)
+ */
+
+TEST(CoreUpgrade, BufferLinesReadInvalid)
+{
+    struct t_gui_buffer *buffer;
+    struct t_upgrade_weechat_line_record record, record2;
+    char chunk[1024];
+    int i, size, size_strings;
+
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer);
+    upgrade_current_buffer = buffer;
+
+    memset (&record, 0, sizeof (record));
+    record.id = 1;
+    record.y = -1;
+    record.date = 1000000000;
+    record.date_printed = 1000000001;
+    record.prefix = 1;
+    record.tags_count = 1;
+    record.message_length = 6;
+
+    /* valid chunk */
+    size = test_build_chunk (chunk, &record, 0, 5, "hello", 6);
+    LONGS_EQUAL(1, upgrade_weechat_read_buffer_lines (chunk, size));
+    LONGS_EQUAL(2, upgrade_lines_strings_count);
+    upgrade_weechat_lines_strings_free ();
+    LONGS_EQUAL(1, buffer->own_lines->lines_count);
+    STRCMP_EQUAL("tag1", buffer->own_lines->last_line->data->tags_array[0]);
+    STRCMP_EQUAL("prefix", buffer->own_lines->last_line->data->prefix);
+    STRCMP_EQUAL("hello", buffer->own_lines->last_line->data->message);
+
+    /* truncated chunk: OK only if the cut is at the end of a record */
+    size_strings = (1 + 4 + 5) + (1 + 4 + 7);
+    for (i = 1; i < size; i++)
+    {
+        LONGS_EQUAL(((i == 1 + 4 + 5) || (i == size_strings)) ? 1 : 0,
+                    upgrade_weechat_read_buffer_lines (chunk, i));
+        upgrade_weechat_lines_strings_free ();
+    }
+    LONGS_EQUAL(1, buffer->own_lines->lines_count);
+
+    /* unknown type of record */
+    size = test_build_chunk (chunk, &record, 0, 5, "hello", 6);
+    chunk[0] = 'X';
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+
+    /* invalid length of string */
+    size = test_build_chunk (chunk, &record, 0, 0, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+    size = test_build_chunk (chunk, &record, 0, -1, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+    size = test_build_chunk (chunk, &record, 0, 4096, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+
+    /* string without final '\0' */
+    size = test_build_chunk (chunk, &record, 0, 4, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+
+    /* invalid index of prefix */
+    memcpy (&record2, &record, sizeof (record2));
+    record2.prefix = 2;
+    size = test_build_chunk (chunk, &record2, 0, 5, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+    record2.prefix = -2;
+    size = test_build_chunk (chunk, &record2, 0, 5, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+
+    /* invalid number of tags */
+    memcpy (&record2, &record, sizeof (record2));
+    record2.tags_count = -1;
+    size = test_build_chunk (chunk, &record2, 0, 5, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+    record2.tags_count = 1000;
+    size = test_build_chunk (chunk, &record2, 0, 5, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+
+    /* invalid index of tag */
+    size = test_build_chunk (chunk, &record, 2, 5, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+    size = test_build_chunk (chunk, &record, -1, 5, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+
+    /* invalid length of message */
+    memcpy (&record2, &record, sizeof (record2));
+    record2.message_length = -1;
+    size = test_build_chunk (chunk, &record2, 0, 5, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+    record2.message_length = 7;
+    size = test_build_chunk (chunk, &record2, 0, 5, "hello", 6);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+
+    /* message without final '\0' */
+    memcpy (&record2, &record, sizeof (record2));
+    record2.message_length = 5;
+    size = test_build_chunk (chunk, &record2, 0, 5, "hello", 5);
+    LONGS_EQUAL(0, upgrade_weechat_read_buffer_lines (chunk, size));
+    upgrade_weechat_lines_strings_free ();
+
+    /* no line added with invalid data */
+    LONGS_EQUAL(1, buffer->own_lines->lines_count);
+
+    upgrade_current_buffer = NULL;
+    gui_buffer_close (buffer);
+}
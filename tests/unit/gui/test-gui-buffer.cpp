@@ -27,6 +27,7 @@ extern "C"
 #include "src/core/wee-hashtable.h"
 #include "src/core/wee-hook.h"
 #include "src/core/wee-input.h"
+#include "src/core/wee-string.h"
 #include "src/gui/gui-buffer.h"
 #include "src/gui/gui-key.h"
 #include "src/gui/gui-line.h"
@@ -699,12 +700,50 @@ TEST(GuiBuffer, GetPointer)
 
 /*
  * Tests functions:
+ *   gui_buffer_ask_chat_refresh_lines_added
  *   gui_buffer_ask_chat_refresh
  */
 
 TEST(GuiBuffer, AskChatRefresh)
 {
-    /* TODO: write tests */
+    struct t_gui_buffer *buffer;
+
+    gui_buffer_ask_chat_refresh_lines_added (NULL);
+    gui_buffer_ask_chat_refresh (NULL, 1);
+
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer);
+    LONGS_EQUAL(2, buffer->chat_refresh_needed);
+    LONGS_EQUAL(0, buffer->chat_refresh_lines_added);
+
+    /* full refresh already asked: not only lines added */
+    gui_buffer_ask_chat_refresh_lines_added (buffer);
+    LONGS_EQUAL(2, buffer->chat_refresh_needed);
+    LONGS_EQUAL(0, buffer->chat_refresh_lines_added);
+
+    /* only lines added */
+    buffer->chat_refresh_needed = 0;
+    gui_buffer_ask_chat_refresh (buffer, 0);
+    LONGS_EQUAL(0, buffer->chat_refresh_needed);
+    gui_buffer_ask_chat_refresh_lines_added (buffer);
+    LONGS_EQUAL(1, buffer->chat_refresh_needed);
+    LONGS_EQUAL(1, buffer->chat_refresh_lines_added);
+    gui_buffer_ask_chat_refresh_lines_added (buffer);
+    LONGS_EQUAL(1, buffer->chat_refresh_needed);
+    LONGS_EQUAL(1, buffer->chat_refresh_lines_added);
+
+    /* refresh asked for another reason: all lines must be drawn */
+    gui_buffer_ask_chat_refresh (buffer, 1);
+    LONGS_EQUAL(1, buffer->chat_refresh_needed);
+    LONGS_EQUAL(0, buffer->chat_refresh_lines_added);
+    gui_buffer_ask_chat_refresh_lines_added (buffer);
+    LONGS_EQUAL(0, buffer->chat_refresh_lines_added);
+    gui_buffer_ask_chat_refresh (buffer, 2);
+    LONGS_EQUAL(2, buffer->chat_refresh_needed);
+    gui_buffer_ask_chat_refresh (buffer, 1);
+    LONGS_EQUAL(2, buffer->chat_refresh_needed);
+
+    gui_buffer_close (buffer);
 }
 
 /*
@@ -807,6 +846,55 @@ TEST(GuiBuffer, SetHighlightWordsList)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   gui_buffer_get_highlight_words_compiled
+ *   gui_buffer_reset_highlight_words_compiled
+ */
+
+TEST(GuiBuffer, GetHighlightWordsCompiled)
+{
+    struct t_gui_buffer *buffer;
+    struct t_string_highlight *highlight;
+
+    POINTERS_EQUAL(NULL, gui_buffer_get_highlight_words_compiled (NULL));
+
+    buffer = gui_buffer_new (NULL, TEST_BUFFER_NAME,
+                             NULL, NULL, NULL,
+                             NULL, NULL, NULL);
+    CHECK(buffer);
+    POINTERS_EQUAL(NULL, buffer->highlight_words_compiled);
+
+    /* no highlight words */
+    highlight = gui_buffer_get_highlight_words_compiled (buffer);
+    CHECK(highlight);
+    POINTERS_EQUAL(highlight, buffer->highlight_words_compiled);
+    LONGS_EQUAL(0, highlight->num_words);
+
+    /* words are compiled again after change of highlight words */
+    gui_buffer_set_highlight_words (buffer, "abc,$var");
+    POINTERS_EQUAL(NULL, buffer->highlight_words_compiled);
+    highlight = gui_buffer_get_highlight_words_compiled (buffer);
+    CHECK(highlight);
+    POINTERS_EQUAL(highlight, gui_buffer_get_highlight_words_compiled (buffer));
+    LONGS_EQUAL(2, highlight->num_words);
+    LONGS_EQUAL(1, string_highlight_match (highlight, "test abc"));
+    LONGS_EQUAL(1, string_highlight_match (highlight, "test $var"));
+    LONGS_EQUAL(0, string_highlight_match (highlight, "test xyz"));
+
+    /* words are compiled again after change of local variables */
+    gui_buffer_local_var_add (buffer, "var", "xyz");
+    POINTERS_EQUAL(NULL, buffer->highlight_words_compiled);
+    highlight = gui_buffer_get_highlight_words_compiled (buffer);
+    CHECK(highlight);
+    LONGS_EQUAL(1, string_highlight_match (highlight, "test xyz"));
+    LONGS_EQUAL(0, string_highlight_match (highlight, "test $var"));
+    gui_buffer_local_var_remove (buffer, "var");
+    POINTERS_EQUAL(NULL, buffer->highlight_words_compiled);
+
+    gui_buffer_close (buffer);
+}
+
 /*
  * Tests functions:
  *   gui_buffer_add_highlight_words
@@ -29,6 +29,7 @@ extern "C"
 #include "src/gui/gui-color.h"
 #include "src/gui/gui-line.h"
 #include "src/gui/gui-window.h"
+#include "src/gui/curses/gui-curses-chat.h"
 }
 
 #define WEE_GET_WORD_INFO(__result_word_start_offset,                   \
@@ -50,6 +51,26 @@ extern "C"
 
 TEST_GROUP(GuiChat)
 {
+    /*
+     * Searches the height of a line cached with the given value.
+     *
+     * Returns index of height in line, -1 if not found.
+     */
+
+    int test_line_height_index (struct t_gui_line *line, int height)
+    {
+        int i;
+
+        for (i = 0; i < GUI_LINE_HEIGHT_CACHE_SIZE; i++)
+        {
+            if ((line->data->height_layout_id[i] > 0)
+                && (line->data->height[i] == height))
+            {
+                return i;
+            }
+        }
+        return -1;
+    }
 };
 
 /*
@@ -346,6 +367,237 @@ TEST(GuiChat, GetWordInfo)
     WEE_GET_WORD_INFO (1, 5, 6, 5, " first second");
 }
 
+/*
+ * Tests functions:
+ *   gui_chat_get_line_height
+ */
+
+TEST(GuiChat, GetLineHeight)
+{
+    struct t_gui_window *new_window;
+    struct t_gui_line *ptr_line;
+    char message[1024];
+    int i, height, height2, index, index2;
+    int old_width, old_height, old_win_width, old_win_height;
+
+    POINTERS_EQUAL(gui_buffers, gui_windows->buffer);
+
+    old_width = gui_windows->win_chat_width;
+    old_height = gui_windows->win_chat_height;
+    gui_windows->win_chat_width = 80;
+    gui_windows->win_chat_height = 25;
+
+    LONGS_EQUAL(0, gui_chat_get_line_height (gui_windows, NULL));
+
+    /* short line: one row */
+    gui_chat_printf (NULL, "short line");
+    ptr_line = gui_buffers->own_lines->last_line;
+    for (i = 0; i < GUI_LINE_HEIGHT_CACHE_SIZE; i++)
+    {
+        LONGS_EQUAL(0, ptr_line->data->height_layout_id[i]);
+    }
+    LONGS_EQUAL(1, gui_chat_get_line_height (gui_windows, ptr_line));
+    CHECK(test_line_height_index (ptr_line, 1) >= 0);
+
+    /* long line: many rows, height is cached */
+    message[0] = '\0';
+    for (i = 0; i < 100; i++)
+    {
+        strcat (message, "word ");
+    }
+    gui_chat_printf (NULL, "%s", message);
+    ptr_line = gui_buffers->own_lines->last_line;
+    height = gui_chat_get_line_height (gui_windows, ptr_line);
+    CHECK(height > 1);
+    index = test_line_height_index (ptr_line, height);
+    CHECK(index >= 0);
+    LONGS_EQUAL(index,
+                gui_chat_line_height_search (
+                    ptr_line->data, ptr_line->data->height_layout_id[index]));
+    ptr_line->data->height[index] = 1000;
+    LONGS_EQUAL(1000, gui_chat_get_line_height (gui_windows, ptr_line));
+
+    /* new layout if chat width changes: height is computed again */
+    gui_windows->win_chat_width = 40;
+    CHECK(gui_chat_get_line_height (gui_windows, ptr_line) > height);
+    gui_windows->win_chat_width = 80;
+    LONGS_EQUAL(height, gui_chat_get_line_height (gui_windows, ptr_line));
+
+    /* new layout after a screen refresh */
+    index = test_line_height_index (ptr_line, height);
+    CHECK(index >= 0);
+    ptr_line->data->height[index] = 1000;
+    gui_chat_layout_generation++;
+    LONGS_EQUAL(height, gui_chat_get_line_height (gui_windows, ptr_line));
+
+    /* reset of heights: height is computed again */
+    index = test_line_height_index (ptr_line, height);
+    CHECK(index >= 0);
+    ptr_line->data->height[index] = 1000;
+    gui_line_reset_height (ptr_line->data);
+    for (i = 0; i < GUI_LINE_HEIGHT_CACHE_SIZE; i++)
+    {
+        LONGS_EQUAL(0, ptr_line->data->height_layout_id[i]);
+    }
+    LONGS_EQUAL(height, gui_chat_get_line_height (gui_windows, ptr_line));
+
+    /* two windows with different widths: each one keeps its height */
+    old_win_width = gui_windows->win_width;
+    old_win_height = gui_windows->win_height;
+    gui_windows->win_width = 120;
+    gui_windows->win_height = 25;
+    new_window = gui_window_split_vertical (gui_windows, 50);
+    CHECK(new_window);
+    POINTERS_EQUAL(gui_buffers, new_window->buffer);
+    new_window->win_chat_width = 40;
+    new_window->win_chat_height = 25;
+    height2 = gui_chat_get_line_height (new_window, ptr_line);
+    CHECK(height2 > height);
+    LONGS_EQUAL(height, gui_chat_get_line_height (gui_windows, ptr_line));
+    index = test_line_height_index (ptr_line, height);
+    index2 = test_line_height_index (ptr_line, height2);
+    CHECK(index >= 0);
+    CHECK(index2 >= 0);
+    CHECK(index != index2);
+    CHECK(ptr_line->data->height_layout_id[index]
+          != ptr_line->data->height_layout_id[index2]);
+    /* heights are not computed again when windows are drawn in turn */
+    ptr_line->data->height[index] = 1000;
+    ptr_line->data->height[index2] = 2000;
+    for (i = 0; i < 3; i++)
+    {
+        LONGS_EQUAL(1000, gui_chat_get_line_height (gui_windows, ptr_line));
+        LONGS_EQUAL(2000, gui_chat_get_line_height (new_window, ptr_line));
+    }
+    gui_line_reset_height (ptr_line->data);
+    gui_window_merge_all (gui_windows);
+    POINTERS_EQUAL(NULL, gui_windows->next_window);
+    gui_windows->win_width = old_win_width;
+    gui_windows->win_height = old_win_height;
+
+    gui_windows->win_chat_width = old_width;
+    gui_windows->win_chat_height = old_height;
+}
+
+/*
+ * Tests functions:
+ *   gui_chat_draw
+ *   gui_chat_draw_formatted_buffer_lines_added
+ *   gui_chat_draw_save_last_line
+ */
+
+TEST(GuiChat, DrawLinesAdded)
+{
+    struct t_gui_line *ptr_line, *ptr_prev_line;
+    long full_count, partial_count;
+    int i, old_width, old_height, height;
+
+    POINTERS_EQUAL(gui_buffers, gui_windows->buffer);
+
+    /* give a size to the window so that the chat area is created */
+    old_width = gui_windows->win_width;
+    old_height = gui_windows->win_height;
+    gui_windows->win_width = 80;
+    gui_windows->win_height = 25;
+    gui_window_switch_to_buffer (gui_windows, gui_buffers, 0);
+    height = gui_windows->win_chat_height;
+    CHECK(height > 2);
+
+    /* fill the window, then draw all lines */
+    for (i = 0; i < height + 5; i++)
+    {
+        gui_chat_printf (NULL, "line %d", i);
+    }
+    full_count = gui_chat_draw_full_count;
+    partial_count = gui_chat_draw_partial_count;
+    gui_chat_draw (gui_buffers, 1);
+    LONGS_EQUAL(full_count + 1, gui_chat_draw_full_count);
+    LONGS_EQUAL(partial_count, gui_chat_draw_partial_count);
+    LONGS_EQUAL(height, gui_windows->coords_size);
+    POINTERS_EQUAL(gui_buffers->own_lines->last_line,
+                   gui_windows->coords[height - 1].line);
+
+    /* new line: only this line is displayed, chat is scrolled by one row */
+    ptr_prev_line = gui_buffers->own_lines->last_line;
+    gui_chat_printf (NULL, "new line");
+    ptr_line = gui_buffers->own_lines->last_line;
+    LONGS_EQUAL(1, gui_buffers->chat_refresh_lines_added);
+    gui_chat_draw (gui_buffers, 0);
+    LONGS_EQUAL(0, gui_buffers->chat_refresh_lines_added);
+    LONGS_EQUAL(full_count + 1, gui_chat_draw_full_count);
+    LONGS_EQUAL(partial_count + 1, gui_chat_draw_partial_count);
+    POINTERS_EQUAL(ptr_prev_line, gui_windows->coords[height - 2].line);
+    POINTERS_EQUAL(ptr_line, gui_windows->coords[height - 1].line);
+    LONGS_EQUAL(height - 1, gui_windows->win_chat_cursor_y);
+
+    /* two new lines */
+    gui_chat_printf (NULL, "new line 2");
+    gui_chat_printf (NULL, "new line 3");
+    gui_chat_draw (gui_buffers, 0);
+    LONGS_EQUAL(full_count + 1, gui_chat_draw_full_count);
+    LONGS_EQUAL(partial_count + 2, gui_chat_draw_partial_count);
+    POINTERS_EQUAL(ptr_line, gui_windows->coords[height - 3].line);
+    POINTERS_EQUAL(gui_buffers->own_lines->last_line->prev_line,
+                   gui_windows->coords[height - 2].line);
+    POINTERS_EQUAL(gui_buffers->own_lines->last_line,
+                   gui_windows->coords[height - 1].line);
+
+    /* clear of chat asked: all lines are drawn */
+    gui_chat_printf (NULL, "new line 4");
+    gui_chat_draw (gui_buffers, 1);
+    LONGS_EQUAL(full_count + 2, gui_chat_draw_full_count);
+    LONGS_EQUAL(partial_count + 2, gui_chat_draw_partial_count);
+
+    /* window scrolled: all lines are drawn */
+    gui_windows->scroll->start_line = gui_buffers->own_lines->first_line;
+    gui_chat_printf (NULL, "new line 5");
+    gui_chat_draw (gui_buffers, 0);
+    LONGS_EQUAL(full_count + 3, gui_chat_draw_full_count);
+    LONGS_EQUAL(partial_count + 2, gui_chat_draw_partial_count);
+    gui_windows->scroll->start_line = NULL;
+    gui_windows->scroll->start_line_pos = 0;
+    gui_chat_printf (NULL, "new line 6");
+    gui_chat_draw (gui_buffers, 0);
+    LONGS_EQUAL(full_count + 4, gui_chat_draw_full_count);
+    LONGS_EQUAL(partial_count + 2, gui_chat_draw_partial_count);
+    POINTERS_EQUAL(gui_buffers->own_lines->last_line,
+                   gui_windows->coords[height - 1].line);
+
+    /* read marker displayed after the last line: all lines are drawn */
+    gui_buffers->own_lines->last_read_line = gui_buffers->own_lines->last_line;
+    gui_chat_draw (gui_buffers, 1);
+    LONGS_EQUAL(full_count + 5, gui_chat_draw_full_count);
+    gui_chat_printf (NULL, "new line 7");
+    gui_chat_draw (gui_buffers, 0);
+    LONGS_EQUAL(full_count + 6, gui_chat_draw_full_count);
+    LONGS_EQUAL(partial_count + 2, gui_chat_draw_partial_count);
+    gui_buffers->own_lines->last_read_line = NULL;
+    gui_buffers->own_lines->first_line_not_read = 0;
+    gui_chat_draw (gui_buffers, 1);
+    LONGS_EQUAL(full_count + 7, gui_chat_draw_full_count);
+
+    /* layout of window changed: all lines are drawn */
+    gui_windows->win_chat_width -= 20;
+    gui_chat_printf (NULL, "new line 8");
+    gui_chat_draw (gui_buffers, 0);
+    LONGS_EQUAL(full_count + 8, gui_chat_draw_full_count);
+    LONGS_EQUAL(partial_count + 2, gui_chat_draw_partial_count);
+    POINTERS_EQUAL(gui_buffers->own_lines->last_line,
+                   gui_windows->coords[height - 1].line);
+
+    /* same layout: only new line is displayed */
+    gui_chat_printf (NULL, "new line 9");
+    gui_chat_draw (gui_buffers, 0);
+    LONGS_EQUAL(full_count + 8, gui_chat_draw_full_count);
+    LONGS_EQUAL(partial_count + 3, gui_chat_draw_partial_count);
+    POINTERS_EQUAL(gui_buffers->own_lines->last_line,
+                   gui_windows->coords[height - 1].line);
+
+    gui_windows->win_width = old_width;
+    gui_windows->win_height = old_height;
+    gui_window_switch_to_buffer (gui_windows, gui_buffers, 0);
+}
+
 /*
  * Tests functions:
  *   gui_chat_get_time_string
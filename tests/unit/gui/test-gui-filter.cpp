@@ -23,11 +23,15 @@
 
 extern "C"
 {
+#include <stdio.h>
 #include <string.h>
+#include "src/core/wee-config.h"
+#include "src/core/wee-config-file.h"
 #include "src/gui/gui-buffer.h"
 #include "src/gui/gui-chat.h"
 #include "src/gui/gui-filter.h"
 #include "src/gui/gui-line.h"
+#include "src/gui/gui-window.h"
 
 extern struct t_gui_filter *gui_filter_find_pos (struct t_gui_filter *filter);
 
@@ -82,11 +86,91 @@ TEST(GuiFilter, CheckLine)
 /*
  * Tests functions:
  *   gui_filter_buffer
+ *   gui_filter_buffers_chunk
  */
 
 TEST(GuiFilter, Buffer)
 {
-    /* TODO: write tests */
+    struct t_gui_buffer *buffer;
+    struct t_gui_filter *filter;
+    struct t_gui_line *ptr_line;
+    int i, count_hidden;
+
+    config_file_option_set (config_history_max_buffer_lines_number, "0", 1);
+
+    buffer = gui_buffer_new (NULL, "test", NULL, NULL, NULL, NULL, NULL, NULL);
+    CHECK(buffer);
+
+    for (i = 0; i < 10; i++)
+    {
+        gui_chat_printf (buffer, "line %d%s", i, (i % 2 == 0) ? " even" : "");
+    }
+
+    /* filter lines: done immediately (few lines) */
+    filter = gui_filter_new (1, "test", "core.test", "*", "even");
+    CHECK(filter);
+    gui_filter_buffer (buffer, NULL);
+    LONGS_EQUAL(0, buffer->filter_pending);
+    LONGS_EQUAL(5, buffer->lines->lines_hidden);
+    LONGS_EQUAL(0, buffer->lines->first_line->data->displayed);
+    LONGS_EQUAL(1, buffer->lines->last_line->data->displayed);
+
+    /* rename buffer: filter does not match any more */
+    gui_buffer_set (buffer, "name", "test2");
+    gui_filter_buffer (buffer, NULL);
+    LONGS_EQUAL(0, buffer->lines->lines_hidden);
+    gui_buffer_set (buffer, "name", "test");
+    gui_filter_buffer (buffer, NULL);
+    LONGS_EQUAL(5, buffer->lines->lines_hidden);
+
+    /* filter many lines: done by chunks, from the last line */
+    for (i = 10; i < (GUI_FILTER_CHUNK_LINES * 2) + 10; i++)
+    {
+        gui_chat_printf (buffer, "line %d%s", i, (i % 2 == 0) ? " even" : "");
+    }
+    LONGS_EQUAL((GUI_FILTER_CHUNK_LINES * 2) + 10, buffer->lines->lines_count);
+    LONGS_EQUAL(GUI_FILTER_CHUNK_LINES + 5, buffer->lines->lines_hidden);
+    filter->enabled = 0;
+    gui_filter_buffer (buffer, NULL);
+    LONGS_EQUAL(1, buffer->filter_pending);
+    CHECK(buffer->filter_next_line);
+    LONGS_EQUAL(1, buffer->lines->last_line->data->displayed);
+    LONGS_EQUAL(0, buffer->lines->first_line->data->displayed);
+    LONGS_EQUAL((GUI_FILTER_CHUNK_LINES / 2) + 5,
+                buffer->lines->lines_hidden);
+
+    /* remove first line while buffer is being filtered */
+    gui_line_free (buffer, buffer->lines->first_line);
+
+    LONGS_EQUAL(1, gui_filter_buffers_chunk (GUI_FILTER_CHUNK_LINES));
+    LONGS_EQUAL(1, buffer->filter_pending);
+    LONGS_EQUAL(0, gui_filter_buffers_chunk (GUI_FILTER_CHUNK_LINES));
+    LONGS_EQUAL(0, buffer->filter_pending);
+    POINTERS_EQUAL(NULL, buffer->filter_next_line);
+    LONGS_EQUAL(0, buffer->lines->lines_hidden);
+
+    /* enable filter again: same result as filtering line by line */
+    filter->enabled = 1;
+    gui_filter_buffer (buffer, NULL);
+    while (gui_filter_buffers_chunk (GUI_FILTER_CHUNK_LINES) > 0)
+    {
+    }
+    count_hidden = 0;
+    for (ptr_line = buffer->lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        LONGS_EQUAL(gui_filter_check_line (ptr_line->data),
+                    ptr_line->data->displayed);
+        if (!ptr_line->data->displayed)
+            count_hidden++;
+    }
+    LONGS_EQUAL(GUI_FILTER_CHUNK_LINES + 4, count_hidden);
+    LONGS_EQUAL(count_hidden, buffer->lines->lines_hidden);
+
+    gui_filter_free (filter);
+    gui_buffer_close (buffer);
+
+    config_file_option_reset (config_history_max_buffer_lines_number, 1);
 }
 
 /*
@@ -96,7 +180,68 @@ TEST(GuiFilter, Buffer)
 
 TEST(GuiFilter, AllBuffers)
 {
-    /* TODO: write tests */
+    struct t_gui_buffer *buffers[20];
+    struct t_gui_filter *filter;
+    char name[64];
+    int i, j;
+
+    /* many small buffers, the first one is displayed in a window */
+    for (i = 0; i < 20; i++)
+    {
+        snprintf (name, sizeof (name), "test_all_%02d", i);
+        buffers[i] = gui_buffer_new (NULL, name,
+                                     NULL, NULL, NULL, NULL, NULL, NULL);
+        CHECK(buffers[i]);
+        for (j = 0; j < 100; j++)
+        {
+            gui_chat_printf (buffers[i], "line %d%s",
+                             j, (j % 2 == 0) ? " even" : "");
+        }
+    }
+    gui_window_switch_to_buffer (gui_windows, buffers[0], 0);
+
+    /* only the buffer displayed is filtered immediately */
+    filter = gui_filter_new (1, "test", "core.test_all_*", "*", "even");
+    CHECK(filter);
+    gui_filter_all_buffers (filter);
+    LONGS_EQUAL(0, buffers[0]->filter_pending);
+    LONGS_EQUAL(50, buffers[0]->lines->lines_hidden);
+    for (i = 1; i < 20; i++)
+    {
+        LONGS_EQUAL(1, buffers[i]->filter_pending);
+        POINTERS_EQUAL(buffers[i]->own_lines->last_line,
+                       buffers[i]->filter_next_line);
+        LONGS_EQUAL(0, buffers[i]->lines->lines_hidden);
+    }
+
+    /* the maximum number of lines is shared by all buffers */
+    LONGS_EQUAL(17, gui_filter_buffers_chunk (250));
+    LONGS_EQUAL(0, buffers[1]->filter_pending);
+    LONGS_EQUAL(50, buffers[1]->lines->lines_hidden);
+    LONGS_EQUAL(0, buffers[2]->filter_pending);
+    LONGS_EQUAL(50, buffers[2]->lines->lines_hidden);
+    LONGS_EQUAL(1, buffers[3]->filter_pending);
+    LONGS_EQUAL(25, buffers[3]->lines->lines_hidden);
+    LONGS_EQUAL(1, buffers[4]->filter_pending);
+    LONGS_EQUAL(0, buffers[4]->lines->lines_hidden);
+
+    /* filter all remaining lines */
+    LONGS_EQUAL(0, gui_filter_buffers_chunk (GUI_FILTER_CHUNK_LINES));
+    for (i = 0; i < 20; i++)
+    {
+        LONGS_EQUAL(0, buffers[i]->filter_pending);
+        POINTERS_EQUAL(NULL, buffers[i]->filter_next_line);
+        LONGS_EQUAL(50, buffers[i]->lines->lines_hidden);
+        LONGS_EQUAL(0, buffers[i]->lines->first_line->data->displayed);
+        LONGS_EQUAL(1, buffers[i]->lines->last_line->data->displayed);
+    }
+
+    gui_window_switch_to_buffer (gui_windows, gui_buffers, 0);
+    gui_filter_free (filter);
+    for (i = 0; i < 20; i++)
+    {
+        gui_buffer_close (buffers[i]);
+    }
 }
 
 /*
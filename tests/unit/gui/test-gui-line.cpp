@@ -61,6 +61,10 @@ extern "C"
     tags_array = string_split_tags (__tags, &tags_count);               \
     LONGS_EQUAL(__result, gui_line_match_tags (&line_data, tags_count,  \
                                                tags_array));            \
+    tags_mask = gui_line_tags_mask_compile (tags_count, tags_array);    \
+    LONGS_EQUAL(__result, gui_line_match_tags_mask (&line_data,         \
+                                                    tags_mask));        \
+    gui_line_tags_mask_free (tags_mask);                                \
     gui_line_tags_free (&line_data);                                    \
     string_free_split_tags (tags_array);
 
@@ -105,6 +109,7 @@ TEST(GuiLine, LinesAlloc)
 TEST(GuiLine, TagsAlloc)
 {
     struct t_gui_line_data line_data;
+    const char *shared_tag;
 
     memset (&line_data, 0, sizeof (line_data));
 
@@ -152,6 +157,36 @@ TEST(GuiLine, TagsAlloc)
     LONGS_EQUAL(3, line_data.tags_count);
     gui_line_tags_free (&line_data);
 
+    /* tags already in lower case: no copy after the tags */
+    line_data.tags_array = NULL;
+    line_data.tags_count = 0;
+    gui_line_tags_alloc (&line_data, "irc_join,nick_test");
+    CHECK(line_data.tags_array);
+    LONGS_EQUAL(2, line_data.tags_count);
+    LONGS_EQUAL(0, line_data.tags_lower);
+    POINTERS_EQUAL(line_data.tags_array, GUI_LINE_TAGS_LOWER(&line_data));
+    gui_line_tags_free (&line_data);
+    LONGS_EQUAL(0, line_data.tags_lower);
+
+    /* tags in lower case, stored after the tags */
+    line_data.tags_array = NULL;
+    line_data.tags_count = 0;
+    gui_line_tags_alloc (&line_data, "irc_join,Nick_Test,nick_\u00c9t\u00e9");
+    CHECK(line_data.tags_array);
+    LONGS_EQUAL(3, line_data.tags_count);
+    LONGS_EQUAL(1, line_data.tags_lower);
+    POINTERS_EQUAL(line_data.tags_array + 4, GUI_LINE_TAGS_LOWER(&line_data));
+    STRCMP_EQUAL("Nick_Test", line_data.tags_array[1]);
+    POINTERS_EQUAL(NULL, line_data.tags_array[3]);
+    shared_tag = string_shared_get ("irc_join");
+    POINTERS_EQUAL(shared_tag, GUI_LINE_TAGS_LOWER(&line_data)[0]);
+    string_shared_free (shared_tag);
+    POINTERS_EQUAL(line_data.tags_array[0],
+                   GUI_LINE_TAGS_LOWER(&line_data)[0]);
+    STRCMP_EQUAL("nick_test", GUI_LINE_TAGS_LOWER(&line_data)[1]);
+    POINTERS_EQUAL(NULL, GUI_LINE_TAGS_LOWER(&line_data)[2]);
+    gui_line_tags_free (&line_data);
+
     gui_line_tags_free (NULL);
 }
 
@@ -410,6 +445,7 @@ TEST(GuiLine, HasTagNoFilter)
 TEST(GuiLine, MatchTags)
 {
     struct t_gui_line_data line_data;
+    struct t_gui_line_tag_mask *tags_mask;
     char ***tags_array;
     int tags_count;
 
@@ -441,6 +477,82 @@ TEST(GuiLine, MatchTags)
     WEE_LINE_MATCH_TAGS(1, "irc_join,nick_test", "nick_test,irc_quit");
     WEE_LINE_MATCH_TAGS(1, "irc_join,nick_test", "!irc_quit,!irc_302,!irc_notice");
     WEE_LINE_MATCH_TAGS(1, "irc_join,nick_test", "!irc_quit+!irc_302+!irc_notice");
+
+    /* case insensitive match */
+    WEE_LINE_MATCH_TAGS(1, "irc_join,nick_Test", "NICK_test");
+    WEE_LINE_MATCH_TAGS(1, "IRC_JOIN,nick_test", "irc_join+nick_TEST");
+    WEE_LINE_MATCH_TAGS(0, "IRC_JOIN,nick_test", "!irc_join");
+
+    /* masks with wildcards */
+    WEE_LINE_MATCH_TAGS(1, "irc_join,nick_test", "nick_*");
+    WEE_LINE_MATCH_TAGS(1, "irc_join,nick_test", "NICK_T*");
+    WEE_LINE_MATCH_TAGS(1, "irc_join,nick_test", "irc_*+nick_test");
+    WEE_LINE_MATCH_TAGS(1, "irc_join,nick_test", "nick_test*");
+    WEE_LINE_MATCH_TAGS(0, "irc_join,nick_test", "nick_test2*");
+    WEE_LINE_MATCH_TAGS(0, "irc_join,nick_test", "!nick_*");
+    WEE_LINE_MATCH_TAGS(0, "irc_join,nick_test", "host_*");
+    WEE_LINE_MATCH_TAGS(1, "irc_join,nick_test", "*_test");
+    WEE_LINE_MATCH_TAGS(1, "irc_join,nick_test", "*ck_te*");
+    WEE_LINE_MATCH_TAGS(0, "irc_join,nick_test", "irc*quit");
+    WEE_LINE_MATCH_TAGS(1, "irc_join,nick_test", "irc*join");
+
+    /* tags with non-ASCII chars */
+    WEE_LINE_MATCH_TAGS(1, "irc_join,nick_\u00e9t\u00e9", "nick_\u00c9T\u00c9");
+    WEE_LINE_MATCH_TAGS(1, "irc_join,nick_\u00c9t\u00e9", "nick_*");
+    WEE_LINE_MATCH_TAGS(1, "irc_join,nick_\u00c9t\u00e9", "nick_\u00e9*");
+    WEE_LINE_MATCH_TAGS(0, "irc_join,nick_\u00e9t\u00e9", "nick_ete");
+}
+
+/*
+ * Tests functions:
+ *   gui_line_tags_mask_compile
+ *   gui_line_tags_mask_free
+ */
+
+TEST(GuiLine, TagsMaskCompile)
+{
+    struct t_gui_line_tag_mask *tags_mask;
+    const char *shared_tag;
+    char ***tags_array;
+    int tags_count;
+
+    POINTERS_EQUAL(NULL, gui_line_tags_mask_compile (0, NULL));
+    POINTERS_EQUAL(NULL, gui_line_tags_mask_compile (1, NULL));
+
+    tags_array = string_split_tags ("Irc_Join+!nick_*,*,irc_*quit", &tags_count);
+    tags_mask = gui_line_tags_mask_compile (tags_count, tags_array);
+    CHECK(tags_mask);
+
+    LONGS_EQUAL(GUI_LINE_TAG_MASK_EXACT, tags_mask[0].type);
+    LONGS_EQUAL(0, tags_mask[0].negated);
+    LONGS_EQUAL(0, tags_mask[0].last);
+    shared_tag = string_shared_get ("irc_join");
+    POINTERS_EQUAL(shared_tag, tags_mask[0].tag);
+    string_shared_free (shared_tag);
+    STRCMP_EQUAL("Irc_Join", tags_mask[0].mask);
+
+    LONGS_EQUAL(GUI_LINE_TAG_MASK_PREFIX, tags_mask[1].type);
+    LONGS_EQUAL(1, tags_mask[1].negated);
+    LONGS_EQUAL(1, tags_mask[1].last);
+    LONGS_EQUAL(5, tags_mask[1].length);
+    STRCMP_EQUAL("nick_*", tags_mask[1].tag);
+    STRCMP_EQUAL("nick_*", tags_mask[1].mask);
+
+    LONGS_EQUAL(GUI_LINE_TAG_MASK_ANY, tags_mask[2].type);
+    LONGS_EQUAL(1, tags_mask[2].last);
+    POINTERS_EQUAL(NULL, tags_mask[2].tag);
+
+    LONGS_EQUAL(GUI_LINE_TAG_MASK_MASK, tags_mask[3].type);
+    LONGS_EQUAL(1, tags_mask[3].last);
+    POINTERS_EQUAL(NULL, tags_mask[3].tag);
+    STRCMP_EQUAL("irc_*quit", tags_mask[3].mask);
+
+    POINTERS_EQUAL(NULL, tags_mask[4].mask);
+
+    gui_line_tags_mask_free (tags_mask);
+    string_free_split_tags (tags_array);
+
+    gui_line_tags_mask_free (NULL);
 }
 
 /*
@@ -537,12 +649,93 @@ TEST(GuiLine, ComputeBufferMaxLength)
 
 /*
  * Tests functions:
+ *   gui_line_ask_prefix_max_length_refresh
+ *   gui_line_get_prefix_length_max
+ *   gui_line_prefix_length_count
  *   gui_line_compute_prefix_max_length
+ *   gui_line_set_displayed
  */
 
 TEST(GuiLine, ComputePrefixMaxLength)
 {
-    /* TODO: write tests */
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *line1, *line2, *line3;
+    char prefix[128];
+
+    LONGS_EQUAL(0, gui_line_get_prefix_length_max (NULL));
+
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer);
+    LONGS_EQUAL(0, buffer->own_lines->prefix_max_length);
+
+    gui_chat_printf (buffer, "abc\tmessage");
+    line1 = buffer->own_lines->last_line;
+    LONGS_EQUAL(3, gui_line_get_prefix_length_max (line1->data));
+    LONGS_EQUAL(3, buffer->own_lines->prefix_max_length);
+    gui_chat_printf (buffer, "abcdef\tmessage");
+    line2 = buffer->own_lines->last_line;
+    gui_chat_printf (buffer, "abcdef\tmessage");
+    line3 = buffer->own_lines->last_line;
+    LONGS_EQUAL(6, buffer->own_lines->prefix_max_length);
+    LONGS_EQUAL(1, buffer->own_lines->prefix_length_count[3]);
+    LONGS_EQUAL(2, buffer->own_lines->prefix_length_count[6]);
+    LONGS_EQUAL(0, buffer->own_lines->prefix_max_length_refresh);
+
+    /* hide lines: max is updated when no more lines have the max length */
+    gui_line_set_displayed (line2->data, 0);
+    LONGS_EQUAL(0, line2->data->displayed);
+    LONGS_EQUAL(6, buffer->own_lines->prefix_max_length);
+    gui_line_set_displayed (line3->data, 0);
+    LONGS_EQUAL(3, buffer->own_lines->prefix_max_length);
+    gui_line_set_displayed (line3->data, 0);
+    LONGS_EQUAL(3, buffer->own_lines->prefix_max_length);
+    LONGS_EQUAL(0, buffer->own_lines->prefix_length_count[6]);
+    gui_line_set_displayed (line3->data, 1);
+    LONGS_EQUAL(6, buffer->own_lines->prefix_max_length);
+    LONGS_EQUAL(1, buffer->own_lines->prefix_length_count[6]);
+
+    /* remove a line */
+    gui_line_free (buffer, line3);
+    LONGS_EQUAL(3, buffer->own_lines->prefix_max_length);
+    LONGS_EQUAL(0, buffer->own_lines->prefix_length_count[6]);
+
+    /* compute again with all lines: same result */
+    gui_line_set_displayed (line2->data, 1);
+    gui_line_ask_prefix_max_length_refresh (buffer->own_lines);
+    LONGS_EQUAL(1, buffer->own_lines->prefix_max_length_refresh);
+    LONGS_EQUAL(1, gui_line_max_length_refresh_needed);
+    gui_line_compute_prefix_max_length (buffer->own_lines);
+    LONGS_EQUAL(0, buffer->own_lines->prefix_max_length_refresh);
+    LONGS_EQUAL(6, buffer->own_lines->prefix_max_length);
+    LONGS_EQUAL(1, buffer->own_lines->prefix_length_count[3]);
+    LONGS_EQUAL(1, buffer->own_lines->prefix_length_count[6]);
+
+    /* long prefix: counts are resized */
+    memset (prefix, 'a', 100);
+    prefix[100] = '\0';
+    gui_chat_printf (buffer, "%s\tmessage", prefix);
+    LONGS_EQUAL(100, buffer->own_lines->prefix_max_length);
+    CHECK(buffer->own_lines->prefix_length_count_size > 100);
+    LONGS_EQUAL(1, buffer->own_lines->prefix_length_count[100]);
+    LONGS_EQUAL(1, buffer->own_lines->prefix_length_count[6]);
+
+    /* nick prefix/suffix and prefix for same nick */
+    config_file_option_set (config_look_nick_suffix, ":", 1);
+    gui_chat_printf_date_tags (buffer, 0, "prefix_nick_red,nick_alice",
+                               "alice\tmessage");
+    LONGS_EQUAL(6, gui_line_get_prefix_length_max (
+                    buffer->own_lines->last_line->data));
+    config_file_option_set (config_look_prefix_same_nick, "(same nick)", 1);
+    LONGS_EQUAL(11, gui_line_get_prefix_length_max (
+                    buffer->own_lines->last_line->data));
+    LONGS_EQUAL(3, gui_line_get_prefix_length_max (line1->data));
+    config_file_option_set (config_look_prefix_same_nick, " ", 1);
+    LONGS_EQUAL(6, gui_line_get_prefix_length_max (
+                    buffer->own_lines->last_line->data));
+    config_file_option_reset (config_look_prefix_same_nick, 1);
+    config_file_option_reset (config_look_nick_suffix, 1);
+
+    gui_buffer_close (buffer);
 }
 
 /*
@@ -984,6 +1177,89 @@ TEST(GuiLine, New)
     free (str_time);
 }
 
+/*
+ * Tests functions:
+ *   gui_line_arena_alloc
+ *   gui_line_arena_unref
+ *   gui_line_free_string
+ */
+
+TEST(GuiLine, Arena)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_line *line;
+    struct t_gui_line_arena *arena;
+    int i, arena_count, arena_lines;
+    long arena_size;
+
+    arena_count = gui_line_arena_count;
+    arena_size = gui_line_arena_size;
+    arena_lines = gui_line_arena_lines;
+
+    buffer = gui_buffer_new_user ("test", GUI_BUFFER_TYPE_FORMATTED);
+    CHECK(buffer);
+    POINTERS_EQUAL(NULL, buffer->lines_arena);
+
+    /* size too big for the arena */
+    POINTERS_EQUAL(NULL, gui_line_arena_alloc (buffer,
+                                               GUI_LINE_ARENA_MAX_SIZE,
+                                               &arena));
+    POINTERS_EQUAL(NULL, arena);
+    POINTERS_EQUAL(NULL, buffer->lines_arena);
+
+    /* first line: a small chunk is created */
+    gui_chat_printf (buffer, "prefix\tmessage");
+    line = buffer->own_lines->last_line;
+    CHECK(line);
+    arena = buffer->lines_arena;
+    CHECK(arena);
+    POINTERS_EQUAL(arena, line->data->arena);
+    POINTERS_EQUAL(arena->data, line->data);
+    LONGS_EQUAL(GUI_LINE_ARENA_MIN_SIZE, arena->size);
+    LONGS_EQUAL(2, arena->refcount);
+    STRCMP_EQUAL("message", line->data->message);
+    POINTERS_EQUAL(line->data + 1, line->data->message);
+    LONGS_EQUAL(arena_count + 1, gui_line_arena_count);
+    LONGS_EQUAL(arena_size + GUI_LINE_ARENA_MIN_SIZE, gui_line_arena_size);
+    LONGS_EQUAL(arena_lines + 1, gui_line_arena_lines);
+
+    /* message stored in arena is not freed, a new one is */
+    gui_line_free_string (line->data, line->data->message);
+    line->data->message = strdup ("new message");
+    gui_line_free_string (line->data, line->data->message);
+    line->data->message = strdup ("message");
+
+    /* fill the first chunk: next chunk is twice bigger */
+    for (i = 0; (i < 1000) && (buffer->lines_arena == arena); i++)
+    {
+        gui_chat_printf (buffer, "prefix\tmessage %d to fill the chunk", i);
+    }
+    CHECK(i > 1);
+    CHECK(buffer->lines_arena != arena);
+    LONGS_EQUAL(GUI_LINE_ARENA_MIN_SIZE * 2, buffer->lines_arena->size);
+    LONGS_EQUAL(2, buffer->lines_arena->refcount);
+    LONGS_EQUAL(arena_count + 2, gui_line_arena_count);
+    LONGS_EQUAL(arena_lines + 1 + i, gui_line_arena_lines);
+
+    /* clear buffer: first chunk is freed, current one is reused */
+    gui_buffer_clear (buffer);
+    arena = buffer->lines_arena;
+    CHECK(arena);
+    LONGS_EQUAL(1, arena->refcount);
+    LONGS_EQUAL(arena_count + 1, gui_line_arena_count);
+    LONGS_EQUAL(arena_lines, gui_line_arena_lines);
+    gui_chat_printf (buffer, "prefix\tmessage");
+    line = buffer->own_lines->last_line;
+    POINTERS_EQUAL(arena, line->data->arena);
+    POINTERS_EQUAL(arena->data, line->data);
+
+    /* close buffer: all chunks are freed */
+    gui_buffer_close (buffer);
+    LONGS_EQUAL(arena_count, gui_line_arena_count);
+    LONGS_EQUAL(arena_size, gui_line_arena_size);
+    LONGS_EQUAL(arena_lines, gui_line_arena_lines);
+}
+
 /*
  * Tests functions:
  *   gui_line_hook_update
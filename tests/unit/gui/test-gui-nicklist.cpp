@@ -0,0 +1,253 @@
+/*
+ * test-gui-nicklist.cpp - test nicklist functions
+ *
+ * Copyright (C) 2023 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <string.h>
+#include "src/core/wee-arraylist.h"
+#include "src/core/wee-hashtable.h"
+#include "src/core/wee-string.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-nicklist.h"
+}
+
+#define TEST_BUFFER_NAME "test"
+
+TEST_GROUP(GuiNicklist)
+{
+};
+
+/*
+ * Compares two nicks, case insensitive (callback used in tests).
+ */
+
+int
+test_gui_nicklist_nickcmp_cb (const void *pointer, void *data,
+                              struct t_gui_buffer *buffer,
+                              const char *nick1, const char *nick2)
+{
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) buffer;
+
+    return string_strcasecmp (nick1, nick2);
+}
+
+/*
+ * Returns key of a nick in index of nicks: nick in lower case, with "{" in
+ * "[" and "}" in "]" (callback used in tests, keys are equal for different
+ * nicks for the callback test_gui_nicklist_nickcmp_cb).
+ */
+
+char *
+test_gui_nicklist_nickcmp_key_cb (const void *pointer, void *data,
+                                  struct t_gui_buffer *buffer,
+                                  const char *nick)
+{
+    char *key, *ptr_key;
+
+    /* make C compiler happy */
+    (void) pointer;
+    (void) data;
+    (void) buffer;
+
+    key = string_tolower (nick);
+    if (!key)
+        return NULL;
+
+    for (ptr_key = key; ptr_key[0]; ptr_key++)
+    {
+        if (ptr_key[0] == '{')
+            ptr_key[0] = '[';
+        else if (ptr_key[0] == '}')
+            ptr_key[0] = ']';
+    }
+
+    return key;
+}
+
+/*
+ * Tests functions:
+ *   gui_nicklist_add_nick
+ *   gui_nicklist_remove_nick
+ *   gui_nicklist_get_next_item
+ */
+
+TEST(GuiNicklist, AddRemoveNick)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_nick_group *group, *ptr_group;
+    struct t_gui_nick *nick_a, *nick_b, *nick_c, *nick_b2, *ptr_nick;
+    const char *names[] = { "a", "B", "b", "c", NULL };
+    int i;
+
+    buffer = gui_buffer_new (NULL, TEST_BUFFER_NAME,
+                             NULL, NULL, NULL,
+                             NULL, NULL, NULL);
+    CHECK(buffer);
+
+    group = gui_nicklist_add_group (buffer, NULL, "group", NULL, 1);
+    CHECK(group);
+    CHECK(group->nicks_sorted);
+
+    POINTERS_EQUAL(NULL, gui_nicklist_add_nick (NULL, group, "a",
+                                                NULL, NULL, NULL, 1));
+    POINTERS_EQUAL(NULL, gui_nicklist_add_nick (buffer, group, NULL,
+                                                NULL, NULL, NULL, 1));
+
+    nick_c = gui_nicklist_add_nick (buffer, group, "c", NULL, NULL, NULL, 1);
+    CHECK(nick_c);
+    nick_b = gui_nicklist_add_nick (buffer, group, "B", NULL, NULL, NULL, 1);
+    CHECK(nick_b);
+    nick_a = gui_nicklist_add_nick (buffer, group, "a", NULL, NULL, NULL, 1);
+    CHECK(nick_a);
+    nick_b2 = gui_nicklist_add_nick (buffer, group, "b", NULL, NULL, NULL, 1);
+    CHECK(nick_b2);
+
+    /* nick already in nicklist */
+    POINTERS_EQUAL(NULL, gui_nicklist_add_nick (buffer, group, "a",
+                                                NULL, NULL, NULL, 1));
+
+    LONGS_EQUAL(4, buffer->nicklist_nicks_count);
+    LONGS_EQUAL(4, arraylist_size (group->nicks_sorted));
+    LONGS_EQUAL(4, buffer->nicklist_index->items_count);
+
+    /* nicks are sorted (same names are kept in order of addition) */
+    POINTERS_EQUAL(nick_a, group->nicks);
+    POINTERS_EQUAL(nick_c, group->last_nick);
+    ptr_group = NULL;
+    ptr_nick = NULL;
+    i = 0;
+    gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+    while (ptr_group || ptr_nick)
+    {
+        if (ptr_nick)
+        {
+            CHECK(names[i]);
+            STRCMP_EQUAL(names[i], ptr_nick->name);
+            i++;
+        }
+        gui_nicklist_get_next_item (buffer, &ptr_group, &ptr_nick);
+    }
+    LONGS_EQUAL(4, i);
+
+    gui_nicklist_remove_nick (buffer, nick_b);
+    POINTERS_EQUAL(nick_b2, nick_a->next_nick);
+    POINTERS_EQUAL(nick_a, nick_b2->prev_nick);
+    LONGS_EQUAL(3, arraylist_size (group->nicks_sorted));
+    LONGS_EQUAL(3, buffer->nicklist_index->items_count);
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "B"));
+    POINTERS_EQUAL(nick_b2, gui_nicklist_search_nick (buffer, NULL, "b"));
+
+    gui_nicklist_remove_all (buffer);
+    LONGS_EQUAL(0, buffer->nicklist_nicks_count);
+    LONGS_EQUAL(0, buffer->nicklist_index->items_count);
+
+    gui_buffer_close (buffer);
+}
+
+/*
+ * Tests functions:
+ *   gui_nicklist_search_nick
+ *   gui_nicklist_index_rebuild
+ */
+
+TEST(GuiNicklist, SearchNick)
+{
+    struct t_gui_buffer *buffer;
+    struct t_gui_nick_group *group1, *group2;
+    struct t_gui_nick *nick1, *nick2, *nick3;
+
+    buffer = gui_buffer_new (NULL, TEST_BUFFER_NAME,
+                             NULL, NULL, NULL,
+                             NULL, NULL, NULL);
+    CHECK(buffer);
+
+    group1 = gui_nicklist_add_group (buffer, NULL, "group1", NULL, 1);
+    CHECK(group1);
+    group2 = gui_nicklist_add_group (buffer, group1, "group2", NULL, 1);
+    CHECK(group2);
+
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (NULL, NULL, NULL));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, NULL));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "nick1"));
+
+    nick1 = gui_nicklist_add_nick (buffer, group1, "Nick[1]",
+                                   NULL, NULL, NULL, 1);
+    CHECK(nick1);
+    nick2 = gui_nicklist_add_nick (buffer, group2, "nick2",
+                                   NULL, NULL, NULL, 1);
+    CHECK(nick2);
+
+    /* case sensitive search (no callback) */
+    POINTERS_EQUAL(nick1, gui_nicklist_search_nick (buffer, NULL, "Nick[1]"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "nick[1]"));
+    POINTERS_EQUAL(nick2, gui_nicklist_search_nick (buffer, NULL, "nick2"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "NICK2"));
+
+    /* search from a group */
+    POINTERS_EQUAL(nick1, gui_nicklist_search_nick (buffer, group1, "Nick[1]"));
+    POINTERS_EQUAL(nick2, gui_nicklist_search_nick (buffer, group1, "nick2"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, group2, "Nick[1]"));
+    POINTERS_EQUAL(nick2, gui_nicklist_search_nick (buffer, group2, "nick2"));
+
+    /* set callback without key callback: no index */
+    gui_buffer_set_pointer (buffer, "nickcmp_callback",
+                            (void *)&test_gui_nicklist_nickcmp_cb);
+    POINTERS_EQUAL(NULL, buffer->nicklist_index);
+    POINTERS_EQUAL(nick1, gui_nicklist_search_nick (buffer, NULL, "nick[1]"));
+    POINTERS_EQUAL(nick2, gui_nicklist_search_nick (buffer, NULL, "NICK2"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "nick3"));
+
+    /* set key callback: index is rebuilt with keys from callback */
+    gui_buffer_set_pointer (buffer, "nickcmp_key_callback",
+                            (void *)&test_gui_nicklist_nickcmp_key_cb);
+    CHECK(buffer->nicklist_index);
+    LONGS_EQUAL(2, buffer->nicklist_index->items_count);
+    LONGS_EQUAL(0, buffer->nicklist_index_missing);
+    POINTERS_EQUAL(nick1, gui_nicklist_search_nick (buffer, NULL, "nick[1]"));
+    POINTERS_EQUAL(nick1, gui_nicklist_search_nick (buffer, NULL, "NICK[1]"));
+    POINTERS_EQUAL(nick2, gui_nicklist_search_nick (buffer, NULL, "NICK2"));
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "nick3"));
+
+    /* same key in index, but different nicks for the callback */
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "nick{1}"));
+    nick3 = gui_nicklist_add_nick (buffer, group2, "nick{1}",
+                                   NULL, NULL, NULL, 1);
+    CHECK(nick3);
+    LONGS_EQUAL(2, buffer->nicklist_index->items_count);
+    LONGS_EQUAL(1, buffer->nicklist_index_missing);
+    POINTERS_EQUAL(nick1, gui_nicklist_search_nick (buffer, NULL, "nick[1]"));
+    POINTERS_EQUAL(nick3, gui_nicklist_search_nick (buffer, NULL, "NICK{1}"));
+
+    /* remove nick in index: the missing nick is added in index */
+    gui_nicklist_remove_nick (buffer, nick1);
+    LONGS_EQUAL(2, buffer->nicklist_index->items_count);
+    LONGS_EQUAL(0, buffer->nicklist_index_missing);
+    POINTERS_EQUAL(NULL, gui_nicklist_search_nick (buffer, NULL, "nick[1]"));
+    POINTERS_EQUAL(nick3, gui_nicklist_search_nick (buffer, NULL, "NICK{1}"));
+
+    gui_buffer_close (buffer);
+}
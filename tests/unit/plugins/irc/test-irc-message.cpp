@@ -26,10 +26,12 @@
 extern "C"
 {
 #include "string.h"
+#include <sys/time.h>
 #include "src/core/wee-config-file.h"
 #include "src/core/wee-hashtable.h"
 #include "src/core/wee-hook.h"
 #include "src/core/wee-string.h"
+#include "src/core/wee-util.h"
 #include "src/plugins/irc/irc-config.h"
 #include "src/plugins/irc/irc-ignore.h"
 #include "src/plugins/irc/irc-message.h"
@@ -754,6 +756,84 @@ TEST(IrcMessage, Parse)
                     ":irc.example.com 404 nick #channel :Cannot send to channel");
 }
 
+/*
+ * Tests functions:
+ *   irc_message_parse_pos
+ */
+
+TEST(IrcMessage, ParsePos)
+{
+    struct t_irc_message_parsed parsed;
+    const char *msg;
+
+    /* NULL parsed: must not crash */
+    irc_message_parse_pos (NULL, "PING", NULL);
+
+    irc_message_parse_pos (NULL, NULL, &parsed);
+    POINTERS_EQUAL(NULL, parsed.message);
+    LONGS_EQUAL(-1, parsed.pos_tags);
+    LONGS_EQUAL(-1, parsed.pos_message_without_tags);
+    LONGS_EQUAL(-1, parsed.pos_nick);
+    LONGS_EQUAL(-1, parsed.pos_user);
+    LONGS_EQUAL(-1, parsed.pos_host);
+    LONGS_EQUAL(-1, parsed.pos_command);
+    LONGS_EQUAL(-1, parsed.pos_arguments);
+    LONGS_EQUAL(-1, parsed.pos_channel);
+    LONGS_EQUAL(-1, parsed.pos_text);
+
+    msg = "PING";
+    irc_message_parse_pos (NULL, msg, &parsed);
+    POINTERS_EQUAL(msg, parsed.message);
+    LONGS_EQUAL(-1, parsed.pos_tags);
+    LONGS_EQUAL(0, parsed.pos_message_without_tags);
+    LONGS_EQUAL(-1, parsed.pos_nick);
+    LONGS_EQUAL(0, parsed.pos_command);
+    LONGS_EQUAL(4, parsed.length_command);
+    LONGS_EQUAL(-1, parsed.pos_arguments);
+    LONGS_EQUAL(-1, parsed.pos_text);
+
+    msg = "@time=2015-06-27T16:40:35.000Z :nick!user@host PRIVMSG #weechat "
+        ":Hello world!";
+    irc_message_parse_pos (NULL, msg, &parsed);
+    LONGS_EQUAL(1, parsed.pos_tags);
+    LONGS_EQUAL(29, parsed.length_tags);
+    LONGS_EQUAL(31, parsed.pos_message_without_tags);
+    LONGS_EQUAL(32, parsed.pos_nick);
+    LONGS_EQUAL(4, parsed.length_nick);
+    LONGS_EQUAL(37, parsed.pos_user);
+    LONGS_EQUAL(4, parsed.length_user);
+    LONGS_EQUAL(32, parsed.pos_host);
+    LONGS_EQUAL(14, parsed.length_host);
+    LONGS_EQUAL(47, parsed.pos_command);
+    LONGS_EQUAL(7, parsed.length_command);
+    LONGS_EQUAL(55, parsed.pos_arguments);
+    LONGS_EQUAL(55, parsed.pos_channel);
+    LONGS_EQUAL(8, parsed.length_channel);
+    LONGS_EQUAL(65, parsed.pos_text);
+    STRCMP_EQUAL("Hello world!", msg + parsed.pos_text);
+
+    /* nick in arguments (no prefix) */
+    msg = "NICK newnick";
+    irc_message_parse_pos (NULL, msg, &parsed);
+    LONGS_EQUAL(5, parsed.pos_nick);
+    LONGS_EQUAL(7, parsed.length_nick);
+    LONGS_EQUAL(-1, parsed.pos_host);
+    LONGS_EQUAL(-1, parsed.pos_channel);
+    LONGS_EQUAL(-1, parsed.pos_text);
+
+    /* channel after nick */
+    msg = ":irc.example.com 404 nick #channel :Cannot send to channel";
+    irc_message_parse_pos (NULL, msg, &parsed);
+    LONGS_EQUAL(1, parsed.pos_nick);
+    LONGS_EQUAL(15, parsed.length_nick);
+    LONGS_EQUAL(17, parsed.pos_command);
+    LONGS_EQUAL(3, parsed.length_command);
+    LONGS_EQUAL(21, parsed.pos_arguments);
+    LONGS_EQUAL(26, parsed.pos_channel);
+    LONGS_EQUAL(8, parsed.length_channel);
+    LONGS_EQUAL(36, parsed.pos_text);
+}
+
 /*
  * Tests functions:
  *   irc_message_parse_to_hashtable
@@ -1785,3 +1865,75 @@ TEST(IrcMessage, Split)
 
     irc_server_free (server);
 }
+
+/*
+ * Benchmarks parsing of "count" IRC messages: positions only
+ * (irc_message_parse_pos) and full parsing with allocated strings and
+ * parameters (irc_message_parse).
+ */
+
+void
+test_irc_message_benchmark (const char *name, const char *message, int count)
+{
+    struct t_irc_message_parsed parsed;
+    struct timeval tv_start, tv_pos, tv_parse;
+    char *tags, *message_without_tags, *nick, *user, *host, *command, *channel;
+    char *arguments, *text, **params;
+    long long diff_pos, diff_parse;
+    int i, num_params;
+
+    gettimeofday (&tv_start, NULL);
+    for (i = 0; i < count; i++)
+    {
+        irc_message_parse_pos (NULL, message, &parsed);
+    }
+    gettimeofday (&tv_pos, NULL);
+    for (i = 0; i < count; i++)
+    {
+        irc_message_parse (NULL, message, &tags, &message_without_tags,
+                           &nick, &user, &host, &command, &channel,
+                           &arguments, &text, &params, &num_params,
+                           NULL, NULL, NULL, NULL);
+        free (tags);
+        free (message_without_tags);
+        free (nick);
+        free (user);
+        free (host);
+        free (command);
+        free (channel);
+        free (arguments);
+        free (text);
+        string_free_split (params);
+    }
+    gettimeofday (&tv_parse, NULL);
+
+    diff_pos = util_timeval_diff (&tv_start, &tv_pos);
+    diff_parse = util_timeval_diff (&tv_pos, &tv_parse);
+    printf ("\n  %-8s: parse_pos: %10lld lines/s, parse: %10lld lines/s",
+            name,
+            (diff_pos > 0) ? (count * 1000000LL) / diff_pos : 0,
+            (diff_parse > 0) ? (count * 1000000LL) / diff_parse : 0);
+}
+
+/*
+ * Benchmark of IRC message parsing (ignored by default, can be run with:
+ * "tests -ri -g IrcMessage -n Benchmark").
+ */
+
+IGNORE_TEST(IrcMessage, Benchmark)
+{
+    test_irc_message_benchmark (
+        "PRIVMSG",
+        "@time=2023-01-01T10:00:00.000Z :nick!user@host PRIVMSG #channel "
+        ":" LOREM_IPSUM_512,
+        100000);
+    test_irc_message_benchmark (
+        "JOIN",
+        ":nick!user@host JOIN #channel account :real name",
+        100000);
+    test_irc_message_benchmark (
+        "353",
+        ":irc.example.com 353 nick = #channel :" NICKS_512_SPACE,
+        100000);
+    printf ("\n");
+}
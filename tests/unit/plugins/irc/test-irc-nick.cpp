@@ -24,6 +24,9 @@
 extern "C"
 {
 #include <string.h>
+#include "src/core/wee-hashtable.h"
+#include "src/gui/gui-buffer.h"
+#include "src/plugins/irc/irc-channel.h"
 #include "src/plugins/irc/irc-nick.h"
 #include "src/plugins/irc/irc-server.h"
 }
@@ -172,3 +175,81 @@ TEST(IrcNick, IsNick)
 
     irc_server_free (server);
 }
+
+/*
+ * Tests functions:
+ *   irc_nick_new
+ *   irc_nick_change
+ *   irc_nick_free
+ *   irc_nick_search
+ *   irc_nick_index_rebuild
+ */
+
+TEST(IrcNick, Search)
+{
+    struct t_irc_server *server;
+    struct t_irc_channel *channel;
+    struct t_irc_nick *nick1, *nick2, *nick3;
+
+    server = irc_server_alloc ("my_ircd");
+    CHECK(server);
+    channel = irc_channel_new (server, IRC_CHANNEL_TYPE_CHANNEL,
+                               "#test", 0, 0);
+    CHECK(channel);
+
+    POINTERS_EQUAL(NULL, irc_nick_search (server, NULL, NULL));
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, NULL));
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "alice"));
+
+    nick1 = irc_nick_new (server, channel, "alice", NULL, NULL, 0, NULL, NULL);
+    CHECK(nick1);
+    nick2 = irc_nick_new (server, channel, "Bob[m]", NULL, NULL, 0, NULL, NULL);
+    CHECK(nick2);
+    nick3 = irc_nick_new (server, channel, "carol", NULL, NULL, 0, NULL, NULL);
+    CHECK(nick3);
+    LONGS_EQUAL(3, channel->nicks_count);
+    LONGS_EQUAL(3, channel->nicks_index->items_count);
+
+    /* nick already in channel */
+    POINTERS_EQUAL(nick1,
+                   irc_nick_new (server, channel, "ALICE", NULL, NULL, 0,
+                                 NULL, NULL));
+    LONGS_EQUAL(3, channel->nicks_count);
+
+    /* search with casemapping rfc1459 */
+    POINTERS_EQUAL(nick1, irc_nick_search (server, channel, "alice"));
+    POINTERS_EQUAL(nick1, irc_nick_search (server, channel, "ALICE"));
+    POINTERS_EQUAL(nick2, irc_nick_search (server, channel, "Bob[m]"));
+    POINTERS_EQUAL(nick2, irc_nick_search (server, channel, "bob{M}"));
+    POINTERS_EQUAL(nick3, irc_nick_search (server, channel, "Carol"));
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "dave"));
+
+    /* change nick */
+    irc_nick_change (server, channel, nick1, "Alice2");
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "alice"));
+    POINTERS_EQUAL(nick1, irc_nick_search (server, channel, "alice2"));
+
+    /* change case of nick */
+    irc_nick_change (server, channel, nick3, "CAROL");
+    POINTERS_EQUAL(nick3, irc_nick_search (server, channel, "carol"));
+
+    /* casemapping ascii: "[" and "{" are different */
+    server->casemapping = IRC_SERVER_CASEMAPPING_ASCII;
+    irc_nick_index_rebuild (server);
+    POINTERS_EQUAL(nick2, irc_nick_search (server, channel, "BOB[M]"));
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "bob{m}"));
+    POINTERS_EQUAL(nick1, irc_nick_search (server, channel, "ALICE2"));
+
+    /* remove nicks */
+    irc_nick_free (server, channel, nick2);
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "bob[m]"));
+    LONGS_EQUAL(2, channel->nicks_count);
+    LONGS_EQUAL(2, channel->nicks_index->items_count);
+    irc_nick_free_all (server, channel);
+    POINTERS_EQUAL(NULL, irc_nick_search (server, channel, "alice2"));
+    LONGS_EQUAL(0, channel->nicks_index->items_count);
+
+    gui_buffer_close (channel->buffer);
+
+    irc_server_free (server);
+}
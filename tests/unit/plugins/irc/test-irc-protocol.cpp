@@ -234,6 +234,48 @@ TEST(IrcProtocol, LogLevelForCommand)
     LONGS_EQUAL(3, irc_protocol_log_level_for_command ("topic"));
 }
 
+/*
+ * Tests functions:
+ *   irc_protocol_search_message
+ */
+
+TEST(IrcProtocol, SearchMessage)
+{
+    const struct t_irc_protocol_msg *ptr_msg;
+
+    POINTERS_EQUAL(NULL, irc_protocol_search_message (NULL));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message (""));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message ("xyz"));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message ("000"));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message ("099"));
+    POINTERS_EQUAL(NULL, irc_protocol_search_message ("zzz"));
+
+    /* first and last commands */
+    ptr_msg = irc_protocol_search_message ("001");
+    CHECK(ptr_msg);
+    STRCMP_EQUAL("001", ptr_msg->name);
+    ptr_msg = irc_protocol_search_message ("warn");
+    CHECK(ptr_msg);
+    STRCMP_EQUAL("warn", ptr_msg->name);
+
+    /* case insensitive search */
+    ptr_msg = irc_protocol_search_message ("privmsg");
+    CHECK(ptr_msg);
+    STRCMP_EQUAL("privmsg", ptr_msg->name);
+    LONGS_EQUAL(1, ptr_msg->decode_color);
+    LONGS_EQUAL(1, ptr_msg->keep_trailing_spaces);
+    POINTERS_EQUAL(ptr_msg, irc_protocol_search_message ("PRIVMSG"));
+    POINTERS_EQUAL(ptr_msg, irc_protocol_search_message ("PrivMsg"));
+
+    ptr_msg = irc_protocol_search_message ("332");
+    CHECK(ptr_msg);
+    LONGS_EQUAL(0, ptr_msg->decode_color);
+    LONGS_EQUAL(1, ptr_msg->keep_trailing_spaces);
+    CHECK(irc_protocol_search_message ("353"));
+    CHECK(irc_protocol_search_message ("975"));
+    CHECK(irc_protocol_search_message ("TAGMSG"));
+}
+
 /*
  * Tests functions:
  *   irc_protocol_tags
@@ -134,6 +134,50 @@ TEST(IrcServer, Strncasecmp)
     /* TODO: write tests */
 }
 
+/*
+ * Tests functions:
+ *   irc_server_string_tolower
+ */
+
+TEST(IrcServer, StringTolower)
+{
+    struct t_irc_server *server;
+    char *str;
+
+    POINTERS_EQUAL(NULL, irc_server_string_tolower (NULL, NULL));
+
+    /* no server: casemapping rfc1459 */
+    str = irc_server_string_tolower (NULL, "");
+    STRCMP_EQUAL("", str);
+    free (str);
+    str = irc_server_string_tolower (NULL, "Nick[A]\\^~_é");
+    STRCMP_EQUAL("nick{a}|~~_é", str);
+    free (str);
+
+    server = irc_server_alloc ("my_ircd");
+    CHECK(server);
+
+    /* casemapping rfc1459 */
+    server->casemapping = IRC_SERVER_CASEMAPPING_RFC1459;
+    str = irc_server_string_tolower (server, "Nick[A]\\^~_É");
+    STRCMP_EQUAL("nick{a}|~~_É", str);
+    free (str);
+
+    /* casemapping strict-rfc1459 */
+    server->casemapping = IRC_SERVER_CASEMAPPING_STRICT_RFC1459;
+    str = irc_server_string_tolower (server, "Nick[A]\\^~_É");
+    STRCMP_EQUAL("nick{a}|^~_É", str);
+    free (str);
+
+    /* casemapping ascii */
+    server->casemapping = IRC_SERVER_CASEMAPPING_ASCII;
+    str = irc_server_string_tolower (server, "Nick[A]\\^~_");
+    STRCMP_EQUAL("nick[a]\\^~_", str);
+    free (str);
+
+    irc_server_free (server);
+}
+
 /*
  * Tests functions:
  *   irc_server_eval_expression
@@ -0,0 +1,199 @@
+/*
+ * test-relay-client.cpp - test relay client functions
+ *
+ * Copyright (C) 2023 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include "src/core/wee-hook.h"
+#include "src/plugins/relay/relay.h"
+#include "src/plugins/relay/relay-client.h"
+}
+
+#define TEST_MSG_SIZE 10000
+
+TEST_GROUP(RelayClient)
+{
+};
+
+/*
+ * Tests functions:
+ *   relay_client_payload_new
+ *   relay_client_payload_unref
+ */
+
+TEST(RelayClient, Payload)
+{
+    struct t_relay_client_payload *payload;
+    char data[] = "abcdef", *data2;
+
+    POINTERS_EQUAL(NULL, relay_client_payload_new (NULL, 0, 1));
+    POINTERS_EQUAL(NULL, relay_client_payload_new (data, 0, 1));
+    POINTERS_EQUAL(NULL, relay_client_payload_new (data, -1, 1));
+
+    /* payload with a copy of data */
+    payload = relay_client_payload_new (data, 3, 1);
+    CHECK(payload);
+    CHECK(payload->data != data);
+    MEMCMP_EQUAL("abc", payload->data, 3);
+    LONGS_EQUAL(3, payload->size);
+    LONGS_EQUAL(1, payload->refcount);
+    payload->refcount++;
+    relay_client_payload_unref (payload);
+    LONGS_EQUAL(1, payload->refcount);
+    relay_client_payload_unref (payload);
+
+    /* payload taking ownership of data */
+    data2 = strdup (data);
+    payload = relay_client_payload_new (data2, 6, 0);
+    CHECK(payload);
+    POINTERS_EQUAL(data2, payload->data);
+    LONGS_EQUAL(6, payload->size);
+    LONGS_EQUAL(1, payload->refcount);
+    relay_client_payload_unref (payload);
+
+    relay_client_payload_unref (NULL);
+}
+
+/*
+ * Tests functions:
+ *   relay_client_send
+ *   relay_client_send_payload
+ *   relay_client_send_outqueue
+ *   relay_client_outqueue_free_all
+ */
+
+TEST(RelayClient, SendOutqueue)
+{
+    struct t_relay_client client;
+    struct t_relay_client_payload *payload;
+    char *message, *received;
+    int sv[2], i, size_received, size_expected, rc;
+
+    message = (char *)malloc (TEST_MSG_SIZE);
+    CHECK(message);
+    for (i = 0; i < TEST_MSG_SIZE; i++)
+    {
+        message[i] = (char)(i % 251);
+    }
+
+    LONGS_EQUAL(0, socketpair (AF_UNIX, SOCK_STREAM, 0, sv));
+    fcntl (sv[0], F_SETFL, fcntl (sv[0], F_GETFL) | O_NONBLOCK);
+    fcntl (sv[1], F_SETFL, fcntl (sv[1], F_GETFL) | O_NONBLOCK);
+
+    memset (&client, 0, sizeof (client));
+    client.desc = (char *)"test";
+    client.sock = sv[0];
+    client.hook_fd = hook_fd (NULL, sv[0], 1, 0, 0,
+                              &relay_client_recv_cb, &client, NULL);
+    CHECK(client.hook_fd);
+    client.status = RELAY_STATUS_CONNECTED;
+    client.protocol = RELAY_PROTOCOL_WEECHAT;
+    client.send_data_type = RELAY_CLIENT_DATA_BINARY;
+
+    /* send messages until the socket is full and data is queued */
+    size_expected = 0;
+    for (i = 0; (i < 10000) && !client.outqueue; i++)
+    {
+        relay_client_send (&client, RELAY_CLIENT_MSG_STANDARD,
+                           message, TEST_MSG_SIZE, "test");
+        size_expected += TEST_MSG_SIZE;
+    }
+    CHECK(client.outqueue);
+    POINTERS_EQUAL(client.outqueue, client.last_outqueue);
+    CHECK(client.outqueue_size > 0);
+    CHECK(client.outqueue_size <= TEST_MSG_SIZE);
+    LONGS_EQUAL(HOOK_FD_FLAG_READ | HOOK_FD_FLAG_WRITE,
+                HOOK_FD(client.hook_fd, flags));
+
+    /* outqueue is not empty: next messages are queued */
+    LONGS_EQUAL(-1, relay_client_send (&client, RELAY_CLIENT_MSG_STANDARD,
+                                       message, TEST_MSG_SIZE, "test"));
+    size_expected += TEST_MSG_SIZE;
+    CHECK(client.outqueue != client.last_outqueue);
+
+    /* shared payload: created on first use, then reused */
+    payload = NULL;
+    LONGS_EQUAL(-1, relay_client_send_payload (&client,
+                                               RELAY_CLIENT_MSG_STANDARD,
+                                               message, TEST_MSG_SIZE,
+                                               &payload, "test"));
+    CHECK(payload);
+    LONGS_EQUAL(2, payload->refcount);
+    LONGS_EQUAL(-1, relay_client_send_payload (&client,
+                                               RELAY_CLIENT_MSG_STANDARD,
+                                               message, TEST_MSG_SIZE,
+                                               &payload, "test"));
+    LONGS_EQUAL(3, payload->refcount);
+    POINTERS_EQUAL(payload, client.last_outqueue->payload);
+    size_expected += 2 * TEST_MSG_SIZE;
+
+    /* read all data, flushing the outqueue when socket is writable */
+    received = (char *)malloc (size_expected);
+    CHECK(received);
+    size_received = 0;
+    for (i = 0; (i < 100000) && (size_received < size_expected); i++)
+    {
+        rc = read (sv[1], received + size_received,
+                   size_expected - size_received);
+        if (rc > 0)
+            size_received += rc;
+        relay_client_send_outqueue (&client);
+    }
+    LONGS_EQUAL(size_expected, size_received);
+    for (i = 0; i < size_expected; i += TEST_MSG_SIZE)
+    {
+        MEMCMP_EQUAL(message, received + i, TEST_MSG_SIZE);
+    }
+    POINTERS_EQUAL(NULL, client.outqueue);
+    POINTERS_EQUAL(NULL, client.last_outqueue);
+    LONGS_EQUAL(0, client.outqueue_size);
+    LONGS_EQUAL(HOOK_FD_FLAG_READ, HOOK_FD(client.hook_fd, flags));
+    LONGS_EQUAL(1, payload->refcount);
+    relay_client_payload_unref (payload);
+
+    /* free outqueue with data not sent */
+    for (i = 0; (i < 10000) && !client.outqueue; i++)
+    {
+        relay_client_send (&client, RELAY_CLIENT_MSG_STANDARD,
+                           message, TEST_MSG_SIZE, "test");
+    }
+    CHECK(client.outqueue);
+    LONGS_EQUAL(HOOK_FD_FLAG_READ | HOOK_FD_FLAG_WRITE,
+                HOOK_FD(client.hook_fd, flags));
+    relay_client_outqueue_free_all (&client);
+    POINTERS_EQUAL(NULL, client.outqueue);
+    POINTERS_EQUAL(NULL, client.last_outqueue);
+    LONGS_EQUAL(0, client.outqueue_size);
+    LONGS_EQUAL(HOOK_FD_FLAG_READ, HOOK_FD(client.hook_fd, flags));
+
+    unhook (client.hook_fd);
+    close (sv[0]);
+    close (sv[1]);
+    free (received);
+    free (message);
+}
@@ -0,0 +1,434 @@
+/*
+ * test-relay-websocket.cpp - test websocket functions
+ *
+ * Copyright (C) 2023 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "src/core/wee-config-file.h"
+#include "src/core/wee-hashtable.h"
+#include "src/plugins/plugin.h"
+#include "src/plugins/relay/relay.h"
+#include "src/plugins/relay/relay-client.h"
+#include "src/plugins/relay/relay-config.h"
+#include "src/plugins/relay/relay-websocket.h"
+}
+
+#define WEE_CHECK_PARSE_EXT(__enabled, __server_ctx, __client_ctx,     \
+                            __bits_deflate, __bits_inflate,            \
+                            __extensions)                              \
+    ws_deflate = relay_websocket_deflate_alloc ();                     \
+    CHECK(ws_deflate);                                                 \
+    relay_websocket_parse_extensions (__extensions, ws_deflate);       \
+    LONGS_EQUAL(__enabled, ws_deflate->enabled);                       \
+    LONGS_EQUAL(__server_ctx, ws_deflate->server_context_takeover);    \
+    LONGS_EQUAL(__client_ctx, ws_deflate->client_context_takeover);    \
+    LONGS_EQUAL(__bits_deflate, ws_deflate->window_bits_deflate);      \
+    LONGS_EQUAL(__bits_inflate, ws_deflate->window_bits_inflate);      \
+    relay_websocket_deflate_free (ws_deflate);
+
+TEST_GROUP(RelayWebsocket)
+{
+};
+
+/*
+ * Builds a frame sent by a client: the frame built by
+ * relay_websocket_encode_frame (not masked, like a frame sent by server) is
+ * masked with a fixed mask.
+ *
+ * Note: result must be freed after use.
+ */
+
+unsigned char *
+test_relay_websocket_client_frame (const char *frame,
+                                   unsigned long long length_frame,
+                                   unsigned long long *length_masked)
+{
+    const unsigned char mask[4] = { 0x37, 0xFA, 0x21, 0x3D };
+    unsigned char *masked;
+    unsigned long long i, index;
+
+    masked = (unsigned char *)malloc (length_frame + 4);
+    if (!masked)
+        return NULL;
+
+    index = 2;
+    if ((frame[1] & 127) == 126)
+        index += 2;
+    else if ((frame[1] & 127) == 127)
+        index += 8;
+
+    memcpy (masked, frame, index);
+    masked[1] |= 128;
+    memcpy (masked + index, mask, 4);
+    for (i = index; i < length_frame; i++)
+    {
+        masked[i + 4] = (unsigned char)frame[i] ^ mask[(i - index) % 4];
+    }
+
+    *length_masked = length_frame + 4;
+
+    return masked;
+}
+
+/*
+ * Tests functions:
+ *   relay_websocket_is_http_get_weechat
+ */
+
+TEST(RelayWebsocket, IsHttpGetWeechat)
+{
+    LONGS_EQUAL(0, relay_websocket_is_http_get_weechat (""));
+    LONGS_EQUAL(0, relay_websocket_is_http_get_weechat ("GET /"));
+    LONGS_EQUAL(0, relay_websocket_is_http_get_weechat ("GET /weechat2"));
+    LONGS_EQUAL(0, relay_websocket_is_http_get_weechat ("POST /weechat"));
+
+    LONGS_EQUAL(1, relay_websocket_is_http_get_weechat ("GET /weechat\n"));
+    LONGS_EQUAL(1, relay_websocket_is_http_get_weechat ("GET /weechat\r\n"));
+    LONGS_EQUAL(1, relay_websocket_is_http_get_weechat ("GET /weechat HTTP/1.1"));
+}
+
+/*
+ * Tests functions:
+ *   relay_websocket_deflate_alloc
+ *   relay_websocket_deflate_free
+ *   relay_websocket_parse_extensions
+ */
+
+TEST(RelayWebsocket, ParseExtensions)
+{
+    struct t_relay_websocket_deflate *ws_deflate;
+
+    /* extension disabled by default */
+    WEE_CHECK_PARSE_EXT(0, 1, 1, 15, 15, "permessage-deflate");
+
+    config_file_option_set (relay_config_network_websocket_permessage_deflate,
+                            "on", 1);
+
+    /* no extension */
+    WEE_CHECK_PARSE_EXT(0, 1, 1, 15, 15, NULL);
+    WEE_CHECK_PARSE_EXT(0, 1, 1, 15, 15, "");
+    WEE_CHECK_PARSE_EXT(0, 1, 1, 15, 15, "x-webkit-deflate-frame");
+    WEE_CHECK_PARSE_EXT(0, 1, 1, 15, 15, "permessage-deflate2");
+
+    /* invalid parameters */
+    WEE_CHECK_PARSE_EXT(0, 1, 1, 15, 15, "permessage-deflate; xxx");
+    WEE_CHECK_PARSE_EXT(0, 1, 1, 15, 15,
+                        "permessage-deflate; server_no_context_takeover=1");
+    WEE_CHECK_PARSE_EXT(0, 1, 1, 15, 15,
+                        "permessage-deflate; server_max_window_bits");
+    WEE_CHECK_PARSE_EXT(0, 1, 1, 15, 15,
+                        "permessage-deflate; server_max_window_bits=8");
+    WEE_CHECK_PARSE_EXT(0, 1, 1, 15, 15,
+                        "permessage-deflate; server_max_window_bits=16");
+    WEE_CHECK_PARSE_EXT(0, 1, 1, 15, 15,
+                        "permessage-deflate; client_max_window_bits=abc");
+
+    /* valid offers */
+    WEE_CHECK_PARSE_EXT(1, 1, 1, 15, 15, "permessage-deflate");
+    WEE_CHECK_PARSE_EXT(1, 1, 1, 15, 15,
+                        "permessage-deflate; client_max_window_bits");
+    WEE_CHECK_PARSE_EXT(1, 0, 0, 10, 12,
+                        "permessage-deflate; server_no_context_takeover; "
+                        "client_no_context_takeover; "
+                        "server_max_window_bits=10; "
+                        "client_max_window_bits=\"12\"");
+
+    /* first valid offer is accepted */
+    WEE_CHECK_PARSE_EXT(1, 1, 0, 15, 15,
+                        "x-webkit-deflate-frame, "
+                        "permessage-deflate; server_max_window_bits=8, "
+                        "permessage-deflate; client_no_context_takeover, "
+                        "permessage-deflate");
+
+    config_file_option_reset (relay_config_network_websocket_permessage_deflate, 1);
+}
+
+/*
+ * Tests functions:
+ *   relay_websocket_build_handshake
+ */
+
+TEST(RelayWebsocket, BuildHandshake)
+{
+    struct t_relay_client client;
+    char *handshake;
+
+    memset (&client, 0, sizeof (client));
+    client.http_headers = hashtable_new (32,
+                                         WEECHAT_HASHTABLE_STRING,
+                                         WEECHAT_HASHTABLE_STRING,
+                                         NULL, NULL);
+    client.ws_deflate = relay_websocket_deflate_alloc ();
+
+    /* no key */
+    POINTERS_EQUAL(NULL, relay_websocket_build_handshake (&client));
+
+    /* example from RFC 6455 */
+    hashtable_set (client.http_headers,
+                   "sec-websocket-key", "dGhlIHNhbXBsZSBub25jZQ==");
+    handshake = relay_websocket_build_handshake (&client);
+    STRCMP_EQUAL("HTTP/1.1 101 Switching Protocols\r\n"
+                 "Upgrade: websocket\r\n"
+                 "Connection: Upgrade\r\n"
+                 "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+                 "\r\n",
+                 handshake);
+    free (handshake);
+
+    /* with extension "permessage-deflate" */
+    config_file_option_set (relay_config_network_websocket_permessage_deflate,
+                            "on", 1);
+    relay_websocket_parse_extensions (
+        "permessage-deflate; client_no_context_takeover; "
+        "server_max_window_bits=12",
+        client.ws_deflate);
+    config_file_option_reset (relay_config_network_websocket_permessage_deflate, 1);
+    handshake = relay_websocket_build_handshake (&client);
+    STRCMP_EQUAL("HTTP/1.1 101 Switching Protocols\r\n"
+                 "Upgrade: websocket\r\n"
+                 "Connection: Upgrade\r\n"
+                 "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+                 "Sec-WebSocket-Extensions: permessage-deflate; "
+                 "client_no_context_takeover; server_max_window_bits=12\r\n"
+                 "\r\n",
+                 handshake);
+    free (handshake);
+
+    relay_websocket_deflate_free (client.ws_deflate);
+    hashtable_free (client.http_headers);
+}
+
+/*
+ * Tests functions:
+ *   relay_websocket_decode_frame
+ */
+
+TEST(RelayWebsocket, DecodeFrame)
+{
+    /* "Hello" masked (RFC 6455, section 5.7) */
+    const unsigned char frame_hello[] = {
+        0x81, 0x85, 0x37, 0xFA, 0x21, 0x3D, 0x7F, 0x9F, 0x4D, 0x51, 0x58 };
+    /* "Hello" compressed (RFC 7692, section 7.2.3.1), masked */
+    const unsigned char frame_hello_deflate[] = {
+        0xC1, 0x87, 0x00, 0x00, 0x00, 0x00,
+        0xF2, 0x48, 0xCD, 0xC9, 0xC9, 0x07, 0x00 };
+    /* "Hello" compressed with context (RFC 7692, section 7.2.3.2), masked */
+    const unsigned char frame_hello_deflate_ctx[] = {
+        0xC1, 0x85, 0x00, 0x00, 0x00, 0x00,
+        0xF2, 0x00, 0x11, 0x00, 0x00 };
+    /* frame not masked */
+    const unsigned char frame_not_masked[] = {
+        0x81, 0x05, 0x48, 0x65, 0x6C, 0x6C, 0x6F };
+    struct t_relay_websocket_deflate *ws_deflate;
+    unsigned char *decoded;
+    unsigned long long decoded_length;
+
+    /* frame not masked */
+    LONGS_EQUAL(0, relay_websocket_decode_frame (frame_not_masked,
+                                                 sizeof (frame_not_masked),
+                                                 NULL,
+                                                 &decoded, &decoded_length));
+    free (decoded);
+
+    /* frame not compressed */
+    LONGS_EQUAL(1, relay_websocket_decode_frame (frame_hello,
+                                                 sizeof (frame_hello),
+                                                 NULL,
+                                                 &decoded, &decoded_length));
+    LONGS_EQUAL(7, decoded_length);
+    LONGS_EQUAL(RELAY_CLIENT_MSG_STANDARD, decoded[0]);
+    STRCMP_EQUAL("Hello", (const char *)decoded + 1);
+    free (decoded);
+
+    /* compressed frame refused if extension is not enabled */
+    ws_deflate = relay_websocket_deflate_alloc ();
+    LONGS_EQUAL(0, relay_websocket_decode_frame (frame_hello_deflate,
+                                                 sizeof (frame_hello_deflate),
+                                                 ws_deflate,
+                                                 &decoded, &decoded_length));
+    free (decoded);
+
+    /*
+     * compressed frames, with context takeover (the window bits negotiated
+     * with client are not used to decompress)
+     */
+    ws_deflate->enabled = 1;
+    ws_deflate->window_bits_inflate = 8;
+    LONGS_EQUAL(1, relay_websocket_decode_frame (frame_hello_deflate,
+                                                 sizeof (frame_hello_deflate),
+                                                 ws_deflate,
+                                                 &decoded, &decoded_length));
+    LONGS_EQUAL(7, decoded_length);
+    STRCMP_EQUAL("Hello", (const char *)decoded + 1);
+    free (decoded);
+    LONGS_EQUAL(1, relay_websocket_decode_frame (frame_hello_deflate_ctx,
+                                                 sizeof (frame_hello_deflate_ctx),
+                                                 ws_deflate,
+                                                 &decoded, &decoded_length));
+    LONGS_EQUAL(7, decoded_length);
+    STRCMP_EQUAL("Hello", (const char *)decoded + 1);
+    free (decoded);
+
+    relay_websocket_deflate_free (ws_deflate);
+}
+
+/*
+ * Tests functions:
+ *   relay_websocket_encode_frame
+ */
+
+TEST(RelayWebsocket, EncodeFrame)
+{
+    const char frame_hello[] = { (char)0x81, 0x05, 'H', 'e', 'l', 'l', 'o' };
+    const char frame_ping[] = { (char)0x89, 0x02, 'a', 'b' };
+    /* "Hello" compressed (RFC 7692, section 7.2.3.1) */
+    const char frame_hello_deflate[] = {
+        (char)0xC1, 0x07, (char)0xF2, 0x48, (char)0xCD, (char)0xC9,
+        (char)0xC9, 0x07, 0x00 };
+    /* empty message compressed (RFC 7692, section 7.2.3.6) */
+    const char frame_empty_deflate[] = { (char)0xC1, 0x01, 0x00 };
+    struct t_relay_websocket_deflate *ws_deflate;
+    char *frame;
+    unsigned long long length_frame;
+
+    /* not compressed */
+    frame = relay_websocket_encode_frame (NULL, WEBSOCKET_FRAME_OPCODE_TEXT,
+                                          "Hello", 5, &length_frame);
+    LONGS_EQUAL(sizeof (frame_hello), length_frame);
+    MEMCMP_EQUAL(frame_hello, frame, length_frame);
+    free (frame);
+
+    /* compressed: RSV1 is set, trailing bytes 0x00 0x00 0xFF 0xFF removed */
+    ws_deflate = relay_websocket_deflate_alloc ();
+    ws_deflate->enabled = 1;
+    frame = relay_websocket_encode_frame (ws_deflate,
+                                          WEBSOCKET_FRAME_OPCODE_TEXT,
+                                          "Hello", 5, &length_frame);
+    LONGS_EQUAL(sizeof (frame_hello_deflate), length_frame);
+    MEMCMP_EQUAL(frame_hello_deflate, frame, length_frame);
+    free (frame);
+    frame = relay_websocket_encode_frame (ws_deflate,
+                                          WEBSOCKET_FRAME_OPCODE_TEXT,
+                                          "", 0, &length_frame);
+    LONGS_EQUAL(sizeof (frame_empty_deflate), length_frame);
+    MEMCMP_EQUAL(frame_empty_deflate, frame, length_frame);
+    free (frame);
+
+    /* control frames are never compressed */
+    frame = relay_websocket_encode_frame (ws_deflate,
+                                          WEBSOCKET_FRAME_OPCODE_PING,
+                                          "ab", 2, &length_frame);
+    LONGS_EQUAL(sizeof (frame_ping), length_frame);
+    MEMCMP_EQUAL(frame_ping, frame, length_frame);
+    free (frame);
+
+    relay_websocket_deflate_free (ws_deflate);
+}
+
+/*
+ * Tests functions:
+ *   relay_websocket_encode_frame
+ *   relay_websocket_decode_frame
+ *
+ * A client is simulated: its frames are compressed with its own deflate
+ * stream and masked, then decoded by the server.
+ */
+
+TEST(RelayWebsocket, EncodeDecodeFrameDeflate)
+{
+    const char *messages[] = {
+        "handshake compression=off",
+        "init password=secret",
+        "(id1) sync",
+        "(id2) input irc.libera.#weechat hello hello hello hello",
+        "(id3) input irc.libera.#weechat hello hello hello hello",
+        "",
+        NULL,
+    };
+    struct t_relay_websocket_deflate *ws_client, *ws_server;
+    char *frame, *big_message;
+    unsigned char *masked, *decoded;
+    unsigned long long length_frame, length_masked, decoded_length;
+    int i, context_takeover;
+
+    for (context_takeover = 1; context_takeover >= 0; context_takeover--)
+    {
+        ws_client = relay_websocket_deflate_alloc ();
+        ws_server = relay_websocket_deflate_alloc ();
+        ws_client->enabled = 1;
+        ws_server->enabled = 1;
+        ws_client->server_context_takeover = context_takeover;
+        ws_server->client_context_takeover = context_takeover;
+
+        for (i = 0; messages[i]; i++)
+        {
+            frame = relay_websocket_encode_frame (ws_client,
+                                                  WEBSOCKET_FRAME_OPCODE_TEXT,
+                                                  messages[i],
+                                                  strlen (messages[i]),
+                                                  &length_frame);
+            CHECK(frame);
+            masked = test_relay_websocket_client_frame (frame, length_frame,
+                                                        &length_masked);
+            LONGS_EQUAL(1, relay_websocket_decode_frame (masked,
+                                                         length_masked,
+                                                         ws_server,
+                                                         &decoded,
+                                                         &decoded_length));
+            LONGS_EQUAL(strlen (messages[i]) + 2, decoded_length);
+            LONGS_EQUAL(RELAY_CLIENT_MSG_STANDARD, decoded[0]);
+            STRCMP_EQUAL(messages[i], (const char *)decoded + 1);
+            free (decoded);
+            free (masked);
+            free (frame);
+        }
+
+        /* big message: decoded data is bigger than the frame received */
+        big_message = (char *)malloc (100000 + 1);
+        memset (big_message, 'a', 100000);
+        big_message[100000] = '\0';
+        frame = relay_websocket_encode_frame (ws_client,
+                                              WEBSOCKET_FRAME_OPCODE_TEXT,
+                                              big_message, 100000,
+                                              &length_frame);
+        CHECK(length_frame < 5000);
+        masked = test_relay_websocket_client_frame (frame, length_frame,
+                                                    &length_masked);
+        LONGS_EQUAL(1, relay_websocket_decode_frame (masked,
+                                                     length_masked,
+                                                     ws_server,
+                                                     &decoded,
+                                                     &decoded_length));
+        LONGS_EQUAL(100000 + 2, decoded_length);
+        STRCMP_EQUAL(big_message, (const char *)decoded + 1);
+        free (decoded);
+        free (masked);
+        free (frame);
+        free (big_message);
+
+        relay_websocket_deflate_free (ws_client);
+        relay_websocket_deflate_free (ws_server);
+    }
+}
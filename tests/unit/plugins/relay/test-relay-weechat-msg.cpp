@@ -0,0 +1,292 @@
+/*
+ * test-relay-weechat-msg.cpp - test binary messages for WeeChat protocol
+ *
+ * Copyright (C) 2023 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <zlib.h>
+#include <zstd.h>
+#include "src/plugins/relay/relay.h"
+#include "src/plugins/relay/relay-client.h"
+#include "src/plugins/relay/weechat/relay-weechat.h"
+#include "src/plugins/relay/weechat/relay-weechat-msg.h"
+}
+
+#define TEST_NUM_MSGS 5
+#define TEST_MSG_MAX_SIZE 65536
+
+TEST_GROUP(RelayWeechatMsg)
+{
+    struct t_relay_client client;
+    struct t_relay_client *ptr_client;
+    int sv[2];
+
+    /*
+     * Initializes a fake connected client using the WeeChat protocol, with
+     * the given compression.
+     */
+
+    void test_client_init (enum t_relay_weechat_compression compression)
+    {
+        LONGS_EQUAL(0, socketpair (AF_UNIX, SOCK_STREAM, 0, sv));
+        fcntl (sv[0], F_SETFL, fcntl (sv[0], F_GETFL) | O_NONBLOCK);
+        fcntl (sv[1], F_SETFL, fcntl (sv[1], F_GETFL) | O_NONBLOCK);
+
+        memset (&client, 0, sizeof (client));
+        ptr_client = &client;
+        client.desc = (char *)"test";
+        client.sock = sv[0];
+        client.status = RELAY_STATUS_CONNECTED;
+        client.protocol = RELAY_PROTOCOL_WEECHAT;
+        client.send_data_type = RELAY_CLIENT_DATA_BINARY;
+        relay_weechat_alloc (ptr_client);
+        CHECK(client.protocol_data);
+        RELAY_WEECHAT_DATA(ptr_client, compression) = compression;
+    }
+
+    /*
+     * Frees the fake client.
+     */
+
+    void test_client_free ()
+    {
+        relay_weechat_free (ptr_client);
+        close (sv[0]);
+        close (sv[1]);
+    }
+
+    /*
+     * Builds a test message: messages with different numbers have a common
+     * content, so that they are compressed against the previous ones with a
+     * stream.
+     */
+
+    struct t_relay_weechat_msg *test_msg_new (int number)
+    {
+        struct t_relay_weechat_msg *msg;
+        char str_value[128];
+        int i;
+
+        msg = relay_weechat_msg_new ("test");
+        CHECK(msg);
+        for (i = 0; i < 20; i++)
+        {
+            snprintf (str_value, sizeof (str_value),
+                      "message %d, the same text in all messages, value %d",
+                      number, i);
+            relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_STRING);
+            relay_weechat_msg_add_string (msg, str_value);
+        }
+        return msg;
+    }
+
+    /*
+     * Sends a message to the client and reads it on the other side of the
+     * socket.
+     *
+     * Returns the number of bytes read.
+     */
+
+    int test_send_and_read (struct t_relay_weechat_msg *msg,
+                            char *buffer, int size)
+    {
+        uint32_t size32;
+        int rc, size_read;
+
+        relay_weechat_msg_send (ptr_client, msg);
+
+        size_read = 0;
+        while (size_read < size)
+        {
+            rc = read (sv[1], buffer + size_read, size - size_read);
+            if (rc <= 0)
+                break;
+            size_read += rc;
+        }
+
+        /* check size in header */
+        CHECK(size_read >= 5);
+        memcpy (&size32, buffer, 4);
+        LONGS_EQUAL(size_read, (int)ntohl (size32));
+
+        return size_read;
+    }
+};
+
+/*
+ * Tests functions:
+ *   relay_weechat_msg_send
+ *   relay_weechat_msg_send_stream
+ *   relay_weechat_msg_compress_zlib_stream
+ *   relay_weechat_msg_free_streams
+ */
+
+TEST(RelayWeechatMsg, SendZlibStream)
+{
+    struct t_relay_weechat_msg *msg;
+    z_stream stream;
+    uLongf dest_size;
+    char *received, *decoded;
+    int i, size_received, size_decoded, size_first;
+
+    test_client_init (RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM);
+    received = (char *)malloc (TEST_MSG_MAX_SIZE);
+    CHECK(received);
+    decoded = (char *)malloc (TEST_MSG_MAX_SIZE);
+    CHECK(decoded);
+
+    /* single inflate stream used for all messages received */
+    memset (&stream, 0, sizeof (stream));
+    LONGS_EQUAL(Z_OK, inflateInit (&stream));
+
+    size_first = 0;
+    for (i = 0; i < TEST_NUM_MSGS; i++)
+    {
+        msg = test_msg_new (i);
+        size_received = test_send_and_read (msg, received, TEST_MSG_MAX_SIZE);
+        LONGS_EQUAL(RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM, received[4]);
+        CHECK(RELAY_WEECHAT_DATA(ptr_client, zlib_stream));
+
+        /* message is flushed: it can be decompressed immediately */
+        stream.next_in = (Bytef *)(received + 5);
+        stream.avail_in = size_received - 5;
+        stream.next_out = (Bytef *)decoded;
+        stream.avail_out = TEST_MSG_MAX_SIZE;
+        LONGS_EQUAL(Z_OK, inflate (&stream, Z_SYNC_FLUSH));
+        LONGS_EQUAL(0, stream.avail_in);
+        size_decoded = TEST_MSG_MAX_SIZE - stream.avail_out;
+        LONGS_EQUAL(msg->data_size - 5, size_decoded);
+        MEMCMP_EQUAL(msg->data + 5, decoded, size_decoded);
+
+        /* next messages are smaller thanks to the dictionary */
+        if (i == 0)
+            size_first = size_received;
+        else
+            CHECK(size_received < size_first);
+
+        relay_weechat_msg_free (msg);
+    }
+
+    inflateEnd (&stream);
+
+    /* error in stream: fallback to zlib compression without stream */
+    deflateEnd ((z_stream *)RELAY_WEECHAT_DATA(ptr_client, zlib_stream));
+    msg = test_msg_new (0);
+    size_received = test_send_and_read (msg, received, TEST_MSG_MAX_SIZE);
+    LONGS_EQUAL(RELAY_WEECHAT_COMPRESSION_OFF, received[4]);
+    LONGS_EQUAL(msg->data_size, size_received);
+    MEMCMP_EQUAL(msg->data + 5, received + 5, size_received - 5);
+    LONGS_EQUAL(RELAY_WEECHAT_COMPRESSION_ZLIB,
+                RELAY_WEECHAT_DATA(ptr_client, compression));
+    POINTERS_EQUAL(NULL, RELAY_WEECHAT_DATA(ptr_client, zlib_stream));
+    relay_weechat_msg_free (msg);
+
+    /* next message is compressed with zlib (one-shot) */
+    msg = test_msg_new (1);
+    size_received = test_send_and_read (msg, received, TEST_MSG_MAX_SIZE);
+    LONGS_EQUAL(RELAY_WEECHAT_COMPRESSION_ZLIB, received[4]);
+    dest_size = TEST_MSG_MAX_SIZE;
+    LONGS_EQUAL(Z_OK, uncompress ((Bytef *)decoded, &dest_size,
+                                  (Bytef *)(received + 5),
+                                  size_received - 5));
+    LONGS_EQUAL(msg->data_size - 5, (int)dest_size);
+    MEMCMP_EQUAL(msg->data + 5, decoded, dest_size);
+    relay_weechat_msg_free (msg);
+
+    test_client_free ();
+    free (received);
+    free (decoded);
+}
+
+/*
+ * Tests functions:
+ *   relay_weechat_msg_send
+ *   relay_weechat_msg_send_stream
+ *   relay_weechat_msg_compress_zstd_stream
+ *   relay_weechat_msg_free_streams
+ */
+
+TEST(RelayWeechatMsg, SendZstdStream)
+{
+    struct t_relay_weechat_msg *msg;
+    ZSTD_DStream *stream;
+    ZSTD_inBuffer buffer_in;
+    ZSTD_outBuffer buffer_out;
+    char *received, *decoded;
+    int i, size_received, size_first;
+
+    test_client_init (RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM);
+    received = (char *)malloc (TEST_MSG_MAX_SIZE);
+    CHECK(received);
+    decoded = (char *)malloc (TEST_MSG_MAX_SIZE);
+    CHECK(decoded);
+
+    /* single zstd stream used for all messages received */
+    stream = ZSTD_createDStream ();
+    CHECK(stream);
+    CHECK(!ZSTD_isError (ZSTD_initDStream (stream)));
+
+    size_first = 0;
+    for (i = 0; i < TEST_NUM_MSGS; i++)
+    {
+        msg = test_msg_new (i);
+        size_received = test_send_and_read (msg, received, TEST_MSG_MAX_SIZE);
+        LONGS_EQUAL(RELAY_WEECHAT_COMPRESSION_ZSTD_STREAM, received[4]);
+        CHECK(RELAY_WEECHAT_DATA(ptr_client, zstd_stream));
+
+        /* message is flushed: it can be decompressed immediately */
+        buffer_in.src = received + 5;
+        buffer_in.size = size_received - 5;
+        buffer_in.pos = 0;
+        buffer_out.dst = decoded;
+        buffer_out.size = TEST_MSG_MAX_SIZE;
+        buffer_out.pos = 0;
+        while (buffer_in.pos < buffer_in.size)
+        {
+            CHECK(!ZSTD_isError (ZSTD_decompressStream (stream, &buffer_out,
+                                                        &buffer_in)));
+        }
+        LONGS_EQUAL(msg->data_size - 5, (int)buffer_out.pos);
+        MEMCMP_EQUAL(msg->data + 5, decoded, buffer_out.pos);
+
+        /* next messages are smaller thanks to the dictionary */
+        if (i == 0)
+            size_first = size_received;
+        else
+            CHECK(size_received < size_first);
+
+        relay_weechat_msg_free (msg);
+    }
+
+    ZSTD_freeDStream (stream);
+
+    test_client_free ();
+    free (received);
+    free (decoded);
+}
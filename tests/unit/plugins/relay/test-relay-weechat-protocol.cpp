@@ -0,0 +1,351 @@
+/*
+ * test-relay-weechat-protocol.cpp - test WeeChat protocol for relay to client
+ *
+ * Copyright (C) 2023 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "CppUTest/TestHarness.h"
+
+extern "C"
+{
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <zlib.h>
+#include "src/core/wee-hashtable.h"
+#include "src/gui/gui-buffer.h"
+#include "src/gui/gui-chat.h"
+#include "src/plugins/relay/relay.h"
+#include "src/plugins/relay/relay-client.h"
+#include "src/plugins/relay/weechat/relay-weechat.h"
+#include "src/plugins/relay/weechat/relay-weechat-msg.h"
+#include "src/plugins/relay/weechat/relay-weechat-protocol.h"
+}
+
+#define TEST_NUM_CLIENTS 4
+#define TEST_MSG_MAX_SIZE 65536
+
+TEST_GROUP(RelayWeechatProtocol)
+{
+    struct t_relay_client clients[TEST_NUM_CLIENTS];
+    struct t_relay_client *ptr_clients[TEST_NUM_CLIENTS];
+    int sockets[TEST_NUM_CLIENTS][2];
+
+    void setup ()
+    {
+        int i;
+
+        for (i = 0; i < TEST_NUM_CLIENTS; i++)
+        {
+            ptr_clients[i] = &clients[i];
+        }
+    }
+
+    /*
+     * Initializes a fake connected client using the WeeChat protocol.
+     */
+
+    void test_client_init (struct t_relay_client *client, int sv[2])
+    {
+        LONGS_EQUAL(0, socketpair (AF_UNIX, SOCK_STREAM, 0, sv));
+        fcntl (sv[0], F_SETFL, fcntl (sv[0], F_GETFL) | O_NONBLOCK);
+        fcntl (sv[1], F_SETFL, fcntl (sv[1], F_GETFL) | O_NONBLOCK);
+
+        memset (client, 0, sizeof (*client));
+        client->desc = (char *)"test";
+        client->sock = sv[0];
+        client->status = RELAY_STATUS_CONNECTED;
+        client->protocol = RELAY_PROTOCOL_WEECHAT;
+        client->send_data_type = RELAY_CLIENT_DATA_BINARY;
+        relay_weechat_alloc (client);
+        CHECK(client->protocol_data);
+        RELAY_WEECHAT_DATA(client, handshake_done) = 1;
+        RELAY_WEECHAT_DATA(client, password_ok) = 1;
+        RELAY_WEECHAT_DATA(client, totp_ok) = 1;
+    }
+
+    /*
+     * Synchronizes client with all buffers.
+     */
+
+    void test_client_sync (struct t_relay_client *client)
+    {
+        int flags;
+
+        flags = RELAY_WEECHAT_PROTOCOL_SYNC_ALL;
+        hashtable_set (RELAY_WEECHAT_DATA(client, buffers_sync),
+                       "*", &flags);
+    }
+
+    /*
+     * Reads all data available on a socket.
+     *
+     * Returns the number of bytes read.
+     */
+
+    int test_read_socket (int sock, char *buffer, int size)
+    {
+        int rc, size_read;
+
+        size_read = 0;
+        while (size_read < size)
+        {
+            rc = read (sock, buffer + size_read, size - size_read);
+            if (rc <= 0)
+                break;
+            size_read += rc;
+        }
+        return size_read;
+    }
+
+    /*
+     * Decodes a binary message received (uncompressed or compressed with
+     * zlib): the message without size and compression flag is stored in
+     * "decoded".
+     *
+     * Returns the size of decoded message, -1 if error.
+     */
+
+    int test_decode_msg (const char *msg, int size, char *decoded,
+                         int decoded_size)
+    {
+        uint32_t size32;
+        uLongf dest_size;
+
+        if (size < 5)
+            return -1;
+
+        memcpy (&size32, msg, 4);
+        if ((int)ntohl (size32) != size)
+            return -1;
+
+        switch (msg[4])
+        {
+            case RELAY_WEECHAT_COMPRESSION_OFF:
+                if (size - 5 > decoded_size)
+                    return -1;
+                memcpy (decoded, msg + 5, size - 5);
+                return size - 5;
+            case RELAY_WEECHAT_COMPRESSION_ZLIB:
+                dest_size = decoded_size;
+                if (uncompress ((Bytef *)decoded, &dest_size,
+                                (Bytef *)(msg + 5), size - 5) != Z_OK)
+                {
+                    return -1;
+                }
+                return (int)dest_size;
+        }
+        return -1;
+    }
+};
+
+/*
+ * Tests functions:
+ *   relay_weechat_hook_signals
+ *   relay_weechat_unhook_signals
+ *   relay_weechat_protocol_signal_buffer_cb
+ *   relay_weechat_msg_send
+ */
+
+TEST(RelayWeechatProtocol, SignalBufferSeveralClients)
+{
+    struct t_relay_client *old_relay_clients, *old_last_relay_client;
+    char *received[TEST_NUM_CLIENTS], *decoded[2], message[2048];
+    int i, size_received[TEST_NUM_CLIENTS], size_decoded[2];
+    int old_num_clients_signals;
+
+    old_relay_clients = relay_clients;
+    old_last_relay_client = last_relay_client;
+    old_num_clients_signals = relay_weechat_num_clients_signals;
+
+    /*
+     * clients:
+     *   0: synchronized, no compression
+     *   1: synchronized, zlib compression
+     *   2: synchronized, zlib compression
+     *   3: not synchronized
+     */
+    relay_clients = NULL;
+    last_relay_client = NULL;
+    for (i = 0; i < TEST_NUM_CLIENTS; i++)
+    {
+        test_client_init (&clients[i], sockets[i]);
+        clients[i].prev_client = last_relay_client;
+        if (last_relay_client)
+            last_relay_client->next_client = &clients[i];
+        else
+            relay_clients = &clients[i];
+        last_relay_client = &clients[i];
+        received[i] = (char *)malloc (TEST_MSG_MAX_SIZE);
+        CHECK(received[i]);
+    }
+    test_client_sync (&clients[0]);
+    test_client_sync (&clients[1]);
+    test_client_sync (&clients[2]);
+    RELAY_WEECHAT_DATA(ptr_clients[1], compression) = RELAY_WEECHAT_COMPRESSION_ZLIB;
+    RELAY_WEECHAT_DATA(ptr_clients[2], compression) = RELAY_WEECHAT_COMPRESSION_ZLIB;
+
+    /* signals are hooked only once for all clients */
+    LONGS_EQUAL(old_num_clients_signals + TEST_NUM_CLIENTS,
+                relay_weechat_num_clients_signals);
+    CHECK(relay_weechat_hook_signal_buffer);
+    CHECK(relay_weechat_hook_hsignal_nicklist);
+    CHECK(relay_weechat_hook_signal_upgrade);
+
+    /* print a line (long enough to be compressed with zlib) */
+    for (i = 0; i < (int)sizeof (message) - 1; i++)
+    {
+        message[i] = 'a' + (i % 26);
+    }
+    message[sizeof (message) - 1] = '\0';
+    gui_chat_printf (NULL, "%s", message);
+
+    for (i = 0; i < TEST_NUM_CLIENTS; i++)
+    {
+        size_received[i] = test_read_socket (sockets[i][1], received[i],
+                                             TEST_MSG_MAX_SIZE);
+    }
+
+    /* client not synchronized: nothing received */
+    LONGS_EQUAL(0, size_received[3]);
+
+    /* plain client: uncompressed message */
+    CHECK(size_received[0] > (int)sizeof (message));
+    LONGS_EQUAL(RELAY_WEECHAT_COMPRESSION_OFF, received[0][4]);
+
+    /* zlib clients: same compressed message, smaller than uncompressed one */
+    CHECK(size_received[1] > 5);
+    CHECK(size_received[1] < size_received[0]);
+    LONGS_EQUAL(RELAY_WEECHAT_COMPRESSION_ZLIB, received[1][4]);
+    LONGS_EQUAL(size_received[1], size_received[2]);
+    MEMCMP_EQUAL(received[1], received[2], size_received[1]);
+    LONGS_EQUAL(size_received[0],
+                RELAY_WEECHAT_DATA(ptr_clients[1], compression_bytes_in));
+    LONGS_EQUAL(size_received[1],
+                RELAY_WEECHAT_DATA(ptr_clients[1], compression_bytes_out));
+
+    /* same message decoded for plain and zlib clients */
+    for (i = 0; i < 2; i++)
+    {
+        decoded[i] = (char *)malloc (TEST_MSG_MAX_SIZE);
+        CHECK(decoded[i]);
+        size_decoded[i] = test_decode_msg (received[i], size_received[i],
+                                           decoded[i], TEST_MSG_MAX_SIZE);
+    }
+    CHECK(size_decoded[0] > 0);
+    LONGS_EQUAL(size_decoded[0], size_decoded[1]);
+    MEMCMP_EQUAL(decoded[0], decoded[1], size_decoded[0]);
+    /* message id is "_buffer_line_added" */
+    MEMCMP_EQUAL("\x00\x00\x00\x12_buffer_line_added", decoded[0], 22);
+
+    /* remove clients: hooks are removed with the last client */
+    for (i = 0; i < TEST_NUM_CLIENTS; i++)
+    {
+        CHECK(relay_weechat_hook_signal_buffer);
+        relay_weechat_free (&clients[i]);
+        LONGS_EQUAL(old_num_clients_signals + TEST_NUM_CLIENTS - i - 1,
+                    relay_weechat_num_clients_signals);
+    }
+    if (old_num_clients_signals == 0)
+    {
+        POINTERS_EQUAL(NULL, relay_weechat_hook_signal_buffer);
+        POINTERS_EQUAL(NULL, relay_weechat_hook_hsignal_nicklist);
+        POINTERS_EQUAL(NULL, relay_weechat_hook_signal_upgrade);
+    }
+
+    relay_clients = old_relay_clients;
+    last_relay_client = old_last_relay_client;
+
+    for (i = 0; i < TEST_NUM_CLIENTS; i++)
+    {
+        close (sockets[i][0]);
+        close (sockets[i][1]);
+        free (received[i]);
+    }
+    free (decoded[0]);
+    free (decoded[1]);
+}
+
+/*
+ * Tests functions:
+ *   relay_weechat_msg_send (message compressed only once)
+ */
+
+TEST(RelayWeechatProtocol, MsgSendCompressedOnce)
+{
+    struct t_relay_weechat_msg *msg;
+    char *received[2], *ptr_compressed, str_value[64];
+    int i, size_received[2], old_num_clients_signals;
+
+    old_num_clients_signals = relay_weechat_num_clients_signals;
+
+    for (i = 0; i < 2; i++)
+    {
+        test_client_init (&clients[i], sockets[i]);
+        RELAY_WEECHAT_DATA(ptr_clients[i], compression) = RELAY_WEECHAT_COMPRESSION_ZLIB;
+        received[i] = (char *)malloc (TEST_MSG_MAX_SIZE);
+        CHECK(received[i]);
+    }
+
+    msg = relay_weechat_msg_new ("test");
+    CHECK(msg);
+    for (i = 0; i < 200; i++)
+    {
+        snprintf (str_value, sizeof (str_value), "value %d", i % 10);
+        relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_STRING);
+        relay_weechat_msg_add_string (msg, str_value);
+    }
+    LONGS_EQUAL(0, msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZLIB]);
+
+    /* first client: message is compressed */
+    relay_weechat_msg_send (&clients[0], msg);
+    ptr_compressed = msg->compressed_data[RELAY_WEECHAT_COMPRESSION_ZLIB];
+    CHECK(ptr_compressed);
+    CHECK(msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZLIB] > 0);
+    CHECK(msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZLIB] < msg->data_size);
+
+    /* second client: compressed data is reused */
+    relay_weechat_msg_send (&clients[1], msg);
+    POINTERS_EQUAL(ptr_compressed,
+                   msg->compressed_data[RELAY_WEECHAT_COMPRESSION_ZLIB]);
+
+    for (i = 0; i < 2; i++)
+    {
+        size_received[i] = test_read_socket (sockets[i][1], received[i],
+                                             TEST_MSG_MAX_SIZE);
+        LONGS_EQUAL(msg->compressed_size[RELAY_WEECHAT_COMPRESSION_ZLIB],
+                    size_received[i]);
+        MEMCMP_EQUAL(ptr_compressed, received[i], size_received[i]);
+    }
+
+    relay_weechat_msg_free (msg);
+
+    for (i = 0; i < 2; i++)
+    {
+        relay_weechat_free (&clients[i]);
+        close (sockets[i][0]);
+        close (sockets[i][1]);
+        free (received[i]);
+    }
+
+    LONGS_EQUAL(old_num_clients_signals, relay_weechat_num_clients_signals);
+}